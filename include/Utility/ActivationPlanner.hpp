@@ -0,0 +1,35 @@
+/*ActivationPlanner.hpp*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Utility/ModelAnalyzer.hpp"
+
+struct PlannedBuffer
+{
+    std::string name;
+    std::string elementType;
+    std::vector<long> shape;
+    size_t bytes = 0;
+    size_t firstLayer = 0;
+    size_t lastLayer = 0;
+    size_t offset = 0;
+};
+
+class ActivationPlanner
+{
+public:
+    static constexpr size_t alignment = 16;
+    static constexpr const char *arenaName = "model_arena";
+
+    // Places every activation buffer at an aligned offset of one arena so that buffers whose
+    // lifetimes (first write to last read, in call order) overlap never share bytes.
+    static bool plan(const ModelProfile &profile, std::vector<PlannedBuffer> &buffers, size_t &arenaBytes);
+
+    // Rewrites the staged model to use the arena; kept only if the outputs stay bit-exact on the host.
+    static bool apply(const std::string &stagedModelFolder, std::string &report);
+
+private:
+    static std::string bufferView(const PlannedBuffer &buffer);
+};
@@ -0,0 +1,65 @@
+/*BenchmarkManager.hpp*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <ostream>
+#include "Utility/ModelAnalyzer.hpp"
+
+struct BenchmarkVariant
+{
+    std::string label;
+    std::string modelFolder;
+    std::string optimization;
+};
+
+struct BenchmarkResult
+{
+    std::string label;
+    bool success = false;
+    std::string error;
+    unsigned long iterations = 0;
+    double minUs = 0.0;
+    double meanUs = 0.0;
+    double p50Us = 0.0;
+    double p90Us = 0.0;
+    double p99Us = 0.0;
+    double maxUs = 0.0;
+    double inferencesPerSecond = 0.0;
+    unsigned long allocations = 0;
+    unsigned long allocatedBytes = 0;
+};
+
+class BenchmarkManager
+{
+public:
+    static BenchmarkResult runBenchmark(const BenchmarkVariant &variant,
+                                        unsigned long iterations,
+                                        const std::atomic<bool> &cancelFlag);
+
+    static std::string formatResults(const std::vector<BenchmarkResult> &results);
+
+    static bool generateHarness(const ModelProfile &profile, const std::string &harnessPath);
+    static bool generateOutputHarness(const ModelProfile &profile, const std::string &harnessPath);
+    static bool collectOutputs(const ModelProfile &profile,
+                               const std::string &modelFolder,
+                               const std::string &flags,
+                               const std::string &workDirectory,
+                               unsigned long inputSets,
+                               std::vector<std::string> &outputs,
+                               std::string &error,
+                               const std::string &inputFile = "");
+    static bool parseOutputLine(const std::string &line, std::vector<double> &values);
+    static bool compileForHost(const std::string &modelFolder,
+                               const std::vector<std::string> &extraSources,
+                               const std::string &flags,
+                               const std::string &outputBinary,
+                               std::string &compilerOutput);
+
+private:
+    static int runCommand(const std::string &command, std::string &output);
+    static std::string prototypeFor(const ModelProfile &profile);
+    static void writeHarnessPrelude(std::ostream &out, const ModelProfile &profile, const std::string &purpose);
+};
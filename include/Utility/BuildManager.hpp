@@ -0,0 +1,48 @@
+/*BuildManager.hpp*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <utility>
+
+struct BuildResult
+{
+    std::string version;
+    bool success = false;
+    double seconds = 0.0;
+    std::vector<std::pair<std::string, long>> fileCompileTimesMs;
+};
+
+class BuildManager
+{
+public:
+    static std::vector<BuildResult> buildVersionsOnRedPitaya(const std::string &hostname,
+                                                             const std::string &password,
+                                                             const std::string &privateKeyPath,
+                                                             const std::string &targetDirectory,
+                                                             const std::vector<std::string> &versions,
+                                                             const std::function<void(const std::string &)> &onOutput,
+                                                             const std::atomic<bool> &cancelExportFlag);
+
+    static BuildResult buildOnRedPitaya(const std::string &hostname,
+                                        const std::string &password,
+                                        const std::string &privateKeyPath,
+                                        const std::string &remoteVersionDir,
+                                        const std::string &version,
+                                        int jobs,
+                                        const std::function<void(const std::string &)> &onOutput,
+                                        const std::atomic<bool> &cancelExportFlag);
+
+private:
+    static bool readRemoteResources(const std::string &hostname,
+                                    const std::string &password,
+                                    const std::string &privateKeyPath,
+                                    long &availableMB,
+                                    int &cores);
+    static bool installTimingShell(const std::string &hostname,
+                                   const std::string &password,
+                                   const std::string &privateKeyPath);
+};
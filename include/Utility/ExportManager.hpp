@@ -11,6 +11,30 @@
 #include <atomic>
 #include <cstdlib>
 #include <iostream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct ExportOptions
+{
+    bool generateNeonKernels = false;
+    int quantizationBits = 0;
+    std::string calibrationFile;
+    bool externalizeWeights = false;
+    bool planActivations = false;
+    bool injectLayerProbes = false;
+    std::function<void(const std::string &)> log;
+};
+
+// What the last successful export to the board used, so it can be repeated when the model changes.
+struct RemoteExportRecord
+{
+    std::vector<std::string> versions;
+    std::string targetDirectory;
+    ExportOptions options;
+    bool buildOnTarget = false;
+};
 
 class ExportManager
 {
@@ -22,7 +46,8 @@ public:
     static bool exportLocally(const std::string &modelFolder,
                               const std::string &version,
                               const std::string &targetFolder,
-                              const std::atomic<bool> &cancelExportFlag);
+                              const std::atomic<bool> &cancelExportFlag,
+                              const ExportOptions &options = ExportOptions());
 
     static bool exportSingleVersionToRedPitaya(const std::string &modelFolder,
                                                const std::string &version,
@@ -30,8 +55,30 @@ public:
                                                const std::string &password,
                                                const std::string &privateKeyPath,
                                                const std::string &targetDirectory,
-                                               const std::atomic<bool> &cancelExportFlag);
+                                               const std::atomic<bool> &cancelExportFlag,
+                                               const ExportOptions &options = ExportOptions());
+
+    static constexpr const char *manifestName = ".rp_manifest";
+
+    static void rememberRemoteExport(const RemoteExportRecord &record);
+    static bool lastRemoteExport(RemoteExportRecord &record);
 
 private:
     static void removeStaticFromModelC(const std::string &versionPath);
+    // Copies rp_stats.h into the version's sources; false (and logged) when it cannot be found or copied.
+    static bool addStatsHeader(const std::string &versionPath, const ExportOptions &options);
+    static void addInferenceStats(const std::string &stagedModelFolder);
+    static void applyModelTransforms(const std::string &stagedModelFolder, const ExportOptions &options);
+
+    // Copies the model into stagedModelFolder with the selected transforms applied, reusing the cached
+    // result of an earlier export when the model fingerprint and the options are unchanged.
+    static bool stageModel(const std::string &modelFolder, const std::string &stagedModelFolder,
+                           const ExportOptions &options, const std::atomic<bool> &cancelExportFlag);
+    static std::string remoteHead(const std::string &url);
+
+    static std::mutex lastRemoteExportMutex;
+    static std::unique_ptr<RemoteExportRecord> lastRemoteExportRecord;
+    static bool uploadChangedFiles(const std::string &hostname, const std::string &password, const std::string &privateKeyPath,
+                                   const std::string &remoteVersionDir, const std::string &modelDir, const std::string &codeDir,
+                                   const std::string &manifestDir, const ExportOptions &options);
 };
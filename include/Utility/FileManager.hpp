@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <map>
 #include <string>
 #include <filesystem>
 
@@ -9,4 +11,43 @@ class FileManager
 {
 public:
     static bool isValidQualiaModel(const std::string& folderPath);
-};
\ No newline at end of file
+
+    // XXH64 of every regular file under folderPath (hashed in parallel over mmapped files), folded
+    // with the relative paths into one fingerprint. Files whose size and mtime match the cache in
+    // cacheDirectory() are not read again. fileHashes, if given, receives the per-file hashes.
+    static uint64_t fingerprintFolder(const std::string& folderPath, std::map<std::string, uint64_t>* fileHashes = nullptr);
+    static uint64_t fingerprintFile(const std::string& filePath);
+
+    static uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+    static std::string toHex(uint64_t value);
+
+    // $XDG_CACHE_HOME/redpitaya_toolbox, or ~/.cache/redpitaya_toolbox.
+    static std::string cacheDirectory();
+    static bool readCachedText(const std::string& category, const std::string& key, std::string& text);
+    static void writeCachedText(const std::string& category, const std::string& key, const std::string& text);
+
+    // Whole file as bytes ("" when it cannot be read) and its replacement; writeText is false on failure.
+    static std::string readText(const std::filesystem::path& path);
+    static bool writeText(const std::filesystem::path& path, const std::string& text);
+    // text with everything but letters and digits replaced by '_', to name work directories after a path.
+    static std::string sanitizedName(const std::string& text);
+
+    // A fresh directory in the temporary directory (mkdtemp), so concurrent runs on the same model do not
+    // share files; removed with everything in it when it goes out of scope.
+    struct ScratchDirectory
+    {
+        std::filesystem::path path;
+
+        ScratchDirectory() = default;
+        ScratchDirectory(const ScratchDirectory&) = delete;
+        ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+        ~ScratchDirectory();
+
+        bool create(const std::string& prefix, std::string& error);
+    };
+
+private:
+    static uint64_t hashFile(const std::filesystem::path& path);
+    static void loadHashCache();
+    static void saveHashCache();
+};
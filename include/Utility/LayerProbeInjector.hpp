@@ -0,0 +1,38 @@
+/*LayerProbeInjector.hpp*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Utility/ModelAnalyzer.hpp"
+
+struct LayerTiming
+{
+    std::string name;
+    size_t samples = 0;
+    double meanUs = 0.0;
+    double p50Us = 0.0;
+    double p99Us = 0.0;
+    double maxUs = 0.0;
+    double share = 0.0;
+};
+
+class LayerProbeInjector
+{
+public:
+    static constexpr const char *headerName = "layer_probes.h";
+    static constexpr const char *remoteRingPath = "/dev/shm/rp_layer_probes";
+    static constexpr unsigned ringSlots = 16;
+    static constexpr unsigned ringRecords = 2048;
+
+    // Adds a CLOCK_MONOTONIC_RAW timestamp after every layer call of the staged model. Each thread claims
+    // a slot of a shared ring file (remoteRingPath, or $RP_PROBE_PATH) and appends (layer, ns) records to it.
+    static bool apply(const std::string &stagedModelFolder, std::string &report);
+
+    // Decodes a ring file copied from the board into per-layer statistics (all slots merged).
+    static bool summarize(const std::string &ring, std::vector<LayerTiming> &timings, size_t &threads, std::string &error);
+    static std::string formatTimings(const std::vector<LayerTiming> &timings, size_t threads);
+
+private:
+    static std::string generateHeader(const std::vector<std::string> &layerNames);
+};
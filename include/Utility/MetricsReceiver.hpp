@@ -0,0 +1,134 @@
+/*MetricsReceiver.hpp*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Utility/SpscRing.hpp"
+#include "Utility/TelemetryDecoder.hpp"
+
+// What the native metrics plot shows. Network and disk traffic are summed over interfaces and disks.
+enum class Metric
+{
+    Cpu,
+    Cpu0,
+    Cpu1,
+    Ram,
+    Temp,
+    Freq0,
+    Freq1,
+    NetRx,
+    NetTx,
+    DiskRead,
+    DiskWrite,
+    Count
+};
+
+struct MetricPoint
+{
+    double time = 0.0; // seconds since the receiver started, from the board clock
+    float value = 0.0f;
+};
+
+// Receives the streams of any number of boards (each monitor_sender connects to us) in one epoll-driven
+// thread. A board is known by the name in its HELLO, else by its address, so a board that reconnects,
+// even over a connection not yet seen closed, keeps its sequence tracking, time base and rings. Each
+// board's metrics reach the GUI thread through their own SPSC rings, so neither side ever takes a lock.
+class MetricsReceiver
+{
+public:
+    static constexpr size_t metricCount = size_t(Metric::Count);
+    static constexpr size_t ringPoints = 2048;
+    static constexpr size_t maxBoards = 128;
+    static constexpr size_t detailSamples = 8;
+    // Board seconds between the samples handed over for the details view.
+    static constexpr double detailPeriod = 0.25;
+
+    MetricsReceiver() = default;
+    ~MetricsReceiver();
+
+    MetricsReceiver(const MetricsReceiver &) = delete;
+    MetricsReceiver &operator=(const MetricsReceiver &) = delete;
+
+    bool start(uint16_t port, std::string &error);
+    void stop();
+    bool running() const { return active.load(); }
+
+    // Consumer side, one thread only. Boards are never removed, so indices below boardCount() stay valid.
+    size_t boardCount() const { return publishedBoards.load(std::memory_order_acquire); }
+    const std::string &boardName(size_t board) const { return boards[board]->name; }
+    bool pop(size_t board, Metric metric, MetricPoint &point) { return boards[board]->rings[size_t(metric)].pop(point); }
+    // The TelemetryDecoder::isDetailField fields of a recent sample, at most one per detailPeriod.
+    bool popDetails(size_t board, TelemetrySample &sample) { return boards[board]->details.pop(sample); }
+
+    bool connected(size_t board) const { return boards[board]->connected.load(); }
+    uint32_t intervalUs(size_t board) const { return boards[board]->interval.load(); }
+    uint32_t missedDeadlines(size_t board) const { return boards[board]->missed.load(); }
+    uint64_t lostSamples(size_t board) const { return boards[board]->lost.load(); }
+    // Points dropped because the consumer stopped draining the board's rings.
+    uint64_t overruns(size_t board) const { return boards[board]->overrun.load(); }
+
+    static const char *metricLabel(Metric metric);
+
+private:
+    struct Connection;
+
+    struct Board
+    {
+        std::string name;
+        std::atomic<bool> connected{false};
+        std::atomic<uint32_t> interval{0};
+        std::atomic<uint32_t> missed{0};
+        std::atomic<uint64_t> lost{0};
+        std::atomic<uint64_t> overrun{0};
+
+        // Receiver thread only.
+        Connection *connection = nullptr;
+        TelemetryDecoder sequences; // gaps across this board's connections
+        double elapsed = 0.0;
+        double origin = 0.0;
+        bool originKnown = false;
+
+        std::array<SpscRing<MetricPoint, ringPoints>, metricCount> rings;
+        SpscRing<TelemetrySample, detailSamples> details;
+        double detailsAt = 0.0;
+        bool detailsSent = false;
+    };
+
+    struct Connection
+    {
+        int fd = -1;
+        std::string address;
+        TelemetryDecoder decoder;
+        Board *board = nullptr;
+    };
+
+    void run();
+    void accept();
+    void closeConnection(Connection *connection);
+    void receive(Connection *connection);
+    Board *attach(Connection *connection, const TelemetryFrame &frame);
+    void publish(Board &board, const TelemetrySample &sample, bool binary);
+    double secondsSinceStart() const;
+
+    int listenFd = -1;
+    int epollFd = -1;
+    int stopFd = -1;
+    std::atomic<bool> active{false};
+    uint64_t startNs = 0;
+
+    // Receiver thread only, apart from boards[i] for i < publishedBoards.
+    std::vector<std::unique_ptr<Connection>> connections;
+    std::array<std::unique_ptr<Board>, maxBoards> boards;
+    size_t boardTotal = 0;
+    std::atomic<size_t> publishedBoards{0};
+    std::vector<uint8_t> buffer;
+    std::vector<TelemetryFrame> frames;
+    std::thread worker;
+};
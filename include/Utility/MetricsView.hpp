@@ -0,0 +1,64 @@
+/*MetricsView.hpp*/
+
+#pragma once
+
+#include <gtkmm/drawingarea.h>
+#include <array>
+#include <deque>
+#include <vector>
+#include "Utility/MetricsReceiver.hpp"
+
+// Rolling plots of the receiver's metrics (CPU, RAM, temperature, frequency, I/O), drawn with Cairo.
+// Up to 60 times a second it drains the rings of every board and invalidates only the panels that got
+// new points from the boards shown: one board, or all of them overlaid.
+class MetricsView : public Gtk::DrawingArea
+{
+public:
+    explicit MetricsView(MetricsReceiver &receiver);
+    ~MetricsView() override;
+
+    // Clears the plots; time restarts at 0.
+    void reset();
+    // Index of the board to plot, or allBoards to overlay every board.
+    void setBoard(int board);
+
+    static constexpr int allBoards = -1;
+    static constexpr unsigned frameMs = 16;
+    static constexpr size_t historyPoints = 2000;
+
+protected:
+    bool on_draw(const Cairo::RefPtr<Cairo::Context> &cr) override;
+
+private:
+    struct Series
+    {
+        Metric metric;
+        double red, green, blue;
+    };
+
+    struct Panel
+    {
+        const char *title;
+        std::vector<Series> series;
+        double fixedMax;  // > 0: the range is [0, fixedMax]
+        bool fromZero;    // else padded around the values by at least minPad
+        double minPad;
+    };
+
+    using History = std::array<std::deque<MetricPoint>, MetricsReceiver::metricCount>;
+
+    bool onFrame();
+    bool shown(size_t board) const { return selected == allBoards || size_t(selected) == board; }
+    Gdk::Rectangle panelArea(size_t index) const;
+    void drawPanel(const Cairo::RefPtr<Cairo::Context> &cr, size_t index, const Gdk::Rectangle &area) const;
+    void drawSeries(const Cairo::RefPtr<Cairo::Context> &cr, const std::deque<MetricPoint> &points, double left, double right,
+                    double top, double bottom, double tMin, double tMax, double vMin, double vMax) const;
+
+    MetricsReceiver &receiver;
+    std::vector<Panel> panels;
+    std::vector<History> history; // per board
+    int selected = allBoards;
+    double latestTime = 0.0;
+    double timeOrigin = 0.0;
+    sigc::connection frameTimer;
+};
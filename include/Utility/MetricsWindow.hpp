@@ -0,0 +1,51 @@
+/*MetricsWindow.hpp*/
+
+#pragma once
+
+#include <gtkmm/box.h>
+#include <gtkmm/button.h>
+#include <gtkmm/comboboxtext.h>
+#include <gtkmm/label.h>
+#include <gtkmm/paned.h>
+#include <gtkmm/scrolledwindow.h>
+#include <gtkmm/textview.h>
+#include <gtkmm/window.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Utility/MetricsReceiver.hpp"
+#include "Utility/MetricsView.hpp"
+
+// Live board metrics inside gen_app: the receiver listening for any number of monitor_sender and
+// their plots, of one board or of all of them overlaid, above tables of the fields the plots do not
+// show (tracked process and threads, pipeline stages, hardware counters, interfaces, disks, XADC).
+class MetricsWindow : public Gtk::Window
+{
+public:
+    MetricsWindow();
+    ~MetricsWindow() override;
+
+    bool start(uint16_t port, std::string &error);
+    void stop();
+
+private:
+    bool updateStatus();
+    void updateDetails();
+    void onBoardChanged();
+
+    MetricsReceiver receiver;
+    Gtk::Box box;
+    Gtk::Box topRow;
+    Gtk::Button buttonReset;
+    Gtk::ComboBoxText comboBoard;
+    Gtk::Label labelStatus;
+    Gtk::Paned panes;
+    MetricsView view;
+    Gtk::ScrolledWindow detailsScroll;
+    Gtk::TextView detailsView;
+    std::vector<TelemetrySample> details; // latest per board
+    std::string detailsText;
+    uint16_t port = 0;
+    size_t listedBoards = 0;
+    sigc::connection statusTimer;
+};
@@ -0,0 +1,116 @@
+/*ModelAnalyzer.hpp*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstddef>
+
+// Byte range inside one of the model source files.
+struct SourceSpan
+{
+    std::string file;
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+struct WeightArray
+{
+    std::string name;
+    std::string declaredType;
+    std::string elementType;
+    std::vector<long> shape;
+    size_t elementSize = 0;
+    bool isConst = false;
+    SourceSpan definition;
+    SourceSpan initializer;
+
+    size_t elements() const;
+    size_t bytes() const { return elements() * elementSize; }
+};
+
+struct ActivationStorage
+{
+    std::string name;
+    bool isUnion = false;
+    bool isStatic = false;
+    std::vector<std::pair<std::string, std::string>> members;
+    size_t bytes = 0;
+    SourceSpan declaration;
+};
+
+struct LayerCall
+{
+    std::string function;
+    std::string kind;
+    std::string activation;
+    std::string elementType;
+    std::vector<std::string> arguments;
+    std::vector<std::string> bufferArguments;
+    std::vector<std::string> weights;
+    std::vector<long> inputShape;
+    std::vector<long> outputShape;
+    // Integer object-like macros visible where the layer function is defined (CONV_STRIDE, POOL_SIZE, ...).
+    std::map<std::string, long> constants;
+    size_t inputBytes = 0;
+    size_t outputBytes = 0;
+    unsigned long long macs = 0;
+    unsigned long long elementOps = 0;
+    SourceSpan call;
+    SourceSpan argumentList;
+};
+
+struct ModelProfile
+{
+    std::string folder;
+    std::string entryFunction;
+    std::vector<std::string> entryParameters;
+    std::vector<std::string> entryParameterTypes;
+    SourceSpan entryBody;
+    std::string numberType;
+    std::string inputElementType;
+    std::string outputElementType;
+    std::vector<long> inputShape;
+    std::vector<long> outputShape;
+    bool fixedPoint = false;
+
+    std::vector<LayerCall> layers;
+    std::vector<WeightArray> weights;
+    std::vector<ActivationStorage> activationStorage;
+    // Resolved element type and shape of each activation buffer ("storage.member" for union members).
+    std::map<std::string, std::pair<std::string, std::vector<long>>> activationBuffers;
+
+    size_t weightBytes = 0;
+    unsigned long long macs = 0;
+    unsigned long long elementOps = 0;
+    size_t allocatedActivationBytes = 0;
+    size_t peakActivationBytes = 0;
+
+    std::vector<std::string> warnings;
+
+    const WeightArray *findWeight(const std::string &name) const;
+    size_t inputElements() const;
+    size_t outputElements() const;
+};
+
+class ModelAnalyzer
+{
+public:
+    // Cortex-A9 defaults used when the board frequency is unknown.
+    static constexpr double defaultFreqMHz = 666.67;
+
+    static bool analyze(const std::string &modelFolder, ModelProfile &profile, std::string &error);
+
+    static double predictLatencyUs(const ModelProfile &profile, double freqMHz);
+    static std::string formatReport(const ModelProfile &profile, double freqMHz);
+    static std::string formatSummary(const ModelProfile &profile);
+
+    static size_t elementSizeOf(const std::string &type);
+    static bool isIntegerType(const std::string &type);
+    // Start of the line holding the entry function's declarator in text (the entry file), skipping back over
+    // a multi-line return type, or npos.
+    static size_t entryDefinitionStart(const std::string &text, const ModelProfile &profile);
+    static std::string formatShape(const std::vector<long> &shape);
+    static std::string formatBytes(size_t bytes);
+};
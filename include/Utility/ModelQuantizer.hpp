@@ -0,0 +1,56 @@
+/*ModelQuantizer.hpp*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Utility/ModelAnalyzer.hpp"
+
+struct QuantizedLayer
+{
+    std::string function;
+    std::string kind;
+    bool relu = false;
+    std::vector<long> parameters;
+    std::vector<long long> kernel;
+    std::vector<long long> bias;
+    int weightFracBits = 0;
+    int inputFracBits = 0;
+    int outputFracBits = 0;
+    double outputMaxAbs = 0.0;
+    long inputElements = 0;
+    long outputElements = 0;
+};
+
+struct QuantizationDrift
+{
+    size_t samples = 0;
+    double maxAbsError = 0.0;
+    double meanAbsError = 0.0;
+    double outputRange = 0.0;
+    double argmaxAgreement = 0.0;
+};
+
+class ModelQuantizer
+{
+public:
+    static constexpr const char *reportName = "quantization_report.txt";
+
+    // Replaces the staged copy's model.c with an int8 or int16 fixed-point version calibrated on the
+    // samples in calibrationFile. The entry function keeps its float signature.
+    static bool quantize(const std::string &stagedModelFolder, int bits, const std::string &calibrationFile, std::string &report);
+
+    // One sample per line (or a flat list split every inputElements values); '#' starts a comment.
+    static bool readSamples(const std::string &path, size_t inputElements, std::vector<std::vector<float>> &samples, std::string &error);
+    static bool parseInitializer(const WeightArray &weight, std::vector<double> &values, std::string &error);
+
+private:
+    static int fracBitsFor(double maxAbs, int bits);
+    static long long quantizeValue(double value, int fracBits, long long low, long long high);
+    static bool planLayers(const ModelProfile &profile, const std::vector<double> &maxAbs, double inputMaxAbs, int bits,
+                           std::vector<QuantizedLayer> &layers, std::string &error);
+    static bool calibrate(const ModelProfile &profile, const std::string &modelFolder, const std::string &workDirectory,
+                          const std::string &samplesFile, size_t sampleCount, std::vector<double> &maxAbs, std::string &error);
+    static std::string generateModel(const ModelProfile &profile, const std::vector<QuantizedLayer> &layers, int bits, int inputFracBits);
+    static QuantizationDrift measureDrift(const std::vector<std::string> &reference, const std::vector<std::string> &quantized);
+};
@@ -0,0 +1,46 @@
+/*ModelWatcher.hpp*/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+
+// Watches a model folder (recursively) with inotify and calls onChange on its own thread once the
+// writes have settled for debounceMs. Events that arrive while onChange runs start a new round.
+class ModelWatcher
+{
+public:
+    ModelWatcher() = default;
+    ~ModelWatcher();
+
+    ModelWatcher(const ModelWatcher &) = delete;
+    ModelWatcher &operator=(const ModelWatcher &) = delete;
+
+    bool start(const std::string &folder, int debounceMs, const std::function<void()> &onChange, std::string &error);
+    // Waits for the worker, and so for an onChange in progress.
+    void stop();
+    // Tells the worker to finish without waiting for it (e.g. on the GUI thread while onChange may be busy
+    // for minutes); running() turns false once it has. start() refuses to run over a worker still finishing.
+    void requestStop();
+    bool running() const { return active.load(); }
+    const std::string &watchedFolder() const { return folder; }
+
+    // Longest a continuous burst of writes can postpone onChange.
+    static constexpr int maxDelayMs = 10000;
+
+private:
+    void run();
+    void addWatches();
+
+    std::string folder;
+    int debounceMs = 500;
+    std::function<void()> onChange;
+    int inotifyFd = -1;
+    int stopFd = -1;
+    std::map<int, std::string> watches;
+    std::atomic<bool> active{false};
+    std::thread worker;
+};
@@ -0,0 +1,50 @@
+/*NeonKernelGenerator.hpp*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Utility/ModelAnalyzer.hpp"
+
+struct NeonLayerPlan
+{
+    std::string function;
+    std::string kind;
+    std::string kernelWeight;
+    std::string biasWeight;
+    bool relu = false;
+    long inputs = 0;
+    long units = 0;
+    long samples = 0;
+    long channels = 0;
+    long kernelSize = 0;
+    long outputSamples = 0;
+    SourceSpan call;
+    std::vector<double> kernelValues;
+    std::vector<double> biasValues;
+
+    // Bytes of the transposed const kernel and bias tables the header adds next to the original weights.
+    size_t tableBytes() const;
+};
+
+class NeonKernelGenerator
+{
+public:
+    static constexpr const char *headerName = "neon_kernels.h";
+    static constexpr unsigned long verificationInputSets = 64;
+
+    // Rewrites the dense/conv1d calls of a staged model copy to shape-specialized NEON kernels, which read
+    // transposed copies of the weights emitted as const tables in the generated header.
+    // The staged folder is only modified when the rewritten model is bit-exact with the original on the host.
+    static bool apply(const std::string &stagedModelFolder, std::string &report);
+
+    static std::vector<NeonLayerPlan> planLayers(const ModelProfile &profile, std::vector<std::string> &skipped);
+    static std::string generateHeader(const std::vector<NeonLayerPlan> &plans);
+    static std::string generateEmulationHeader();
+
+private:
+    static bool rewriteModelSource(const ModelProfile &profile, const std::vector<NeonLayerPlan> &plans,
+                                   const std::string &sourceFolder, const std::string &targetFolder, std::string &error);
+    static std::string generateDense(const NeonLayerPlan &plan);
+    static std::string generateConv1d(const NeonLayerPlan &plan);
+};
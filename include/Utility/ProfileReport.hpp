@@ -0,0 +1,54 @@
+/*ProfileReport.hpp*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "telemetry_proto.h"
+
+// A sampled return address, made relative to the file it was mapped from so stacks recorded before and
+// after a restart of the process (different load addresses) still fold together.
+struct ProfileLocation
+{
+    int module = -1;     // index in ProfileData::modules, -1 when the address was outside every mapping
+    uint64_t offset = 0; // file offset in that module, or the raw address
+};
+
+struct ProfileStack
+{
+    uint32_t count = 0;
+    uint32_t tid = 0;
+    std::vector<ProfileLocation> frames; // innermost first
+};
+
+struct ProfileData
+{
+    uint32_t pid = 0;
+    uint32_t frequencyHz = 0;
+    uint64_t samples = 0;
+    uint64_t lost = 0;
+    uint32_t frames = 0;
+    uint64_t firstNs = 0;
+    uint64_t lastNs = 0;
+    std::vector<std::string> modules; // board paths of the sampled executables and libraries
+    std::map<uint32_t, std::string> threadNames;
+    std::vector<ProfileStack> stacks;
+};
+
+// Host side of monitor_sender --profile-out: reads its TP_FRAME_PROFILE frames, symbolizes the stacks
+// against the ELF files they were sampled in and renders them as a flame graph.
+class ProfileReport
+{
+public:
+    static bool parse(const std::string &bytes, ProfileData &profile, std::string &error);
+
+    // Folded stacks ("thread;outer;...;inner" -> samples). images maps a module path to the contents of that
+    // ELF file; frames of modules without an image are shown as module+offset.
+    static std::map<std::string, uint64_t> fold(const ProfileData &profile, const std::map<std::string, std::string> &images);
+
+    static std::string renderFlameGraph(const std::map<std::string, uint64_t> &folded, const std::string &title);
+    static std::string formatHotFunctions(const ProfileData &profile, const std::map<std::string, uint64_t> &folded, size_t limit);
+};
@@ -4,11 +4,16 @@
 
 #include <libssh/libssh.h>
 #include <libssh/sftp.h>
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
 #include <sys/stat.h>
 
 class SSHManager
@@ -19,6 +24,24 @@ public:
     static bool scp_transfer(const std::string &hostname, const std::string &password, const std::string &localPath, const std::string &remotePath, const std::string &privateKeyPath = "");
     static bool execute_remote_command(const std::string &hostname, const std::string &password, const std::string &privateKeyPath, const std::string &command);
 
+    // Runs a command over a pooled session and hands each output line (stdout and stderr) to onLine.
+    // Returns the remote exit status, or -1 if the command could not be run.
+    static int execute_remote_command_streamed(const std::string &hostname, const std::string &password, const std::string &privateKeyPath,
+                                               const std::string &command, const std::function<void(const std::string &)> &onLine);
+
+    // Sends each (local file, remote path) pair over one pooled session, creating remote directories as needed.
+    // The remote file keeps the local file name; only its directory is taken from the remote path.
+    static bool upload_files(const std::string &hostname, const std::string &password, const std::string &privateKeyPath,
+                             const std::vector<std::pair<std::string, std::string>> &files);
+
+    // Copies a remote file into contents over a pooled session (SCP read).
+    static bool read_remote_file(const std::string &hostname, const std::string &password, const std::string &privateKeyPath,
+                                 const std::string &remotePath, std::string &contents);
+
+    static ssh_session acquire_session(const std::string &hostname, const std::string &password, const std::string &privateKeyPath);
+    static void release_session(const std::string &hostname, ssh_session session);
+    static void close_pooled_sessions();
+
 private:
     static bool authenticate(ssh_session session, const std::string &password, const std::string &privateKeyPath);
     static bool send_directory(ssh_session session, const std::string &localPath, const std::string &remotePath);
@@ -5,20 +5,33 @@
 #include <gtkmm/dialog.h>
 #include <gtkmm/checkbutton.h>
 #include <gtkmm/box.h>
+#include <gtkmm/comboboxtext.h>
+#include <gtkmm/filechooserbutton.h>
+#include <gtkmm/label.h>
 #include <vector>
 #include <string>
 #include <thread>
+#include "Utility/ExportManager.hpp"
 
 class SelectDialog : public Gtk::Dialog
 {
 public:
     SelectDialog();
     std::vector<std::string> get_selected_versions() const;
+    ExportOptions get_export_options() const;
 
 private:
     Gtk::Box box;
 
     Gtk::CheckButton cb_threads_mutex, cb_threads_sem, cb_process_mutex, cb_process_sem;
+    Gtk::CheckButton cb_neon_kernels;
+    Gtk::CheckButton cb_external_weights;
+    Gtk::CheckButton cb_activation_arena;
+    Gtk::CheckButton cb_layer_probes;
+    Gtk::Label labelPrecision;
+    Gtk::ComboBoxText comboPrecision;
+    Gtk::Label labelCalibration;
+    Gtk::FileChooserButton chooserCalibration;
 
     Gtk::Button buttonVersionHelp;
 
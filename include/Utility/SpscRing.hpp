@@ -0,0 +1,46 @@
+/*SpscRing.hpp*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Fixed-size lock-free queue between exactly one producer thread and one consumer thread. Each side
+// owns one index and only reads the other's, so push and pop are a load and a store each.
+template <typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    // Producer side. Returns false, leaving the ring untouched, when the consumer has fallen Capacity behind.
+    bool push(const T &item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        slots[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side.
+    bool pop(T &item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        item = slots[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+private:
+    std::array<T, Capacity> slots{};
+    // On separate cache lines so the two threads do not invalidate each other's index.
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+};
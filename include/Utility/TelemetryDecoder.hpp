@@ -0,0 +1,90 @@
+/*TelemetryDecoder.hpp*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "telemetry_proto.h"
+
+struct TelemetryField
+{
+    uint16_t id = 0;
+    uint16_t instance = 0;
+    uint8_t type = 0;
+    double value = 0.0;
+    std::string text; // TP_STR fields
+};
+
+struct TelemetrySample
+{
+    uint64_t timestampNs = 0;
+    uint32_t sequence = 0;
+    uint16_t flags = 0;
+    std::vector<TelemetryField> fields;
+
+    // First field with this id/instance, or fallback when the sample does not carry it.
+    double get(uint16_t id, uint16_t instance = 0, double fallback = 0.0) const;
+    bool has(uint16_t id, uint16_t instance = 0) const;
+};
+
+struct TelemetryFrame
+{
+    uint8_t version = 0;
+    uint8_t type = 0;
+    uint32_t sequence = 0;
+    uint64_t timestampNs = 0;
+    std::vector<TelemetrySample> samples;
+};
+
+// Streaming decoder for what monitor_sender writes to its socket: binary frames (telemetry_proto.h)
+// or, when the sender runs with --text, the legacy lines. The format is picked from the first bytes.
+class TelemetryDecoder
+{
+public:
+    enum class Format
+    {
+        Unknown,
+        Binary,
+        Text
+    };
+
+    // Appends received bytes and decodes every complete frame (or line) they finish.
+    void feed(const uint8_t *data, size_t length, std::vector<TelemetryFrame> &frames);
+    void reset();
+    // New connection from the same sender: drops partial input but keeps counting sequence gaps.
+    void reconnect();
+
+    // Counts the sequence gaps of frames decoded elsewhere, e.g. by the decoder of one connection when a
+    // board may reconnect over another. feed() already does this for its own frames.
+    void track(const TelemetryFrame &frame);
+
+    Format format() const { return mode; }
+    uint64_t droppedBytes() const { return dropped; }
+    uint64_t lostSamples() const { return lost; }
+
+    bool decodeFrame(const uint8_t *data, size_t length, TelemetryFrame &frame, std::string &error);
+    static bool parseTextLine(const std::string &line, TelemetryFrame &frame);
+    static const char *fieldName(uint16_t id);
+    // Fields at or above TP_PROC_PID: the tracked process and its threads, pipeline stages, hardware counters,
+    // interfaces, disks and XADC rails, which the plots do not show.
+    static bool isDetailField(uint16_t id) { return id >= TP_PROC_PID; }
+    // The detail fields of a sample as text tables, a row per instance and a column per field; "" without any.
+    static std::string formatDetails(const TelemetrySample &sample);
+
+private:
+    void decodeBinary(std::vector<TelemetryFrame> &frames);
+    void decodeText(std::vector<TelemetryFrame> &frames);
+    bool unpackBlocks(const uint8_t *p, const uint8_t *end, uint16_t blockCount, TelemetryFrame &frame, std::string &error);
+
+    std::vector<uint8_t> pending;
+    Format mode = Format::Unknown;
+    uint64_t dropped = 0;
+    uint64_t lost = 0;
+    uint32_t textSequence = 0;
+    uint32_t nextSequence = 0;
+    bool sequenceKnown = false;
+    std::vector<uint8_t> unpacked; // packed blocks expand here, reused from frame to frame
+    size_t largestSample = 0;
+};
@@ -0,0 +1,37 @@
+/*WeightExternalizer.hpp*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Utility/ModelAnalyzer.hpp"
+
+struct ExternalWeight
+{
+    std::string name;
+    std::string elementType;
+    std::vector<long> shape;
+    size_t offset = 0;
+    size_t bytes = 0;
+    SourceSpan definition;
+};
+
+class WeightExternalizer
+{
+public:
+    static constexpr const char *blobName = "model_weights.bin";
+    static constexpr size_t alignment = 64;
+    static constexpr uint32_t blobVersion = 1;
+
+    // Moves every constant weight table of a staged model copy into model_weights.bin and replaces the
+    // definitions with macros over a read-only mapping of that file, made by a loader added to model.c.
+    static bool apply(const std::string &stagedModelFolder, std::string &report);
+
+    static uint64_t layoutHash(const std::vector<ExternalWeight> &weights);
+
+private:
+    static bool encodeArray(const WeightArray &weight, const std::vector<double> &values, std::string &bytes, std::string &error);
+    static std::string generateLoader(const std::vector<ExternalWeight> &weights, size_t totalBytes, uint64_t layout);
+    static std::string accessMacro(const ExternalWeight &weight);
+};
@@ -17,6 +17,12 @@
 #include "buttonsHandler/QuitHandler.hpp"
 #include "Utility/DetailsPanel.hpp"
 #include "buttonsHandler/ShowMetricsHandler.hpp" 
+#include "buttonsHandler/AnalyzeModelHandler.hpp"
+#include "buttonsHandler/BenchmarkModelHandler.hpp"
+#include "buttonsHandler/LayerTimingsHandler.hpp"
+#include "buttonsHandler/ProfileVersionHandler.hpp"
+#include "buttonsHandler/WatchModelHandler.hpp"
+#include "Utility/ModelWatcher.hpp"
 
 namespace fs = std::filesystem;
 
@@ -25,8 +31,12 @@ class Vue : public Gtk::Window
 private:
     Gtk::Button buttonBrowseModel;
     Gtk::Button buttonExportLocally;
+    Gtk::Button buttonAnalyzeModel;
+    Gtk::Button buttonBenchmarkModel;
     Gtk::Button buttonConnectRedPitaya;
     Gtk::Button buttonShowMetrics;
+    Gtk::Button buttonLayerTimings;
+    Gtk::Button buttonProfile;
     Gtk::Button buttonExportToRedPitaya;
     Gtk::Button cancelExportButton;
     Gtk::Button buttonHelp;
@@ -35,6 +45,7 @@ private:
     Gtk::Box mainBox;
     Gtk::Box buttonRowBox;
     Gtk::CheckButton checkShowDetails;
+    Gtk::CheckButton checkWatchModel;
 
     std::string modelFolder;
     std::string redpitayaHost;
@@ -42,6 +53,7 @@ private:
     std::string redpitayaPrivateKeyPath;
 
     DetailsPanel detailsPanel;
+    ModelWatcher modelWatcher;
 
     bool modelLoaded = false;
     bool redpitayaConnected = false;
@@ -0,0 +1,23 @@
+/*AnalyzeModelHandler.hpp*/
+
+#pragma once
+
+#include <gtkmm.h>
+#include <string>
+#include <thread>
+#include <iomanip>
+#include <sstream>
+#include "Utility/DetailsPanel.hpp"
+#include "Utility/ModelAnalyzer.hpp"
+
+namespace AnalyzeModelHandler
+{
+    void handle(Gtk::Window* parentWindow,
+                Gtk::Button& buttonAnalyzeModel,
+                const std::string& modelFolder,
+                const std::string& redpitayaHost,
+                const std::string& redpitayaPassword,
+                const std::string& redpitayaPrivateKeyPath,
+                bool redpitayaConnected,
+                DetailsPanel& detailsPanel);
+}
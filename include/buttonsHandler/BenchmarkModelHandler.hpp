@@ -0,0 +1,19 @@
+/*BenchmarkModelHandler.hpp*/
+
+#pragma once
+
+#include <gtkmm.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Utility/DetailsPanel.hpp"
+#include "Utility/BenchmarkManager.hpp"
+
+namespace BenchmarkModelHandler
+{
+    void handle(Gtk::Window* parentWindow,
+                Gtk::Button& buttonBenchmarkModel,
+                const std::string& modelFolder,
+                DetailsPanel& detailsPanel);
+}
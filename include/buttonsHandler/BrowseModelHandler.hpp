@@ -5,9 +5,11 @@
 #include <gtkmm.h>
 #include <string>
 #include <atomic>
+#include <thread>
 #include <iostream>
 #include "Utility/DetailsPanel.hpp"
 #include "Utility/FileManager.hpp"
+#include "Utility/ModelAnalyzer.hpp"
 
 namespace BrowseModelHandler
 {
@@ -15,6 +17,8 @@ namespace BrowseModelHandler
                 Gtk::Button& buttonBrowseModel,
                 Gtk::Button& buttonExportLocally,
                 Gtk::Button& buttonExportToRedPitaya,
+                Gtk::Button& buttonAnalyzeModel,
+                Gtk::Button& buttonBenchmarkModel,
                 DetailsPanel& detailsPanel,
                 std::string& modelFolder,
                 bool& modelLoaded,
@@ -15,6 +15,8 @@ namespace ConnectRedPitayaHandler
                 Gtk::Button& buttonConnectRedPitaya,
                 Gtk::Button& buttonExportToRedPitaya,
                 Gtk::Button& buttonShowMetrics,
+                Gtk::Button& buttonLayerTimings,
+                Gtk::Button& buttonProfile,
                 DetailsPanel& detailsPanel,
                 std::string& redpitayaHost,
                 std::string& redpitayaPassword,
@@ -6,6 +6,8 @@
 #include <atomic>
 #include <string>
 #include <vector>
+#include <sstream>
+#include <iomanip>
 #include "Utility/DetailsPanel.hpp"
 
 namespace ExportToRedPitayaHandler
@@ -0,0 +1,21 @@
+/*LayerTimingsHandler.hpp*/
+
+#pragma once
+
+#include <gtkmm.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Utility/DetailsPanel.hpp"
+#include "Utility/SSHManager.hpp"
+#include "Utility/LayerProbeInjector.hpp"
+
+namespace LayerTimingsHandler
+{
+    void handle(Gtk::Window* parentWindow,
+                Gtk::Button& buttonLayerTimings,
+                const std::string& redpitayaHost,
+                const std::string& redpitayaPassword,
+                const std::string& redpitayaPrivateKeyPath,
+                DetailsPanel& detailsPanel);
+}
@@ -0,0 +1,21 @@
+/*ProfileVersionHandler.hpp*/
+
+#pragma once
+
+#include <gtkmm.h>
+#include <string>
+#include <thread>
+#include <map>
+#include "Utility/DetailsPanel.hpp"
+#include "Utility/SSHManager.hpp"
+#include "Utility/ProfileReport.hpp"
+
+namespace ProfileVersionHandler
+{
+    void handle(Gtk::Window* parentWindow,
+                Gtk::Button& buttonProfile,
+                const std::string& redpitayaHost,
+                const std::string& redpitayaPassword,
+                const std::string& redpitayaPrivateKeyPath,
+                DetailsPanel& detailsPanel);
+}
@@ -11,10 +11,12 @@
 #include <iostream>
 #include <chrono>
 #include <sstream>
+#include <memory>
 
 #include "Utility/DetailsPanel.hpp"
 #include "Utility/ConnectionManager.hpp"
 #include "Utility/SSHManager.hpp"
+#include "Utility/MetricsWindow.hpp"
 
 namespace ShowMetricsHandler
 {
@@ -25,4 +27,7 @@ namespace ShowMetricsHandler
                 const std::string& redpitayaPassword,
                 const std::string& redpitayaPrivateKeyPath,
                 DetailsPanel& detailsPanel);
+
+    // Stops the receiver and destroys the metrics window, before the application exits.
+    void close();
 }
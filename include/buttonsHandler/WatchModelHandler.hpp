@@ -0,0 +1,28 @@
+/*WatchModelHandler.hpp*/
+
+#pragma once
+
+#include <gtkmm.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include "Utility/DetailsPanel.hpp"
+#include "Utility/ModelWatcher.hpp"
+
+namespace WatchModelHandler
+{
+    void handle(Gtk::Window* parentWindow,
+                Gtk::CheckButton& checkWatchModel,
+                ModelWatcher& modelWatcher,
+                const std::string& modelFolder,
+                const std::string& redpitayaHost,
+                const std::string& redpitayaPassword,
+                const std::string& redpitayaPrivateKeyPath,
+                bool modelLoaded,
+                bool redpitayaConnected,
+                DetailsPanel& detailsPanel);
+
+    // Cancels a redeploy in progress so that destroying the watcher does not wait for all of it.
+    void close(ModelWatcher& modelWatcher);
+}
@@ -0,0 +1,183 @@
+// io_stats.c
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "io_stats.h"
+#include "proc_util.h"
+
+#define IO_BUF_BYTES 16384
+#define SECTOR_BYTES 512.0f
+
+int io_stats_open(struct io_stats *io)
+{
+    memset(io, 0, sizeof(*io));
+    io->net_fd = open("/proc/net/dev", O_RDONLY | O_CLOEXEC);
+    io->disk_fd = open("/proc/diskstats", O_RDONLY | O_CLOEXEC);
+    io->buf_size = IO_BUF_BYTES;
+    io->buf = malloc(io->buf_size);
+    if (!io->buf || (io->net_fd < 0 && io->disk_fd < 0))
+    {
+        io_stats_close(io);
+        return -1;
+    }
+    return 0;
+}
+
+// Copies the next blank-delimited word (or everything up to stop) into name and skips stop.
+static const char *parse_name(const char *p, char *name, char stop)
+{
+    size_t length = 0;
+    while (*p == ' ' || *p == '\t')
+        p++;
+    while (*p && *p != stop && *p != ' ' && *p != '\n')
+    {
+        if (length + 1 < IO_NAME_BYTES)
+            name[length++] = *p;
+        p++;
+    }
+    name[length] = 0;
+    if (*p == stop)
+        p++;
+    return p;
+}
+
+static unsigned long long counter_delta(unsigned long long last, unsigned long long now, int wraps)
+{
+    if (now >= last)
+        return now - last;
+    // diskstats counters are unsigned long in the kernel (32 bits on the board) and wrap; anything else was reset.
+    return wraps && last <= ULONG_MAX ? now + ((unsigned long long)ULONG_MAX - last) + 1 : 0;
+}
+
+// Devices that never moved anything take no slot, so the board's handful of real ones always fit.
+static void update_device(struct io_device *devices, int *count, uint32_t pass, const char *name,
+                          const unsigned long long *values, int counters, int wraps)
+{
+    struct io_device *d = NULL;
+    for (int i = 0; i < *count && !d; i++)
+        if (strcmp(devices[i].name, name) == 0)
+            d = &devices[i];
+    if (!d)
+    {
+        int idle = 1;
+        for (int c = 0; c < counters; c++)
+            idle &= values[c] == 0;
+        if (idle || *count == IO_MAX_DEVICES)
+            return;
+        d = &devices[(*count)++];
+        memset(d, 0, sizeof(*d));
+        memcpy(d->name, name, IO_NAME_BYTES);
+    }
+    d->valid = d->pass != 0 && d->pass + 1 == pass;
+    for (int c = 0; c < counters; c++)
+    {
+        d->delta[c] = counter_delta(d->last[c], values[c], wraps);
+        d->last[c] = values[c];
+    }
+    d->pass = pass;
+}
+
+// Two header lines, then "  eth0: rx bytes packets errs drop fifo frame compressed multicast tx bytes packets errs drop ...".
+static void parse_net(struct io_stats *io, const char *p)
+{
+    for (int header = 0; header < 2 && p; header++)
+        if ((p = strchr(p, '\n')))
+            p++;
+    while (p && *p)
+    {
+        char name[IO_NAME_BYTES];
+        unsigned long long v[16];
+        p = parse_name(p, name, ':');
+        for (int i = 0; i < 16; i++)
+            p = parse_ull(p, &v[i]);
+        const unsigned long long values[IO_NET_COUNTERS] = {v[0], v[1], v[3], v[8], v[9], v[11]};
+        if (name[0] && strcmp(name, "lo") != 0)
+            update_device(io->net, &io->net_count, io->pass, name, values, IO_NET_COUNTERS, 0);
+        if ((p = strchr(p, '\n')))
+            p++;
+    }
+}
+
+// "major minor name reads merged sectors ms writes merged sectors ms in_flight io_ms weighted_ms [discard, flush...]".
+static void parse_disks(struct io_stats *io, const char *p)
+{
+    while (p && *p)
+    {
+        char name[IO_NAME_BYTES];
+        unsigned long long major, minor, v[11];
+        p = parse_ull(p, &major);
+        p = parse_ull(p, &minor);
+        p = parse_name(p, name, ' ');
+        for (int i = 0; i < 11; i++)
+            p = parse_ull(p, &v[i]);
+        const unsigned long long values[IO_DISK_COUNTERS] = {v[0], v[4], v[2], v[6], v[3] + v[7], v[9], v[10]};
+        if (name[0] && strncmp(name, "loop", 4) != 0 && strncmp(name, "ram", 3) != 0 && strncmp(name, "zram", 4) != 0)
+            update_device(io->disk, &io->disk_count, io->pass, name, values, IO_DISK_COUNTERS, 1);
+        if ((p = strchr(p, '\n')))
+            p++;
+    }
+}
+
+void io_stats_read(struct io_stats *io, uint64_t now_ns)
+{
+    io->pass++;
+    io->elapsed_s = io->last_ns ? (double)(now_ns - io->last_ns) / 1e9 : 0.0;
+    io->last_ns = now_ns;
+    if (io->net_fd >= 0 && read_fd(io->net_fd, io->buf, io->buf_size) > 0)
+        parse_net(io, io->buf);
+    if (io->disk_fd >= 0 && read_fd(io->disk_fd, io->buf, io->buf_size) > 0)
+        parse_disks(io, io->buf);
+}
+
+void io_stats_encode(const struct io_stats *io, struct tp_writer *writer)
+{
+    if (io->elapsed_s <= 0.0)
+        return;
+    float per_s = (float)(1.0 / io->elapsed_s);
+    for (int i = 0; i < io->net_count; i++)
+    {
+        const struct io_device *d = &io->net[i];
+        if (!d->valid || d->pass != io->pass)
+            continue;
+        uint16_t instance = (uint16_t)i;
+        tp_put_str(writer, TP_NET_IFACE, instance, d->name);
+        tp_put_f32(writer, TP_NET_RX_BYTES_PER_S, instance, (float)d->delta[IO_NET_RX_BYTES] * per_s);
+        tp_put_f32(writer, TP_NET_TX_BYTES_PER_S, instance, (float)d->delta[IO_NET_TX_BYTES] * per_s);
+        tp_put_f32(writer, TP_NET_RX_PACKETS_PER_S, instance, (float)d->delta[IO_NET_RX_PACKETS] * per_s);
+        tp_put_f32(writer, TP_NET_TX_PACKETS_PER_S, instance, (float)d->delta[IO_NET_TX_PACKETS] * per_s);
+        tp_put_f32(writer, TP_NET_RX_DROPS_PER_S, instance, (float)d->delta[IO_NET_RX_DROPS] * per_s);
+        tp_put_f32(writer, TP_NET_TX_DROPS_PER_S, instance, (float)d->delta[IO_NET_TX_DROPS] * per_s);
+    }
+    float elapsed_ms = (float)(io->elapsed_s * 1000.0);
+    for (int i = 0; i < io->disk_count; i++)
+    {
+        const struct io_device *d = &io->disk[i];
+        if (!d->valid || d->pass != io->pass)
+            continue;
+        uint16_t instance = (uint16_t)i;
+        unsigned long long ios = d->delta[IO_DISK_READS] + d->delta[IO_DISK_WRITES];
+        float busy = 100.0f * (float)d->delta[IO_DISK_BUSY_MS] / elapsed_ms;
+        tp_put_str(writer, TP_DISK_NAME, instance, d->name);
+        tp_put_f32(writer, TP_DISK_READS_PER_S, instance, (float)d->delta[IO_DISK_READS] * per_s);
+        tp_put_f32(writer, TP_DISK_WRITES_PER_S, instance, (float)d->delta[IO_DISK_WRITES] * per_s);
+        tp_put_f32(writer, TP_DISK_READ_BYTES_PER_S, instance, (float)d->delta[IO_DISK_SECTORS_READ] * SECTOR_BYTES * per_s);
+        tp_put_f32(writer, TP_DISK_WRITE_BYTES_PER_S, instance, (float)d->delta[IO_DISK_SECTORS_WRITTEN] * SECTOR_BYTES * per_s);
+        tp_put_f32(writer, TP_DISK_AWAIT_MS, instance, ios ? (float)d->delta[IO_DISK_IO_MS] / (float)ios : 0.0f);
+        tp_put_f32(writer, TP_DISK_BUSY_PERCENT, instance, busy < 100.0f ? busy : 100.0f);
+        tp_put_f32(writer, TP_DISK_QUEUE_DEPTH, instance, (float)d->delta[IO_DISK_WEIGHTED_MS] / elapsed_ms);
+    }
+}
+
+void io_stats_close(struct io_stats *io)
+{
+    if (io->net_fd >= 0)
+        close(io->net_fd);
+    if (io->disk_fd >= 0)
+        close(io->disk_fd);
+    free(io->buf);
+    memset(io, 0, sizeof(*io));
+    io->net_fd = io->disk_fd = -1;
+}
@@ -0,0 +1,72 @@
+// io_stats.h
+// Network and storage traffic: per-interface counters from /proc/net/dev and per-device counters from
+// /proc/diskstats, both kept open and parsed in one pass per sample, sent as rates over the interval.
+#ifndef IO_STATS_H
+#define IO_STATS_H
+
+#include <stdint.h>
+#include "telemetry_proto.h"
+
+#define IO_MAX_DEVICES 8
+#define IO_NAME_BYTES 16
+#define IO_MAX_COUNTERS 7
+
+// /proc/net/dev columns kept, in this order.
+enum io_net_counter
+{
+    IO_NET_RX_BYTES,
+    IO_NET_RX_PACKETS,
+    IO_NET_RX_DROPS,
+    IO_NET_TX_BYTES,
+    IO_NET_TX_PACKETS,
+    IO_NET_TX_DROPS,
+    IO_NET_COUNTERS
+};
+
+// /proc/diskstats columns kept, in this order.
+enum io_disk_counter
+{
+    IO_DISK_READS,
+    IO_DISK_WRITES,
+    IO_DISK_SECTORS_READ,
+    IO_DISK_SECTORS_WRITTEN,
+    IO_DISK_IO_MS,       // time reads and writes took, queueing included
+    IO_DISK_BUSY_MS,     // time with at least one request in flight
+    IO_DISK_WEIGHTED_MS, // in-flight requests integrated over time
+    IO_DISK_COUNTERS
+};
+
+struct io_device
+{
+    char name[IO_NAME_BYTES];
+    uint32_t pass; // read that last listed it
+    int valid;     // delta holds a full interval
+    unsigned long long last[IO_MAX_COUNTERS];
+    unsigned long long delta[IO_MAX_COUNTERS];
+};
+
+struct io_stats
+{
+    int net_fd;
+    int disk_fd;
+    char *buf;
+    size_t buf_size;
+    uint32_t pass;
+    uint64_t last_ns;
+    double elapsed_s;
+    int net_count;
+    int disk_count;
+    struct io_device net[IO_MAX_DEVICES];  // slot is the instance sent, stable while the sender runs
+    struct io_device disk[IO_MAX_DEVICES];
+};
+
+// Returns 0 when at least one of the two files could be opened.
+int io_stats_open(struct io_stats *io);
+void io_stats_read(struct io_stats *io, uint64_t now_ns);
+void io_stats_encode(const struct io_stats *io, struct tp_writer *writer);
+void io_stats_close(struct io_stats *io);
+
+// Upper bound of what io_stats_encode writes.
+#define IO_ENCODED_BYTES (2 * IO_MAX_DEVICES * (TP_FIELD_HEADER_BYTES + 2 + IO_NAME_BYTES + 7 * 9))
+
+#endif
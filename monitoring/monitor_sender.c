@@ -1,4 +1,5 @@
 // monitor_sender.c
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,218 +7,1215 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <sys/time.h>
+#include <sys/uio.h>
+#include <signal.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include "telemetry_proto.h"
+#include "telemetry_pack.h"
+#include "proc_util.h"
+#include "thread_sampler.h"
+#include "perf_counters.h"
+#include "profiler.h"
+#include "pipeline_stats.h"
+#include "io_stats.h"
+#include "xadc_capture.h"
+#include "subscribers.h"
 
 #define SERVER_PORT 5000
 
-int get_gateway_ip(char *ip_buffer, size_t size)
+// The gateway of the main table's default IPv4 route, from a route dump over rtnetlink.
+int get_gateway(struct in_addr *gateway)
 {
-    FILE *fp = popen("ip route | grep default | awk '{print $3}'", "r");
-    if (!fp)
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0)
         return -1;
-    if (fgets(ip_buffer, size, fp) == NULL)
+    struct
     {
-        pclose(fp);
+        struct nlmsghdr header;
+        struct rtmsg route;
+    } request;
+    memset(&request, 0, sizeof(request));
+    request.header.nlmsg_len = sizeof(request);
+    request.header.nlmsg_type = RTM_GETROUTE;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = 1;
+    request.route.rtm_family = AF_INET;
+    if (send(fd, &request, sizeof(request), 0) < 0)
+    {
+        close(fd);
         return -1;
     }
-    ip_buffer[strcspn(ip_buffer, "\n")] = 0;
-    pclose(fp);
+
+    int found = -1, done = 0;
+    uint32_t buf[2048];
+    while (!done && found != 0)
+    {
+        int length = (int)recv(fd, buf, sizeof(buf), 0);
+        if (length <= 0)
+            break;
+        for (struct nlmsghdr *h = (struct nlmsghdr *)buf; NLMSG_OK(h, (unsigned int)length); h = NLMSG_NEXT(h, length))
+        {
+            if (h->nlmsg_type == NLMSG_DONE || h->nlmsg_type == NLMSG_ERROR)
+            {
+                done = 1;
+                break;
+            }
+            const struct rtmsg *route = NLMSG_DATA(h);
+            if (h->nlmsg_type != RTM_NEWROUTE || route->rtm_dst_len != 0 || route->rtm_table != RT_TABLE_MAIN)
+                continue;
+            int attributes = (int)RTM_PAYLOAD(h);
+            for (const struct rtattr *a = RTM_RTA(route); RTA_OK(a, attributes); a = RTA_NEXT(a, attributes))
+                if (a->rta_type == RTA_GATEWAY && RTA_PAYLOAD(a) == sizeof(*gateway))
+                {
+                    memcpy(gateway, RTA_DATA(a), sizeof(*gateway));
+                    found = 0;
+                }
+        }
+    }
+    close(fd);
+    return found;
+}
+
+#define XADC_TEMP_PATH "/sys/devices/soc0/axi/f8007100.adc/iio:device0/in_temp0_raw"
+#define THERMAL_TEMP_PATH "/sys/class/thermal/thermal_zone0/temp"
+
+struct cpu_times
+{
+    unsigned long long total;
+    unsigned long long idle;
+};
+
+// Keeps every source file open and re-reads it with pread() from offset 0, so one sample costs a
+// handful of syscalls and no allocations whatever the interval.
+struct sampler
+{
+    int stat_fd;
+    int meminfo_fd;
+    int temp_fd;
+    int temp_is_xadc;
+    int cores;
+    int *freq_fds;
+    struct cpu_times *prev; // [0] all cores, [1 + n] core n
+    struct cpu_times *curr;
+    float *usage;           // same indexing as prev/curr
+    float *freq_mhz;        // [n] core n, -1 when cpufreq is unavailable
+    char *buf;
+    size_t buf_size;
+    unsigned long mem_total_kb;
+    unsigned long mem_available_kb;
+    float temp_c;
+};
+
+// Parses the "cpu " and every "cpuN" line of /proc/stat in one pass. Returns the number of cores seen.
+static int parse_cpu_times(const char *text, struct cpu_times *times, int max_cores)
+{
+    int cores = 0;
+    const char *p = text;
+    while (p[0] == 'c' && p[1] == 'p' && p[2] == 'u')
+    {
+        p += 3;
+        int slot = 0;
+        if (*p >= '0' && *p <= '9')
+        {
+            unsigned long long core;
+            p = parse_ull(p, &core);
+            slot = (int)core + 1;
+            if ((int)core + 1 > cores)
+                cores = (int)core + 1;
+        }
+
+        unsigned long long v[8] = {0};
+        for (int i = 0; i < 8; i++)
+            p = parse_ull(p, &v[i]);
+        if (times && slot <= max_cores)
+        {
+            // user nice system idle iowait irq softirq steal
+            times[slot].idle = v[3] + v[4];
+            times[slot].total = v[0] + v[1] + v[2] + v[3] + v[4] + v[5] + v[6] + v[7];
+        }
+
+        p = strchr(p, '\n');
+        if (!p)
+            break;
+        p++;
+    }
+    return cores;
+}
+
+float calculate_cpu_usage(const struct cpu_times *prev, const struct cpu_times *curr)
+{
+    unsigned long long total_diff = curr->total - prev->total;
+    unsigned long long idle_diff = curr->idle - prev->idle;
+    return (total_diff > 0) ? 100.0f * (1.0f - ((float)idle_diff / total_diff)) : 0.0f;
+}
+
+static void sampler_close(struct sampler *s)
+{
+    if (s->stat_fd >= 0)
+        close(s->stat_fd);
+    if (s->meminfo_fd >= 0)
+        close(s->meminfo_fd);
+    if (s->temp_fd >= 0)
+        close(s->temp_fd);
+    for (int i = 0; s->freq_fds && i < s->cores; i++)
+        if (s->freq_fds[i] >= 0)
+            close(s->freq_fds[i]);
+    free(s->freq_fds);
+    free(s->prev);
+    free(s->curr);
+    free(s->usage);
+    free(s->freq_mhz);
+    free(s->buf);
+    memset(s, 0, sizeof(*s));
+    s->stat_fd = s->meminfo_fd = s->temp_fd = -1;
+}
+
+int sampler_open(struct sampler *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->stat_fd = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+    s->meminfo_fd = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+    s->temp_fd = open(XADC_TEMP_PATH, O_RDONLY | O_CLOEXEC);
+    s->temp_is_xadc = s->temp_fd >= 0;
+    if (s->temp_fd < 0)
+        s->temp_fd = open(THERMAL_TEMP_PATH, O_RDONLY | O_CLOEXEC);
+    if (s->stat_fd < 0 || s->meminfo_fd < 0)
+    {
+        sampler_close(s);
+        return -1;
+    }
+
+    // Size the buffer and the per-core tables from the core count /proc/stat reports.
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    s->buf_size = 4096 + 160 * (size_t)(cpus > 0 ? cpus : 1);
+    s->buf = malloc(s->buf_size);
+    if (!s->buf || read_fd(s->stat_fd, s->buf, s->buf_size) <= 0)
+    {
+        sampler_close(s);
+        return -1;
+    }
+    s->cores = parse_cpu_times(s->buf, NULL, 0);
+    s->freq_fds = malloc(sizeof(int) * (size_t)(s->cores + 1));
+    s->prev = calloc((size_t)s->cores + 1, sizeof(struct cpu_times));
+    s->curr = calloc((size_t)s->cores + 1, sizeof(struct cpu_times));
+    s->usage = calloc((size_t)s->cores + 1, sizeof(float));
+    s->freq_mhz = calloc((size_t)s->cores + 1, sizeof(float));
+    if (!s->freq_fds || !s->prev || !s->curr || !s->usage || !s->freq_mhz)
+    {
+        sampler_close(s);
+        return -1;
+    }
+    parse_cpu_times(s->buf, s->prev, s->cores);
+
+    for (int i = 0; i < s->cores; i++)
+    {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", i);
+        s->freq_fds[i] = open(path, O_RDONLY | O_CLOEXEC);
+    }
     return 0;
 }
 
-int read_cpu_line(const char *label, unsigned long *total, unsigned long *idle)
+// Returns 0 when CPU, RAM and temperature were all read. The XADC capture, when running, supplies the
+// temperature (its interval mean) and the sysfs file is left alone.
+int sampler_read(struct sampler *s, const struct xadc_capture *xadc)
 {
-    FILE *fp = fopen("/proc/stat", "r");
-    if (!fp)
+    if (read_fd(s->stat_fd, s->buf, s->buf_size) <= 0)
         return -1;
-    char line[512];
-    while (fgets(line, sizeof(line), fp))
+    parse_cpu_times(s->buf, s->curr, s->cores);
+    for (int i = 0; i <= s->cores; i++)
+    {
+        s->usage[i] = calculate_cpu_usage(&s->prev[i], &s->curr[i]);
+        s->prev[i] = s->curr[i];
+    }
+
+    for (int i = 0; i < s->cores; i++)
     {
-        if (strncmp(line, label, strlen(label)) == 0)
+        unsigned long long khz;
+        s->freq_mhz[i] = -1;
+        if (s->freq_fds[i] >= 0 && read_fd(s->freq_fds[i], s->buf, 64) > 0)
         {
-            unsigned long user, nice, system, idle_t, iowait, irq, softirq, steal;
-            if (sscanf(line + strlen(label),
-                       "%lu %lu %lu %lu %lu %lu %lu %lu",
-                       &user, &nice, &system, &idle_t, &iowait,
-                       &irq, &softirq, &steal) < 8)
-            {
-                fclose(fp);
-                return -1;
-            }
-            *idle = idle_t + iowait;
-            *total = user + nice + system + *idle + irq + softirq + steal;
-            fclose(fp);
-            return 0;
+            parse_ull(s->buf, &khz);
+            s->freq_mhz[i] = khz / 1000.0f;
         }
     }
-    fclose(fp);
-    return -1;
+
+    if (read_fd(s->meminfo_fd, s->buf, s->buf_size) <= 0 ||
+        !find_value(s->buf, "MemTotal:", &s->mem_total_kb) ||
+        !find_value(s->buf, "MemAvailable:", &s->mem_available_kb) || s->mem_total_kb == 0)
+        return -1;
+
+    if (xadc && xadc_temperature(xadc, &s->temp_c) == 0)
+        return 0;
+    if (s->temp_fd < 0 || read_fd(s->temp_fd, s->buf, 64) <= 0)
+        return -1;
+    int raw = atoi(s->buf);
+    s->temp_c = s->temp_is_xadc ? ((raw / 4096.0f) * 503.975f) - 273.15f : raw / 1000.0f;
+    return 0;
 }
 
-int read_ram(unsigned long *total_kb, unsigned long *available_kb)
+#define BACKLOG_MAGIC 0x4b4c4252u /* "RBLK" */
+#define BACKLOG_VERSION 2
+#define DEFAULT_BACKLOG_BYTES (1u << 20)
+#define RECONNECT_MIN_NS 100000000ull
+#define RECONNECT_MAX_NS 5000000000ull
+#define PROFILE_WRITE_NS 1000000000ull
+#define PACK_BLOCK_BYTES (64u << 10)
+#define PACK_DEFAULT_FLUSH_US 1000000ul
+#define BOARD_NAME_BYTES 64
+#define HELLO_BYTES (TP_FRAME_HEADER_BYTES + TP_SAMPLE_HEADER_BYTES + 3 * 9 + TP_FIELD_HEADER_BYTES + 2 + BOARD_NAME_BYTES)
+
+// Samples not sent yet, oldest first: the batch being built and, while the host is unreachable, the
+// backlog. The state is one block (heap, or a file mapped from tmpfs so a restarted sender replays
+// it) holding this header, one u32 length per sample slot, then the byte ring. With --compress a slot
+// holds a sealed block of packed samples (telemetry_pack.h) instead of one sample.
+struct backlog_state
 {
-    FILE *fp = fopen("/proc/meminfo", "r");
-    if (!fp)
-        return -1;
-    char key[64];
-    unsigned long value;
-    char unit[16];
-    while (fscanf(fp, "%63s %lu %15s\n", key, &value, unit) == 3)
+    uint32_t magic;
+    uint32_t version;
+    uint32_t text_mode;
+    uint32_t packed;
+    uint32_t next_sequence;
+    uint32_t reserved;
+    uint64_t capacity;
+    uint64_t slots;
+    uint64_t head;
+    uint64_t length;
+    uint64_t slot_head;
+    uint64_t count;
+    uint64_t dropped;
+};
+
+struct sample_ring
+{
+    struct backlog_state *state;
+    uint32_t *lengths;
+    uint8_t *data;
+    struct tp_packer *packer; // the block being packed, before it takes a slot
+    size_t block_bytes;
+    int mapped;
+    uint64_t oldest_ns;
+    // Frame being written: prefix (frame header, or a whole HELLO) then the oldest frame_samples samples.
+    int in_flight;
+    uint8_t prefix[128];
+    size_t prefix_bytes;
+    uint64_t frame_samples;
+    size_t frame_payload;
+    size_t frame_sent;
+};
+
+static int ring_open(struct sample_ring *r, size_t capacity, size_t slots, const char *path, int text_mode,
+                     struct tp_packer *packer)
+{
+    memset(r, 0, sizeof(*r));
+    r->packer = packer;
+    r->block_bytes = sizeof(struct backlog_state) + slots * sizeof(uint32_t) + capacity;
+    if (path)
     {
-        if (strcmp(key, "MemTotal:") == 0)
-            *total_kb = value;
-        else if (strcmp(key, "MemAvailable:") == 0)
+        int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 ||
+            ((size_t)st.st_size != r->block_bytes && ftruncate(fd, (off_t)r->block_bytes) != 0))
         {
-            *available_kb = value;
-            break;
+            if (fd >= 0)
+                close(fd);
+            return -1;
         }
+        void *block = mmap(NULL, r->block_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (block == MAP_FAILED)
+            return -1;
+        r->state = block;
+        r->mapped = 1;
     }
-    fclose(fp);
+    else if (!(r->state = calloc(1, r->block_bytes)))
+        return -1;
+    r->lengths = (uint32_t *)(r->state + 1);
+    r->data = (uint8_t *)(r->lengths + slots);
+
+    struct backlog_state *st = r->state;
+    if (st->magic != BACKLOG_MAGIC || st->version != BACKLOG_VERSION || st->capacity != capacity ||
+        st->slots != slots || st->text_mode != (uint32_t)text_mode || st->packed != (packer != NULL) ||
+        st->length > capacity || st->count > slots)
+    {
+        memset(st, 0, sizeof(*st));
+        st->magic = BACKLOG_MAGIC;
+        st->version = BACKLOG_VERSION;
+        st->text_mode = (uint32_t)text_mode;
+        st->packed = packer != NULL;
+        st->capacity = capacity;
+        st->slots = slots;
+    }
+    else if (st->count > 0)
+        fprintf(stderr, "Resuming %llu buffered %s from %s\n", (unsigned long long)st->count,
+                packer ? "block(s)" : "sample(s)", path);
     return 0;
 }
 
-int read_temperature(float *temp_c)
+static void ring_close(struct sample_ring *r)
+{
+    if (r->mapped)
+        munmap(r->state, r->block_bytes);
+    else
+        free(r->state);
+    r->state = NULL;
+}
+
+static void ring_pop(struct sample_ring *r, uint64_t samples)
 {
-    FILE *fp = fopen("/sys/devices/soc0/axi/f8007100.adc/iio:device0/in_temp0_raw", "r");
-    if (fp)
+    struct backlog_state *st = r->state;
+    for (uint64_t i = 0; i < samples; i++)
     {
-        int raw;
-        if (fscanf(fp, "%d", &raw) == 1)
+        st->head = (st->head + r->lengths[st->slot_head]) % st->capacity;
+        st->length -= r->lengths[st->slot_head];
+        st->slot_head = (st->slot_head + 1) % st->slots;
+    }
+    st->count -= samples;
+}
+
+// Drops the oldest samples to make room, or the new one while a frame is partly on the wire. Dropped samples show up on the host as a gap in the sequence numbers.
+static int ring_push(struct sample_ring *r, const uint8_t *bytes, size_t length, uint64_t timestamp_ns)
+{
+    struct backlog_state *st = r->state;
+    int frame_on_wire = r->in_flight && r->frame_samples > 0;
+    while (st->length + length > st->capacity || st->count == st->slots)
+    {
+        if (frame_on_wire || st->count == 0)
         {
-            fclose(fp);
-            *temp_c = ((raw / 4096.0f) * 503.975f) - 273.15f;
-            return 0;
+            st->dropped++;
+            return -1;
         }
-        fclose(fp);
+        ring_pop(r, 1);
+        st->dropped++;
+    }
+    if (st->count == 0)
+        r->oldest_ns = timestamp_ns;
+    size_t tail = (st->head + st->length) % st->capacity;
+    size_t first = length < st->capacity - tail ? length : st->capacity - tail;
+    memcpy(r->data + tail, bytes, first);
+    memcpy(r->data, bytes + first, length - first);
+    r->lengths[(st->slot_head + st->count) % st->slots] = (uint32_t)length;
+    st->length += length;
+    st->count++;
+    return 0;
+}
+
+// Moves the block being packed into the ring.
+static void ring_seal(struct sample_ring *r)
+{
+    size_t bytes = tp_packer_seal(r->packer);
+    if (bytes > 0)
+        ring_push(r, r->packer->block, bytes, r->packer->first_ns);
+    tp_packer_restart(r->packer);
+}
+
+static void ring_add(struct sample_ring *r, const uint8_t *bytes, size_t length, uint64_t timestamp_ns)
+{
+    if (!r->packer)
+    {
+        ring_push(r, bytes, length, timestamp_ns);
+        return;
     }
+    if (tp_pack_sample(r->packer, bytes, length) == 0)
+        return;
+    ring_seal(r);
+    if (tp_pack_sample(r->packer, bytes, length) != 0)
+        r->state->dropped++;
+}
+
+// Samples are batched before packing, so with --compress a batch is counted in samples not yet sealed
+// and every sealed block is ready to go.
+static int ring_batch_ready(const struct sample_ring *r, uint64_t batch)
+{
+    if (!r->packer)
+        return r->state->count >= batch;
+    return r->state->count > 0 || r->packer->state.samples >= batch;
+}
+
+static int ring_flush_due(const struct sample_ring *r, uint64_t now, uint64_t flush_ns)
+{
+    if (r->state->count > 0)
+        return now - r->oldest_ns >= flush_ns;
+    return r->packer && r->packer->state.samples > 0 && now - r->packer->first_ns >= flush_ns;
+}
 
-    // fallback
-    fp = fopen("/sys/class/thermal/thermal_zone0/temp", "r");
-    if (fp)
+// A sealed block starts with its first sample's sequence at the same offset as a sample does.
+static uint32_t ring_first_sequence(const struct sample_ring *r)
+{
+    const struct backlog_state *st = r->state;
+    if (st->count == 0 && r->packer && r->packer->state.samples > 0)
+        return tp_get32(r->packer->block + 8);
+    if (st->count == 0 || st->text_mode)
+        return st->next_sequence;
+    uint8_t bytes[4];
+    for (int i = 0; i < 4; i++)
+        bytes[i] = r->data[(st->head + 8 + (size_t)i) % st->capacity];
+    return tp_get32(bytes);
+}
+
+// Queues bytes (the HELLO) to go out before any sample.
+static void ring_send_first(struct sample_ring *r, const void *bytes, size_t length)
+{
+    memcpy(r->prefix, bytes, length);
+    r->prefix_bytes = length;
+    r->frame_samples = 0;
+    r->frame_payload = 0;
+    r->frame_sent = 0;
+    r->in_flight = 1;
+}
+
+static void ring_start_frame(struct sample_ring *r)
+{
+    const struct backlog_state *st = r->state;
+    size_t limit = TP_MAX_FRAME_BYTES - TP_FRAME_HEADER_BYTES;
+    r->frame_samples = 0;
+    r->frame_payload = 0;
+    while (r->frame_samples < st->count && r->frame_samples < TP_MAX_FRAME_SAMPLES)
     {
-        int raw;
-        if (fscanf(fp, "%d", &raw) == 1)
+        uint32_t length = r->lengths[(st->slot_head + r->frame_samples) % st->slots];
+        if (r->frame_samples > 0 && r->frame_payload + length > limit)
+            break;
+        r->frame_payload += length;
+        r->frame_samples++;
+    }
+    r->prefix_bytes = 0;
+    if (!st->text_mode)
+    {
+        tp_write_frame_header(r->prefix, st->packed ? TP_FRAME_PACKED : TP_FRAME_SAMPLES, (uint32_t)r->frame_payload, ring_first_sequence(r),
+                              monotonic_ns(), (uint16_t)r->frame_samples);
+        r->prefix_bytes = TP_FRAME_HEADER_BYTES;
+    }
+    r->frame_sent = 0;
+    r->in_flight = 1;
+}
+
+// Writes frames while at least min_samples are buffered, without blocking. Each writev() sends the
+// frame header and the samples straight from the ring, resuming where a short write stopped.
+// Returns -1 when the connection failed.
+static int ring_send(struct sample_ring *r, int sock, uint64_t min_samples)
+{
+    struct backlog_state *st = r->state;
+    if (r->packer)
+    {
+        if (r->packer->state.samples >= min_samples)
+            ring_seal(r);
+        min_samples = 1;
+    }
+    while (r->in_flight || (st->count > 0 && st->count >= min_samples))
+    {
+        if (!r->in_flight)
+            ring_start_frame(r);
+
+        struct iovec iov[3];
+        int n = 0;
+        size_t skip = r->frame_sent;
+        size_t first = r->frame_payload < st->capacity - st->head ? r->frame_payload : st->capacity - st->head;
+        const void *bases[3] = {r->prefix, r->data + st->head, r->data};
+        size_t lengths[3] = {r->prefix_bytes, first, r->frame_payload - first};
+        for (int i = 0; i < 3; i++)
         {
-            fclose(fp);
-            *temp_c = raw / 1000.0f;
-            return 0;
+            if (skip >= lengths[i])
+            {
+                skip -= lengths[i];
+                continue;
+            }
+            iov[n].iov_base = (uint8_t *)bases[i] + skip;
+            iov[n++].iov_len = lengths[i] - skip;
+            skip = 0;
         }
-        fclose(fp);
+
+        ssize_t sent = writev(sock, iov, n);
+        if (sent < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        r->frame_sent += (size_t)sent;
+        if (r->frame_sent < r->prefix_bytes + r->frame_payload)
+            return 0;
+        ring_pop(r, r->frame_samples);
+        r->in_flight = 0;
+        r->oldest_ns = monotonic_ns();
+    }
+    return 0;
+}
+
+// Server mode: moves the oldest frame's worth of samples out of the ring, frame header included, into one
+// buffer that every subscriber is sent from. Returns NULL while fewer than min_samples are buffered.
+static struct shared_frame *ring_take_frame(struct sample_ring *r, uint64_t min_samples)
+{
+    struct backlog_state *st = r->state;
+    if (r->packer)
+    {
+        if (r->packer->state.samples >= min_samples)
+            ring_seal(r);
+        min_samples = 1;
     }
+    if (st->count == 0 || st->count < min_samples)
+        return NULL;
+    ring_start_frame(r);
+    r->in_flight = 0;
+    struct shared_frame *frame = shared_frame_new(r->prefix_bytes + r->frame_payload);
+    if (!frame)
+        return NULL;
+    size_t first = r->frame_payload < st->capacity - st->head ? r->frame_payload : st->capacity - st->head;
+    memcpy(frame->bytes, r->prefix, r->prefix_bytes);
+    memcpy(frame->bytes + r->prefix_bytes, r->data + st->head, first);
+    memcpy(frame->bytes + r->prefix_bytes + first, r->data, r->frame_payload - first);
+    ring_pop(r, r->frame_samples);
+    r->oldest_ns = monotonic_ns();
+    return frame;
+}
+
+// Non-blocking connection to the host (--host, else the default gateway), retried with exponential backoff
+// while samples keep queueing.
+struct host_link
+{
+    int sock;
+    int fixed_host;
+    struct in_addr host;
+    uint16_t port;
+    int connecting;
+    uint64_t next_attempt_ns;
+    uint64_t backoff_ns;
+};
+
+static void link_close(struct host_link *l, struct sample_ring *r)
+{
+    if (l->sock >= 0)
+        close(l->sock);
+    l->sock = -1;
+    l->connecting = 0;
+    // A frame cut off mid-way is resent whole on the next connection; a pending HELLO is rebuilt.
+    r->in_flight = 0;
+}
+
+static void link_try_connect(struct host_link *l, uint64_t now)
+{
+    if (l->sock >= 0 || now < l->next_attempt_ns)
+        return;
+    l->next_attempt_ns = now + l->backoff_ns;
+    l->backoff_ns = l->backoff_ns * 2 > RECONNECT_MAX_NS ? RECONNECT_MAX_NS : l->backoff_ns * 2;
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(l->port);
+    server_addr.sin_addr = l->host;
+    if (!l->fixed_host && get_gateway(&server_addr.sin_addr) != 0)
+        return;
+
+    l->sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (l->sock < 0)
+        return;
+    if (connect(l->sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) == 0)
+        l->connecting = 0;
+    else if (errno == EINPROGRESS)
+        l->connecting = 1;
+    else
+    {
+        close(l->sock);
+        l->sock = -1;
+    }
+}
+
+static size_t encode_sample(const struct sampler *s, const struct thread_sampler *threads, const struct perf_counters *perf,
+                            const struct pipeline_stats *stats, const struct io_stats *io,
+                            const struct xadc_capture *xadc, uint8_t *buf, size_t size, uint32_t sequence, uint64_t timestamp_ns, uint32_t missed_deadlines)
+{
+    struct tp_writer writer;
+    unsigned long ram_used = s->mem_total_kb - s->mem_available_kb;
+    tp_writer_init(&writer, buf, size);
+    tp_begin_sample(&writer, sequence, timestamp_ns);
+    tp_put_f32(&writer, TP_CPU_PERCENT, 0, s->usage[0]);
+    for (int i = 0; i < s->cores; i++)
+        tp_put_f32(&writer, TP_CORE_PERCENT, (uint16_t)i, s->usage[i + 1]);
+    tp_put_f32(&writer, TP_RAM_PERCENT, 0, 100.0f * (float)ram_used / s->mem_total_kb);
+    tp_put_u32(&writer, TP_RAM_USED_KB, 0, (uint32_t)ram_used);
+    tp_put_u32(&writer, TP_RAM_TOTAL_KB, 0, (uint32_t)s->mem_total_kb);
+    for (int i = 0; i < s->cores; i++)
+        tp_put_f32(&writer, TP_FREQ_MHZ, (uint16_t)i, s->freq_mhz[i]);
+    tp_put_f32(&writer, TP_TEMP_C, 0, s->temp_c);
+    tp_put_u32(&writer, TP_MISSED_DEADLINES, 0, missed_deadlines);
+    if (threads)
+        thread_sampler_encode(threads, &writer);
+    if (perf)
+        perf_counters_encode(perf, &writer);
+    if (stats)
+        pipeline_stats_encode(stats, &writer);
+    if (io)
+        io_stats_encode(io, &writer);
+    if (xadc)
+        xadc_encode(xadc, &writer);
+    tp_end_sample(&writer);
+    return writer.overflow ? 0 : writer.length;
+}
+
+// The legacy line always has two core columns.
+// The HELLO goes first on every connection and names the oldest sample still held, so the host can count
+// what was dropped, and the board, so a host receiving several can keep them apart across reconnections.
+static size_t build_hello(uint8_t *hello, size_t size, int text_mode, unsigned int interval_us, uint32_t flush_us,
+                          uint32_t first_sequence, const char *board_name)
+{
+    if (text_mode)
+        return (size_t)snprintf((char *)hello, size, "INTERVAL_US:%u\n", interval_us);
+    struct tp_writer writer;
+    uint64_t hello_ns = monotonic_ns();
+    tp_writer_init(&writer, hello, size);
+    tp_begin_frame(&writer, TP_FRAME_HELLO, 0, hello_ns);
+    tp_begin_sample(&writer, 0, hello_ns);
+    tp_put_u32(&writer, TP_INTERVAL_US, 0, interval_us);
+    tp_put_u32(&writer, TP_FLUSH_US, 0, flush_us);
+    tp_put_u32(&writer, TP_SEQUENCE_START, 0, first_sequence);
+    tp_put_str(&writer, TP_BOARD_NAME, 0, board_name);
+    tp_end_sample(&writer);
+    return tp_end_frame(&writer);
+}
 
-    return -1;
+static size_t format_text_sample(const struct sampler *s, char *buf, size_t size)
+{
+    unsigned long ram_used = s->mem_total_kb - s->mem_available_kb;
+    int length = snprintf(buf, size,
+                          "CPU:%.2f%%, CPU0:%.2f%%, CPU1:%.2f%%, RAM:%.2f%% (%lu/%lu MB), FREQ0:%.0fMHz, FREQ1:%.0fMHz, Temp:%.2f°C\n",
+                          s->usage[0], s->cores > 0 ? s->usage[1] : 0.0f, s->cores > 1 ? s->usage[2] : 0.0f,
+                          100.0f * (float)ram_used / s->mem_total_kb, ram_used / 1024, s->mem_total_kb / 1024,
+                          s->cores > 0 ? s->freq_mhz[0] : -1.0f, s->cores > 1 ? s->freq_mhz[1] : -1.0f, s->temp_c);
+    return length > 0 && (size_t)length < size ? (size_t)length : 0;
 }
 
-float get_freq_mhz(int core)
+// Absolute-deadline periodic timer: every expiry is interval_us after the previous deadline, not after
+// the previous wakeup, so sampling and send time never stretch the period.
+static int start_timer(unsigned int interval_us, uint64_t first_deadline_ns)
 {
-    char path[128];
-    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", core);
-    FILE *fp = fopen(path, "r");
-    if (!fp)
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (fd < 0)
         return -1;
-    float freq;
-    if (fscanf(fp, "%f", &freq) == 1)
+    struct itimerspec spec;
+    spec.it_value.tv_sec = (time_t)(first_deadline_ns / 1000000000ull);
+    spec.it_value.tv_nsec = (long)(first_deadline_ns % 1000000000ull);
+    spec.it_interval.tv_sec = interval_us / 1000000u;
+    spec.it_interval.tv_nsec = (long)(interval_us % 1000000u) * 1000;
+    if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, NULL) != 0)
     {
-        fclose(fp);
-        return freq / 1000.0f;
+        close(fd);
+        return -1;
     }
-    fclose(fp);
-    return -1;
+    return fd;
 }
 
-float calculate_cpu_usage(unsigned long prev_total, unsigned long prev_idle,
-                          unsigned long curr_total, unsigned long curr_idle)
+static void set_realtime(int fifo_priority, int cpu)
 {
-    unsigned long total_diff = curr_total - prev_total;
-    unsigned long idle_diff = curr_idle - prev_idle;
-    return (total_diff > 0) ? 100.0f * (1.0f - ((float)idle_diff / total_diff)) : 0.0f;
+    if (cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0)
+            perror("sched_setaffinity");
+    }
+    if (fifo_priority > 0)
+    {
+        struct sched_param param = {.sched_priority = fifo_priority};
+        if (sched_setscheduler(0, SCHED_FIFO, &param) != 0)
+            perror("SCHED_FIFO");
+        // Page faults would cost more than the sampling itself at real-time priority.
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+            perror("mlockall");
+    }
+}
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void request_stop(int signo)
+{
+    (void)signo;
+    stop_requested = 1;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [--text] [--flush-us T] [--batch N] [--fifo PRIO] [--cpu N]\n"
+                    "          [--backlog-bytes N] [--backlog-file PATH] [--pid PID | --process NAME]\n"
+                    "          [--perf] [--profile-out PATH [--profile-hz HZ]] [--duration S] [--no-stream]\n"
+                    "          [--xadc-hz HZ] [--iio-root DIR] [--compress] [--host ADDR | --listen] [--port N]\n"
+                    "          [--name NAME]\n"
+                    "          [interval_us]\n"
+                    "  --text        send the legacy human-readable lines instead of binary frames\n"
+                    "  --flush-us T  send buffered samples at least every T microseconds\n"
+                    "  --batch N     send as soon as N samples are buffered (default 1 without --flush-us)\n"
+                    "  --fifo PRIO   sample under SCHED_FIFO at this priority (1-99)\n"
+                    "  --cpu N       pin the sampler to core N\n"
+                    "  --backlog-bytes N    samples kept while the host is unreachable (default 1 MiB)\n"
+                    "  --backlog-file PATH  keep that backlog in a mapped file (e.g. on /dev/shm) that survives restarts\n"
+                    "  --pid PID / --process NAME  also report per-thread CPU, run-queue wait and context switches\n"
+                    "                              of that process (found again by name when it restarts)\n"
+                    "  --perf        per-core IPC and L1D/L2/branch misses per 1000 instructions (perf_event_open)\n"
+                    "  --profile-out PATH  sample the call stacks of the --pid/--process target and append them,\n"
+                    "                      folded, to PATH once per second (build it with -fno-omit-frame-pointer)\n"
+                    "  --profile-hz HZ     stack samples per second and core (default 499)\n"
+                    "  --duration S  exit after S seconds\n"
+                    "  --no-stream   do not connect to the host (e.g. profile only)\n"
+                    "  --xadc-hz HZ  capture XADC temperature, VCCINT and VCCAUX through the IIO buffer at HZ scans\n"
+                    "                per second and send each interval's mean, min and max (default: sysfs, once per sample)\n"
+                    "  --iio-root DIR  look for /sys/bus/iio and /dev/iio:device* under DIR (a fake tree for testing)\n"
+                    "  --compress    pack samples with delta-of-delta timestamps and XOR-compressed values, on the\n"
+                    "                link and in the backlog; pays off with batching (default --flush-us 1000000)\n"
+                    "  --host ADDR   send to this IPv4 address instead of the default gateway\n"
+                    "  --listen      serve any number of hosts that connect instead (each gets the samples from then on;\n"
+                    "                the first one also gets the backlog)\n"
+                    "  --port N      port to connect to, or to listen on with --listen (default 5000)\n"
+                    "  --name NAME   how hosts receiving several boards label this one (default: the hostname)\n",
+            program);
 }
 
 int main(int argc, char *argv[])
 {
     unsigned int interval_us = 500000; // Default: 500ms
+    int text_mode = 0;
+    unsigned long flush_us = 0;
+    unsigned long batch = 0;
+    int fifo_priority = 0;
+    int cpu = -1;
+    unsigned long backlog_bytes = DEFAULT_BACKLOG_BYTES;
+    const char *backlog_file = NULL;
+    pid_t target_pid = 0;
+    const char *target_name = NULL;
+    int use_perf = 0;
+    const char *profile_path = NULL;
+    unsigned int profile_hz = PF_DEFAULT_HZ;
+    unsigned long duration_s = 0;
+    int stream = 1;
+    unsigned int xadc_hz = 0;
+    const char *iio_root = "";
+    int compress = 0;
+    const char *host = NULL;
+    int listen_mode = 0;
+    uint16_t port = SERVER_PORT;
+    char board_name[BOARD_NAME_BYTES] = "";
 
-    if (argc > 1)
+    static const struct option options[] = {
+        {"text", no_argument, NULL, 't'},
+        {"flush-us", required_argument, NULL, 'f'},
+        {"batch", required_argument, NULL, 'b'},
+        {"fifo", required_argument, NULL, 'r'},
+        {"cpu", required_argument, NULL, 'c'},
+        {"backlog-bytes", required_argument, NULL, 'k'},
+        {"backlog-file", required_argument, NULL, 'F'},
+        {"pid", required_argument, NULL, 'p'},
+        {"process", required_argument, NULL, 'P'},
+        {"perf", no_argument, NULL, 'e'},
+        {"profile-out", required_argument, NULL, 'o'},
+        {"profile-hz", required_argument, NULL, 'z'},
+        {"duration", required_argument, NULL, 'd'},
+        {"no-stream", no_argument, NULL, 'n'},
+        {"xadc-hz", required_argument, NULL, 'x'},
+        {"iio-root", required_argument, NULL, 'I'},
+        {"compress", no_argument, NULL, 'C'},
+        {"host", required_argument, NULL, 'H'},
+        {"listen", no_argument, NULL, 'L'},
+        {"port", required_argument, NULL, 'T'},
+        {"name", required_argument, NULL, 'N'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "tf:b:r:c:k:F:p:P:eo:z:d:nx:I:CH:LT:N:h", options, NULL)) != -1)
     {
-        int val = atoi(argv[1]);
+        if (opt == 't')
+            text_mode = 1;
+        else if (opt == 'f')
+            flush_us = strtoul(optarg, NULL, 10);
+        else if (opt == 'b')
+            batch = strtoul(optarg, NULL, 10);
+        else if (opt == 'r')
+            fifo_priority = atoi(optarg);
+        else if (opt == 'c')
+            cpu = atoi(optarg);
+        else if (opt == 'k')
+            backlog_bytes = strtoul(optarg, NULL, 10);
+        else if (opt == 'F')
+            backlog_file = optarg;
+        else if (opt == 'p')
+            target_pid = (pid_t)atoi(optarg);
+        else if (opt == 'P')
+            target_name = optarg;
+        else if (opt == 'e')
+            use_perf = 1;
+        else if (opt == 'o')
+            profile_path = optarg;
+        else if (opt == 'z')
+            profile_hz = (unsigned int)strtoul(optarg, NULL, 10);
+        else if (opt == 'd')
+            duration_s = strtoul(optarg, NULL, 10);
+        else if (opt == 'n')
+            stream = 0;
+        else if (opt == 'x')
+            xadc_hz = (unsigned int)strtoul(optarg, NULL, 10);
+        else if (opt == 'I')
+            iio_root = optarg;
+        else if (opt == 'C')
+            compress = 1;
+        else if (opt == 'H')
+            host = optarg;
+        else if (opt == 'L')
+            listen_mode = 1;
+        else if (opt == 'T')
+            port = (uint16_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'N')
+            snprintf(board_name, sizeof(board_name), "%s", optarg);
+        else
+        {
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind < argc)
+    {
+        int val = atoi(argv[optind]);
         if (val > 0)
             interval_us = (unsigned int)val;
     }
 
-    char server_ip[64];
-    if (get_gateway_ip(server_ip, sizeof(server_ip)) != 0)
-        return 1;
+    if (!board_name[0] && gethostname(board_name, sizeof(board_name) - 1) != 0)
+        board_name[0] = 0;
 
-    int sock;
-    struct sockaddr_in server_addr;
-    if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0)
-        return 1;
+    struct host_link link = {.sock = -1, .backoff_ns = RECONNECT_MIN_NS, .port = port};
+    if (host)
+    {
+        if (listen_mode || inet_pton(AF_INET, host, &link.host) != 1)
+        {
+            fprintf(stderr, listen_mode ? "--host and --listen exclude each other\n" : "--host needs an IPv4 address\n");
+            return 1;
+        }
+        link.fixed_host = 1;
+    }
 
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(SERVER_PORT);
-    if (inet_pton(AF_INET, server_ip, &server_addr.sin_addr) <= 0)
+    struct sampler sampler;
+    if (sampler_open(&sampler) != 0)
+    {
+        perror("Cannot open /proc sources");
         return 1;
+    }
+
+    // A packed block needs a few samples to pay off, so --compress alone batches for a second.
+    if (compress && text_mode)
+    {
+        fprintf(stderr, "--compress has no effect with --text\n");
+        compress = 0;
+    }
+    if (compress && batch == 0 && flush_us == 0)
+        flush_us = PACK_DEFAULT_FLUSH_US;
+    // Without --batch, send every sample unless a flush interval asks for time-based batching.
+    if (batch == 0)
+        batch = flush_us ? TP_MAX_FRAME_SAMPLES : 1;
+    if (batch > TP_MAX_FRAME_SAMPLES)
+        batch = TP_MAX_FRAME_SAMPLES;
+    if (flush_us && flush_us / interval_us + 1 < batch)
+        batch = flush_us / interval_us + 1;
+    uint64_t flush_ns = flush_us ? (uint64_t)flush_us * 1000u : UINT64_MAX;
+    uint32_t hello_flush_us = (uint32_t)(flush_us ? flush_us : batch * interval_us);
 
-    while (connect(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
+    struct thread_sampler *threads = NULL;
+    if (target_pid > 0 || target_name)
     {
-        perror("Connection failed, retrying...");
-        sleep(2);
+        threads = malloc(sizeof(*threads));
+        if (!threads)
+            return 1;
+        thread_sampler_init(threads, target_pid, target_name);
     }
 
-    char interval_msg[64];
-    snprintf(interval_msg, sizeof(interval_msg), "INTERVAL_US:%u\n", interval_us);
-    send(sock, interval_msg, strlen(interval_msg), 0);
+    struct perf_counters perf_storage, *perf = NULL;
+    if (use_perf && !text_mode)
+    {
+        if (perf_counters_open(&perf_storage, sampler.cores) > 0)
+            perf = &perf_storage;
+        else
+            fprintf(stderr, "No hardware counters available; continuing without --perf\n");
+    }
 
-    unsigned long prev_total = 0, prev_idle = 0;
-    unsigned long prev0_total = 0, prev0_idle = 0;
-    unsigned long prev1_total = 0, prev1_idle = 0;
-    usleep(100000);
+    struct profiler profiler_storage, *profiler = NULL;
+    int profile_fd = -1;
+    if (profile_path)
+    {
+        if (!threads)
+        {
+            fprintf(stderr, "--profile-out needs --pid or --process\n");
+            return 1;
+        }
+        profile_fd = open(profile_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (profile_fd < 0)
+        {
+            perror(profile_path);
+            return 1;
+        }
+        if (profiler_open(&profiler_storage, sampler.cores, profile_hz) > 0)
+            profiler = &profiler_storage;
+        else
+            fprintf(stderr, "Stack sampling unavailable; continuing without --profile-out\n");
+    }
+
+    // Whatever the exported pipeline publishes through rp_stats.h rides along; absent, it costs one open() a second.
+    struct pipeline_stats stats_storage, *stats = NULL;
+    if (!text_mode)
+    {
+        pipeline_stats_init(&stats_storage);
+        stats = &stats_storage;
+    }
 
-    // Initialisation unique ici
-    unsigned long mem_total_kb = 0, mem_available_kb = 0;
+    struct io_stats io_storage, *io = NULL;
+    if (!text_mode && io_stats_open(&io_storage) == 0)
+        io = &io_storage;
+
+    struct xadc_capture xadc_storage, *xadc = NULL;
+    if (!text_mode && xadc_open(&xadc_storage, iio_root, xadc_hz) == 0)
+        xadc = &xadc_storage;
+    else if (xadc_hz)
+        fprintf(stderr, "No XADC IIO device found; continuing without --xadc-hz\n");
+
+    // Sample header and up to 9 bytes per field (two per core plus the fixed ones), or one text line.
+    size_t sample_bytes = TP_SAMPLE_HEADER_BYTES + 9 * (2 * (size_t)sampler.cores + 8) + (threads ? TS_ENCODED_BYTES : 0) +
+                          (perf ? PC_ENCODED_BYTES_PER_CORE * (size_t)sampler.cores : 0) + (stats ? PS_ENCODED_BYTES : 0) + (io ? IO_ENCODED_BYTES : 0) +
+                          (xadc ? XC_ENCODED_BYTES : 0);
+    if (sample_bytes < 256)
+        sample_bytes = 256;
+    size_t ring_bytes = batch * sample_bytes;
+    if (ring_bytes > TP_MAX_FRAME_BYTES - TP_FRAME_HEADER_BYTES)
+        ring_bytes = TP_MAX_FRAME_BYTES - TP_FRAME_HEADER_BYTES;
+    if (ring_bytes < backlog_bytes)
+        ring_bytes = backlog_bytes;
+    struct tp_packer packer_storage, *packer = NULL;
+    if (compress)
+    {
+        size_t block_bytes = PACK_BLOCK_BYTES > 2 * sample_bytes + 64 ? PACK_BLOCK_BYTES : 2 * sample_bytes + 64;
+        if (tp_packer_init(&packer_storage, block_bytes) != 0)
+            return 1;
+        packer = &packer_storage;
+        if (ring_bytes < 2 * block_bytes)
+            ring_bytes = 2 * block_bytes;
+    }
+    uint8_t *scratch = malloc(sample_bytes);
+    struct sample_ring ring;
+    if (!scratch || ring_open(&ring, ring_bytes, ring_bytes / 32 + batch, backlog_file, text_mode, packer) != 0)
+    {
+        perror("Cannot allocate the sample backlog");
+        return 1;
+    }
+    // A subscriber may fall behind by a whole backlog replay and as much again before it loses frames.
+    struct subscribers subscribers_storage, *subscribers = NULL;
+    if (stream && listen_mode)
+    {
+        if (subscribers_open(&subscribers_storage, port, 2 * ring_bytes) != 0)
+        {
+            perror("Cannot listen for subscribers");
+            return 1;
+        }
+        subscribers = &subscribers_storage;
+        fprintf(stderr, "Listening for subscribers on port %u\n", (unsigned)port);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGTERM, request_stop);
+    signal(SIGINT, request_stop);
+
+    set_realtime(fifo_priority, cpu);
+    int timer_fd = start_timer(interval_us, monotonic_ns() + (uint64_t)interval_us * 1000u);
+    if (timer_fd < 0)
+    {
+        perror("timerfd");
+        return 1;
+    }
+    uint32_t missed_deadlines = 0;
+    uint32_t sequence = ring.state->next_sequence;
+    uint64_t stop_ns = duration_s ? monotonic_ns() + (uint64_t)duration_s * 1000000000u : UINT64_MAX;
+    uint64_t profile_written_ns = monotonic_ns();
+    uint32_t profile_frames = 0;
+    int poll_count = 3 + (profiler ? profiler->cores : 0);
+    struct pollfd *fds = calloc((size_t)poll_count, sizeof(*fds));
+    if (!fds)
+        return 1;
 
-    while (1)
+    while (!stop_requested && monotonic_ns() < stop_ns)
     {
-        unsigned long total, idle, total0, idle0, total1, idle1;
-        float temp_c;
+        uint64_t now = monotonic_ns();
+        int flush_due = ring_flush_due(&ring, now, flush_ns);
+        int want_send = ring.in_flight || ring_batch_ready(&ring, batch) || flush_due;
 
-        read_cpu_line("cpu ", &total, &idle);
-        read_cpu_line("cpu0", &total0, &idle0);
-        read_cpu_line("cpu1", &total1, &idle1);
+        // Closed links, the subscribers' epoll set outside --listen and idle profiler cores have fd -1, which poll skips.
+        fds[0] = (struct pollfd){.fd = timer_fd, .events = POLLIN};
+        fds[1] = (struct pollfd){.fd = link.sock, .events = POLLIN};
+        if (link.connecting || want_send)
+            fds[1].events |= POLLOUT;
+        fds[2] = (struct pollfd){.fd = subscribers ? subscribers->epoll_fd : -1, .events = POLLIN};
+        for (int c = 3; c < poll_count; c++)
+            fds[c] = (struct pollfd){.fd = profiler->core[c - 3].fd, .events = POLLIN};
+        int timeout_ms = -1;
+        if (stream && !subscribers && link.sock < 0)
+            timeout_ms = link.next_attempt_ns > now ? (int)((link.next_attempt_ns - now) / 1000000u) + 1 : 0;
+        if (poll(fds, (nfds_t)poll_count, timeout_ms) < 0 && errno != EINTR)
+            break;
 
-        float cpu_usage = calculate_cpu_usage(prev_total, prev_idle, total, idle);
-        float cpu0_usage = calculate_cpu_usage(prev0_total, prev0_idle, total0, idle0);
-        float cpu1_usage = calculate_cpu_usage(prev1_total, prev1_idle, total1, idle1);
+        if (profiler)
+        {
+            // Drained on every tick as well, so the ring never holds more than one interval.
+            int ring_ready = fds[0].revents & POLLIN;
+            for (int c = 3; c < poll_count; c++)
+                ring_ready |= fds[c].revents & POLLIN;
+            if (ring_ready)
+                profiler_drain(profiler, threads->pid);
+            now = monotonic_ns();
+            if (profiler_full(profiler) || now - profile_written_ns >= PROFILE_WRITE_NS)
+            {
+                if (profiler_write(profiler, profile_fd, threads->pid, profile_frames++, now) != 0)
+                    perror("profile write");
+                profile_written_ns = now;
+            }
+        }
 
-        prev_total = total;
-        prev_idle = idle;
-        prev0_total = total0;
-        prev0_idle = idle0;
-        prev1_total = total1;
-        prev1_idle = idle1;
+        if (fds[0].revents & POLLIN)
+        {
+            // The expiration count is above 1 when whole periods passed while we were busy or descheduled.
+            uint64_t expirations = 0;
+            if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations) && expirations > 1)
+                missed_deadlines += (uint32_t)(expirations - 1);
 
-        float freq0 = get_freq_mhz(0);
-        float freq1 = get_freq_mhz(1);
+            uint64_t timestamp_ns = monotonic_ns();
+            if (perf)
+                perf_counters_read(perf);
+            if (threads)
+                thread_sampler_read(threads, timestamp_ns);
+            if (stats)
+                pipeline_stats_read(stats, timestamp_ns);
+            if (io)
+                io_stats_read(io, timestamp_ns);
+            if (xadc)
+                xadc_read(xadc, timestamp_ns);
+            if (sampler_read(&sampler, xadc) == 0)
+            {
+                size_t length = text_mode ? format_text_sample(&sampler, (char *)scratch, sample_bytes)
+                                          : encode_sample(&sampler, threads, perf, stats, io, xadc, scratch, sample_bytes, sequence, timestamp_ns, missed_deadlines);
+                if (length > 0)
+                {
+                    ring_add(&ring, scratch, length, timestamp_ns);
+                    ring.state->next_sequence = ++sequence;
+                    if (text_mode && batch == 1)
+                        printf("Sampled: %.*s", (int)length, (const char *)scratch);
+                }
+            }
+        }
 
-        if (read_ram(&mem_total_kb, &mem_available_kb) == 0 &&
-            read_temperature(&temp_c) == 0)
+        int connected = 0;
+        if (!stream)
+            continue;
+        if (subscribers)
         {
-            float ram_percent = 100.0f * (1.0f - (float)mem_available_kb / mem_total_kb);
-            unsigned long ram_used = mem_total_kb - mem_available_kb;
+            if ((fds[2].revents & POLLIN) && subscribers_poll(subscribers) > 0)
+            {
+                struct shared_frame *hello = shared_frame_new(HELLO_BYTES);
+                if (hello)
+                {
+                    hello->length = build_hello(hello->bytes, HELLO_BYTES, text_mode, interval_us, hello_flush_us, ring_first_sequence(&ring), board_name);
+                    subscribers_greet(subscribers, hello);
+                    shared_frame_release(hello);
+                }
+            }
+            // Without subscribers the ring keeps the backlog, for whoever connects first.
+            if (subscribers->count > 0)
+            {
+                struct shared_frame *frame;
+                flush_due = ring_flush_due(&ring, monotonic_ns(), flush_ns);
+                while ((frame = ring_take_frame(&ring, flush_due ? 1 : batch)))
+                {
+                    subscribers_publish(subscribers, frame);
+                    shared_frame_release(frame);
+                }
+            }
+            continue;
+        }
+        if (link.sock < 0)
+        {
+            link_try_connect(&link, monotonic_ns());
+            connected = link.sock >= 0 && !link.connecting;
+        }
+        else if (link.connecting && fds[1].revents)
+        {
+            int error = 0;
+            socklen_t error_length = sizeof(error);
+            getsockopt(link.sock, SOL_SOCKET, SO_ERROR, &error, &error_length);
+            if (error != 0)
+                link_close(&link, &ring);
+            else
+                connected = 1;
+            link.connecting = 0;
+        }
+        else if (fds[1].revents & (POLLIN | POLLERR | POLLHUP))
+        {
+            // The host never sends anything, so readable means it closed the connection.
+            char byte;
+            ssize_t got = recv(link.sock, &byte, 1, MSG_DONTWAIT);
+            if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+                link_close(&link, &ring);
+        }
 
-            char message[256];
-            snprintf(message, sizeof(message),
-                     "CPU:%.2f%%, CPU0:%.2f%%, CPU1:%.2f%%, RAM:%.2f%% (%lu/%lu MB), FREQ0:%.0fMHz, FREQ1:%.0fMHz, Temp:%.2f°C\n",
-                     cpu_usage, cpu0_usage, cpu1_usage,
-                     ram_percent, ram_used / 1024, mem_total_kb / 1024,
-                     freq0, freq1, temp_c);
+        if (connected)
+        {
+            link.backoff_ns = RECONNECT_MIN_NS;
+            if (ring.state->count > 0)
+                fprintf(stderr, "Connected, replaying %llu buffered %s\n", (unsigned long long)ring.state->count,
+                        packer ? "block(s)" : "sample(s)");
 
-            send(sock, message, strlen(message), 0);
-            printf("Sent: %s", message);
+            uint8_t hello[HELLO_BYTES];
+            size_t hello_bytes = build_hello(hello, sizeof(hello), text_mode, interval_us, hello_flush_us, ring_first_sequence(&ring), board_name);
+            ring_send_first(&ring, hello, hello_bytes);
         }
 
-        usleep(interval_us);
+        if (link.sock >= 0 && !link.connecting)
+        {
+            now = monotonic_ns();
+            flush_due = ring_flush_due(&ring, now, flush_ns);
+            if (ring_send(&ring, link.sock, flush_due ? 1 : batch) != 0)
+                link_close(&link, &ring);
+        }
     }
 
-    close(sock);
+    if (missed_deadlines > 0)
+        fprintf(stderr, "Missed %u sampling deadline(s)\n", missed_deadlines);
+    if (profiler)
+    {
+        profiler_drain(profiler, threads->pid);
+        profiler_write(profiler, profile_fd, threads->pid, profile_frames, monotonic_ns());
+        profiler_close(profiler);
+    }
+    if (profile_fd >= 0)
+        close(profile_fd);
+    free(fds);
+    close(timer_fd);
+    link_close(&link, &ring);
+    if (subscribers)
+        subscribers_close(subscribers);
+    // The open block goes to the backlog too, so a --backlog-file keeps it for the next run.
+    if (packer)
+    {
+        ring_seal(&ring);
+        tp_packer_free(packer);
+    }
+    ring_close(&ring);
+    free(scratch);
+    sampler_close(&sampler);
+    if (threads)
+        thread_sampler_close(threads);
+    if (perf)
+        perf_counters_close(perf);
+    if (stats)
+        pipeline_stats_close(stats);
+    if (io)
+        io_stats_close(io);
+    if (xadc)
+        xadc_close(xadc);
+    free(threads);
     return 0;
 }
@@ -1,6 +1,10 @@
 # pip install PyQt5 matplotlib
+# Standalone viewer, optional: gen_app's Show Metrics plots the same stream natively.
 import socket
+import struct
+import sys
 import threading
+import time
 import re
 from collections import deque
 
@@ -11,6 +15,7 @@ from matplotlib.figure import Figure
 # ---- Config ----
 IP = "0.0.0.0"
 PORT = 5000
+BOARD = None  # (host, port) of a `monitor_sender --listen` to subscribe to, from --connect HOST[:PORT]
 HISTORY = 200  # samples kept in the rolling window
 
 # ---- Regex (unchanged) ----
@@ -18,7 +23,163 @@ pattern = re.compile(
     r"CPU:(\d+\.?\d*)%, CPU0:(\d+\.?\d*)%, CPU1:(\d+\.?\d*)%, RAM:(\d+\.?\d*)%.*?FREQ0:(\d+)\w+, FREQ1:(\d+)\w+, Temp:(\d+\.?\d*)°C"
 )
 
-# ---- Reader thread (TCP server) ----
+# ---- Binary frames (see telemetry_proto.h) ----
+TP_MAGIC = 0x4d545052
+TP_FRAME_HELLO, TP_FRAME_SAMPLES, TP_FRAME_PACKED = 1, 2, 4
+TP_F32, TP_U32, TP_U64, TP_F64, TP_STR = 1, 2, 3, 4, 5
+FRAME_HEADER = struct.Struct('<IBBHIIQHH')
+SAMPLE_HEADER = struct.Struct('<QIHH')
+FIELD_HEADER = struct.Struct('<HHB')
+VALUE_FORMATS = {1: struct.Struct('<f'), 2: struct.Struct('<I'), 3: struct.Struct('<Q'), 4: struct.Struct('<d')}
+FIELD_KEYS = {(2, 0): 'CPU', (3, 0): 'CPU0', (3, 1): 'CPU1', (4, 0): 'RAM',
+              (7, 0): 'FREQ0', (7, 1): 'FREQ1', (8, 0): 'TEMP', (1, 0): 'INTERVAL_US',
+              (10, 0): 'MISSED'}
+# Summed over interfaces and disks, in MB/s (partitions of a listed disk are left out)
+IO_KEYS = {51: 'NET_RX', 52: 'NET_TX', 63: 'DISK_RD', 64: 'DISK_WR'}
+TP_DISK_NAME = 60
+
+# ---- Packed blocks (monitor_sender --compress, see telemetry_pack.h) ----
+PACK_BLOCK_HEADER = struct.Struct('<IHHIQ')
+PACK_STR_BYTES = 32
+TIMESTAMP_WIDTHS = (14, 20, 32, 64)
+
+class BitReader:
+    def __init__(self, data):
+        self.data, self.pos = data, 0
+
+    def get(self, n):
+        v = 0
+        while n:
+            room = 8 - (self.pos & 7)
+            take = min(n, room)
+            v = (v << take) | ((self.data[self.pos >> 3] >> (room - take)) & ((1 << take) - 1))
+            self.pos += take
+            n -= take
+        return v
+
+def signed(v, bits):
+    return v - (1 << bits) if v >> (bits - 1) else v
+
+def unpack_block(buf, off):
+    """Returns (block size, [(timestamp_ns, sequence, [(id, instance, type, value)])])."""
+    size, count, _, seq, ts = PACK_BLOCK_HEADER.unpack_from(buf, off)
+    bits = BitReader(bytes(buf[off + PACK_BLOCK_HEADER.size:off + size]))
+    fields, delta, samples = [], 0, []
+    for n in range(count):
+        if n:
+            prefix = 0
+            while prefix < 4 and bits.get(1):
+                prefix += 1
+            if prefix:
+                width = TIMESTAMP_WIDTHS[prefix - 1]
+                delta += signed(bits.get(width), width)
+            ts += delta
+            seq = bits.get(32) if bits.get(1) else (seq + 1) & 0xffffffff
+        if bits.get(1):
+            bits.get(16)  # sample flags
+        if bits.get(1):
+            # New field list: each field takes over the state of the first one listed before with its key
+            old = {}
+            for f in fields:
+                old.setdefault(f[0], f)
+            new = []
+            for _ in range(bits.get(16)):
+                key = (bits.get(16), bits.get(16), bits.get(8))
+                prev = old.get(key)
+                new.append(list(prev) if prev else [key, 0, 0, 0, False, None])
+            fields = new
+        values = []
+        for f in fields:
+            # f = [key, previous, leading, trailing, window, text]
+            fid, inst, vtype = f[0]
+            if vtype == TP_STR:
+                if bits.get(1):
+                    raw = bytes(bits.get(8) for _ in range(bits.get(16)))
+                    f[5] = raw if len(raw) <= PACK_STR_BYTES else None
+                elif f[5] is None:
+                    raise struct.error('packed string without a previous value')
+                else:
+                    raw = f[5]
+                values.append((fid, inst, vtype, raw.decode('utf-8', 'ignore')))
+                continue
+            width = 64 if vtype in (TP_U64, TP_F64) else 32
+            if bits.get(1):
+                if bits.get(1):
+                    f[2] = bits.get(5)
+                    f[3] = width - f[2] - bits.get(6) - 1
+                    f[4] = True
+                f[1] ^= bits.get(width - f[2] - f[3]) << f[3]
+            v = f[1]
+            if vtype == TP_F32:
+                v = struct.unpack('<f', struct.pack('<I', v))[0]
+            elif vtype == TP_F64:
+                v = struct.unpack('<d', struct.pack('<Q', v))[0]
+            values.append((fid, inst, vtype, v))
+        samples.append((ts, seq, values))
+    return size, samples
+
+def sample_values(ts, seq, fields):
+    """The plotted values of one sample, from its (id, instance, type, value) fields."""
+    vals = {'TS': ts / 1e9, 'SEQ': seq}
+    disks, io = {}, {}
+    for fid, inst, vtype, v in fields:
+        if vtype == TP_STR:
+            if fid == TP_DISK_NAME:
+                disks[inst] = v
+            continue
+        key = FIELD_KEYS.get((fid, inst))
+        if key:
+            vals[key] = float(v)
+        elif fid in IO_KEYS:
+            io[(fid, inst)] = float(v)
+    for (fid, inst), v in io.items():
+        name = disks.get(inst, '') if fid >= TP_DISK_NAME else ''
+        if any(name != d and name.startswith(d) for d in disks.values()):
+            continue
+        vals[IO_KEYS[fid]] = vals.get(IO_KEYS[fid], 0.0) + v / 1e6
+    return vals
+
+def decode_frames(buf):
+    """Yields (frame_type, [sample dict]) for each complete frame and removes it from buf."""
+    while len(buf) >= FRAME_HEADER.size:
+        magic, _, ftype, hbytes, pbytes, _, _, count, _ = FRAME_HEADER.unpack_from(buf)
+        if magic != TP_MAGIC or hbytes < FRAME_HEADER.size:
+            del buf[:1]  # resync on the next magic
+            continue
+        if len(buf) < hbytes + pbytes:
+            return
+        off, samples = hbytes, []
+        try:
+            if ftype == TP_FRAME_PACKED:
+                # sample_count counts blocks; they expand to ordinary samples
+                for _ in range(count):
+                    size, unpacked = unpack_block(buf, off)
+                    off += size
+                    samples.extend(sample_values(*s) for s in unpacked)
+                ftype = TP_FRAME_SAMPLES
+                count = 0
+            for _ in range(count):
+                ts, seq, nfields, _ = SAMPLE_HEADER.unpack_from(buf, off)
+                off += SAMPLE_HEADER.size
+                fields = []
+                for _ in range(nfields):
+                    fid, inst, vtype = FIELD_HEADER.unpack_from(buf, off)
+                    off += FIELD_HEADER.size
+                    if vtype == TP_STR:
+                        n = struct.unpack_from('<H', buf, off)[0]
+                        fields.append((fid, inst, vtype, bytes(buf[off + 2:off + 2 + n]).decode('utf-8', 'ignore')))
+                        off += 2 + n
+                        continue
+                    fmt = VALUE_FORMATS[vtype]
+                    fields.append((fid, inst, vtype, fmt.unpack_from(buf, off)[0]))
+                    off += fmt.size
+                samples.append(sample_values(ts, seq, fields))
+        except (KeyError, IndexError, struct.error):
+            samples = []
+        del buf[:hbytes + pbytes]
+        yield ftype, samples
+
+# ---- Reader thread (TCP server, or subscriber with --connect) ----
 class TcpReader(QtCore.QThread):
     data = QtCore.pyqtSignal(dict)     # emits parsed values
     interval = QtCore.pyqtSignal(float)  # emits seconds
@@ -26,6 +187,11 @@ class TcpReader(QtCore.QThread):
     def run(self):
         while True:
             try:
+                if BOARD:
+                    with socket.create_connection(BOARD) as conn:
+                        print(f"Subscribed to {BOARD[0]}:{BOARD[1]}")
+                        self.serve(conn)
+                    continue
                 with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as srv:
                     srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
                     srv.bind((IP, PORT))
@@ -34,56 +200,73 @@ class TcpReader(QtCore.QThread):
                     conn, addr = srv.accept()
                     print(f"Client {addr} connected")
                     with conn:
-                        buf = bytearray()
-                        while True:
-                            chunk = conn.recv(4096)
-                            if not chunk:
-                                print("Client disconnected")
-                                break
-                            buf.extend(chunk)
-                            # process complete lines
-                            while True:
-                                nl = buf.find(b'\n')
-                                if nl < 0:
-                                    break
-                                line = buf[:nl]
-                                del buf[:nl+1]
-                                s = line.decode('utf-8', 'ignore').strip()
-                                if not s:
-                                    continue
-                                if s.startswith("INTERVAL_US:"):
-                                    try:
-                                        us = int(s.split(':', 1)[1])
-                                        self.interval.emit(max(us/1e6, 0.001))
-                                    except Exception:
-                                        pass
-                                    continue
-
-                                m = pattern.search(s)
-                                if m:
-                                    vals = {
-                                        'CPU'  : float(m.group(1)),
-                                        'CPU0' : float(m.group(2)),
-                                        'CPU1' : float(m.group(3)),
-                                        'RAM'  : float(m.group(4)),
-                                        'FREQ0': float(m.group(5)),
-                                        'FREQ1': float(m.group(6)),
-                                        'TEMP' : float(m.group(7)),
-                                    }
-                                    self.data.emit(vals)
-                                # Optionally print raw line:
-                                # print(s)
+                        self.serve(conn)
             except Exception as e:
                 print(f"[TcpReader] {e} — restarting")
+                if BOARD:
+                    time.sleep(1)
+
+    def serve(self, conn):
+        buf = bytearray()
+        binary = None  # decided from the first bytes
+        while True:
+            chunk = conn.recv(4096)
+            if not chunk:
+                print("Client disconnected")
+                break
+            buf.extend(chunk)
+            if binary is None and len(buf) >= 4:
+                binary = struct.unpack_from('<I', buf)[0] == TP_MAGIC
+            if binary:
+                for ftype, samples in decode_frames(buf):
+                    for vals in samples:
+                        if ftype == TP_FRAME_HELLO and 'INTERVAL_US' in vals:
+                            self.interval.emit(max(vals['INTERVAL_US'] / 1e6, 0.001))
+                        elif ftype == TP_FRAME_SAMPLES:
+                            self.data.emit(vals)
+                continue
+            # process complete lines
+            while True:
+                nl = buf.find(b'\n')
+                if nl < 0:
+                    break
+                line = buf[:nl]
+                del buf[:nl+1]
+                s = line.decode('utf-8', 'ignore').strip()
+                if not s:
+                    continue
+                if s.startswith("INTERVAL_US:"):
+                    try:
+                        us = int(s.split(':', 1)[1])
+                        self.interval.emit(max(us/1e6, 0.001))
+                    except Exception:
+                        pass
+                    continue
+
+                m = pattern.search(s)
+                if m:
+                    vals = {
+                        'CPU'  : float(m.group(1)),
+                        'CPU0' : float(m.group(2)),
+                        'CPU1' : float(m.group(3)),
+                        'RAM'  : float(m.group(4)),
+                        'FREQ0': float(m.group(5)),
+                        'FREQ1': float(m.group(6)),
+                        'TEMP' : float(m.group(7)),
+                    }
+                    self.data.emit(vals)
+                # Optionally print raw line:
+                # print(s)
 
 # ---- Matplotlib canvas ----
 class MplCanvas(FigureCanvas):
     def __init__(self):
-        fig = Figure(figsize=(9, 10), dpi=100)
-        self.ax1 = fig.add_subplot(411)  # CPU
-        self.ax2 = fig.add_subplot(412)  # RAM
-        self.ax3 = fig.add_subplot(413)  # Temp
-        self.ax4 = fig.add_subplot(414)  # Freq
+        fig = Figure(figsize=(9, 12), dpi=100)
+        self.ax1 = fig.add_subplot(511)  # CPU
+        self.ax2 = fig.add_subplot(512)  # RAM
+        self.ax3 = fig.add_subplot(513)  # Temp
+        self.ax4 = fig.add_subplot(514)  # Freq
+        self.ax5 = fig.add_subplot(515)  # Network and disk I/O
         super().__init__(fig)
 
 # ---- Main Window ----
@@ -101,9 +284,12 @@ class Main(QtWidgets.QMainWindow):
         self.temp = deque(maxlen=HISTORY)
         self.f0   = deque(maxlen=HISTORY)
         self.f1   = deque(maxlen=HISTORY)
+        self.io   = {key: deque(maxlen=HISTORY) for key in IO_KEYS.values()}
 
         self.dt = 0.5  # updated by INTERVAL_US
         self.elapsed = 0.0
+        self.t0 = None  # board time of elapsed == 0
+        self.missed = 0
 
         # UI
         central = QtWidgets.QWidget()
@@ -154,6 +340,15 @@ class Main(QtWidgets.QMainWindow):
         ax4.grid(True)
         ax4.legend()
 
+        ax5 = self.canvas.ax5
+        self.l_io = {}
+        for key, label in (('NET_RX', 'Net RX'), ('NET_TX', 'Net TX'), ('DISK_RD', 'Disk read'), ('DISK_WR', 'Disk write')):
+            (self.l_io[key],) = ax5.plot([], [], label=label)
+        ax5.set_ylabel("I/O (MB/s)")
+        ax5.set_xlabel("Time (s)")
+        ax5.grid(True)
+        ax5.legend()
+
         # Reader thread
         self.reader = TcpReader()
         self.reader.data.connect(self.on_data)
@@ -174,9 +369,18 @@ class Main(QtWidgets.QMainWindow):
 
     @QtCore.pyqtSlot(dict)
     def on_data(self, vals):
-        # Advance time
-        self.t.append(self.elapsed)
-        self.elapsed += self.dt
+        if vals.get('MISSED', 0) != self.missed:
+            self.missed = int(vals['MISSED'])
+            self.int_label.setText(f"Interval: {self.dt:.3f} s, missed deadlines: {self.missed}")
+        # Advance time: board timestamps when the frames carry them, else one interval per sample
+        if 'TS' in vals:
+            if self.t0 is None:
+                self.t0 = vals['TS'] - self.elapsed
+            self.elapsed = vals['TS'] - self.t0
+            self.t.append(self.elapsed)
+        else:
+            self.t.append(self.elapsed)
+            self.elapsed += self.dt
 
         # Append with last value fallback
         self.cpu.append(vals.get('CPU',  self.cpu[-1]  if self.cpu  else 0.0))
@@ -186,13 +390,18 @@ class Main(QtWidgets.QMainWindow):
         self.temp.append(vals.get('TEMP', self.temp[-1] if self.temp else 0.0))
         self.f0.append(vals.get('FREQ0', self.f0[-1]   if self.f0   else 0.0))
         self.f1.append(vals.get('FREQ1', self.f1[-1]   if self.f1   else 0.0))
+        for key, q in self.io.items():
+            q.append(vals.get(key, 0.0))
 
     def reset_buffers(self):
         self.t.clear()
         self.cpu.clear(); self.cpu0.clear(); self.cpu1.clear()
         self.ram.clear(); self.temp.clear(); self.f0.clear(); self.f1.clear()
+        for q in self.io.values():
+            q.clear()
         self.elapsed = 0.0
-        for ln in (self.l_cpu, self.l_cpu0, self.l_cpu1, self.l_ram, self.l_temp, self.l_f0, self.l_f1):
+        self.t0 = None
+        for ln in (self.l_cpu, self.l_cpu0, self.l_cpu1, self.l_ram, self.l_temp, self.l_f0, self.l_f1, *self.l_io.values()):
             ln.set_data([], [])
         self.canvas.draw_idle()
 
@@ -210,11 +419,13 @@ class Main(QtWidgets.QMainWindow):
         self.l_temp.set_data(x, list(self.temp))
         self.l_f0.set_data(x,   list(self.f0))
         self.l_f1.set_data(x,   list(self.f1))
+        for key, ln in self.l_io.items():
+            ln.set_data(x, list(self.io[key]))
 
         # keep x limits to visible history
         xmax = x[-1]
         xmin = max(0.0, xmax - (HISTORY-1)*self.dt)
-        for ax in (self.canvas.ax1, self.canvas.ax2, self.canvas.ax3, self.canvas.ax4):
+        for ax in (self.canvas.ax1, self.canvas.ax2, self.canvas.ax3, self.canvas.ax4, self.canvas.ax5):
             ax.set_xlim(xmin, xmax if xmax > 0 else 1.0)
 
         # dynamic y for Temp
@@ -238,12 +449,19 @@ class Main(QtWidgets.QMainWindow):
             else:
                 self.canvas.ax4.set_ylim(max(0, fmin - pad), fmax + pad)
 
+        # dynamic y for I/O, from zero
+        iomax = max((max(q) for q in self.io.values() if q), default=0.0)
+        self.canvas.ax5.set_ylim(0, max(1.0, iomax * 1.1))
+
         self.canvas.draw_idle()
 
 # ---- Run ----
 if __name__ == "__main__":
+    if len(sys.argv) > 2 and sys.argv[1] == "--connect":
+        host, _, port = sys.argv[2].partition(':')
+        BOARD = (host, int(port or PORT))
     app = QtWidgets.QApplication([])
     w = Main()
-    w.resize(1000, 900)
+    w.resize(1000, 1050)
     w.show()
     app.exec_()
\ No newline at end of file
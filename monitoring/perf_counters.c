@@ -0,0 +1,162 @@
+// perf_counters.c
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "perf_counters.h"
+
+static int perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu, int group_fd, unsigned long flags)
+{
+    return (int)syscall(SYS_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
+
+static void counter_attr(enum perf_counter counter, struct perf_event_attr *attr)
+{
+    memset(attr, 0, sizeof(*attr));
+    attr->size = sizeof(*attr);
+    attr->type = PERF_TYPE_HARDWARE;
+    switch (counter)
+    {
+    case PC_CYCLES:
+        attr->config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PC_INSTRUCTIONS:
+        attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PC_L1D_MISSES:
+        attr->type = PERF_TYPE_HW_CACHE;
+        attr->config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case PC_L2_MISSES:
+        // The A9's L2 (PL310) sits outside the core PMU; the generic cache-miss event is its closest view.
+        attr->config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    default:
+        attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    }
+    attr->read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr->disabled = counter == PC_CYCLES;
+}
+
+int perf_counters_open(struct perf_counters *pc, int cores)
+{
+    memset(pc, 0, sizeof(*pc));
+    pc->core = calloc((size_t)cores, sizeof(*pc->core));
+    if (!pc->core)
+        return 0;
+    pc->cores = cores;
+
+    int usable = 0;
+    for (int c = 0; c < cores; c++)
+    {
+        struct perf_core *core = &pc->core[c];
+        for (int i = 0; i < PC_COUNT; i++)
+            core->fds[i] = core->slot[i] = -1;
+
+        struct perf_event_attr attr;
+        for (int i = 0; i < PC_COUNT; i++)
+        {
+            counter_attr((enum perf_counter)i, &attr);
+            int fd = perf_event_open(&attr, -1, c, i == PC_CYCLES ? -1 : core->fds[PC_CYCLES], PERF_FLAG_FD_CLOEXEC);
+            if (fd < 0)
+            {
+                if (i == PC_CYCLES)
+                {
+                    if (c == 0)
+                        perror("perf_event_open (cycles)");
+                    break;
+                }
+                continue; // event not on this PMU, or no counter left for it
+            }
+            core->fds[i] = fd;
+            core->slot[i] = core->members++;
+        }
+        if (core->fds[PC_CYCLES] < 0 || core->fds[PC_INSTRUCTIONS] < 0)
+        {
+            for (int i = 0; i < PC_COUNT; i++)
+                if (core->fds[i] >= 0)
+                    close(core->fds[i]);
+            core->members = 0;
+            continue;
+        }
+        ioctl(core->fds[PC_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(core->fds[PC_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        usable++;
+    }
+    return usable;
+}
+
+void perf_counters_read(struct perf_counters *pc)
+{
+    // nr, time_enabled, time_running, then one value per member.
+    uint64_t values[3 + PC_COUNT];
+    for (int c = 0; c < pc->cores; c++)
+    {
+        struct perf_core *core = &pc->core[c];
+        if (core->members == 0)
+            continue;
+        ssize_t length = read(core->fds[PC_CYCLES], values, sizeof(values));
+        if (length < (ssize_t)(3 * sizeof(uint64_t)) || values[0] != (uint64_t)core->members)
+        {
+            core->valid = 0;
+            continue;
+        }
+
+        // When the PMU was shared with other users the group only ran part of the time; scale up.
+        uint64_t enabled = values[1] - core->last_enabled, running = values[2] - core->last_running;
+        double scale = running > 0 && running < enabled ? (double)enabled / (double)running : 1.0;
+        for (int i = 0; i < PC_COUNT; i++)
+        {
+            if (core->slot[i] < 0)
+                continue;
+            uint64_t value = values[3 + core->slot[i]];
+            core->delta[i] = (uint64_t)((double)(value - core->last[i]) * scale);
+            core->last[i] = value;
+        }
+        core->valid = core->last_enabled != 0 && running > 0;
+        core->last_enabled = values[1];
+        core->last_running = values[2];
+    }
+}
+
+static float per_kilo(uint64_t count, uint64_t instructions)
+{
+    return instructions ? (float)(1000.0 * (double)count / (double)instructions) : 0.0f;
+}
+
+void perf_counters_encode(const struct perf_counters *pc, struct tp_writer *writer)
+{
+    for (int c = 0; c < pc->cores; c++)
+    {
+        const struct perf_core *core = &pc->core[c];
+        if (!core->valid)
+            continue;
+        uint16_t instance = (uint16_t)c;
+        uint64_t instructions = core->delta[PC_INSTRUCTIONS];
+        tp_put_u64(writer, TP_PERF_CYCLES, instance, core->delta[PC_CYCLES]);
+        tp_put_f32(writer, TP_PERF_IPC, instance,
+                   core->delta[PC_CYCLES] ? (float)((double)instructions / (double)core->delta[PC_CYCLES]) : 0.0f);
+        if (core->slot[PC_L1D_MISSES] >= 0)
+            tp_put_f32(writer, TP_PERF_L1D_MPKI, instance, per_kilo(core->delta[PC_L1D_MISSES], instructions));
+        if (core->slot[PC_L2_MISSES] >= 0)
+            tp_put_f32(writer, TP_PERF_L2_MPKI, instance, per_kilo(core->delta[PC_L2_MISSES], instructions));
+        if (core->slot[PC_BRANCH_MISSES] >= 0)
+            tp_put_f32(writer, TP_PERF_BRANCH_MPKI, instance, per_kilo(core->delta[PC_BRANCH_MISSES], instructions));
+    }
+}
+
+void perf_counters_close(struct perf_counters *pc)
+{
+    for (int c = 0; c < pc->cores; c++)
+        for (int i = 0; i < PC_COUNT; i++)
+            if (pc->core[c].fds[i] >= 0)
+                close(pc->core[c].fds[i]);
+    free(pc->core);
+    memset(pc, 0, sizeof(*pc));
+}
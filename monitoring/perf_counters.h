@@ -0,0 +1,46 @@
+// perf_counters.h
+// Per-core hardware counter groups (perf_event_open): cycles lead, instructions, L1D and L2 misses and
+// branch misses follow, so one read() per core returns the whole group.
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+#include "telemetry_proto.h"
+
+enum perf_counter
+{
+    PC_CYCLES,
+    PC_INSTRUCTIONS,
+    PC_L1D_MISSES,
+    PC_L2_MISSES,
+    PC_BRANCH_MISSES,
+    PC_COUNT
+};
+
+struct perf_core
+{
+    int fds[PC_COUNT];            // -1 where the PMU has no such event
+    int slot[PC_COUNT];           // position in the group read, or -1
+    int members;
+    uint64_t last[PC_COUNT];
+    uint64_t delta[PC_COUNT];
+    uint64_t last_enabled;
+    uint64_t last_running;
+    int valid;                    // delta holds a full interval
+};
+
+struct perf_counters
+{
+    int cores;
+    struct perf_core *core;
+};
+
+// Opens a group on every core. Returns the number of cores with at least cycles and instructions.
+int perf_counters_open(struct perf_counters *pc, int cores);
+void perf_counters_read(struct perf_counters *pc);
+void perf_counters_encode(const struct perf_counters *pc, struct tp_writer *writer);
+void perf_counters_close(struct perf_counters *pc);
+
+#define PC_ENCODED_BYTES_PER_CORE (5 * 9 + 13)
+
+#endif
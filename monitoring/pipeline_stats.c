@@ -0,0 +1,167 @@
+// pipeline_stats.c
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "pipeline_stats.h"
+
+void pipeline_stats_init(struct pipeline_stats *ps)
+{
+    memset(ps, 0, sizeof(*ps));
+}
+
+static void try_map(struct pipeline_stats *ps)
+{
+    int fd = open(RP_STATS_PATH, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(struct rp_stats_block))
+    {
+        void *mapping = mmap(NULL, sizeof(struct rp_stats_block), PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED)
+            ps->block = mapping;
+    }
+    close(fd);
+}
+
+// Counters are copied one by one with atomic loads, so a 64-bit value is never torn on the 32-bit board.
+static void copy_stage(struct rp_stats_stage *dst, const struct rp_stats_stage *src)
+{
+    memcpy(dst->name, src->name, sizeof(dst->name));
+    dst->name[sizeof(dst->name) - 1] = 0;
+    dst->capacity = __atomic_load_n(&src->capacity, __ATOMIC_RELAXED);
+    dst->depth = __atomic_load_n(&src->depth, __ATOMIC_RELAXED);
+    dst->depth_max = __atomic_load_n(&src->depth_max, __ATOMIC_RELAXED);
+    dst->items = __atomic_load_n(&src->items, __ATOMIC_RELAXED);
+    dst->drops = __atomic_load_n(&src->drops, __ATOMIC_RELAXED);
+    dst->latency_sum_ns = __atomic_load_n(&src->latency_sum_ns, __ATOMIC_RELAXED);
+    for (int b = 0; b < RP_STATS_BUCKETS; b++)
+        dst->latency_buckets[b] = __atomic_load_n(&src->latency_buckets[b], __ATOMIC_RELAXED);
+}
+
+// Seqlock read of the layout: retried while a stage is being registered or the block re-initialized.
+static int snapshot(struct pipeline_stats *ps, uint32_t *generation)
+{
+    const struct rp_stats_block *block = ps->block;
+    for (int attempt = 0; attempt < 4; attempt++)
+    {
+        uint32_t before = __atomic_load_n(&block->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1u)
+            continue;
+        if (block->magic != RP_STATS_MAGIC || block->version != RP_STATS_VERSION)
+            return -1;
+        uint32_t count = block->stage_count < RP_STATS_MAX_STAGES ? block->stage_count : RP_STATS_MAX_STAGES;
+        *generation = block->generation;
+        for (uint32_t i = 0; i < count; i++)
+            copy_stage(&ps->curr[i], &block->stages[i]);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&block->sequence, __ATOMIC_RELAXED) == before)
+        {
+            ps->stage_count = count;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Latency below which a share q of the interval's items completed, interpolated inside the log2 bucket.
+static float percentile_us(const uint64_t *counts, uint64_t total, double q)
+{
+    if (total == 0)
+        return 0.0f;
+    double rank = q * (double)total, seen = 0.0;
+    for (int b = 0; b < RP_STATS_BUCKETS; b++)
+    {
+        if (counts[b] == 0 || seen + (double)counts[b] < rank)
+        {
+            seen += (double)counts[b];
+            continue;
+        }
+        double low = b == 0 ? 0.0 : (double)(1ull << b), high = (double)(1ull << (b + 1));
+        return (float)((low + (high - low) * (rank - seen) / (double)counts[b]) / 1000.0);
+    }
+    return (float)((double)(1ull << RP_STATS_BUCKETS) / 1000.0);
+}
+
+int pipeline_stats_read(struct pipeline_stats *ps, uint64_t now_ns)
+{
+    if (now_ns - ps->last_check_ns >= PS_REOPEN_NS || ps->last_check_ns == 0)
+    {
+        // Once per second: look for the block, and whether the process that owns it still runs.
+        ps->last_check_ns = now_ns;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            if (!ps->block)
+                try_map(ps);
+            ps->live = ps->block && ps->block->pid != 0 && (kill((pid_t)ps->block->pid, 0) == 0 || errno != ESRCH);
+            if (ps->live || !ps->block || pass == 1)
+                break;
+            // The owner is gone; a restarted pipeline may have recreated the file, so map it afresh.
+            munmap((void *)ps->block, sizeof(struct rp_stats_block));
+            ps->block = NULL;
+        }
+    }
+    uint32_t generation;
+    if (!ps->live || snapshot(ps, &generation) != 0)
+    {
+        ps->have_previous = 0;
+        return -1;
+    }
+
+    double elapsed_s = (double)(now_ns - ps->last_ns) / 1e9;
+    int deltas = ps->have_previous && generation == ps->generation && elapsed_s > 0;
+    for (uint32_t i = 0; i < ps->stage_count; i++)
+    {
+        const struct rp_stats_stage *curr = &ps->curr[i], *prev = &ps->prev[i];
+        if (!deltas || strcmp(curr->name, prev->name) != 0)
+        {
+            ps->items_per_s[i] = ps->mean_us[i] = ps->p50_us[i] = ps->p99_us[i] = 0.0f;
+            continue;
+        }
+        uint64_t items = curr->items - prev->items;
+        uint64_t counts[RP_STATS_BUCKETS], total = 0;
+        for (int b = 0; b < RP_STATS_BUCKETS; b++)
+            total += counts[b] = curr->latency_buckets[b] - prev->latency_buckets[b];
+        ps->items_per_s[i] = (float)((double)items / elapsed_s);
+        ps->mean_us[i] = total ? (float)((double)(curr->latency_sum_ns - prev->latency_sum_ns) / (double)total / 1000.0) : 0.0f;
+        ps->p50_us[i] = percentile_us(counts, total, 0.50);
+        ps->p99_us[i] = percentile_us(counts, total, 0.99);
+    }
+    memcpy(ps->prev, ps->curr, sizeof(ps->prev));
+    ps->generation = generation;
+    ps->have_previous = 1;
+    ps->last_ns = now_ns;
+    return 0;
+}
+
+void pipeline_stats_encode(const struct pipeline_stats *ps, struct tp_writer *writer)
+{
+    if (!ps->have_previous)
+        return;
+    for (uint32_t i = 0; i < ps->stage_count; i++)
+    {
+        const struct rp_stats_stage *stage = &ps->curr[i];
+        uint16_t instance = (uint16_t)i;
+        tp_put_str(writer, TP_STAGE_NAME, instance, stage->name);
+        tp_put_u32(writer, TP_STAGE_DEPTH, instance, stage->depth);
+        tp_put_u32(writer, TP_STAGE_DEPTH_MAX, instance, stage->depth_max);
+        tp_put_u32(writer, TP_STAGE_CAPACITY, instance, stage->capacity);
+        tp_put_u64(writer, TP_STAGE_DROPS, instance, stage->drops);
+        tp_put_f32(writer, TP_STAGE_ITEMS_PER_S, instance, ps->items_per_s[i]);
+        tp_put_f32(writer, TP_STAGE_LATENCY_MEAN_US, instance, ps->mean_us[i]);
+        tp_put_f32(writer, TP_STAGE_LATENCY_P50_US, instance, ps->p50_us[i]);
+        tp_put_f32(writer, TP_STAGE_LATENCY_P99_US, instance, ps->p99_us[i]);
+    }
+}
+
+void pipeline_stats_close(struct pipeline_stats *ps)
+{
+    if (ps->block)
+        munmap((void *)ps->block, sizeof(struct rp_stats_block));
+    memset(ps, 0, sizeof(*ps));
+}
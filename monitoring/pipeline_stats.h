@@ -0,0 +1,40 @@
+// pipeline_stats.h
+// Reader of the block the exported pipeline publishes through rp_stats.h: queue depth, drops, throughput and
+// latency percentiles per stage, from a read-only mapping (no syscall per sample).
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <stdint.h>
+#define RP_STATS_READER
+#include "rp_stats.h"
+#include "telemetry_proto.h"
+
+#define PS_REOPEN_NS 1000000000ull
+
+struct pipeline_stats
+{
+    const struct rp_stats_block *block;
+    uint64_t last_check_ns;
+    uint64_t last_ns;
+    uint32_t generation;
+    uint32_t stage_count;
+    int live;          // the owning process is running
+    int have_previous; // prev holds a snapshot of the same generation
+    struct rp_stats_stage prev[RP_STATS_MAX_STAGES];
+    struct rp_stats_stage curr[RP_STATS_MAX_STAGES];
+    float items_per_s[RP_STATS_MAX_STAGES];
+    float mean_us[RP_STATS_MAX_STAGES];
+    float p50_us[RP_STATS_MAX_STAGES];
+    float p99_us[RP_STATS_MAX_STAGES];
+};
+
+void pipeline_stats_init(struct pipeline_stats *ps);
+// Returns 0 when a running pipeline's stages were read.
+int pipeline_stats_read(struct pipeline_stats *ps, uint64_t now_ns);
+void pipeline_stats_encode(const struct pipeline_stats *ps, struct tp_writer *writer);
+void pipeline_stats_close(struct pipeline_stats *ps);
+
+// Upper bound of what pipeline_stats_encode writes.
+#define PS_ENCODED_BYTES (RP_STATS_MAX_STAGES * (TP_FIELD_HEADER_BYTES + 2 + RP_STATS_NAME_BYTES + 7 * 9 + 13))
+
+#endif
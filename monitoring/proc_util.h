@@ -0,0 +1,58 @@
+// proc_util.h
+// Helpers shared by the monitor_sender samplers: re-reading kept-open /proc and sysfs files with
+// pread() and parsing their numbers without stdio.
+#ifndef PROC_UTIL_H
+#define PROC_UTIL_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Reads the whole file from offset 0 into buf (NUL-terminated, truncated to size - 1).
+static inline ssize_t read_fd(int fd, char *buf, size_t size)
+{
+    size_t length = 0;
+    while (length + 1 < size)
+    {
+        ssize_t n = pread(fd, buf + length, size - 1 - length, (off_t)length);
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            break;
+        length += (size_t)n;
+    }
+    buf[length] = 0;
+    return (ssize_t)length;
+}
+
+static inline const char *parse_ull(const char *p, unsigned long long *value)
+{
+    while (*p == ' ' || *p == '\t')
+        p++;
+    unsigned long long v = 0;
+    while (*p >= '0' && *p <= '9')
+        v = v * 10 + (unsigned long long)(*p++ - '0');
+    *value = v;
+    return p;
+}
+
+static inline const char *find_value(const char *text, const char *key, unsigned long *value)
+{
+    const char *p = strstr(text, key);
+    if (!p)
+        return NULL;
+    unsigned long long v;
+    p = parse_ull(p + strlen(key), &v);
+    *value = (unsigned long)v;
+    return p;
+}
+
+static inline uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#endif
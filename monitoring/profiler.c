@@ -0,0 +1,372 @@
+// profiler.c
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "profiler.h"
+#include "telemetry_proto.h"
+
+#define RECORD_BYTES 65536 // perf_event_header.size is a u16
+
+static int perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu, int group_fd, unsigned long flags)
+{
+    return (int)syscall(SYS_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
+
+static int open_core(struct profiler *p, int cpu, uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.freq = 1;
+    attr.sample_freq = p->frequency_hz;
+    attr.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.exclude_callchain_kernel = 1;
+    // Wake the poll once half the ring is used, whatever the tick interval.
+    attr.watermark = 1;
+    attr.wakeup_watermark = (uint32_t)(p->data_size / 2);
+    return perf_event_open(&attr, -1, cpu, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+int profiler_open(struct profiler *p, int cores, unsigned int frequency_hz)
+{
+    memset(p, 0, sizeof(*p));
+    p->frequency_hz = frequency_hz ? frequency_hz : PF_DEFAULT_HZ;
+    p->page_size = (size_t)sysconf(_SC_PAGESIZE);
+    p->data_size = PF_RING_PAGES * p->page_size;
+    p->core = calloc((size_t)cores, sizeof(*p->core));
+    p->table = calloc(PF_TABLE_SLOTS, sizeof(*p->table));
+    p->arena = malloc(PF_ARENA_ADDRESSES * sizeof(*p->arena));
+    p->record = malloc(RECORD_BYTES);
+    p->mappings = malloc(PF_MAX_MAPPINGS * sizeof(*p->mappings));
+    if (!p->core || !p->table || !p->arena || !p->record || !p->mappings)
+    {
+        profiler_close(p);
+        return 0;
+    }
+    p->cores = cores;
+
+    int usable = 0;
+    for (int c = 0; c < cores; c++)
+    {
+        struct pf_core *core = &p->core[c];
+        core->ring = MAP_FAILED;
+        // Cycles where the PMU has them; the cpu-clock timer otherwise, which samples the same way.
+        core->fd = open_core(p, c, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        if (core->fd < 0)
+            core->fd = open_core(p, c, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK);
+        if (core->fd < 0)
+        {
+            if (c == 0)
+                perror("perf_event_open (sampling)");
+            continue;
+        }
+        core->ring = mmap(NULL, p->page_size + p->data_size, PROT_READ | PROT_WRITE, MAP_SHARED, core->fd, 0);
+        if (core->ring == MAP_FAILED)
+        {
+            if (c == 0)
+                perror("mmap (perf ring)");
+            close(core->fd);
+            core->fd = -1;
+            continue;
+        }
+        ioctl(core->fd, PERF_EVENT_IOC_ENABLE, 0);
+        usable++;
+    }
+    return usable;
+}
+
+static void copy_out(const struct profiler *p, const uint8_t *data, uint64_t position, void *dst, size_t length)
+{
+    size_t offset = (size_t)(position & (p->data_size - 1));
+    size_t first = p->data_size - offset < length ? p->data_size - offset : length;
+    memcpy(dst, data + offset, first);
+    memcpy((uint8_t *)dst + first, data, length - first);
+}
+
+static uint32_t hash_stack(uint32_t tid, const uint64_t *addresses, uint16_t depth)
+{
+    uint32_t hash = 2166136261u ^ tid;
+    for (uint16_t i = 0; i < depth; i++)
+    {
+        hash = (hash ^ (uint32_t)addresses[i]) * 16777619u;
+        hash = (hash ^ (uint32_t)(addresses[i] >> 32)) * 16777619u;
+    }
+    return hash;
+}
+
+static void fold(struct profiler *p, uint32_t tid, const uint64_t *addresses, uint16_t depth)
+{
+    uint32_t hash = hash_stack(tid, addresses, depth);
+    for (uint32_t probe = 0; probe < PF_TABLE_SLOTS; probe++)
+    {
+        struct pf_stack *slot = &p->table[(hash + probe) & (PF_TABLE_SLOTS - 1)];
+        if (slot->count == 0)
+        {
+            if (p->stack_count >= PF_TABLE_SLOTS * 7 / 8 || p->arena_used + depth > PF_ARENA_ADDRESSES)
+                break;
+            slot->hash = hash;
+            slot->tid = tid;
+            slot->count = 1;
+            slot->depth = depth;
+            slot->first = p->arena_used;
+            memcpy(p->arena + p->arena_used, addresses, depth * sizeof(*addresses));
+            p->arena_used += depth;
+            p->stack_count++;
+            p->samples++;
+            return;
+        }
+        if (slot->hash == hash && slot->tid == tid && slot->depth == depth &&
+            memcmp(p->arena + slot->first, addresses, depth * sizeof(*addresses)) == 0)
+        {
+            slot->count++;
+            p->samples++;
+            return;
+        }
+    }
+    p->lost++;
+}
+
+// sample = ip u64 | pid u32 | tid u32 | nr u64 | ips u64 * nr, the order PERF_SAMPLE_* bits are laid out in.
+static void handle_sample(struct profiler *p, const uint8_t *record, size_t length, pid_t pid)
+{
+    if (length < sizeof(struct perf_event_header) + 24)
+        return;
+    const uint8_t *body = record + sizeof(struct perf_event_header);
+    uint64_t ip, nr;
+    uint32_t sample_pid, tid;
+    memcpy(&ip, body, 8);
+    memcpy(&sample_pid, body + 8, 4);
+    memcpy(&tid, body + 12, 4);
+    memcpy(&nr, body + 16, 8);
+    if (pid <= 0 || sample_pid != (uint32_t)pid)
+        return;
+    if (nr > (length - sizeof(struct perf_event_header) - 24) / 8)
+        return;
+
+    uint64_t addresses[PF_MAX_DEPTH];
+    uint16_t depth = 0;
+    for (uint64_t i = 0; i < nr && depth < PF_MAX_DEPTH; i++)
+    {
+        uint64_t address;
+        memcpy(&address, body + 24 + 8 * i, 8);
+        if (address >= (uint64_t)PERF_CONTEXT_MAX) // PERF_CONTEXT_USER and other markers
+            continue;
+        addresses[depth++] = address;
+    }
+    if (depth == 0)
+        addresses[depth++] = ip;
+    fold(p, tid, addresses, depth);
+}
+
+void profiler_drain(struct profiler *p, pid_t pid)
+{
+    for (int c = 0; c < p->cores; c++)
+    {
+        struct pf_core *core = &p->core[c];
+        if (core->fd < 0)
+            continue;
+        struct perf_event_mmap_page *meta = core->ring;
+        const uint8_t *data = (const uint8_t *)core->ring + p->page_size;
+        uint64_t head = __atomic_load_n(&meta->data_head, __ATOMIC_ACQUIRE);
+        uint64_t tail = meta->data_tail;
+
+        while (head - tail >= sizeof(struct perf_event_header))
+        {
+            struct perf_event_header header;
+            copy_out(p, data, tail, &header, sizeof(header));
+            if (header.size < sizeof(header) || header.size > head - tail)
+                break;
+            const uint8_t *record = data + (tail & (p->data_size - 1));
+            if ((tail & (p->data_size - 1)) + header.size > p->data_size)
+            {
+                copy_out(p, data, tail, p->record, header.size);
+                record = p->record;
+            }
+            if (header.type == PERF_RECORD_SAMPLE)
+                handle_sample(p, record, header.size, pid);
+            else if (header.type == PERF_RECORD_LOST && header.size >= sizeof(header) + 16)
+            {
+                uint64_t lost;
+                memcpy(&lost, record + sizeof(header) + 8, 8);
+                p->lost += (uint32_t)lost;
+            }
+            tail += header.size;
+        }
+        __atomic_store_n(&meta->data_tail, tail, __ATOMIC_RELEASE);
+    }
+}
+
+int profiler_full(const struct profiler *p)
+{
+    return p->stack_count >= PF_TABLE_SLOTS / 2 || p->arena_used >= PF_ARENA_ADDRESSES / 2;
+}
+
+static int read_mappings(struct profiler *p, pid_t pid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/maps", (int)pid);
+    FILE *maps = fopen(path, "re");
+    if (!maps)
+        return 0;
+    int count = 0;
+    char line[512];
+    while (count < PF_MAX_MAPPINGS && fgets(line, sizeof(line), maps))
+    {
+        // start-end perms offset dev inode path
+        struct pf_mapping *m = &p->mappings[count];
+        char perms[8];
+        int path_start = 0;
+        if (sscanf(line, "%" SCNx64 "-%" SCNx64 " %7s %" SCNx64 " %*s %*s %n", &m->start, &m->end, perms, &m->offset, &path_start) < 4 ||
+            strchr(perms, 'x') == NULL || path_start == 0 || line[path_start] != '/')
+            continue;
+        snprintf(m->path, sizeof(m->path), "%s", line + path_start);
+        m->path[strcspn(m->path, "\n")] = 0;
+        count++;
+    }
+    fclose(maps);
+    return count;
+}
+
+static void read_thread_name(pid_t pid, uint32_t tid, char name[16])
+{
+    char path[96];
+    snprintf(path, sizeof(path), "/proc/%d/task/%u/comm", (int)pid, tid);
+    name[0] = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    ssize_t length = read(fd, name, 15);
+    close(fd);
+    name[length > 0 ? length : 0] = 0;
+    name[strcspn(name, "\n")] = 0;
+}
+
+static void put_bytes(struct tp_writer *w, const void *bytes, size_t length)
+{
+    uint8_t *p = tp_reserve(w, length);
+    if (p)
+        memcpy(p, bytes, length);
+}
+
+static void put_u16(struct tp_writer *w, uint16_t v)
+{
+    uint8_t *p = tp_reserve(w, 2);
+    if (p)
+        tp_put16(p, v);
+}
+
+static void put_u32(struct tp_writer *w, uint32_t v)
+{
+    uint8_t *p = tp_reserve(w, 4);
+    if (p)
+        tp_put32(p, v);
+}
+
+static void put_u64(struct tp_writer *w, uint64_t v)
+{
+    uint8_t *p = tp_reserve(w, 8);
+    if (p)
+        tp_put64(p, v);
+}
+
+int profiler_write(struct profiler *p, int fd, pid_t pid, uint32_t sequence, uint64_t timestamp_ns)
+{
+    int mapping_count = pid > 0 ? read_mappings(p, pid) : 0;
+
+    uint32_t tids[PF_MAX_THREADS];
+    int thread_count = 0;
+    for (uint32_t i = 0; i < PF_TABLE_SLOTS; i++)
+    {
+        const struct pf_stack *slot = &p->table[i];
+        int known = 0;
+        for (int t = 0; slot->count && t < thread_count && !known; t++)
+            known = tids[t] == slot->tid;
+        if (slot->count && !known && thread_count < PF_MAX_THREADS)
+            tids[thread_count++] = slot->tid;
+    }
+
+    size_t capacity = TP_FRAME_HEADER_BYTES + TP_PROFILE_HEADER_BYTES + (size_t)mapping_count * (26 + sizeof(p->mappings[0].path)) +
+                      (size_t)thread_count * (6 + 16) + (size_t)p->stack_count * 10 + (size_t)p->arena_used * 8;
+    uint8_t *buf = malloc(capacity);
+    if (!buf)
+        return -1;
+    struct tp_writer writer;
+    tp_writer_init(&writer, buf, capacity);
+    tp_begin_frame(&writer, TP_FRAME_PROFILE, sequence, timestamp_ns);
+
+    put_u32(&writer, (uint32_t)pid);
+    put_u32(&writer, p->frequency_hz);
+    put_u32(&writer, p->samples);
+    put_u32(&writer, p->lost);
+    put_u16(&writer, (uint16_t)mapping_count);
+    put_u16(&writer, (uint16_t)thread_count);
+    put_u32(&writer, p->stack_count);
+    for (int i = 0; i < mapping_count; i++)
+    {
+        const struct pf_mapping *m = &p->mappings[i];
+        put_u64(&writer, m->start);
+        put_u64(&writer, m->end);
+        put_u64(&writer, m->offset);
+        put_u16(&writer, (uint16_t)strlen(m->path));
+        put_bytes(&writer, m->path, strlen(m->path));
+    }
+    for (int t = 0; t < thread_count; t++)
+    {
+        char name[16];
+        read_thread_name(pid, tids[t], name);
+        put_u32(&writer, tids[t]);
+        put_u16(&writer, (uint16_t)strlen(name));
+        put_bytes(&writer, name, strlen(name));
+    }
+    for (uint32_t i = 0; i < PF_TABLE_SLOTS; i++)
+    {
+        const struct pf_stack *slot = &p->table[i];
+        if (slot->count == 0)
+            continue;
+        put_u32(&writer, slot->count);
+        put_u32(&writer, slot->tid);
+        put_u16(&writer, slot->depth);
+        for (uint16_t d = 0; d < slot->depth; d++)
+            put_u64(&writer, p->arena[slot->first + d]);
+    }
+
+    size_t length = tp_end_frame(&writer);
+    ssize_t written = length ? write(fd, buf, length) : -1;
+    free(buf);
+
+    memset(p->table, 0, PF_TABLE_SLOTS * sizeof(*p->table));
+    p->stack_count = p->arena_used = 0;
+    p->samples = p->lost = 0;
+    return written == (ssize_t)length ? 0 : -1;
+}
+
+void profiler_close(struct profiler *p)
+{
+    for (int c = 0; c < p->cores; c++)
+    {
+        if (p->core[c].ring != MAP_FAILED)
+            munmap(p->core[c].ring, p->page_size + p->data_size);
+        if (p->core[c].fd >= 0)
+            close(p->core[c].fd);
+    }
+    free(p->core);
+    free(p->table);
+    free(p->arena);
+    free(p->record);
+    free(p->mappings);
+    memset(p, 0, sizeof(*p));
+}
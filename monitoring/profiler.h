@@ -0,0 +1,70 @@
+// profiler.h
+// Statistical profiler (--profile-out): one sampling event per core (perf_event_open, IP + user callchain)
+// writing into an mmapped ring that is drained on every tick, or as soon as it is half full. Samples of the
+// tracked process are folded into (thread, stack) counts and written out as TP_FRAME_PROFILE frames with the
+// executable mappings and thread names the host needs to symbolize them.
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define PF_DEFAULT_HZ 499        // off the round rates, so sampling does not lock step with periodic work
+#define PF_MAX_DEPTH 64
+#define PF_TABLE_SLOTS 4096      // distinct stacks per frame; a power of two
+#define PF_ARENA_ADDRESSES 32768 // return addresses stored per frame
+#define PF_RING_PAGES 32         // data pages per core; a power of two
+#define PF_MAX_MAPPINGS 128
+#define PF_MAX_THREADS 256
+
+struct pf_core
+{
+    int fd;
+    void *ring; // metadata page followed by the data pages
+};
+
+struct pf_stack
+{
+    uint32_t hash;
+    uint32_t tid;
+    uint32_t count; // 0: free slot
+    uint32_t first; // index in the address arena
+    uint16_t depth;
+};
+
+struct pf_mapping
+{
+    uint64_t start;
+    uint64_t end;
+    uint64_t offset;
+    char path[256];
+};
+
+struct profiler
+{
+    int cores;
+    struct pf_core *core;
+    size_t page_size;
+    size_t data_size;
+    unsigned int frequency_hz;
+    uint32_t samples;     // folded since the last frame
+    uint32_t lost;        // dropped by the kernel or for want of room since the last frame
+    uint32_t stack_count;
+    uint32_t arena_used;
+    struct pf_stack *table;
+    uint64_t *arena;
+    uint8_t *record;      // a record that wraps around the end of the ring, copied out
+    struct pf_mapping *mappings;
+};
+
+// Returns the number of cores sampling, or 0 when perf_event_open is not permitted.
+int profiler_open(struct profiler *p, int cores, unsigned int frequency_hz);
+// Folds the samples of pid queued since the last call; drops them all while pid is 0 (target not running).
+void profiler_drain(struct profiler *p, pid_t pid);
+// 1 when the table should be written out before the next drain.
+int profiler_full(const struct profiler *p);
+// Appends one TP_FRAME_PROFILE frame to fd and starts a new table. Returns -1 on a write error.
+int profiler_write(struct profiler *p, int fd, pid_t pid, uint32_t sequence, uint64_t timestamp_ns);
+void profiler_close(struct profiler *p);
+
+#endif
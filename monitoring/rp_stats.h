@@ -0,0 +1,216 @@
+// rp_stats.h
+// Pipeline statistics shared with monitor_sender. The toolbox copies this header into every exported version;
+// the pipeline includes it and reports from its stages, monitor_sender maps the same block read-only and
+// forwards it with the system metrics.
+//
+//   int acq = rp_stats_stage("acquisition", QUEUE_CAPACITY);   once per stage, at start-up
+//   rp_stats_depth(acq, queued);                              whenever the queue depth changes
+//   rp_stats_drop(acq, 1);                                    when an item is discarded
+//   rp_stats_done(acq, rp_stats_now() - started_ns);          per item, with its latency in the stage
+//
+// Exactly one file of the program defines RP_STATS_IMPLEMENTATION before including it, so that all of them
+// share one mapping. The toolbox does so in the exported model.c, which reports every inference as the
+// "inference" stage; the version's own stages (acquisition, output) only have to include the header.
+//
+// The block lives in a POSIX shared memory object (/dev/shm/rp_pipeline_stats, no -lrt needed). Reporting is
+// a few relaxed atomic adds: no lock and no syscall. The block header is a seqlock that only (re)initialization
+// and stage registration take, one writer at a time under a flock on the file, so a reader either sees a
+// consistent layout or retries.
+#ifndef RP_STATS_H
+#define RP_STATS_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RP_STATS_PATH "/dev/shm/rp_pipeline_stats"
+#define RP_STATS_MAGIC 0x53545052u /* "RPTS" */
+#define RP_STATS_VERSION 1u
+#define RP_STATS_MAX_STAGES 8
+#define RP_STATS_NAME_BYTES 16
+#define RP_STATS_BUCKETS 32 /* bucket b: latencies below 2^(b+1) ns and not below 2^b (bucket 0 also holds 0) */
+
+struct rp_stats_stage
+{
+    char name[RP_STATS_NAME_BYTES];
+    uint32_t capacity;  /* queue capacity, 0 when unbounded */
+    uint32_t depth;     /* gauge */
+    uint32_t depth_max; /* since start */
+    uint32_t reserved;
+    uint64_t items;
+    uint64_t drops;
+    uint64_t latency_sum_ns;
+    uint64_t latency_buckets[RP_STATS_BUCKETS];
+};
+
+struct rp_stats_block
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sequence;    /* seqlock: odd while the layout is being written */
+    uint32_t stage_count;
+    uint32_t pid;         /* process that initialized the block */
+    uint32_t generation;  /* bumped on every (re)initialization, so readers reset their deltas */
+    struct rp_stats_stage stages[RP_STATS_MAX_STAGES];
+};
+
+static inline uint32_t rp_stats_bucket(uint64_t ns)
+{
+    uint32_t bucket = ns ? 63u - (uint32_t)__builtin_clzll(ns) : 0u;
+    return bucket < RP_STATS_BUCKETS ? bucket : RP_STATS_BUCKETS - 1;
+}
+
+#ifndef RP_STATS_READER
+
+extern struct rp_stats_block *rp_stats_block_ptr;
+#ifdef RP_STATS_IMPLEMENTATION
+struct rp_stats_block *rp_stats_block_ptr;
+#endif
+
+static inline uint64_t rp_stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Layout changes are rare; the seqlock sequence doubles as the writers' lock (even -> odd). */
+static inline void rp_stats_write_begin(struct rp_stats_block *block)
+{
+    uint32_t sequence;
+    do
+        sequence = __atomic_load_n(&block->sequence, __ATOMIC_ACQUIRE) & ~1u;
+    while (!__atomic_compare_exchange_n(&block->sequence, &sequence, sequence + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+}
+
+static inline void rp_stats_write_end(struct rp_stats_block *block)
+{
+    __atomic_fetch_add(&block->sequence, 1, __ATOMIC_RELEASE);
+}
+
+/* The block's file under an exclusive flock, which makes the ownership check and reset of rp_stats_open() and
+ * the stage registration one step per process or thread. -1 on failure. */
+static inline int rp_stats_lock(void)
+{
+    int fd = open(RP_STATS_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd >= 0 && flock(fd, LOCK_EX) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/* Unlocked explicitly: a mapping made through fd keeps its open file, and with it the flock, past close(). */
+static inline void rp_stats_unlock(int fd)
+{
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+/* Maps the block, and resets it unless another live process of the pipeline already owns it (forked or
+ * separately started stages share one block). Called by rp_stats_stage(); returns 0 on success. */
+static inline int rp_stats_open(void)
+{
+    if (__atomic_load_n(&rp_stats_block_ptr, __ATOMIC_ACQUIRE))
+        return 0;
+    int fd = rp_stats_lock();
+    if (fd < 0)
+        return -1;
+    /* Never truncated or shrunk: monitor_sender may hold a mapping of it. */
+    struct stat st;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && ((size_t)st.st_size >= sizeof(struct rp_stats_block) || ftruncate(fd, sizeof(struct rp_stats_block)) == 0))
+        mapping = mmap(0, sizeof(struct rp_stats_block), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        rp_stats_unlock(fd);
+        return -1;
+    }
+
+    struct rp_stats_block *block = (struct rp_stats_block *)mapping;
+    int owned = block->magic == RP_STATS_MAGIC && block->version == RP_STATS_VERSION && block->pid != 0 &&
+                (kill((pid_t)block->pid, 0) == 0 || errno != ESRCH);
+    if (!owned)
+    {
+        if (block->sequence & 1u)
+            block->sequence++; /* the previous owner died mid-update */
+        rp_stats_write_begin(block);
+        memset(block->stages, 0, sizeof(block->stages));
+        block->stage_count = 0;
+        block->pid = (uint32_t)getpid();
+        block->generation++;
+        block->version = RP_STATS_VERSION;
+        block->magic = RP_STATS_MAGIC;
+        rp_stats_write_end(block);
+    }
+    rp_stats_unlock(fd);
+
+    /* Another thread of this process may have mapped it meanwhile. */
+    struct rp_stats_block *expected = 0;
+    if (!__atomic_compare_exchange_n(&rp_stats_block_ptr, &expected, block, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        munmap(mapping, sizeof(struct rp_stats_block));
+    return 0;
+}
+
+/* Registers a stage (or finds it by name) and returns its index, or -1; the other calls ignore -1. */
+static inline int rp_stats_stage(const char *name, uint32_t capacity)
+{
+    int fd = -1;
+    if (rp_stats_open() != 0 || (fd = rp_stats_lock()) < 0)
+        return -1;
+    struct rp_stats_block *block = rp_stats_block_ptr;
+    rp_stats_write_begin(block);
+
+    int index = -1;
+    for (uint32_t i = 0; i < block->stage_count && index < 0; i++)
+        if (strncmp(block->stages[i].name, name, RP_STATS_NAME_BYTES - 1) == 0)
+            index = (int)i;
+    if (index < 0 && block->stage_count < RP_STATS_MAX_STAGES)
+    {
+        struct rp_stats_stage *stage = &block->stages[block->stage_count];
+        strncpy(stage->name, name, RP_STATS_NAME_BYTES - 1);
+        stage->capacity = capacity;
+        index = (int)block->stage_count++;
+    }
+    rp_stats_write_end(block);
+    rp_stats_unlock(fd);
+    return index;
+}
+
+static inline void rp_stats_depth(int stage, uint32_t depth)
+{
+    if (stage < 0 || !rp_stats_block_ptr)
+        return;
+    struct rp_stats_stage *s = &rp_stats_block_ptr->stages[stage];
+    __atomic_store_n(&s->depth, depth, __ATOMIC_RELAXED);
+    uint32_t max = __atomic_load_n(&s->depth_max, __ATOMIC_RELAXED);
+    while (depth > max && !__atomic_compare_exchange_n(&s->depth_max, &max, depth, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static inline void rp_stats_drop(int stage, uint32_t count)
+{
+    if (stage >= 0 && rp_stats_block_ptr)
+        __atomic_fetch_add(&rp_stats_block_ptr->stages[stage].drops, count, __ATOMIC_RELAXED);
+}
+
+static inline void rp_stats_done(int stage, uint64_t latency_ns)
+{
+    if (stage < 0 || !rp_stats_block_ptr)
+        return;
+    struct rp_stats_stage *s = &rp_stats_block_ptr->stages[stage];
+    __atomic_fetch_add(&s->latency_buckets[rp_stats_bucket(latency_ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->latency_sum_ns, latency_ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->items, 1, __ATOMIC_RELAXED);
+}
+
+#endif
+#endif
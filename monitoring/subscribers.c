@@ -0,0 +1,264 @@
+// subscribers.c
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "subscribers.h"
+
+#define SUB_EVENTS 16
+#define SUB_IOV 16
+
+struct shared_frame *shared_frame_new(size_t length)
+{
+    struct shared_frame *frame = malloc(sizeof(*frame) + length);
+    if (!frame)
+        return NULL;
+    frame->refs = 1;
+    frame->length = length;
+    return frame;
+}
+
+void shared_frame_release(struct shared_frame *frame)
+{
+    if (frame && --frame->refs == 0)
+        free(frame);
+}
+
+int subscribers_open(struct subscribers *s, uint16_t port, size_t max_queued_bytes)
+{
+    memset(s, 0, sizeof(*s));
+    s->max_queued_bytes = max_queued_bytes;
+    s->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    s->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (s->listen_fd < 0 || s->epoll_fd < 0)
+    {
+        subscribers_close(s);
+        return -1;
+    }
+
+    int one = 1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    // The listening socket is the one registration whose data.ptr is NULL.
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL};
+    setsockopt(s->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(s->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(s->listen_fd, 8) != 0 ||
+        epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, s->listen_fd, &event) != 0)
+    {
+        subscribers_close(s);
+        return -1;
+    }
+    return 0;
+}
+
+static void remove_subscriber(struct subscribers *s, struct subscriber *sub)
+{
+    fprintf(stderr, "Subscriber %s disconnected", sub->name);
+    if (sub->dropped_frames > 0)
+        fprintf(stderr, " (%llu frame(s) dropped while it fell behind)", (unsigned long long)sub->dropped_frames);
+    fprintf(stderr, "\n");
+    close(sub->fd);
+    for (int i = 0; i < sub->count; i++)
+        shared_frame_release(sub->queue[(sub->head + i) % sub->capacity]);
+    for (int i = 0; i < s->count; i++)
+        if (s->sub[i] == sub)
+            s->sub[i] = s->sub[--s->count];
+    free(sub->queue);
+    free(sub);
+}
+
+// Writes queued frames until the socket is full (EAGAIN, which re-arms the edge-triggered EPOLLOUT), up to
+// SUB_IOV frames per writev(). Returns -1 when the connection failed.
+static int flush_subscriber(struct subscriber *sub)
+{
+    while (sub->count > 0)
+    {
+        struct iovec iov[SUB_IOV];
+        int n = 0;
+        for (; n < sub->count && n < SUB_IOV; n++)
+        {
+            const struct shared_frame *frame = sub->queue[(sub->head + n) % sub->capacity];
+            size_t skip = n == 0 ? sub->sent : 0;
+            iov[n].iov_base = (uint8_t *)frame->bytes + skip;
+            iov[n].iov_len = frame->length - skip;
+        }
+        ssize_t written = writev(sub->fd, iov, n);
+        if (written < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+
+        size_t left = (size_t)written;
+        while (sub->count > 0)
+        {
+            struct shared_frame *frame = sub->queue[sub->head];
+            if (left < frame->length - sub->sent)
+            {
+                sub->sent += left;
+                break;
+            }
+            left -= frame->length - sub->sent;
+            sub->queued_bytes -= frame->length;
+            shared_frame_release(frame);
+            sub->sent = 0;
+            sub->head = (sub->head + 1) % sub->capacity;
+            sub->count--;
+        }
+    }
+    return 0;
+}
+
+// Doubles the queue, unwrapping it so that the head is at 0.
+static int grow_queue(struct subscriber *sub)
+{
+    int capacity = sub->capacity > 0 ? sub->capacity * 2 : SUB_QUEUE_FRAMES;
+    struct shared_frame **queue = malloc((size_t)capacity * sizeof(*queue));
+    if (!queue)
+        return -1;
+    for (int i = 0; i < sub->count; i++)
+        queue[i] = sub->queue[(sub->head + i) % sub->capacity];
+    free(sub->queue);
+    sub->queue = queue;
+    sub->capacity = capacity;
+    sub->head = 0;
+    return 0;
+}
+
+// Over its budget, a subscriber loses the oldest frame after the head one (which may be partly written or
+// its HELLO); the host sees a gap in the sequence numbers. Only the budget drops frames: the queue grows
+// with it, so a stall is bridged for as long as the bytes last.
+static void enqueue(struct subscriber *sub, struct shared_frame *frame, size_t max_queued_bytes)
+{
+    while (sub->count > 1 && sub->queued_bytes + frame->length > max_queued_bytes)
+    {
+        int second = (sub->head + 1) % sub->capacity;
+        sub->queued_bytes -= sub->queue[second]->length;
+        shared_frame_release(sub->queue[second]);
+        sub->queue[second] = sub->queue[sub->head];
+        sub->head = second;
+        sub->count--;
+        sub->dropped_frames++;
+    }
+    if (sub->count == sub->capacity && grow_queue(sub) != 0)
+    {
+        sub->dropped_frames++;
+        return;
+    }
+    frame->refs++;
+    sub->queue[(sub->head + sub->count) % sub->capacity] = frame;
+    sub->count++;
+    sub->queued_bytes += frame->length;
+}
+
+static void accept_subscribers(struct subscribers *s)
+{
+    for (;;)
+    {
+        struct sockaddr_in addr;
+        socklen_t addr_length = sizeof(addr);
+        int fd = accept4(s->listen_fd, (struct sockaddr *)&addr, &addr_length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        struct subscriber *sub = s->count < SUB_MAX_SUBSCRIBERS ? calloc(1, sizeof(*sub)) : NULL;
+        if (!sub)
+        {
+            close(fd);
+            continue;
+        }
+        sub->fd = fd;
+        char ip[INET_ADDRSTRLEN] = "?";
+        inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+        snprintf(sub->name, sizeof(sub->name), "%s:%u", ip, (unsigned)ntohs(addr.sin_port));
+
+        struct epoll_event event = {.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.ptr = sub};
+        if (epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            close(fd);
+            free(sub);
+            continue;
+        }
+        s->sub[s->count++] = sub;
+        fprintf(stderr, "Subscriber %s connected (%d now)\n", sub->name, s->count);
+    }
+}
+
+int subscribers_poll(struct subscribers *s)
+{
+    struct epoll_event events[SUB_EVENTS];
+    int n = epoll_wait(s->epoll_fd, events, SUB_EVENTS, 0);
+    for (int i = 0; i < n; i++)
+    {
+        struct subscriber *sub = events[i].data.ptr;
+        if (!sub)
+        {
+            accept_subscribers(s);
+            continue;
+        }
+        int failed = (events[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+        if (!failed && (events[i].events & (EPOLLIN | EPOLLRDHUP)))
+        {
+            // Subscribers never send anything, so readable means closed (or stray bytes, discarded).
+            char discard[256];
+            ssize_t got;
+            while ((got = recv(sub->fd, discard, sizeof(discard), MSG_DONTWAIT)) > 0)
+                ;
+            failed = got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+        }
+        if (!failed && (events[i].events & EPOLLOUT))
+            failed = flush_subscriber(sub) != 0;
+        if (failed)
+            remove_subscriber(s, sub);
+    }
+
+    int waiting = 0;
+    for (int i = 0; i < s->count; i++)
+        waiting += !s->sub[i]->greeted;
+    return waiting;
+}
+
+void subscribers_greet(struct subscribers *s, struct shared_frame *hello)
+{
+    for (int i = s->count - 1; i >= 0; i--)
+    {
+        struct subscriber *sub = s->sub[i];
+        if (sub->greeted)
+            continue;
+        enqueue(sub, hello, s->max_queued_bytes);
+        sub->greeted = 1;
+        if (flush_subscriber(sub) != 0)
+            remove_subscriber(s, sub);
+    }
+}
+
+void subscribers_publish(struct subscribers *s, struct shared_frame *frame)
+{
+    // Backwards, since removing a subscriber moves the last one into its place.
+    for (int i = s->count - 1; i >= 0; i--)
+    {
+        struct subscriber *sub = s->sub[i];
+        if (!sub->greeted)
+            continue;
+        enqueue(sub, frame, s->max_queued_bytes);
+        if (flush_subscriber(sub) != 0)
+            remove_subscriber(s, sub);
+    }
+}
+
+void subscribers_close(struct subscribers *s)
+{
+    while (s->count > 0)
+        remove_subscriber(s, s->sub[s->count - 1]);
+    if (s->listen_fd >= 0)
+        close(s->listen_fd);
+    if (s->epoll_fd >= 0)
+        close(s->epoll_fd);
+    s->listen_fd = s->epoll_fd = -1;
+}
@@ -0,0 +1,61 @@
+// subscribers.h
+// Server mode (--listen): any number of hosts connect to the board instead of the board connecting to one.
+// Each frame is encoded once into a reference-counted buffer that every subscriber's queue points at, and
+// one edge-triggered epoll set covers the listening socket and all connections; the sender's poll() only
+// waits on its fd.
+#ifndef SUBSCRIBERS_H
+#define SUBSCRIBERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SUB_MAX_SUBSCRIBERS 32
+#define SUB_QUEUE_FRAMES 64 // initial queue capacity, doubled as needed
+#define SUB_NAME_BYTES 48
+
+struct shared_frame
+{
+    uint32_t refs;
+    size_t length;
+    uint8_t bytes[];
+};
+
+struct subscriber
+{
+    int fd;
+    int greeted; // its HELLO is queued
+    struct shared_frame **queue; // circular, oldest at head
+    int capacity;
+    int head;
+    int count;
+    size_t sent; // bytes of the head frame already written
+    size_t queued_bytes;
+    uint64_t dropped_frames;
+    char name[SUB_NAME_BYTES];
+};
+
+struct subscribers
+{
+    int listen_fd;
+    int epoll_fd;
+    size_t max_queued_bytes; // per subscriber; a slower one loses its oldest unsent frames
+    int count;
+    struct subscriber *sub[SUB_MAX_SUBSCRIBERS];
+};
+
+// A frame of length bytes with one reference, the caller's.
+struct shared_frame *shared_frame_new(size_t length);
+void shared_frame_release(struct shared_frame *frame);
+
+// Listens on port (all addresses). Returns 0 on success.
+int subscribers_open(struct subscribers *s, uint16_t port, size_t max_queued_bytes);
+// Accepts new connections and writes or reads whatever epoll reports ready, without blocking. Returns how
+// many subscribers still wait for their HELLO.
+int subscribers_poll(struct subscribers *s);
+// Queues hello to every subscriber that has not had one, ahead of any other frame.
+void subscribers_greet(struct subscribers *s, struct shared_frame *hello);
+// Queues frame to every greeted subscriber and writes as much as their sockets take.
+void subscribers_publish(struct subscribers *s, struct shared_frame *frame);
+void subscribers_close(struct subscribers *s);
+
+#endif
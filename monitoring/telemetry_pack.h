@@ -0,0 +1,547 @@
+// telemetry_pack.h
+// Compressed telemetry (monitor_sender --compress), shared by the board (C) and the host decoders.
+//
+// Samples encoded as in telemetry_proto.h are packed into self-contained blocks; a TP_FRAME_PACKED frame
+// carries one or more blocks and its header's sample_count is the number of blocks. Nothing carries over
+// from one block to the next, so blocks can be dropped from the backlog or replayed on a new connection.
+//
+//   block   = block_bytes u32 | sample_count u16 | reserved u16 | sequence u32 | timestamp_ns u64 | bits
+//
+// The bits (most significant first, the last byte zero-padded) hold, per sample:
+//
+//   timestamp  delta-of-delta in ns, the first sample's taken from the block header and the first
+//              delta's predecessor being 0: '0' same delta | '10' 14-bit | '110' 20-bit | '1110' 32-bit
+//              | '1111' 64-bit, two's complement
+//   sequence   '0' previous + 1 | '1' u32           (the first sample's comes from the block header)
+//   flags      '0' as before | '1' u16               (0 before the first sample)
+//   fields     '0' same ids, instances and types as the previous sample
+//              | '1' count u16, then id u16 | instance u16 | type u8 per field
+//   values     in field order. Numbers are XORed with the same field's previous value (0 at first)
+//              (Gorilla): '0' equal | '10' meaningful bits inside the previous window
+//              | '11' leading zeros (5 bits) | meaningful bits - 1 (6 bits) | meaningful bits.
+//              TP_STR: '0' same as before | '1' length u16 | bytes; only strings of up to
+//              TP_PACK_STR_BYTES are remembered for the comparison.
+//
+// A field keeps its previous value and window across a change of the field list when its id, instance
+// and type stay listed (from the first such field, should the list repeat one).
+#ifndef TELEMETRY_PACK_H
+#define TELEMETRY_PACK_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "telemetry_proto.h"
+
+#define TP_PACK_BLOCK_HEADER_BYTES 20
+#define TP_PACK_STR_BYTES 32
+#define TP_PACK_MAX_SAMPLES 65535
+
+struct tp_bits
+{
+    uint8_t *buf;
+    size_t bytes;
+    size_t bit;
+    int overflow;
+};
+
+static inline void tp_bits_put(struct tp_bits *b, uint64_t value, unsigned count)
+{
+    if (b->bit + count > b->bytes * 8)
+    {
+        b->overflow = 1;
+        return;
+    }
+    while (count > 0)
+    {
+        unsigned room = 8 - (unsigned)(b->bit & 7);
+        unsigned take = count < room ? count : room;
+        uint8_t chunk = (uint8_t)((value >> (count - take)) & ((1u << take) - 1));
+        size_t byte = b->bit >> 3;
+        if (room == 8)
+            b->buf[byte] = 0;
+        b->buf[byte] |= (uint8_t)(chunk << (room - take));
+        b->bit += take;
+        count -= take;
+    }
+}
+
+static inline uint64_t tp_bits_get(struct tp_bits *b, unsigned count)
+{
+    if (b->bit + count > b->bytes * 8)
+    {
+        b->overflow = 1;
+        return 0;
+    }
+    uint64_t value = 0;
+    while (count > 0)
+    {
+        unsigned room = 8 - (unsigned)(b->bit & 7);
+        unsigned take = count < room ? count : room;
+        uint8_t chunk = (uint8_t)((b->buf[b->bit >> 3] >> (room - take)) & ((1u << take) - 1));
+        value = value << take | chunk;
+        b->bit += take;
+        count -= take;
+    }
+    return value;
+}
+
+static inline int64_t tp_sign_extend(uint64_t value, unsigned bits)
+{
+    return bits < 64 && (value >> (bits - 1)) ? (int64_t)(value | ~((1ull << bits) - 1)) : (int64_t)value;
+}
+
+/* Per field state, identical on both ends. */
+struct tp_pack_field
+{
+    uint16_t id;
+    uint16_t instance;
+    uint8_t type;
+    uint8_t leading;  /* XOR window of the previous value */
+    uint8_t trailing;
+    uint8_t window;   /* leading/trailing are set */
+    uint64_t previous;
+    uint16_t text_length;
+    uint8_t text_valid;
+    char text[TP_PACK_STR_BYTES];
+};
+
+/* Field tables and the running predictions of the block being packed or unpacked. */
+struct tp_pack_state
+{
+    struct tp_pack_field *fields;
+    struct tp_pack_field *next; /* the new list while the field list changes */
+    size_t field_count;
+    size_t field_capacity;
+    uint16_t samples;
+    uint32_t sequence;
+    uint64_t timestamp_ns;
+    int64_t delta_ns;
+    uint16_t flags;
+};
+
+static inline int tp_pack_state_reserve(struct tp_pack_state *s, size_t fields)
+{
+    if (fields <= s->field_capacity)
+        return 0;
+    struct tp_pack_field *a = (struct tp_pack_field *)realloc(s->fields, fields * sizeof(*a));
+    if (a)
+        s->fields = a;
+    struct tp_pack_field *b = (struct tp_pack_field *)realloc(s->next, fields * sizeof(*b));
+    if (b)
+        s->next = b;
+    if (!a || !b)
+        return -1;
+    s->field_capacity = fields;
+    return 0;
+}
+
+static inline void tp_pack_state_reset(struct tp_pack_state *s)
+{
+    s->field_count = 0;
+    s->samples = 0;
+    s->sequence = 0;
+    s->timestamp_ns = 0;
+    s->delta_ns = 0;
+    s->flags = 0;
+}
+
+static inline void tp_pack_state_free(struct tp_pack_state *s)
+{
+    free(s->fields);
+    free(s->next);
+    memset(s, 0, sizeof(*s));
+}
+
+/* Installs the field list staged in s->next (count entries); each field takes over the state of the first
+ * field listed before with the same id, instance and type. */
+static inline void tp_pack_state_switch(struct tp_pack_state *s, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        struct tp_pack_field *f = &s->next[i];
+        struct tp_pack_field key = *f;
+        memset(f, 0, sizeof(*f));
+        f->id = key.id;
+        f->instance = key.instance;
+        f->type = key.type;
+        for (size_t j = 0; j < s->field_count; j++)
+        {
+            const struct tp_pack_field *old = &s->fields[j];
+            if (old->id == key.id && old->instance == key.instance && old->type == key.type)
+            {
+                *f = *old;
+                break;
+            }
+        }
+    }
+    struct tp_pack_field *swap = s->fields;
+    s->fields = s->next;
+    s->next = swap;
+    s->field_count = count;
+}
+
+static inline void tp_pack_timestamp(struct tp_bits *b, int64_t dod)
+{
+    if (dod == 0)
+        tp_bits_put(b, 0, 1);
+    else if (dod >= -(1 << 13) && dod < (1 << 13))
+    {
+        tp_bits_put(b, 2, 2);
+        tp_bits_put(b, (uint64_t)dod, 14);
+    }
+    else if (dod >= -(1 << 19) && dod < (1 << 19))
+    {
+        tp_bits_put(b, 6, 3);
+        tp_bits_put(b, (uint64_t)dod, 20);
+    }
+    else if (dod >= INT32_MIN && dod <= INT32_MAX)
+    {
+        tp_bits_put(b, 14, 4);
+        tp_bits_put(b, (uint64_t)dod, 32);
+    }
+    else
+    {
+        tp_bits_put(b, 15, 4);
+        tp_bits_put(b, (uint64_t)dod, 64);
+    }
+}
+
+static inline int64_t tp_unpack_timestamp(struct tp_bits *b)
+{
+    static const unsigned widths[4] = {14, 20, 32, 64};
+    int prefix = 0;
+    while (prefix < 4 && tp_bits_get(b, 1))
+        prefix++;
+    if (prefix == 0)
+        return 0;
+    unsigned bits = widths[prefix - 1];
+    return tp_sign_extend(tp_bits_get(b, bits), bits);
+}
+
+static inline void tp_pack_number(struct tp_bits *b, struct tp_pack_field *f, uint64_t value, unsigned width)
+{
+    uint64_t x = value ^ f->previous;
+    f->previous = value;
+    if (x == 0)
+    {
+        tp_bits_put(b, 0, 1);
+        return;
+    }
+    unsigned leading = (unsigned)__builtin_clzll(x) - (64 - width);
+    unsigned trailing = (unsigned)__builtin_ctzll(x);
+    if (leading > 31)
+        leading = 31;
+    if (f->window && leading >= f->leading && trailing >= f->trailing)
+    {
+        tp_bits_put(b, 2, 2);
+        tp_bits_put(b, x >> f->trailing, width - f->leading - f->trailing);
+        return;
+    }
+    unsigned meaningful = width - leading - trailing;
+    tp_bits_put(b, 3, 2);
+    tp_bits_put(b, leading, 5);
+    tp_bits_put(b, meaningful - 1, 6);
+    tp_bits_put(b, x >> trailing, meaningful);
+    f->leading = (uint8_t)leading;
+    f->trailing = (uint8_t)trailing;
+    f->window = 1;
+}
+
+static inline uint64_t tp_unpack_number(struct tp_bits *b, struct tp_pack_field *f, unsigned width)
+{
+    if (tp_bits_get(b, 1))
+    {
+        if (tp_bits_get(b, 1))
+        {
+            unsigned leading = (unsigned)tp_bits_get(b, 5);
+            unsigned meaningful = (unsigned)tp_bits_get(b, 6) + 1;
+            if (leading + meaningful > width)
+            {
+                b->overflow = 1;
+                return 0;
+            }
+            f->leading = (uint8_t)leading;
+            f->trailing = (uint8_t)(width - leading - meaningful);
+            f->window = 1;
+        }
+        else if (!f->window)
+        {
+            b->overflow = 1;
+            return 0;
+        }
+        f->previous ^= tp_bits_get(b, width - f->leading - f->trailing) << f->trailing;
+    }
+    return f->previous;
+}
+
+static inline void tp_pack_remember_text(struct tp_pack_field *f, const uint8_t *text, size_t length)
+{
+    f->text_valid = length <= TP_PACK_STR_BYTES;
+    f->text_length = (uint16_t)length;
+    if (f->text_valid)
+        memcpy(f->text, text, length);
+}
+
+/* Packer: the block is built in a caller-sized buffer, then handed to the ring whole. */
+struct tp_packer
+{
+    uint8_t *block;
+    size_t capacity;
+    struct tp_bits bits;
+    struct tp_pack_state state;
+    uint64_t first_ns;
+};
+
+static inline int tp_packer_init(struct tp_packer *p, size_t block_bytes)
+{
+    memset(p, 0, sizeof(*p));
+    p->block = (uint8_t *)malloc(block_bytes);
+    p->capacity = block_bytes;
+    p->bits.buf = p->block ? p->block + TP_PACK_BLOCK_HEADER_BYTES : NULL;
+    p->bits.bytes = block_bytes - TP_PACK_BLOCK_HEADER_BYTES;
+    return p->block ? 0 : -1;
+}
+
+static inline void tp_packer_free(struct tp_packer *p)
+{
+    free(p->block);
+    tp_pack_state_free(&p->state);
+    memset(p, 0, sizeof(*p));
+}
+
+/* Adds one sample (header and fields as tp_begin_sample/tp_end_sample wrote them). Returns -1 when it may
+ * not fit: seal the block and add it again; a sample that does not fit an empty block is refused too. */
+static inline int tp_pack_sample(struct tp_packer *p, const uint8_t *sample, size_t length)
+{
+    struct tp_pack_state *s = &p->state;
+    struct tp_bits *b = &p->bits;
+    // Packed, a sample never takes more than twice its size, flags and field list included.
+    if (length < TP_SAMPLE_HEADER_BYTES || s->samples == TP_PACK_MAX_SAMPLES || b->bit / 8 + 2 * length + 16 > b->bytes)
+        return -1;
+    uint64_t timestamp_ns = tp_get64(sample);
+    uint32_t sequence = tp_get32(sample + 8);
+    uint16_t field_count = tp_get16(sample + 12);
+    uint16_t flags = tp_get16(sample + 14);
+    if (tp_pack_state_reserve(s, field_count) != 0)
+        return -1;
+
+    // Stage the field list, and check every value is there before anything is written.
+    int changed = field_count != s->field_count;
+    size_t offset = TP_SAMPLE_HEADER_BYTES;
+    for (uint16_t i = 0; i < field_count; i++)
+    {
+        if (length - offset < TP_FIELD_HEADER_BYTES)
+            return -1;
+        struct tp_pack_field *f = &s->next[i];
+        f->id = tp_get16(sample + offset);
+        f->instance = tp_get16(sample + offset + 2);
+        f->type = sample[offset + 4];
+        size_t value_bytes = tp_field_value_bytes(f->type, sample + offset + TP_FIELD_HEADER_BYTES, length - offset - TP_FIELD_HEADER_BYTES);
+        if (value_bytes == 0)
+            return -1;
+        if (!changed)
+        {
+            const struct tp_pack_field *old = &s->fields[i];
+            changed = old->id != f->id || old->instance != f->instance || old->type != f->type;
+        }
+        offset += TP_FIELD_HEADER_BYTES + value_bytes;
+    }
+
+    if (s->samples == 0)
+    {
+        p->first_ns = timestamp_ns;
+        tp_put32(p->block + 8, sequence);
+        tp_put64(p->block + 12, timestamp_ns);
+        s->timestamp_ns = timestamp_ns;
+        s->sequence = sequence;
+    }
+    else
+    {
+        int64_t delta = (int64_t)(timestamp_ns - s->timestamp_ns);
+        tp_pack_timestamp(b, delta - s->delta_ns);
+        s->delta_ns = delta;
+        s->timestamp_ns = timestamp_ns;
+        if (sequence == s->sequence + 1)
+            tp_bits_put(b, 0, 1);
+        else
+        {
+            tp_bits_put(b, 1, 1);
+            tp_bits_put(b, sequence, 32);
+        }
+        s->sequence = sequence;
+    }
+    if (flags == s->flags)
+        tp_bits_put(b, 0, 1);
+    else
+    {
+        tp_bits_put(b, 1, 1);
+        tp_bits_put(b, flags, 16);
+        s->flags = flags;
+    }
+    tp_bits_put(b, (uint64_t)changed, 1);
+    if (changed)
+    {
+        tp_bits_put(b, field_count, 16);
+        for (uint16_t i = 0; i < field_count; i++)
+        {
+            tp_bits_put(b, s->next[i].id, 16);
+            tp_bits_put(b, s->next[i].instance, 16);
+            tp_bits_put(b, s->next[i].type, 8);
+        }
+        tp_pack_state_switch(s, field_count);
+    }
+
+    offset = TP_SAMPLE_HEADER_BYTES;
+    for (uint16_t i = 0; i < field_count; i++)
+    {
+        struct tp_pack_field *f = &s->fields[i];
+        const uint8_t *value = sample + offset + TP_FIELD_HEADER_BYTES;
+        if (f->type == TP_STR)
+        {
+            size_t text_length = tp_get16(value);
+            if (f->text_valid && f->text_length == text_length && memcmp(f->text, value + 2, text_length) == 0)
+                tp_bits_put(b, 0, 1);
+            else
+            {
+                tp_bits_put(b, 1, 1);
+                tp_bits_put(b, text_length, 16);
+                for (size_t c = 0; c < text_length; c++)
+                    tp_bits_put(b, value[2 + c], 8);
+                tp_pack_remember_text(f, value + 2, text_length);
+            }
+            offset += TP_FIELD_HEADER_BYTES + 2 + text_length;
+        }
+        else
+        {
+            unsigned width = (unsigned)tp_value_bytes(f->type) * 8;
+            tp_pack_number(b, f, width == 64 ? tp_get64(value) : tp_get32(value), width);
+            offset += TP_FIELD_HEADER_BYTES + width / 8;
+        }
+    }
+    s->samples++;
+    return 0;
+}
+
+/* Finishes the block at p->block and returns its size (0 when it holds no sample); tp_packer_restart
+ * starts the next one. */
+static inline size_t tp_packer_seal(struct tp_packer *p)
+{
+    if (p->state.samples == 0)
+        return 0;
+    size_t bytes = TP_PACK_BLOCK_HEADER_BYTES + (p->bits.bit + 7) / 8;
+    tp_put32(p->block, (uint32_t)bytes);
+    tp_put16(p->block + 4, p->state.samples);
+    tp_put16(p->block + 6, 0);
+    return bytes;
+}
+
+static inline void tp_packer_restart(struct tp_packer *p)
+{
+    tp_pack_state_reset(&p->state);
+    p->bits.bit = 0;
+    p->bits.overflow = 0;
+}
+
+/* Expands the block at data (available bytes) back into samples appended to writer, exactly as they were
+ * encoded. Returns the block size, or 0 when it is malformed. Samples that do not fit the writer leave it
+ * overflowed, the block still being read through so that writer->missing tells how much room it needs. */
+static inline size_t tp_unpack_block(struct tp_pack_state *s, const uint8_t *data, size_t available, struct tp_writer *writer)
+{
+    if (available < TP_PACK_BLOCK_HEADER_BYTES)
+        return 0;
+    size_t bytes = tp_get32(data);
+    uint16_t samples = tp_get16(data + 4);
+    if (bytes < TP_PACK_BLOCK_HEADER_BYTES || bytes > available)
+        return 0;
+    struct tp_bits b;
+    b.buf = (uint8_t *)(data + TP_PACK_BLOCK_HEADER_BYTES);
+    b.bytes = bytes - TP_PACK_BLOCK_HEADER_BYTES;
+    b.bit = 0;
+    b.overflow = 0;
+
+    tp_pack_state_reset(s);
+    for (uint16_t n = 0; n < samples && !b.overflow; n++)
+    {
+        if (n == 0)
+        {
+            s->sequence = tp_get32(data + 8);
+            s->timestamp_ns = tp_get64(data + 12);
+        }
+        else
+        {
+            s->delta_ns += tp_unpack_timestamp(&b);
+            s->timestamp_ns += (uint64_t)s->delta_ns;
+            s->sequence = tp_bits_get(&b, 1) ? (uint32_t)tp_bits_get(&b, 32) : s->sequence + 1;
+        }
+        if (tp_bits_get(&b, 1))
+            s->flags = (uint16_t)tp_bits_get(&b, 16);
+        if (tp_bits_get(&b, 1))
+        {
+            size_t count = (size_t)tp_bits_get(&b, 16);
+            if (tp_pack_state_reserve(s, count) != 0)
+                return 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                s->next[i].id = (uint16_t)tp_bits_get(&b, 16);
+                s->next[i].instance = (uint16_t)tp_bits_get(&b, 16);
+                s->next[i].type = (uint8_t)tp_bits_get(&b, 8);
+                if (s->next[i].type != TP_STR && tp_value_bytes(s->next[i].type) == 0)
+                    return 0;
+            }
+            tp_pack_state_switch(s, count);
+        }
+
+        tp_begin_sample(writer, s->sequence, s->timestamp_ns);
+        for (size_t i = 0; i < s->field_count && !b.overflow; i++)
+        {
+            struct tp_pack_field *f = &s->fields[i];
+            if (f->type == TP_STR)
+            {
+                if (tp_bits_get(&b, 1))
+                {
+                    size_t length = (size_t)tp_bits_get(&b, 16);
+                    uint8_t *p = tp_field_sized(writer, f->id, f->instance, TP_STR, 2 + length);
+                    char text[TP_PACK_STR_BYTES];
+                    for (size_t c = 0; c < length; c++)
+                    {
+                        uint8_t byte = (uint8_t)tp_bits_get(&b, 8);
+                        if (p)
+                            p[2 + c] = byte;
+                        if (c < TP_PACK_STR_BYTES)
+                            text[c] = (char)byte;
+                    }
+                    if (p)
+                        tp_put16(p, (uint16_t)length);
+                    tp_pack_remember_text(f, (const uint8_t *)text, length);
+                }
+                else if (f->text_valid)
+                {
+                    uint8_t *p = tp_field_sized(writer, f->id, f->instance, TP_STR, 2 + (size_t)f->text_length);
+                    if (p)
+                    {
+                        tp_put16(p, f->text_length);
+                        memcpy(p + 2, f->text, f->text_length);
+                    }
+                }
+                else
+                    return 0;
+                continue;
+            }
+            unsigned width = (unsigned)tp_value_bytes(f->type) * 8;
+            uint64_t value = tp_unpack_number(&b, f, width);
+            uint8_t *p = tp_field(writer, f->id, f->instance, f->type);
+            if (p && width == 64)
+                tp_put64(p, value);
+            else if (p)
+                tp_put32(p, (uint32_t)value);
+        }
+        if (b.overflow)
+            return 0;
+        if (!writer->overflow)
+            tp_put16(writer->buf + writer->sample_start + 14, s->flags);
+        tp_end_sample(writer);
+    }
+    return b.overflow ? 0 : bytes;
+}
+
+#endif
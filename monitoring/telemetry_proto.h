@@ -0,0 +1,316 @@
+// telemetry_proto.h
+// Binary telemetry frames sent by monitor_sender. Shared by the board (C) and the host decoders.
+//
+// Everything is little-endian and written byte by byte, so the layout does not depend on struct padding.
+//
+//   frame   = header (TP_FRAME_HEADER_BYTES) + payload (payload_bytes)
+//   header  = magic u32 'RPTM' | version u8 | type u8 | header_bytes u16 | payload_bytes u32
+//             | sequence u32 (first sample in the frame) | timestamp_ns u64 (CLOCK_MONOTONIC at encode)
+//             | sample_count u16 | flags u16
+//   sample  = timestamp_ns u64 | sequence u32 | field_count u16 | flags u16 | fields
+//   field   = id u16 | instance u16 | type u8 | value (4 or 8 bytes; TP_STR: length u16 + bytes)
+//
+// TP_FRAME_PROFILE frames carry no samples (sample_count 0); their payload is
+//   profile = pid u32 | frequency_hz u32 | samples u32 | lost u32 | mapping_count u16 | thread_count u16
+//             | stack_count u32 | mappings | threads | stacks
+//   mapping = start u64 | end u64 | file_offset u64 | path_length u16 | path   (executable mappings)
+//   thread  = tid u32 | name_length u16 | name
+//   stack   = count u32 | tid u32 | depth u16 | address u64 * depth            (innermost frame first)
+//
+// Readers skip fields with unknown ids (the type gives their size) and frames with unknown types, and
+// honour header_bytes so later versions can append header members.
+#ifndef TELEMETRY_PROTO_H
+#define TELEMETRY_PROTO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define TP_MAGIC 0x4d545052u /* "RPTM" */
+#define TP_VERSION 1
+#define TP_FRAME_HEADER_BYTES 28
+#define TP_SAMPLE_HEADER_BYTES 16
+#define TP_FIELD_HEADER_BYTES 5
+#define TP_PROFILE_HEADER_BYTES 24
+#define TP_MAX_FRAME_BYTES (1u << 20)
+#define TP_MAX_FRAME_SAMPLES 65535
+
+enum tp_frame_type
+{
+    TP_FRAME_HELLO = 1,   /* one sample: TP_INTERVAL_US and static board facts */
+    TP_FRAME_SAMPLES = 2, /* one or more samples */
+    TP_FRAME_PROFILE = 3, /* folded profiler stacks (--profile-out) */
+    TP_FRAME_PACKED = 4,  /* blocks of packed samples (--compress, telemetry_pack.h) */
+};
+
+enum tp_value_type
+{
+    TP_F32 = 1,
+    TP_U32 = 2,
+    TP_U64 = 3,
+    TP_F64 = 4,
+    TP_STR = 5,
+};
+
+/* Field ids. instance is the core, interface, thread... index where relevant, else 0. */
+enum tp_field_id
+{
+    TP_INTERVAL_US = 1,
+    TP_CPU_PERCENT = 2,      /* instance 0: all cores */
+    TP_CORE_PERCENT = 3,     /* instance: core */
+    TP_RAM_PERCENT = 4,
+    TP_RAM_USED_KB = 5,
+    TP_RAM_TOTAL_KB = 6,
+    TP_FREQ_MHZ = 7,         /* instance: core */
+    TP_TEMP_C = 8,
+    TP_FLUSH_US = 9,         /* HELLO: longest time a sample waits before it is sent */
+    TP_MISSED_DEADLINES = 10, /* periods skipped since start because sampling overran */
+    TP_SEQUENCE_START = 11,  /* HELLO: sequence of the next sample sent (older ones were dropped) */
+    TP_BOARD_NAME = 12,      /* HELLO, TP_STR: hostname or --name, how a host tells boards apart */
+
+    /* Tracked process (--pid/--process). Thread fields use the thread's slot as instance. */
+    TP_PROC_PID = 20,
+    TP_PROC_THREADS = 21,
+    TP_PROC_CPU_PERCENT = 22, /* sum over threads, 100 per fully busy core */
+    TP_PROC_RSS_KB = 23,
+    TP_THREAD_TID = 24,
+    TP_THREAD_NAME = 25,      /* TP_STR */
+    TP_THREAD_CPU_PERCENT = 26,
+    TP_THREAD_WAIT_PERCENT = 27, /* share of the interval spent runnable but waiting for a core */
+    TP_THREAD_VOLUNTARY_CS = 28, /* per second */
+    TP_THREAD_INVOLUNTARY_CS = 29, /* per second */
+
+    /* Exported pipeline stages (rp_stats.h), instance: stage. */
+    TP_STAGE_NAME = 30,       /* TP_STR */
+    TP_STAGE_DEPTH = 31,      /* items queued at the sample */
+    TP_STAGE_DEPTH_MAX = 32,  /* since the pipeline started */
+    TP_STAGE_CAPACITY = 33,   /* 0: unbounded */
+    TP_STAGE_DROPS = 34,      /* TP_U64, since the pipeline started */
+    TP_STAGE_ITEMS_PER_S = 35,
+    TP_STAGE_LATENCY_MEAN_US = 36, /* over the interval */
+    TP_STAGE_LATENCY_P50_US = 37,
+    TP_STAGE_LATENCY_P99_US = 38,
+
+    /* Hardware counters (--perf), instance: core. Rates per 1000 instructions. */
+    TP_PERF_CYCLES = 40,      /* TP_U64, cycles in the interval */
+    TP_PERF_IPC = 41,
+    TP_PERF_L1D_MPKI = 42,
+    TP_PERF_L2_MPKI = 43,
+    TP_PERF_BRANCH_MPKI = 44,
+
+    /* Network interfaces (/proc/net/dev, lo left out), instance: interface. Per second over the interval. */
+    TP_NET_IFACE = 50,        /* TP_STR */
+    TP_NET_RX_BYTES_PER_S = 51,
+    TP_NET_TX_BYTES_PER_S = 52,
+    TP_NET_RX_PACKETS_PER_S = 53,
+    TP_NET_TX_PACKETS_PER_S = 54,
+    TP_NET_RX_DROPS_PER_S = 55,
+    TP_NET_TX_DROPS_PER_S = 56,
+
+    /* Block devices (/proc/diskstats), instance: device. */
+    TP_DISK_NAME = 60,        /* TP_STR */
+    TP_DISK_READS_PER_S = 61,
+    TP_DISK_WRITES_PER_S = 62,
+    TP_DISK_READ_BYTES_PER_S = 63,
+    TP_DISK_WRITE_BYTES_PER_S = 64,
+    TP_DISK_AWAIT_MS = 65,    /* mean time per completed request, queueing included */
+    TP_DISK_BUSY_PERCENT = 66,
+    TP_DISK_QUEUE_DEPTH = 67, /* mean requests in flight */
+
+    /* Zynq XADC (IIO). TP_TEMP_C is its mean die temperature when present; min/max need --xadc-hz. */
+    TP_XADC_SCANS_PER_S = 70,   /* buffered captures per second actually received */
+    TP_XADC_TEMP_MIN_C = 71,
+    TP_XADC_TEMP_MAX_C = 72,
+    TP_XADC_VOLTAGE_V = 73,     /* instance 0: VCCINT, 1: VCCAUX; mean over the interval */
+    TP_XADC_VOLTAGE_MIN_V = 74,
+    TP_XADC_VOLTAGE_MAX_V = 75,
+};
+
+static inline size_t tp_value_bytes(uint8_t type)
+{
+    return type == TP_U64 || type == TP_F64 ? 8 : type == TP_F32 || type == TP_U32 ? 4 : 0;
+}
+
+static inline void tp_put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void tp_put32(uint8_t *p, uint32_t v)
+{
+    tp_put16(p, (uint16_t)v);
+    tp_put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline void tp_put64(uint8_t *p, uint64_t v)
+{
+    tp_put32(p, (uint32_t)v);
+    tp_put32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint16_t tp_get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t tp_get32(const uint8_t *p)
+{
+    return (uint32_t)tp_get16(p) | ((uint32_t)tp_get16(p + 2) << 16);
+}
+
+static inline uint64_t tp_get64(const uint8_t *p)
+{
+    return (uint64_t)tp_get32(p) | ((uint64_t)tp_get32(p + 4) << 32);
+}
+
+/* Size of the value at p (available bytes left), or 0 if the type is unknown or the value truncated. */
+static inline size_t tp_field_value_bytes(uint8_t type, const uint8_t *p, size_t available)
+{
+    size_t bytes = type == TP_STR ? (available >= 2 ? 2 + (size_t)tp_get16(p) : 0) : tp_value_bytes(type);
+    return bytes <= available ? bytes : 0;
+}
+
+/* Encoder over a caller-provided buffer. Any write that does not fit sets overflow and is dropped. */
+struct tp_writer
+{
+    uint8_t *buf;
+    size_t capacity;
+    size_t length;
+    size_t frame_start;
+    size_t sample_start;
+    uint16_t samples;
+    uint16_t fields;
+    int overflow;
+    size_t missing; /* bytes asked for once it overflowed: length + missing is what would have fit */
+};
+
+static inline void tp_writer_init(struct tp_writer *w, uint8_t *buf, size_t capacity)
+{
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->capacity = capacity;
+}
+
+static inline uint8_t *tp_reserve(struct tp_writer *w, size_t bytes)
+{
+    if (w->overflow || w->length + bytes > w->capacity)
+    {
+        w->overflow = 1;
+        w->missing += bytes;
+        return NULL;
+    }
+    uint8_t *p = w->buf + w->length;
+    w->length += bytes;
+    return p;
+}
+
+/* Header for samples that were encoded elsewhere (e.g. batched in a ring and sent with writev). */
+static inline void tp_write_frame_header(uint8_t *p, uint8_t type, uint32_t payload_bytes, uint32_t sequence,
+                                         uint64_t timestamp_ns, uint16_t sample_count)
+{
+    tp_put32(p, TP_MAGIC);
+    p[4] = TP_VERSION;
+    p[5] = type;
+    tp_put16(p + 6, TP_FRAME_HEADER_BYTES);
+    tp_put32(p + 8, payload_bytes);
+    tp_put32(p + 12, sequence);
+    tp_put64(p + 16, timestamp_ns);
+    tp_put16(p + 24, sample_count);
+    tp_put16(p + 26, 0);
+}
+
+static inline void tp_begin_frame(struct tp_writer *w, uint8_t type, uint32_t sequence, uint64_t timestamp_ns)
+{
+    w->frame_start = w->length;
+    w->samples = 0;
+    uint8_t *p = tp_reserve(w, TP_FRAME_HEADER_BYTES);
+    if (p)
+        tp_write_frame_header(p, type, 0, sequence, timestamp_ns, 0);
+}
+
+static inline void tp_begin_sample(struct tp_writer *w, uint32_t sequence, uint64_t timestamp_ns)
+{
+    w->sample_start = w->length;
+    w->fields = 0;
+    uint8_t *p = tp_reserve(w, TP_SAMPLE_HEADER_BYTES);
+    if (!p)
+        return;
+    tp_put64(p, timestamp_ns);
+    tp_put32(p + 8, sequence);
+    tp_put16(p + 12, 0);
+    tp_put16(p + 14, 0);
+}
+
+static inline uint8_t *tp_field_sized(struct tp_writer *w, uint16_t id, uint16_t instance, uint8_t type, size_t value_bytes)
+{
+    uint8_t *p = tp_reserve(w, TP_FIELD_HEADER_BYTES + value_bytes);
+    if (!p)
+        return NULL;
+    tp_put16(p, id);
+    tp_put16(p + 2, instance);
+    p[4] = type;
+    w->fields++;
+    return p + TP_FIELD_HEADER_BYTES;
+}
+
+static inline uint8_t *tp_field(struct tp_writer *w, uint16_t id, uint16_t instance, uint8_t type)
+{
+    return tp_field_sized(w, id, instance, type, tp_value_bytes(type));
+}
+
+static inline void tp_put_f32(struct tp_writer *w, uint16_t id, uint16_t instance, float value)
+{
+    uint8_t *p = tp_field(w, id, instance, TP_F32);
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (p)
+        tp_put32(p, bits);
+}
+
+static inline void tp_put_u32(struct tp_writer *w, uint16_t id, uint16_t instance, uint32_t value)
+{
+    uint8_t *p = tp_field(w, id, instance, TP_U32);
+    if (p)
+        tp_put32(p, value);
+}
+
+static inline void tp_put_u64(struct tp_writer *w, uint16_t id, uint16_t instance, uint64_t value)
+{
+    uint8_t *p = tp_field(w, id, instance, TP_U64);
+    if (p)
+        tp_put64(p, value);
+}
+
+static inline void tp_put_str(struct tp_writer *w, uint16_t id, uint16_t instance, const char *text)
+{
+    size_t length = strlen(text);
+    if (length > 0xffff)
+        length = 0xffff;
+    uint8_t *p = tp_field_sized(w, id, instance, TP_STR, 2 + length);
+    if (!p)
+        return;
+    tp_put16(p, (uint16_t)length);
+    memcpy(p + 2, text, length);
+}
+
+static inline void tp_end_sample(struct tp_writer *w)
+{
+    if (w->overflow)
+        return;
+    tp_put16(w->buf + w->sample_start + 12, w->fields);
+    w->samples++;
+}
+
+/* Returns the frame size, or 0 if it did not fit. */
+static inline size_t tp_end_frame(struct tp_writer *w)
+{
+    if (w->overflow)
+        return 0;
+    uint8_t *header = w->buf + w->frame_start;
+    tp_put32(header + 8, (uint32_t)(w->length - w->frame_start - TP_FRAME_HEADER_BYTES));
+    tp_put16(header + 24, w->samples);
+    return w->length - w->frame_start;
+}
+
+#endif
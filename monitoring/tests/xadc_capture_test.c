@@ -0,0 +1,280 @@
+// xadc_capture_test.c
+// Runs xadc_capture against a fake IIO tree in a temporary directory: the XADC's sysfs attributes, its scan
+// elements and samplerate trigger, and a regular file standing in for /dev/iio:device0 with packed scans.
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <ftw.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "xadc_capture.h"
+
+#define TEMP_RAW 2600
+#define TEMP_OFFSET -2219
+#define TEMP_SCALE 123.040771484
+#define VCCINT_RAW 1365
+#define VCCAUX_RAW 2458
+#define VOLTAGE_SCALE 0.732421875
+#define SCANS 10
+
+static char root[64];
+static char device_dir[XC_PATH_BYTES];
+static int failures;
+
+static void check(int ok, const char *what)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static void check_near(double value, double expected, const char *what)
+{
+    if (fabs(value - expected) > 1e-4 * fabs(expected) + 1e-6)
+    {
+        fprintf(stderr, "FAIL: %s is %f, expected %f\n", what, value, expected);
+        failures++;
+    }
+}
+
+static void put_file(const char *content, const char *format, ...)
+{
+    char path[XC_PATH_BYTES * 2];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(path, sizeof(path), format, args);
+    va_end(args);
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        perror(path);
+        exit(2);
+    }
+    fputs(content, f);
+    fclose(f);
+}
+
+static void put_dir(const char *format, ...)
+{
+    char path[XC_PATH_BYTES * 2];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(path, sizeof(path), format, args);
+    va_end(args);
+    if (mkdir(path, 0755) != 0)
+    {
+        perror(path);
+        exit(2);
+    }
+}
+
+// The attribute's first line, or "" when it is missing.
+static const char *attr(const char *name)
+{
+    static char value[64];
+    char path[XC_PATH_BYTES * 2];
+    snprintf(path, sizeof(path), "%s/%s", device_dir, name);
+    value[0] = 0;
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return value;
+    if (fgets(value, sizeof(value), f))
+        value[strcspn(value, "\n")] = 0;
+    fclose(f);
+    return value;
+}
+
+static void put_scan_element(const char *base, int index, const char *type)
+{
+    char value[16];
+    put_file("0\n", "%s/scan_elements/%s_en", device_dir, base);
+    snprintf(value, sizeof(value), "%d\n", index);
+    put_file(value, "%s/scan_elements/%s_index", device_dir, base);
+    put_file(type, "%s/scan_elements/%s_type", device_dir, base);
+}
+
+// The XADC as the kernel driver lays it out; the scan indexes are deliberately not in channel order.
+static void make_tree(void)
+{
+    put_dir("%s/sys", root);
+    put_dir("%s/sys/bus", root);
+    put_dir("%s/sys/bus/iio", root);
+    put_dir("%s/sys/bus/iio/devices", root);
+    put_dir("%s/dev", root);
+    snprintf(device_dir, sizeof(device_dir), "%s/sys/bus/iio/devices/iio:device0", root);
+    put_dir("%s", device_dir);
+    put_dir("%s/buffer", device_dir);
+    put_dir("%s/trigger", device_dir);
+    put_dir("%s/scan_elements", device_dir);
+
+    put_file("xadc\n", "%s/name", device_dir);
+    put_file("2600\n", "%s/in_temp0_raw", device_dir);
+    put_file("123.040771484\n", "%s/in_temp0_scale", device_dir);
+    put_file("-2219\n", "%s/in_temp0_offset", device_dir);
+    put_file("1365\n", "%s/in_voltage0_vccint_raw", device_dir);
+    put_file("2458\n", "%s/in_voltage1_vccaux_raw", device_dir);
+    put_file("1200\n", "%s/in_voltage10_vccbram_raw", device_dir);
+    put_file("0.732421875\n", "%s/in_voltage_scale", device_dir);
+    put_file("1000000\n", "%s/sampling_frequency", device_dir);
+    put_file("0\n", "%s/buffer/enable", device_dir);
+    put_file("2\n", "%s/buffer/length", device_dir);
+    put_file("\n", "%s/trigger/current_trigger", device_dir);
+
+    put_scan_element("in_voltage0_vccint", 0, "le:u12/16>>4\n");
+    put_scan_element("in_voltage1_vccaux", 1, "le:u12/16>>4\n");
+    put_scan_element("in_temp0", 2, "le:u12/16>>0\n");
+    put_scan_element("in_voltage10_vccbram", 3, "le:u12/16>>4\n");
+    put_scan_element("in_timestamp", 4, "le:s64/64>>0\n");
+    put_file("1\n", "%s/scan_elements/in_voltage10_vccbram_en", device_dir);
+
+    put_dir("%s/sys/bus/iio/devices/trigger0", root);
+    put_file("xadc-samplerate\n", "%s/sys/bus/iio/devices/trigger0/name", root);
+}
+
+static void put_le16(uint8_t *p, unsigned int value)
+{
+    p[0] = (uint8_t)(value & 0xff);
+    p[1] = (uint8_t)(value >> 8);
+}
+
+// SCANS scans of vccint, vccaux, temp (ascending index); the last one carries a temperature step and a vccint dip.
+static void make_device(void)
+{
+    uint8_t scans[SCANS][6];
+    for (int i = 0; i < SCANS; i++)
+    {
+        int last = i == SCANS - 1;
+        put_le16(scans[i] + 0, (last ? VCCINT_RAW - 65 : VCCINT_RAW) << 4);
+        put_le16(scans[i] + 2, VCCAUX_RAW << 4);
+        put_le16(scans[i] + 4, last ? TEMP_RAW + 10 : TEMP_RAW);
+    }
+    char path[XC_PATH_BYTES];
+    snprintf(path, sizeof(path), "%s/dev/iio:device0", root);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || write(fd, scans, sizeof(scans)) != (ssize_t)sizeof(scans))
+    {
+        perror(path);
+        exit(2);
+    }
+    close(fd);
+}
+
+static double temperature(double raw)
+{
+    return (raw + TEMP_OFFSET) * TEMP_SCALE / 1000.0;
+}
+
+static double voltage(double raw)
+{
+    return raw * VOLTAGE_SCALE / 1000.0;
+}
+
+static void test_sysfs(void)
+{
+    struct xadc_capture x;
+    check(xadc_open(&x, root, 0) == 0, "sysfs: xadc_open finds the device");
+    check(!x.buffered, "sysfs: no buffer without a rate");
+    xadc_read(&x, 1000000000ull);
+
+    float temp = 0.0f;
+    check(xadc_temperature(&x, &temp) == 0, "sysfs: temperature valid");
+    check_near(temp, temperature(TEMP_RAW), "sysfs: temperature");
+    check_near(x.ch[XC_VCCINT].mean_value, voltage(VCCINT_RAW), "sysfs: vccint");
+    check_near(x.ch[XC_VCCAUX].mean_value, voltage(VCCAUX_RAW), "sysfs: vccaux");
+    check(strcmp(attr("buffer/enable"), "0") == 0, "sysfs: buffer left disabled");
+    xadc_close(&x);
+}
+
+static void test_buffered(void)
+{
+    struct xadc_capture x;
+    check(xadc_open(&x, root, 100) == 0, "buffered: xadc_open finds the device");
+    check(x.buffered, "buffered: buffer enabled");
+
+    check(strcmp(attr("buffer/enable"), "1") == 0, "buffered: buffer/enable is 1");
+    check(strcmp(attr("buffer/length"), "128") == 0, "buffered: buffer/length holds the minimum scans");
+    check(strcmp(attr("sampling_frequency"), "100") == 0, "buffered: sampling_frequency set");
+    check(strcmp(attr("trigger/current_trigger"), "xadc-samplerate") == 0, "buffered: samplerate trigger attached");
+    check(strcmp(attr("scan_elements/in_temp0_en"), "1") == 0, "buffered: temp enabled");
+    check(strcmp(attr("scan_elements/in_voltage0_vccint_en"), "1") == 0, "buffered: vccint enabled");
+    check(strcmp(attr("scan_elements/in_voltage1_vccaux_en"), "1") == 0, "buffered: vccaux enabled");
+    check(strcmp(attr("scan_elements/in_voltage10_vccbram_en"), "0") == 0, "buffered: vccbram disabled");
+    check(strcmp(attr("scan_elements/in_timestamp_en"), "0") == 0, "buffered: timestamp disabled");
+
+    check(x.scan_bytes == 6, "buffered: scan is 6 bytes");
+    check(x.ch[XC_VCCINT].offset == 0 && x.ch[XC_VCCAUX].offset == 2 && x.ch[XC_TEMP].offset == 4,
+          "buffered: values laid out by scan index");
+    check(x.ch[XC_VCCINT].shift == 4 && x.ch[XC_TEMP].shift == 0 && x.ch[XC_TEMP].bits == 12,
+          "buffered: scan types parsed");
+    check(x.ch[XC_TEMP].raw_fd < 0 && x.ch[XC_VCCINT].raw_fd < 0, "buffered: raw attributes closed");
+
+    xadc_read(&x, 1000000000ull);
+    const struct xadc_channel *temp = &x.ch[XC_TEMP], *vccint = &x.ch[XC_VCCINT], *vccaux = &x.ch[XC_VCCAUX];
+    check(temp->valid && vccint->valid && vccaux->valid, "buffered: all channels valid");
+    check_near(temp->mean_value, temperature(TEMP_RAW + 10.0 / SCANS), "buffered: temperature mean");
+    check_near(temp->min_value, temperature(TEMP_RAW), "buffered: temperature min");
+    check_near(temp->max_value, temperature(TEMP_RAW + 10), "buffered: temperature max");
+    check_near(vccint->mean_value, voltage(VCCINT_RAW - 65.0 / SCANS), "buffered: vccint mean");
+    check_near(vccint->min_value, voltage(VCCINT_RAW - 65), "buffered: vccint min");
+    check_near(vccint->max_value, voltage(VCCINT_RAW), "buffered: vccint max");
+    check_near(vccaux->mean_value, voltage(VCCAUX_RAW), "buffered: vccaux mean");
+    check(x.buf_fill == 0, "buffered: whole scans drained");
+
+    xadc_close(&x);
+    check(strcmp(attr("buffer/enable"), "0") == 0, "buffered: buffer/enable back to 0 on close");
+}
+
+// Without a trigger the buffer cannot run: the capture falls back to sysfs and leaves the buffer disabled.
+static void test_fallback(void)
+{
+    char path[XC_PATH_BYTES];
+    snprintf(path, sizeof(path), "%s/sys/bus/iio/devices/trigger0/name", root);
+    put_file("other\n", "%s", path);
+
+    struct xadc_capture x;
+    check(xadc_open(&x, root, 100) == 0, "fallback: xadc_open finds the device");
+    check(!x.buffered, "fallback: not buffered");
+    check(strcmp(attr("buffer/enable"), "0") == 0, "fallback: buffer/enable is 0");
+    xadc_read(&x, 1000000000ull);
+    check_near(x.ch[XC_VCCAUX].mean_value, voltage(VCCAUX_RAW), "fallback: vccaux through sysfs");
+    xadc_close(&x);
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+int main(void)
+{
+    snprintf(root, sizeof(root), "/tmp/xadc_test_XXXXXX");
+    if (!mkdtemp(root))
+    {
+        perror("mkdtemp");
+        return 2;
+    }
+    make_tree();
+    make_device();
+
+    test_sysfs();
+    test_buffered();
+    test_fallback();
+
+    nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    if (failures)
+    {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("xadc_capture_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,308 @@
+// thread_sampler.c
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "thread_sampler.h"
+#include "proc_util.h"
+
+static int open_proc(pid_t pid, pid_t tid, const char *file)
+{
+    char path[96];
+    if (tid > 0)
+        snprintf(path, sizeof(path), "/proc/%d/task/%d/%s", (int)pid, (int)tid, file);
+    else
+        snprintf(path, sizeof(path), "/proc/%d/%s", (int)pid, file);
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+static void close_fd(int *fd)
+{
+    if (*fd >= 0)
+        close(*fd);
+    *fd = -1;
+}
+
+static void close_slot(struct thread_slot *slot)
+{
+    close_fd(&slot->stat_fd);
+    close_fd(&slot->status_fd);
+    close_fd(&slot->schedstat_fd);
+}
+
+static void drop_process(struct thread_sampler *ts)
+{
+    for (int i = 0; i < ts->thread_count; i++)
+        close_slot(&ts->threads[i]);
+    ts->thread_count = 0;
+    ts->next_instance = 0;
+    close_fd(&ts->statm_fd);
+    if (ts->target_name[0])
+        ts->pid = 0;
+}
+
+// Matches comm (15 characters at most) or the basename of argv[0].
+static pid_t find_process(struct thread_sampler *ts)
+{
+    DIR *dir = opendir("/proc");
+    if (!dir)
+        return 0;
+    pid_t found = 0, self = getpid();
+    struct dirent *entry;
+    while (!found && (entry = readdir(dir)))
+    {
+        pid_t pid = (pid_t)atoi(entry->d_name);
+        if (pid <= 0 || pid == self)
+            continue;
+        for (int pass = 0; pass < 2 && !found; pass++)
+        {
+            int fd = open_proc(pid, 0, pass == 0 ? "comm" : "cmdline");
+            if (fd < 0)
+                break;
+            ssize_t length = read_fd(fd, ts->buf, sizeof(ts->buf));
+            close(fd);
+            if (length <= 0)
+                continue;
+            ts->buf[strcspn(ts->buf, "\n")] = 0;
+            const char *name = ts->buf;
+            if (pass == 1 && strrchr(name, '/'))
+                name = strrchr(name, '/') + 1;
+            if (pass == 0 ? strncmp(name, ts->target_name, 15) == 0 && strlen(name) == strnlen(ts->target_name, 15)
+                          : strcmp(name, ts->target_name) == 0)
+                found = pid;
+        }
+    }
+    closedir(dir);
+    return found;
+}
+
+static int compare_slots(const void *a, const void *b)
+{
+    return (int)((const struct thread_slot *)a)->tid - (int)((const struct thread_slot *)b)->tid;
+}
+
+static void read_name(struct thread_sampler *ts, struct thread_slot *slot)
+{
+    if (slot->stat_fd < 0 || read_fd(slot->stat_fd, ts->buf, sizeof(ts->buf)) <= 0)
+        return;
+    const char *open_paren = strchr(ts->buf, '(');
+    const char *close_paren = strrchr(ts->buf, ')');
+    if (!open_paren || !close_paren || close_paren <= open_paren)
+        return;
+    size_t length = (size_t)(close_paren - open_paren - 1);
+    if (length >= sizeof(slot->name))
+        length = sizeof(slot->name) - 1;
+    memcpy(slot->name, open_paren + 1, length);
+    slot->name[length] = 0;
+}
+
+// Run and wait time in ns: schedstat when the kernel has it, else utime + stime from stat (no wait).
+static int read_times(struct thread_sampler *ts, struct thread_slot *slot, unsigned long long *run_ns, unsigned long long *wait_ns)
+{
+    if (slot->schedstat_fd >= 0)
+    {
+        if (read_fd(slot->schedstat_fd, ts->buf, sizeof(ts->buf)) <= 0)
+            return -1;
+        parse_ull(parse_ull(ts->buf, run_ns), wait_ns);
+        return 0;
+    }
+    if (slot->stat_fd < 0 || read_fd(slot->stat_fd, ts->buf, sizeof(ts->buf)) <= 0)
+        return -1;
+    // utime and stime are fields 14 and 15; the comm (field 2) may contain spaces, so count from its ')'.
+    const char *p = strrchr(ts->buf, ')');
+    for (int field = 3; p && field <= 14; field++)
+        p = strchr(p + 1, ' ');
+    if (!p)
+        return -1;
+    unsigned long long utime, stime;
+    parse_ull(parse_ull(p, &utime), &stime);
+    *run_ns = (utime + stime) * (1000000000ull / (unsigned long long)ts->ticks_per_s);
+    *wait_ns = 0;
+    return 0;
+}
+
+static int read_switches(struct thread_sampler *ts, struct thread_slot *slot, unsigned long *voluntary, unsigned long *involuntary)
+{
+    if (slot->status_fd < 0 || read_fd(slot->status_fd, ts->buf, sizeof(ts->buf)) <= 0)
+        return -1;
+    if (!find_value(ts->buf, "\nvoluntary_ctxt_switches:", voluntary) ||
+        !find_value(ts->buf, "\nnonvoluntary_ctxt_switches:", involuntary))
+        return -1;
+    return 0;
+}
+
+// The sorted position of a thread shifts as others start and exit, so each thread gets its own instance when
+// first seen. They are handed out in turn, so the number of an exited thread is reused as late as possible.
+static uint16_t claim_instance(struct thread_sampler *ts)
+{
+    for (int k = 0; k < TS_MAX_THREADS; k++)
+    {
+        uint16_t candidate = (uint16_t)((ts->next_instance + k) % TS_MAX_THREADS);
+        int used = 0;
+        for (int i = 0; i < ts->thread_count && !used; i++)
+            used = ts->threads[i].instance == candidate;
+        if (!used)
+        {
+            ts->next_instance = (uint16_t)((candidate + 1) % TS_MAX_THREADS);
+            return candidate;
+        }
+    }
+    return 0; // not reached: a slot is only opened while fewer than TS_MAX_THREADS are in use
+}
+
+// Keeps the slots (and their fds, counters and instances) of threads still alive, opens new ones, sorted by tid.
+static void rescan_threads(struct thread_sampler *ts)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", (int)ts->pid);
+    DIR *dir = opendir(path);
+    if (!dir)
+        return;
+
+    int seen[TS_MAX_THREADS] = {0};
+    struct dirent *entry;
+    while ((entry = readdir(dir)))
+    {
+        pid_t tid = (pid_t)atoi(entry->d_name);
+        if (tid <= 0)
+            continue;
+        int index = -1;
+        for (int i = 0; i < ts->thread_count && index < 0; i++)
+            if (ts->threads[i].tid == tid)
+                index = i;
+        if (index < 0 && ts->thread_count < TS_MAX_THREADS)
+        {
+            struct thread_slot *slot = &ts->threads[ts->thread_count];
+            memset(slot, 0, sizeof(*slot));
+            slot->tid = tid;
+            slot->instance = claim_instance(ts);
+            slot->stat_fd = open_proc(ts->pid, tid, "stat");
+            slot->status_fd = open_proc(ts->pid, tid, "status");
+            slot->schedstat_fd = open_proc(ts->pid, tid, "schedstat");
+            read_name(ts, slot);
+            read_times(ts, slot, &slot->run_ns, &slot->wait_ns);
+            read_switches(ts, slot, &slot->voluntary_cs, &slot->involuntary_cs);
+            index = ts->thread_count++;
+        }
+        if (index >= 0)
+            seen[index] = 1;
+    }
+    closedir(dir);
+
+    int kept = 0;
+    for (int i = 0; i < ts->thread_count; i++)
+    {
+        if (!seen[i])
+        {
+            close_slot(&ts->threads[i]);
+            continue;
+        }
+        ts->threads[kept++] = ts->threads[i];
+    }
+    ts->thread_count = kept;
+    qsort(ts->threads, (size_t)ts->thread_count, sizeof(ts->threads[0]), compare_slots);
+}
+
+void thread_sampler_init(struct thread_sampler *ts, pid_t pid, const char *name)
+{
+    memset(ts, 0, sizeof(*ts));
+    ts->pid = pid;
+    ts->statm_fd = -1;
+    if (name)
+        snprintf(ts->target_name, sizeof(ts->target_name), "%s", name);
+    ts->ticks_per_s = sysconf(_SC_CLK_TCK);
+    if (ts->ticks_per_s <= 0)
+        ts->ticks_per_s = 100;
+    ts->page_kb = sysconf(_SC_PAGESIZE) / 1024;
+}
+
+int thread_sampler_read(struct thread_sampler *ts, uint64_t now_ns)
+{
+    if (ts->statm_fd < 0)
+    {
+        // Looking for the process (again) at most once per rescan period.
+        if (now_ns - ts->last_scan_ns < TS_RESCAN_NS && ts->last_scan_ns != 0)
+            return -1;
+        ts->last_scan_ns = now_ns;
+        if (ts->pid == 0 && ts->target_name[0])
+            ts->pid = find_process(ts);
+        if (ts->pid <= 0 || (ts->statm_fd = open_proc(ts->pid, 0, "statm")) < 0)
+            return -1;
+        rescan_threads(ts);
+        ts->last_ns = now_ns;
+    }
+
+    unsigned long long size_pages, resident_pages;
+    if (read_fd(ts->statm_fd, ts->buf, sizeof(ts->buf)) <= 0)
+    {
+        drop_process(ts);
+        return -1;
+    }
+    parse_ull(parse_ull(ts->buf, &size_pages), &resident_pages);
+    ts->rss_kb = (unsigned long)(resident_pages * (unsigned long long)ts->page_kb);
+
+    if (now_ns - ts->last_scan_ns >= TS_RESCAN_NS)
+    {
+        ts->last_scan_ns = now_ns;
+        rescan_threads(ts);
+    }
+
+    double elapsed_ns = (double)(now_ns - ts->last_ns);
+    ts->last_ns = now_ns;
+    ts->cpu_percent = 0.0f;
+    for (int i = 0; i < ts->thread_count; i++)
+    {
+        struct thread_slot *slot = &ts->threads[i];
+        unsigned long long run_ns, wait_ns;
+        unsigned long voluntary, involuntary;
+        if (read_times(ts, slot, &run_ns, &wait_ns) != 0 || read_switches(ts, slot, &voluntary, &involuntary) != 0)
+        {
+            // The thread exited: rescan on the next sample.
+            slot->cpu_percent = slot->wait_percent = slot->voluntary_per_s = slot->involuntary_per_s = 0.0f;
+            ts->last_scan_ns = now_ns - TS_RESCAN_NS;
+            continue;
+        }
+        if (elapsed_ns > 0)
+        {
+            slot->cpu_percent = (float)(100.0 * (double)(run_ns - slot->run_ns) / elapsed_ns);
+            slot->wait_percent = (float)(100.0 * (double)(wait_ns - slot->wait_ns) / elapsed_ns);
+            slot->voluntary_per_s = (float)((double)(voluntary - slot->voluntary_cs) * 1e9 / elapsed_ns);
+            slot->involuntary_per_s = (float)((double)(involuntary - slot->involuntary_cs) * 1e9 / elapsed_ns);
+        }
+        slot->run_ns = run_ns;
+        slot->wait_ns = wait_ns;
+        slot->voluntary_cs = voluntary;
+        slot->involuntary_cs = involuntary;
+        ts->cpu_percent += slot->cpu_percent;
+    }
+    return 0;
+}
+
+void thread_sampler_encode(const struct thread_sampler *ts, struct tp_writer *writer)
+{
+    if (ts->statm_fd < 0)
+        return;
+    tp_put_u32(writer, TP_PROC_PID, 0, (uint32_t)ts->pid);
+    tp_put_u32(writer, TP_PROC_THREADS, 0, (uint32_t)ts->thread_count);
+    tp_put_f32(writer, TP_PROC_CPU_PERCENT, 0, ts->cpu_percent);
+    tp_put_u32(writer, TP_PROC_RSS_KB, 0, (uint32_t)ts->rss_kb);
+    for (int i = 0; i < ts->thread_count; i++)
+    {
+        const struct thread_slot *slot = &ts->threads[i];
+        tp_put_u32(writer, TP_THREAD_TID, slot->instance, (uint32_t)slot->tid);
+        tp_put_str(writer, TP_THREAD_NAME, slot->instance, slot->name);
+        tp_put_f32(writer, TP_THREAD_CPU_PERCENT, slot->instance, slot->cpu_percent);
+        tp_put_f32(writer, TP_THREAD_WAIT_PERCENT, slot->instance, slot->wait_percent);
+        tp_put_f32(writer, TP_THREAD_VOLUNTARY_CS, slot->instance, slot->voluntary_per_s);
+        tp_put_f32(writer, TP_THREAD_INVOLUNTARY_CS, slot->instance, slot->involuntary_per_s);
+    }
+}
+
+void thread_sampler_close(struct thread_sampler *ts)
+{
+    ts->target_name[0] = 0;
+    drop_process(ts);
+}
@@ -0,0 +1,59 @@
+// thread_sampler.h
+// Per-thread view of one process (the deployed pipeline): CPU and run-queue wait from schedstat,
+// context switches from status, RSS from statm. Every file stays open between samples.
+#ifndef THREAD_SAMPLER_H
+#define THREAD_SAMPLER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "telemetry_proto.h"
+
+#define TS_MAX_THREADS 64
+#define TS_RESCAN_NS 1000000000ull
+
+struct thread_slot
+{
+    pid_t tid;
+    uint16_t instance; // telemetry instance, kept for the thread's lifetime
+    int stat_fd;
+    int status_fd;
+    int schedstat_fd;
+    char name[16];
+    unsigned long long run_ns;
+    unsigned long long wait_ns;
+    unsigned long voluntary_cs;
+    unsigned long involuntary_cs;
+    float cpu_percent;
+    float wait_percent;
+    float voluntary_per_s;
+    float involuntary_per_s;
+};
+
+struct thread_sampler
+{
+    char target_name[64]; // re-resolved when the process restarts; empty when tracking a fixed pid
+    pid_t pid;
+    int statm_fd;
+    int thread_count;
+    struct thread_slot threads[TS_MAX_THREADS];
+    uint16_t next_instance;
+    uint64_t last_ns;
+    uint64_t last_scan_ns;
+    unsigned long rss_kb;
+    float cpu_percent;
+    long ticks_per_s;
+    long page_kb;
+    char buf[4096];
+};
+
+// Tracks pid, or (pid 0) the process whose comm or argv[0] basename is name.
+void thread_sampler_init(struct thread_sampler *ts, pid_t pid, const char *name);
+// Returns 0 while the process exists.
+int thread_sampler_read(struct thread_sampler *ts, uint64_t now_ns);
+void thread_sampler_encode(const struct thread_sampler *ts, struct tp_writer *writer);
+void thread_sampler_close(struct thread_sampler *ts);
+
+// Upper bound of what thread_sampler_encode writes.
+#define TS_ENCODED_BYTES (4 * 9 + TS_MAX_THREADS * (5 * 9 + TP_FIELD_HEADER_BYTES + 2 + 15))
+
+#endif
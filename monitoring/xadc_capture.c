@@ -0,0 +1,402 @@
+// xadc_capture.c
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "xadc_capture.h"
+#include "proc_util.h"
+
+#define IIO_DEVICES_DIR "/sys/bus/iio/devices"
+
+// sysfs and scan element names start with these; the rails carry an extend name (in_voltage0_vccint_raw).
+static const char *const channel_prefix[XC_CHANNELS] = {"in_temp0", "in_voltage0", "in_voltage1"};
+static const char *const channel_type[XC_CHANNELS] = {"in_temp", "in_voltage", "in_voltage"};
+
+static int read_attr(const char *dir, const char *name, char *buf, size_t size)
+{
+    char path[XC_PATH_BYTES * 2];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    ssize_t n = read_fd(fd, buf, size);
+    close(fd);
+    if (n <= 0)
+        return -1;
+    buf[strcspn(buf, "\n")] = 0;
+    return 0;
+}
+
+static int write_attr(const char *dir, const char *name, const char *value)
+{
+    char path[XC_PATH_BYTES * 2];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd = open(path, O_WRONLY | O_TRUNC | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    ssize_t n = write(fd, value, strlen(value));
+    close(fd);
+    return n == (ssize_t)strlen(value) ? 0 : -1;
+}
+
+// Finds "<prefix>_<anything>suffix" or "<prefix>suffix" in dir; the '_' check keeps in_voltage1 from matching in_voltage10.
+static int find_attr(const char *dir, const char *prefix, const char *suffix, char *name, size_t size)
+{
+    DIR *d = opendir(dir);
+    if (!d)
+        return -1;
+    size_t prefix_length = strlen(prefix), suffix_length = strlen(suffix);
+    int found = -1;
+    struct dirent *entry;
+    while (found != 0 && (entry = readdir(d)))
+    {
+        size_t length = strlen(entry->d_name);
+        if (length < prefix_length + suffix_length || strncmp(entry->d_name, prefix, prefix_length) != 0 ||
+            strcmp(entry->d_name + length - suffix_length, suffix) != 0 || length >= size)
+            continue;
+        char next = entry->d_name[prefix_length];
+        if (length == prefix_length + suffix_length || next == '_')
+        {
+            memcpy(name, entry->d_name, length + 1);
+            found = 0;
+        }
+    }
+    closedir(d);
+    return found;
+}
+
+// The first IIO device, or trigger, whose name contains all of the given words.
+static int find_iio_entry(const char *devices_dir, const char *kind, const char *word, const char *word2, char *out, size_t size)
+{
+    DIR *d = opendir(devices_dir);
+    if (!d)
+        return -1;
+    int found = -1;
+    struct dirent *entry;
+    while (found != 0 && (entry = readdir(d)))
+    {
+        char dir[XC_PATH_BYTES * 2], name[64];
+        if (strncmp(entry->d_name, kind, strlen(kind)) != 0)
+            continue;
+        snprintf(dir, sizeof(dir), "%s/%s", devices_dir, entry->d_name);
+        if (read_attr(dir, "name", name, sizeof(name)) != 0 || !strstr(name, word) || (word2 && !strstr(name, word2)))
+            continue;
+        const char *result = strcmp(kind, "trigger") == 0 ? name : dir;
+        if (strlen(result) >= size)
+            continue;
+        memcpy(out, result, strlen(result) + 1);
+        found = 0;
+    }
+    closedir(d);
+    return found;
+}
+
+// "le:u12/16>>4": endianness, sign, value bits, storage bits, shift.
+static int parse_scan_type(const char *text, struct xadc_channel *c)
+{
+    unsigned long long bits, storage, shift = 0;
+    c->big_endian = strncmp(text, "be:", 3) == 0;
+    if (strncmp(text, "be:", 3) != 0 && strncmp(text, "le:", 3) != 0)
+        return -1;
+    c->is_signed = text[3] == 's';
+    const char *p = parse_ull(text + 4, &bits);
+    if (*p++ != '/')
+        return -1;
+    p = parse_ull(p, &storage);
+    p = strstr(p, ">>");
+    if (p)
+        parse_ull(p + 2, &shift);
+    if (bits == 0 || bits > storage || (storage != 8 && storage != 16 && storage != 32 && storage != 64))
+        return -1;
+    c->bits = (int)bits;
+    c->storage_bytes = (int)(storage / 8);
+    c->shift = (int)shift;
+    return 0;
+}
+
+static double scan_value(const struct xadc_channel *c, const uint8_t *scan)
+{
+    uint64_t raw = 0;
+    for (int i = 0; i < c->storage_bytes; i++)
+    {
+        int byte = c->big_endian ? i : c->storage_bytes - 1 - i;
+        raw = raw << 8 | scan[c->offset + (size_t)byte];
+    }
+    raw >>= c->shift;
+    int64_t value;
+    if (c->bits < 64)
+    {
+        raw &= (1ull << c->bits) - 1;
+        value = c->is_signed && (raw >> (c->bits - 1)) ? (int64_t)(raw | ~((1ull << c->bits) - 1)) : (int64_t)raw;
+    }
+    else
+        value = (int64_t)raw;
+    return ((double)value + c->raw_offset) * c->scale / 1000.0;
+}
+
+static void accumulate(struct xadc_channel *c, double value)
+{
+    if (c->count == 0 || value < c->min)
+        c->min = value;
+    if (c->count == 0 || value > c->max)
+        c->max = value;
+    c->sum += value;
+    c->count++;
+}
+
+static void disable_buffer(struct xadc_capture *x)
+{
+    if (x->dev_fd >= 0)
+        close(x->dev_fd);
+    x->dev_fd = -1;
+    write_attr(x->device_dir, "buffer/enable", "0");
+    x->buffered = 0;
+}
+
+// Enables exactly our channels as scan elements, lays the scan out (each value aligned to its own size, the
+// whole scan to the largest), attaches the XADC's own trigger and starts the buffer.
+static int enable_buffer(struct xadc_capture *x, const char *devices_dir, const char *dev_dir, unsigned int hz)
+{
+    char scan_dir[XC_PATH_BYTES + 16], name[XC_PATH_BYTES * 2], value[64];
+    snprintf(scan_dir, sizeof(scan_dir), "%s/scan_elements", x->device_dir);
+    write_attr(x->device_dir, "buffer/enable", "0");
+
+    DIR *d = opendir(scan_dir);
+    if (!d)
+        return -1;
+    struct dirent *entry;
+    while ((entry = readdir(d)))
+    {
+        size_t length = strlen(entry->d_name);
+        if (length > 3 && strcmp(entry->d_name + length - 3, "_en") == 0)
+            write_attr(scan_dir, entry->d_name, "0");
+    }
+    closedir(d);
+
+    int order[XC_CHANNELS], captured = 0;
+    for (int i = 0; i < XC_CHANNELS; i++)
+    {
+        struct xadc_channel *c = &x->ch[i];
+        c->scan_index = -1;
+        if (!c->present || find_attr(scan_dir, channel_prefix[i], "_en", name, sizeof(name)) != 0)
+            continue;
+        char base[XC_PATH_BYTES];
+        snprintf(base, sizeof(base), "%.*s", (int)(strlen(name) - 3), name);
+        char index_name[XC_PATH_BYTES + 8], type_name[XC_PATH_BYTES + 8];
+        snprintf(index_name, sizeof(index_name), "%s_index", base);
+        snprintf(type_name, sizeof(type_name), "%s_type", base);
+        if (read_attr(scan_dir, index_name, value, sizeof(value)) != 0)
+            continue;
+        c->scan_index = atoi(value);
+        if (read_attr(scan_dir, type_name, value, sizeof(value)) != 0 || parse_scan_type(value, c) != 0 ||
+            write_attr(scan_dir, name, "1") != 0)
+        {
+            c->scan_index = -1;
+            continue;
+        }
+        order[captured++] = i;
+    }
+    if (captured == 0)
+        return -1;
+
+    // The kernel packs enabled elements by ascending index.
+    for (int a = 1; a < captured; a++)
+        for (int b = a; b > 0 && x->ch[order[b]].scan_index < x->ch[order[b - 1]].scan_index; b--)
+        {
+            int t = order[b];
+            order[b] = order[b - 1];
+            order[b - 1] = t;
+        }
+    size_t offset = 0, largest = 1;
+    for (int k = 0; k < captured; k++)
+    {
+        struct xadc_channel *c = &x->ch[order[k]];
+        size_t bytes = (size_t)c->storage_bytes;
+        offset = (offset + bytes - 1) / bytes * bytes;
+        c->offset = offset;
+        offset += bytes;
+        if (bytes > largest)
+            largest = bytes;
+    }
+    x->scan_bytes = (offset + largest - 1) / largest * largest;
+
+    char trigger[64];
+    if (find_iio_entry(devices_dir, "trigger", "xadc", "samplerate", trigger, sizeof(trigger)) != 0 &&
+        find_iio_entry(devices_dir, "trigger", "xadc", NULL, trigger, sizeof(trigger)) != 0)
+        return -1;
+    if (write_attr(x->device_dir, "trigger/current_trigger", trigger) != 0)
+        return -1;
+    snprintf(value, sizeof(value), "%u", hz);
+    if (write_attr(x->device_dir, "sampling_frequency", value) != 0)
+        fprintf(stderr, "XADC: cannot set sampling_frequency to %u Hz\n", hz);
+
+    // One second of scans in the kernel buffer; our buffer holds as much, so one read() drains it.
+    unsigned int scans = hz > XC_MIN_BUFFER_SCANS ? hz : XC_MIN_BUFFER_SCANS;
+    snprintf(value, sizeof(value), "%u", scans);
+    if (write_attr(x->device_dir, "buffer/length", value) != 0)
+        return -1;
+    x->buf_size = (size_t)scans * x->scan_bytes;
+    x->buf = malloc(x->buf_size);
+    if (!x->buf || write_attr(x->device_dir, "buffer/enable", "1") != 0)
+        return -1;
+
+    const char *device_name = strrchr(x->device_dir, '/') + 1;
+    snprintf(name, sizeof(name), "%s/%s", dev_dir, device_name);
+    x->dev_fd = open(name, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (x->dev_fd < 0)
+        return -1;
+    x->buffered = 1;
+    return 0;
+}
+
+int xadc_open(struct xadc_capture *x, const char *root, unsigned int hz)
+{
+    memset(x, 0, sizeof(*x));
+    x->dev_fd = -1;
+    for (int i = 0; i < XC_CHANNELS; i++)
+        x->ch[i].raw_fd = x->ch[i].scan_index = -1;
+
+    char devices_dir[XC_PATH_BYTES], dev_dir[XC_PATH_BYTES];
+    snprintf(devices_dir, sizeof(devices_dir), "%s%s", root, IIO_DEVICES_DIR);
+    snprintf(dev_dir, sizeof(dev_dir), "%s/dev", root);
+    if (find_iio_entry(devices_dir, "iio:device", "xadc", NULL, x->device_dir, sizeof(x->device_dir)) != 0)
+        return -1;
+
+    int found = 0;
+    for (int i = 0; i < XC_CHANNELS; i++)
+    {
+        struct xadc_channel *c = &x->ch[i];
+        char name[XC_PATH_BYTES], base[XC_PATH_BYTES], attr[XC_PATH_BYTES + 16], value[64];
+        if (find_attr(x->device_dir, channel_prefix[i], "_raw", name, sizeof(name)) != 0)
+            continue;
+        snprintf(base, sizeof(base), "%.*s", (int)(strlen(name) - 4), name);
+        // Scale and offset are per channel or shared by the channel type.
+        snprintf(attr, sizeof(attr), "%s_scale", base);
+        if (read_attr(x->device_dir, attr, value, sizeof(value)) != 0)
+        {
+            snprintf(attr, sizeof(attr), "%s_scale", channel_type[i]);
+            if (read_attr(x->device_dir, attr, value, sizeof(value)) != 0)
+                continue;
+        }
+        c->scale = strtod(value, NULL);
+        snprintf(attr, sizeof(attr), "%s_offset", base);
+        if (read_attr(x->device_dir, attr, value, sizeof(value)) == 0)
+            c->raw_offset = strtod(value, NULL);
+        snprintf(attr, sizeof(attr), "%s/%s", x->device_dir, name);
+        c->raw_fd = open(attr, O_RDONLY | O_CLOEXEC);
+        c->present = 1;
+        found++;
+    }
+    if (found == 0)
+        return -1;
+
+    if (hz > 0 && enable_buffer(x, devices_dir, dev_dir, hz) != 0)
+    {
+        fprintf(stderr, "XADC buffered capture unavailable; reading %s through sysfs\n", x->device_dir);
+        disable_buffer(x);
+    }
+    // Raw attributes are busy while the buffer runs.
+    for (int i = 0; x->buffered && i < XC_CHANNELS; i++)
+        if (x->ch[i].raw_fd >= 0 && x->ch[i].scan_index >= 0)
+        {
+            close(x->ch[i].raw_fd);
+            x->ch[i].raw_fd = -1;
+        }
+    return 0;
+}
+
+static void drain_buffer(struct xadc_capture *x)
+{
+    for (;;)
+    {
+        size_t space = x->buf_size - x->buf_fill;
+        ssize_t n = read(x->dev_fd, x->buf + x->buf_fill, space);
+        if (n <= 0)
+            return;
+        x->buf_fill += (size_t)n;
+        size_t whole = x->buf_fill - x->buf_fill % x->scan_bytes;
+        for (size_t off = 0; off < whole; off += x->scan_bytes)
+        {
+            for (int i = 0; i < XC_CHANNELS; i++)
+                if (x->ch[i].scan_index >= 0)
+                    accumulate(&x->ch[i], scan_value(&x->ch[i], x->buf + off));
+            x->scans++;
+        }
+        memmove(x->buf, x->buf + whole, x->buf_fill - whole);
+        x->buf_fill -= whole;
+        if ((size_t)n < space)
+            return;
+    }
+}
+
+void xadc_read(struct xadc_capture *x, uint64_t now_ns)
+{
+    if (x->buffered)
+        drain_buffer(x);
+    for (int i = 0; i < XC_CHANNELS; i++)
+    {
+        struct xadc_channel *c = &x->ch[i];
+        char value[32];
+        if (c->raw_fd >= 0 && read_fd(c->raw_fd, value, sizeof(value)) > 0)
+            accumulate(c, ((double)strtoll(value, NULL, 10) + c->raw_offset) * c->scale / 1000.0);
+        c->valid = c->count > 0;
+        if (c->valid)
+        {
+            c->mean_value = (float)(c->sum / c->count);
+            c->min_value = (float)c->min;
+            c->max_value = (float)c->max;
+        }
+        c->sum = 0.0;
+        c->count = 0;
+    }
+    x->scans_per_s = x->last_ns && now_ns > x->last_ns ? (float)((double)x->scans * 1e9 / (double)(now_ns - x->last_ns)) : 0.0f;
+    x->scans = 0;
+    x->last_ns = now_ns;
+}
+
+int xadc_temperature(const struct xadc_capture *x, float *temp_c)
+{
+    if (!x->ch[XC_TEMP].valid)
+        return -1;
+    *temp_c = x->ch[XC_TEMP].mean_value;
+    return 0;
+}
+
+void xadc_encode(const struct xadc_capture *x, struct tp_writer *writer)
+{
+    if (x->buffered)
+        tp_put_f32(writer, TP_XADC_SCANS_PER_S, 0, x->scans_per_s);
+    const struct xadc_channel *temp = &x->ch[XC_TEMP];
+    if (temp->valid && x->buffered)
+    {
+        tp_put_f32(writer, TP_XADC_TEMP_MIN_C, 0, temp->min_value);
+        tp_put_f32(writer, TP_XADC_TEMP_MAX_C, 0, temp->max_value);
+    }
+    for (int i = XC_VCCINT; i <= XC_VCCAUX; i++)
+    {
+        const struct xadc_channel *c = &x->ch[i];
+        uint16_t instance = (uint16_t)(i - XC_VCCINT);
+        if (!c->valid)
+            continue;
+        tp_put_f32(writer, TP_XADC_VOLTAGE_V, instance, c->mean_value);
+        if (!x->buffered)
+            continue;
+        tp_put_f32(writer, TP_XADC_VOLTAGE_MIN_V, instance, c->min_value);
+        tp_put_f32(writer, TP_XADC_VOLTAGE_MAX_V, instance, c->max_value);
+    }
+}
+
+void xadc_close(struct xadc_capture *x)
+{
+    if (x->buffered)
+        disable_buffer(x);
+    for (int i = 0; i < XC_CHANNELS; i++)
+        if (x->ch[i].raw_fd >= 0)
+            close(x->ch[i].raw_fd);
+    free(x->buf);
+    memset(x, 0, sizeof(*x));
+    x->dev_fd = -1;
+}
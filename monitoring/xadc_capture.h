@@ -0,0 +1,73 @@
+// xadc_capture.h
+// Zynq XADC through its IIO device: die temperature and the VCCINT and VCCAUX rails. With a rate set, the
+// buffered interface (scan elements, the XADC's samplerate trigger, /dev/iio:deviceN) streams scans at
+// that rate and one read() per sample drains them, so each sample carries their mean, minimum and maximum.
+// Without one, or when the buffer cannot be set up, the raw sysfs attributes are re-read per sample.
+#ifndef XADC_CAPTURE_H
+#define XADC_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "telemetry_proto.h"
+
+#define XC_PATH_BYTES 256
+#define XC_MIN_BUFFER_SCANS 128
+
+enum xadc_channel_id
+{
+    XC_TEMP,   // instance-less, degrees C
+    XC_VCCINT, // voltage instance 0
+    XC_VCCAUX, // voltage instance 1
+    XC_CHANNELS
+};
+
+struct xadc_channel
+{
+    int present;
+    int raw_fd;        // sysfs mode
+    int scan_index;    // buffered mode: position among the scan elements, -1 when not captured
+    size_t offset;     // byte offset of the value in a scan
+    int storage_bytes;
+    int bits;
+    int shift;
+    int is_signed;
+    int big_endian;
+    double scale;      // (raw + raw_offset) * scale is in milli-units (mV, m°C)
+    double raw_offset;
+    double sum;
+    double min;
+    double max;
+    uint32_t count;    // values in the current interval
+    float mean_value;  // V or °C, of the last interval
+    float min_value;
+    float max_value;
+    int valid;
+};
+
+struct xadc_capture
+{
+    char device_dir[XC_PATH_BYTES];
+    int buffered;
+    int dev_fd;
+    size_t scan_bytes;
+    uint8_t *buf;
+    size_t buf_size;
+    size_t buf_fill;
+    uint64_t last_ns;
+    uint64_t scans;    // in the current interval
+    float scans_per_s;
+    struct xadc_channel ch[XC_CHANNELS];
+};
+
+// root is prepended to /sys/bus/iio/devices and /dev ("" on the board, a fake tree in tests). hz 0 keeps
+// to sysfs. Returns 0 when an XADC device was found.
+int xadc_open(struct xadc_capture *x, const char *root, unsigned int hz);
+void xadc_read(struct xadc_capture *x, uint64_t now_ns);
+// The interval's mean die temperature, when the XADC provided one.
+int xadc_temperature(const struct xadc_capture *x, float *temp_c);
+void xadc_encode(const struct xadc_capture *x, struct tp_writer *writer);
+void xadc_close(struct xadc_capture *x);
+
+#define XC_ENCODED_BYTES (9 * 9)
+
+#endif
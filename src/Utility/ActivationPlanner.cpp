@@ -0,0 +1,223 @@
+/*ActivationPlanner.cpp*/
+
+#include "Utility/ActivationPlanner.hpp"
+#include "Utility/BenchmarkManager.hpp"
+#include "Utility/FileManager.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <regex>
+#include <set>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static std::string referencePattern(const std::string &buffer)
+{
+    std::string pattern = "\\b";
+    for (char c : buffer)
+        pattern += c == '.' ? std::string("\\s*\\.\\s*") : std::string(1, c);
+    return pattern + "\\b";
+}
+
+bool ActivationPlanner::plan(const ModelProfile &profile, std::vector<PlannedBuffer> &buffers, size_t &arenaBytes)
+{
+    buffers.clear();
+    arenaBytes = 0;
+
+    std::map<std::string, size_t> index;
+    for (size_t i = 0; i < profile.layers.size(); ++i)
+    {
+        const auto &arguments = profile.layers[i].bufferArguments;
+        for (size_t a = 0; a < arguments.size(); ++a)
+        {
+            auto known = profile.activationBuffers.find(arguments[a]);
+            if (known == profile.activationBuffers.end() || profile.findWeight(arguments[a]))
+                continue;
+
+            if (!index.count(arguments[a]))
+            {
+                PlannedBuffer buffer;
+                buffer.name = arguments[a];
+                buffer.elementType = known->second.first;
+                buffer.shape = known->second.second;
+                buffer.bytes = ModelAnalyzer::elementSizeOf(buffer.elementType);
+                for (long dim : buffer.shape)
+                    buffer.bytes *= static_cast<size_t>(std::max(dim, 0L));
+                buffer.firstLayer = i;
+                index[arguments[a]] = buffers.size();
+                buffers.push_back(buffer);
+            }
+            buffers[index[arguments[a]]].lastLayer = i;
+        }
+    }
+
+    for (const auto &buffer : buffers)
+        if (buffer.bytes == 0)
+            return false;
+
+    // Largest first, each at the lowest aligned offset that clears every placed buffer alive at the same time.
+    std::vector<PlannedBuffer *> order;
+    for (auto &buffer : buffers)
+        order.push_back(&buffer);
+    std::stable_sort(order.begin(), order.end(), [](const PlannedBuffer *a, const PlannedBuffer *b)
+                     { return a->bytes > b->bytes; });
+
+    std::vector<const PlannedBuffer *> placed;
+    for (PlannedBuffer *buffer : order)
+    {
+        std::vector<const PlannedBuffer *> conflicts;
+        for (const PlannedBuffer *other : placed)
+            if (other->firstLayer <= buffer->lastLayer && buffer->firstLayer <= other->lastLayer)
+                conflicts.push_back(other);
+        std::sort(conflicts.begin(), conflicts.end(), [](const PlannedBuffer *a, const PlannedBuffer *b)
+                  { return a->offset < b->offset; });
+
+        size_t offset = 0;
+        for (const PlannedBuffer *other : conflicts)
+        {
+            if (offset + buffer->bytes <= other->offset)
+                break;
+            offset = std::max(offset, (other->offset + other->bytes + alignment - 1) / alignment * alignment);
+        }
+        buffer->offset = offset;
+        arenaBytes = std::max(arenaBytes, (offset + buffer->bytes + alignment - 1) / alignment * alignment);
+        placed.push_back(buffer);
+    }
+    return !buffers.empty();
+}
+
+std::string ActivationPlanner::bufferView(const PlannedBuffer &buffer)
+{
+    std::ostringstream out;
+    out << "(*(" << buffer.elementType << " (*)";
+    for (long dim : buffer.shape)
+        out << "[" << dim << "]";
+    out << ")(" << arenaName << " + " << buffer.offset << "))";
+    return out.str();
+}
+
+bool ActivationPlanner::apply(const std::string &stagedModelFolder, std::string &report)
+{
+    std::string error;
+    auto fail = [&](const std::string &message)
+    {
+        report = "Activation planning skipped: " + message;
+        return false;
+    };
+
+    ModelProfile profile;
+    if (!ModelAnalyzer::analyze(stagedModelFolder, profile, error))
+        return fail(error);
+
+    std::vector<PlannedBuffer> buffers;
+    size_t arenaBytes = 0;
+    if (!plan(profile, buffers, arenaBytes))
+        return fail("the layer calls do not pass any activation buffer of known size.");
+
+    // Only storage whose referenced members all moved into the arena can be dropped.
+    std::set<std::string> planned;
+    for (const auto &buffer : buffers)
+        planned.insert(buffer.name);
+    std::vector<const ActivationStorage *> removed;
+    size_t removedBytes = 0;
+    bool isStatic = false;
+    for (const auto &storage : profile.activationStorage)
+    {
+        bool used = false, movable = true;
+        for (const auto &member : storage.members)
+        {
+            std::string name = storage.name + "." + member.second;
+            if (!profile.activationBuffers.count(name))
+                name = member.second;
+            bool referenced = std::any_of(profile.layers.begin(), profile.layers.end(), [&](const LayerCall &layer)
+                                          { return std::count(layer.bufferArguments.begin(), layer.bufferArguments.end(), name) > 0; });
+            used = used || planned.count(name);
+            movable = movable && (planned.count(name) || !referenced);
+        }
+        if (!used)
+            continue;
+        if (!movable || storage.declaration.file != profile.entryBody.file)
+            return fail("activation storage '" + storage.name + "' is also used outside the layer calls.");
+        removed.push_back(&storage);
+        removedBytes += storage.bytes;
+        isStatic = isStatic || storage.isStatic;
+    }
+    if (arenaBytes >= removedBytes)
+        return fail("the " + ModelAnalyzer::formatBytes(removedBytes) + " of activation buffers already reuse memory as well as a " +
+                    ModelAnalyzer::formatBytes(arenaBytes) + " arena would.");
+
+    for (const auto &layer : profile.layers)
+        if (layer.call.file != profile.entryBody.file)
+            return fail("the layer calls are not in the entry function's file.");
+
+    std::string workName = FileManager::sanitizedName(stagedModelFolder);
+    FileManager::ScratchDirectory scratch;
+    if (!scratch.create("rp_arena" + workName + "_", error))
+        return fail(error);
+    fs::path workDir = scratch.path;
+    fs::path candidate = workDir / "model";
+
+    try
+    {
+        fs::copy(stagedModelFolder, candidate, fs::copy_options::recursive);
+
+        // Edits from the end of the file backwards so earlier offsets stay valid.
+        std::string text = FileManager::readText(profile.entryBody.file);
+        std::vector<std::pair<SourceSpan, std::string>> edits;
+        for (const ActivationStorage *storage : removed)
+        {
+            SourceSpan line = storage->declaration;
+            while (line.begin > 0 && (text[line.begin - 1] == ' ' || text[line.begin - 1] == '\t'))
+                --line.begin;
+            if (line.end < text.size() && text[line.end] == '\n')
+                ++line.end;
+            edits.push_back({line, ""});
+        }
+        for (const auto &layer : profile.layers)
+        {
+            std::string call = text.substr(layer.call.begin, layer.call.end - layer.call.begin);
+            for (const auto &buffer : buffers)
+                call = std::regex_replace(call, std::regex(referencePattern(buffer.name)), bufferView(buffer));
+            edits.push_back({layer.call, call});
+        }
+
+        std::ostringstream arena;
+        arena << "\n  // Activation arena: " << buffers.size() << " buffer(s) at liveness-planned offsets.\n  "
+              << (isStatic ? "static " : "") << "unsigned char " << arenaName << "[" << arenaBytes
+              << "] __attribute__((aligned(" << alignment << ")));\n";
+        SourceSpan arenaSpan = profile.entryBody;
+        arenaSpan.begin = arenaSpan.end = profile.entryBody.begin + 1;
+        edits.push_back({arenaSpan, arena.str()});
+
+        std::sort(edits.begin(), edits.end(), [](const auto &a, const auto &b)
+                  { return a.first.begin > b.first.begin; });
+        for (const auto &edit : edits)
+            text.replace(edit.first.begin, edit.first.end - edit.first.begin, edit.second);
+
+        fs::path relative = fs::relative(profile.entryBody.file, stagedModelFolder);
+        if (!FileManager::writeText(candidate / relative, text))
+            return fail("cannot write " + relative.string());
+
+        std::vector<std::string> reference, arenaOutputs;
+        if (!BenchmarkManager::collectOutputs(profile, stagedModelFolder, "-O2", (workDir / "separate").string(), 32, reference, error) ||
+            !BenchmarkManager::collectOutputs(profile, candidate.string(), "-O2", (workDir / "arena").string(), 32, arenaOutputs, error))
+            return fail(error);
+        if (reference != arenaOutputs)
+            return fail("outputs changed when the buffers share the arena; keeping separate buffers.");
+
+        fs::copy_file(candidate / relative, fs::path(stagedModelFolder) / relative, fs::copy_options::overwrite_existing);
+
+        std::ostringstream out;
+        out << "Activations: " << ModelAnalyzer::formatBytes(removedBytes) << " in " << removed.size() << " buffer declaration(s) -> "
+            << ModelAnalyzer::formatBytes(arenaBytes) << " arena (live peak " << ModelAnalyzer::formatBytes(profile.peakActivationBytes) << ").";
+        for (const auto &buffer : buffers)
+            out << "\n  " << buffer.name << " " << ModelAnalyzer::formatShape(buffer.shape) << " @" << buffer.offset
+                << ", layers " << buffer.firstLayer + 1 << "-" << buffer.lastLayer + 1;
+        report = out.str();
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        return fail(e.what());
+    }
+}
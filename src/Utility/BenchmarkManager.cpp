@@ -0,0 +1,471 @@
+/*BenchmarkManager.cpp*/
+
+#include "Utility/BenchmarkManager.hpp"
+#include "Utility/FileManager.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <sys/wait.h>
+
+namespace fs = std::filesystem;
+
+static std::string arrayDeclarator(const std::string &name, const std::vector<long> &shape)
+{
+    if (shape.empty())
+        return "*" + name;
+
+    std::string text = name;
+    for (long dim : shape)
+        text += "[" + std::to_string(dim) + "]";
+    return text;
+}
+
+std::string BenchmarkManager::prototypeFor(const ModelProfile &profile)
+{
+    // Spelled with plain array parameters so the harness does not depend on the typedefs in model.c;
+    // after array-to-pointer adjustment it is the same signature as the generated definition.
+    return "void " + profile.entryFunction + "(const " + profile.inputElementType + " " +
+           arrayDeclarator("input", profile.inputShape) + ", " + profile.outputElementType + " " +
+           arrayDeclarator("output", profile.outputShape) + ")";
+}
+
+void BenchmarkManager::writeHarnessPrelude(std::ostream &out, const ModelProfile &profile, const std::string &purpose)
+{
+    bool integerInput = ModelAnalyzer::isIntegerType(profile.inputElementType);
+    bool integerOutput = ModelAnalyzer::isIntegerType(profile.outputElementType);
+    size_t inputBits = ModelAnalyzer::elementSizeOf(profile.inputElementType) * 8;
+
+    out << "/* Host " << purpose << " harness for " << profile.entryFunction << "(), generated by the RedPitaya Toolbox. */\n"
+        << "#define _GNU_SOURCE\n"
+        << "#include <stdint.h>\n"
+        << "#include <stdio.h>\n"
+        << "#include <stdlib.h>\n"
+        << "#include <string.h>\n"
+        << "#include <time.h>\n\n"
+        << "#define BENCH_INPUT_ELEMENTS " << std::max<size_t>(profile.inputElements(), 1) << "\n"
+        << "#define BENCH_OUTPUT_ELEMENTS " << std::max<size_t>(profile.outputElements(), 1) << "\n"
+        << "#define BENCH_INPUT_SETS 16\n"
+        << "#define BENCH_INTEGER_INPUT " << (integerInput ? 1 : 0) << "\n"
+        << "#define BENCH_INTEGER_OUTPUT " << (integerOutput ? 1 : 0) << "\n"
+        << "#define BENCH_INPUT_RANGE " << (integerInput ? (1UL << std::min<size_t>(inputBits - 2, 30)) : 0) << "UL\n\n"
+        << "typedef " << profile.inputElementType << " bench_input_t;\n"
+        << "typedef " << profile.outputElementType << " bench_output_t;\n\n"
+        << prototypeFor(profile) << ";\n\n";
+
+    out << R"(static uint32_t bench_rng = 0x2545f491u;
+
+static uint32_t bench_next(void)
+{
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 17;
+    bench_rng ^= bench_rng << 5;
+    return bench_rng;
+}
+
+static bench_input_t bench_random_value(void)
+{
+#if BENCH_INTEGER_INPUT
+    return (bench_input_t)((long)(bench_next() % BENCH_INPUT_RANGE) - (long)(BENCH_INPUT_RANGE / 2));
+#else
+    return (bench_input_t)((double)bench_next() / 2147483648.0 - 1.0);
+#endif
+}
+
+)";
+}
+
+bool BenchmarkManager::generateHarness(const ModelProfile &profile, const std::string &harnessPath)
+{
+    if (profile.entryParameters.size() != 2 || profile.inputElementType.empty() || profile.outputElementType.empty())
+        return false;
+
+    std::ofstream out(harnessPath);
+    if (!out)
+        return false;
+
+    writeHarnessPrelude(out, profile, "benchmark");
+
+    out << R"(static volatile int bench_counting;
+static unsigned long bench_allocations;
+static unsigned long bench_allocated_bytes;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    if (bench_counting)
+    {
+        bench_allocations++;
+        bench_allocated_bytes += size;
+    }
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    if (bench_counting)
+    {
+        bench_allocations++;
+        bench_allocated_bytes += count * size;
+    }
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    if (bench_counting)
+    {
+        bench_allocations++;
+        bench_allocated_bytes += size;
+    }
+    return __real_realloc(ptr, size);
+}
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int bench_compare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static bench_input_t bench_inputs[BENCH_INPUT_SETS][BENCH_INPUT_ELEMENTS];
+static bench_output_t bench_output[BENCH_OUTPUT_ELEMENTS];
+
+int main(int argc, char **argv)
+{
+    unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+    if (iterations == 0)
+        iterations = 1;
+
+    uint64_t *samples = malloc(iterations * sizeof(uint64_t));
+    if (!samples)
+        return 1;
+
+    for (int set = 0; set < BENCH_INPUT_SETS; set++)
+        for (int i = 0; i < BENCH_INPUT_ELEMENTS; i++)
+            bench_inputs[set][i] = bench_random_value();
+
+    for (unsigned long i = 0; i < iterations / 10 + 1; i++)
+        )"
+        << profile.entryFunction << R"(((const void *)bench_inputs[i % BENCH_INPUT_SETS], (void *)bench_output);
+
+    bench_counting = 1;
+    uint64_t start = bench_now_ns();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        uint64_t t0 = bench_now_ns();
+        )"
+        << profile.entryFunction << R"(((const void *)bench_inputs[i % BENCH_INPUT_SETS], (void *)bench_output);
+        samples[i] = bench_now_ns() - t0;
+    }
+    uint64_t total = bench_now_ns() - start;
+    bench_counting = 0;
+
+    double checksum = 0.0;
+    for (int i = 0; i < BENCH_OUTPUT_ELEMENTS; i++)
+        checksum += (double)bench_output[i];
+
+    double sum = 0.0;
+    for (unsigned long i = 0; i < iterations; i++)
+        sum += (double)samples[i];
+    qsort(samples, iterations, sizeof(uint64_t), bench_compare);
+
+    printf("BENCH iterations=%lu min_ns=%llu mean_ns=%.1f p50_ns=%llu p90_ns=%llu p99_ns=%llu max_ns=%llu "
+           "total_ns=%llu allocations=%lu allocated_bytes=%lu checksum=%.9g\n",
+           iterations,
+           (unsigned long long)samples[0],
+           sum / iterations,
+           (unsigned long long)samples[(iterations - 1) * 50 / 100],
+           (unsigned long long)samples[(iterations - 1) * 90 / 100],
+           (unsigned long long)samples[(iterations - 1) * 99 / 100],
+           (unsigned long long)samples[iterations - 1],
+           (unsigned long long)total,
+           bench_allocations,
+           bench_allocated_bytes,
+           checksum);
+
+    free(samples);
+    return 0;
+}
+)";
+
+    return static_cast<bool>(out);
+}
+
+bool BenchmarkManager::generateOutputHarness(const ModelProfile &profile, const std::string &harnessPath)
+{
+    if (profile.entryParameters.size() != 2 || profile.inputElementType.empty() || profile.outputElementType.empty())
+        return false;
+
+    std::ofstream out(harnessPath);
+    if (!out)
+        return false;
+
+    writeHarnessPrelude(out, profile, "output dump");
+
+    // Inputs come from a raw file of bench_input_t when one is given; otherwise set 0 is all zeros and
+    // the rest are random. Floats are printed with %a so the text is exact.
+    out << R"(static bench_input_t bench_input[BENCH_INPUT_ELEMENTS];
+static bench_output_t bench_output[BENCH_OUTPUT_ELEMENTS];
+
+int main(int argc, char **argv)
+{
+    unsigned long sets = argc > 1 ? strtoul(argv[1], NULL, 10) : 64;
+    FILE *inputs = argc > 2 ? fopen(argv[2], "rb") : NULL;
+    if (argc > 2 && !inputs)
+        return 1;
+
+    for (unsigned long set = 0; set < sets; set++)
+    {
+        if (inputs)
+        {
+            if (fread(bench_input, sizeof(bench_input), 1, inputs) != 1)
+                return 1;
+        }
+        else
+            for (int i = 0; i < BENCH_INPUT_ELEMENTS; i++)
+                bench_input[i] = set == 0 ? (bench_input_t)0 : bench_random_value();
+        memset(bench_output, 0, sizeof(bench_output));
+
+        )"
+        << profile.entryFunction << R"(((const void *)bench_input, (void *)bench_output);
+
+        printf("OUT %lu", set);
+        for (int i = 0; i < BENCH_OUTPUT_ELEMENTS; i++)
+#if BENCH_INTEGER_OUTPUT
+            printf(" %lld", (long long)bench_output[i]);
+#else
+            printf(" %a", (double)bench_output[i]);
+#endif
+        printf("\n");
+    }
+
+    if (inputs)
+        fclose(inputs);
+    return 0;
+}
+)";
+
+    return static_cast<bool>(out);
+}
+
+bool BenchmarkManager::parseOutputLine(const std::string &line, std::vector<double> &values)
+{
+    values.clear();
+    std::istringstream words(line);
+    std::string word;
+    if (!(words >> word) || word != "OUT" || !(words >> word))
+        return false;
+    while (words >> word)
+        values.push_back(std::strtod(word.c_str(), nullptr));
+    return true;
+}
+
+bool BenchmarkManager::collectOutputs(const ModelProfile &profile,
+                                      const std::string &modelFolder,
+                                      const std::string &flags,
+                                      const std::string &workDirectory,
+                                      unsigned long inputSets,
+                                      std::vector<std::string> &outputs,
+                                      std::string &error,
+                                      const std::string &inputFile)
+{
+    outputs.clear();
+    std::error_code ec;
+    fs::create_directories(workDirectory, ec);
+    if (ec)
+    {
+        error = "Cannot create " + workDirectory + ": " + ec.message();
+        return false;
+    }
+    std::string harness = (fs::path(workDirectory) / "outputs.c").string();
+    std::string binary = (fs::path(workDirectory) / "outputs").string();
+
+    if (!generateOutputHarness(profile, harness))
+    {
+        error = "Could not generate an output harness for " + profile.entryFunction + "().";
+        return false;
+    }
+
+    std::string output;
+    if (!compileForHost(modelFolder, {harness}, flags, binary, output))
+    {
+        error = "Host compilation failed:\n" + output;
+        return false;
+    }
+
+    std::string command = "\"" + binary + "\" " + std::to_string(inputSets);
+    if (!inputFile.empty())
+        command += " \"" + inputFile + "\"";
+    if (runCommand(command, output) != 0)
+    {
+        error = "Output harness failed:\n" + output;
+        return false;
+    }
+
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line))
+        if (line.rfind("OUT ", 0) == 0)
+            outputs.push_back(line);
+
+    if (outputs.size() != inputSets)
+    {
+        error = "Unexpected output harness result:\n" + output;
+        return false;
+    }
+    return true;
+}
+
+int BenchmarkManager::runCommand(const std::string &command, std::string &output)
+{
+    output.clear();
+    FILE *pipe = popen((command + " 2>&1").c_str(), "r");
+    if (!pipe)
+        return -1;
+
+    char buffer[4096];
+    size_t bytesRead;
+    while ((bytesRead = fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+        output.append(buffer, bytesRead);
+
+    int status = pclose(pipe);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+bool BenchmarkManager::compileForHost(const std::string &modelFolder,
+                                      const std::vector<std::string> &extraSources,
+                                      const std::string &flags,
+                                      const std::string &outputBinary,
+                                      std::string &compilerOutput)
+{
+    std::ostringstream command;
+    command << "gcc -std=gnu11 " << flags
+            << " -I\"" << modelFolder << "\" -I\"" << modelFolder << "/include\""
+            << " \"" << modelFolder << "/model.c\"";
+    // Externalized weights are found through their absolute path so the binary runs from any directory.
+    fs::path weightsBlob = fs::path(modelFolder) / "model_weights.bin";
+    if (fs::exists(weightsBlob))
+        command << " -DMODEL_WEIGHTS_DEFAULT_PATH='\"" << fs::absolute(weightsBlob).string() << "\"'";
+    for (const auto &source : extraSources)
+        command << " \"" << source << "\"";
+    command << " -o \"" << outputBinary << "\" -lm";
+
+    return runCommand(command.str(), compilerOutput) == 0;
+}
+
+BenchmarkResult BenchmarkManager::runBenchmark(const BenchmarkVariant &variant,
+                                               unsigned long iterations,
+                                               const std::atomic<bool> &cancelFlag)
+{
+    BenchmarkResult result;
+    result.label = variant.label;
+
+    ModelProfile profile;
+    if (!ModelAnalyzer::analyze(variant.modelFolder, profile, result.error))
+        return result;
+
+    std::string workName = FileManager::sanitizedName(variant.label);
+    FileManager::ScratchDirectory scratch;
+    if (!scratch.create("rp_benchmark_" + workName + "_", result.error))
+        return result;
+    fs::path workDir = scratch.path;
+
+    std::string harness = (workDir / "harness.c").string();
+    std::string binary = (workDir / "bench").string();
+    if (!generateHarness(profile, harness))
+    {
+        result.error = "Could not generate a harness for " + profile.entryFunction + "().";
+        return result;
+    }
+
+    if (cancelFlag.load())
+        return result;
+
+    std::string output;
+    if (!compileForHost(variant.modelFolder, {harness},
+                        variant.optimization + " -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc", binary, output))
+    {
+        result.error = "Host compilation failed:\n" + output;
+        return result;
+    }
+
+    if (cancelFlag.load())
+        return result;
+
+    if (runCommand("\"" + binary + "\" " + std::to_string(iterations), output) != 0)
+    {
+        result.error = "Benchmark run failed:\n" + output;
+        return result;
+    }
+
+    std::istringstream lines(output);
+    std::string line;
+    std::map<std::string, double> fields;
+    while (std::getline(lines, line))
+    {
+        if (line.rfind("BENCH ", 0) != 0)
+            continue;
+        std::istringstream words(line.substr(6));
+        std::string word;
+        while (words >> word)
+        {
+            size_t eq = word.find('=');
+            if (eq != std::string::npos)
+                fields[word.substr(0, eq)] = std::atof(word.c_str() + eq + 1);
+        }
+    }
+
+    if (!fields.count("iterations"))
+    {
+        result.error = "Unexpected benchmark output:\n" + output;
+        return result;
+    }
+
+    result.iterations = static_cast<unsigned long>(fields["iterations"]);
+    result.minUs = fields["min_ns"] / 1000.0;
+    result.meanUs = fields["mean_ns"] / 1000.0;
+    result.p50Us = fields["p50_ns"] / 1000.0;
+    result.p90Us = fields["p90_ns"] / 1000.0;
+    result.p99Us = fields["p99_ns"] / 1000.0;
+    result.maxUs = fields["max_ns"] / 1000.0;
+    result.inferencesPerSecond = fields["total_ns"] > 0 ? result.iterations * 1e9 / fields["total_ns"] : 0.0;
+    result.allocations = static_cast<unsigned long>(fields["allocations"]);
+    result.allocatedBytes = static_cast<unsigned long>(fields["allocated_bytes"]);
+    result.success = true;
+    return result;
+}
+
+std::string BenchmarkManager::formatResults(const std::vector<BenchmarkResult> &results)
+{
+    std::ostringstream out;
+    out << std::left << std::setw(24) << "Variant" << std::right << std::setw(10) << "p50 us" << std::setw(10) << "p90 us"
+        << std::setw(10) << "p99 us" << std::setw(10) << "max us" << std::setw(12) << "inf/s" << std::setw(8) << "allocs" << "\n";
+
+    for (const auto &result : results)
+    {
+        out << std::left << std::setw(24) << result.label << std::right;
+        if (!result.success)
+        {
+            out << "  failed: " << result.error << "\n";
+            continue;
+        }
+        out << std::fixed << std::setprecision(2) << std::setw(10) << result.p50Us << std::setw(10) << result.p90Us
+            << std::setw(10) << result.p99Us << std::setw(10) << result.maxUs << std::setprecision(0)
+            << std::setw(12) << result.inferencesPerSecond << std::setw(8) << result.allocations << "\n";
+    }
+    return out.str();
+}
@@ -0,0 +1,211 @@
+/*BuildManager.cpp*/
+
+#include "Utility/BuildManager.hpp"
+#include "Utility/SSHManager.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+// Rough peak RSS of one gcc job on the board; large model.c initializers dominate it.
+static const long compileJobMB = 160;
+static const char *timingShellPath = "/tmp/rp_build_time.sh";
+static const char *timingTag = "@@RP_CCTIME ";
+// Both in the version directory while its build runs.
+static const char *timingLogName = ".rp_build_times";
+static const char *buildPidName = ".rp_build_pid";
+
+bool BuildManager::readRemoteResources(const std::string &hostname,
+                                       const std::string &password,
+                                       const std::string &privateKeyPath,
+                                       long &availableMB,
+                                       int &cores)
+{
+    availableMB = 0;
+    cores = 0;
+
+    int status = SSHManager::execute_remote_command_streamed(
+        hostname, password, privateKeyPath,
+        "nproc; awk '/^MemAvailable:/ {print $2}' /proc/meminfo",
+        [&](const std::string &line)
+        {
+            if (line.empty())
+                return;
+            if (cores == 0)
+                cores = std::atoi(line.c_str());
+            else
+                availableMB = std::atol(line.c_str()) / 1024;
+        });
+
+    return status == 0 && cores > 0 && availableMB > 0;
+}
+
+bool BuildManager::installTimingShell(const std::string &hostname,
+                                      const std::string &password,
+                                      const std::string &privateKeyPath)
+{
+    // make runs every recipe line through $(SHELL) -c '<line>', so wrapping SHELL times each compile
+    // without touching the Makefile of the exported version. $(shell ...) goes through it as well, so the
+    // times go to $RP_CCTIME_LOG rather than stdout, and only for compile lines (-c).
+    std::ostringstream cmd;
+    cmd << "cat > " << timingShellPath << " <<'EOF'\n"
+        << "#!/bin/sh\n"
+        << "start=$(date +%s%N)\n"
+        << "/bin/sh \"$@\"\n"
+        << "rc=$?\n"
+        << "end=$(date +%s%N)\n"
+        << "set -f\n"
+        << "src=\"\"\n"
+        << "compile=\"\"\n"
+        << "for w in $2; do case \"$w\" in -c) compile=1 ;; *.c|*.cc|*.cpp) src=\"$w\" ;; esac; done\n"
+        << "[ -n \"$compile\" ] && [ -n \"$src\" ] && [ -n \"$RP_CCTIME_LOG\" ] && "
+        << "echo \"$src $(( (end - start) / 1000000 ))\" >> \"$RP_CCTIME_LOG\"\n"
+        << "exit $rc\n"
+        << "EOF\n"
+        << "chmod +x " << timingShellPath;
+
+    return SSHManager::execute_remote_command_streamed(hostname, password, privateKeyPath, cmd.str(), nullptr) == 0;
+}
+
+BuildResult BuildManager::buildOnRedPitaya(const std::string &hostname,
+                                           const std::string &password,
+                                           const std::string &privateKeyPath,
+                                           const std::string &remoteVersionDir,
+                                           const std::string &version,
+                                           int jobs,
+                                           const std::function<void(const std::string &)> &onOutput,
+                                           const std::atomic<bool> &cancelExportFlag)
+{
+    BuildResult result;
+    result.version = version;
+
+    // make leads its own process group (setsid) and leaves its pid behind, so that a cancel can kill it with
+    // every compiler it started. The compile times follow its output once it exits.
+    std::string pidPath = "\"" + remoteVersionDir + "/" + buildPidName + "\"";
+    std::string command = "cd \"" + remoteVersionDir + "\" && rm -f " + timingLogName + " && " +
+                          "{ RP_CCTIME_LOG=\"$PWD/" + timingLogName + "\" setsid make -j" + std::to_string(std::max(jobs, 1)) +
+                          " SHELL=" + timingShellPath + " </dev/null & echo $! > " + buildPidName + "; wait $!; }; rc=$?; " +
+                          "sed 's/^/" + timingTag + "/' " + timingLogName + " 2>/dev/null; rm -f " + timingLogName + " " + buildPidName +
+                          "; exit $rc";
+
+    std::mutex doneMutex;
+    std::condition_variable doneChanged;
+    bool done = false;
+    std::thread canceller([&]()
+    {
+        std::unique_lock<std::mutex> lock(doneMutex);
+        while (!done)
+        {
+            doneChanged.wait_for(lock, std::chrono::milliseconds(250));
+            if (done || !cancelExportFlag.load())
+                continue;
+            lock.unlock();
+            SSHManager::execute_remote_command_streamed(hostname, password, privateKeyPath,
+                                                        "kill -TERM -- -$(cat " + pidPath + ") 2>/dev/null", nullptr);
+            lock.lock();
+            // Again only if make outlives this (e.g. the pid was not written yet).
+            doneChanged.wait_for(lock, std::chrono::seconds(1), [&done]()
+                                 { return done; });
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    int status = SSHManager::execute_remote_command_streamed(
+        hostname, password, privateKeyPath, command,
+        [&](const std::string &line)
+        {
+            if (line.compare(0, std::char_traits<char>::length(timingTag), timingTag) == 0)
+            {
+                std::istringstream fields(line.substr(std::char_traits<char>::length(timingTag)));
+                std::string file;
+                long ms = 0;
+                if (fields >> file >> ms)
+                    result.fileCompileTimesMs.emplace_back(file, ms);
+                return;
+            }
+            if (onOutput)
+                onOutput("[" + version + "] " + line);
+        });
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.success = status == 0 && !cancelExportFlag.load();
+
+    {
+        std::lock_guard<std::mutex> lock(doneMutex);
+        done = true;
+    }
+    doneChanged.notify_all();
+    canceller.join();
+
+    std::sort(result.fileCompileTimesMs.begin(), result.fileCompileTimesMs.end(),
+              [](const auto &a, const auto &b)
+              { return a.second > b.second; });
+    return result;
+}
+
+std::vector<BuildResult> BuildManager::buildVersionsOnRedPitaya(const std::string &hostname,
+                                                                const std::string &password,
+                                                                const std::string &privateKeyPath,
+                                                                const std::string &targetDirectory,
+                                                                const std::vector<std::string> &versions,
+                                                                const std::function<void(const std::string &)> &onOutput,
+                                                                const std::atomic<bool> &cancelExportFlag)
+{
+    std::vector<BuildResult> results(versions.size());
+    if (versions.empty())
+        return results;
+
+    long availableMB = 0;
+    int cores = 0;
+    if (!readRemoteResources(hostname, password, privateKeyPath, availableMB, cores))
+    {
+        availableMB = compileJobMB;
+        cores = 1;
+    }
+
+    if (!installTimingShell(hostname, password, privateKeyPath))
+    {
+        if (onOutput)
+            onOutput("Failed to install build timing shell on RedPitaya.");
+        for (size_t i = 0; i < versions.size(); ++i)
+            results[i].version = versions[i];
+        return results;
+    }
+
+    // Keep a quarter of the available memory for the acquisition buffers and the running pipeline.
+    long affordableJobs = std::max(1L, (availableMB * 3 / 4) / compileJobMB);
+    int jobsPerBuild = static_cast<int>(std::min<long>(cores, affordableJobs));
+    size_t parallelBuilds = std::clamp<size_t>(affordableJobs / jobsPerBuild, 1, versions.size());
+
+    if (onOutput)
+        onOutput("RedPitaya has " + std::to_string(availableMB) + " MB available and " + std::to_string(cores) +
+                 " core(s): running " + std::to_string(parallelBuilds) + " build(s) at a time with -j" +
+                 std::to_string(jobsPerBuild) + ".");
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]()
+    {
+        size_t index;
+        while ((index = next.fetch_add(1)) < versions.size())
+        {
+            if (cancelExportFlag.load())
+            {
+                results[index].version = versions[index];
+                continue;
+            }
+            results[index] = buildOnRedPitaya(hostname, password, privateKeyPath,
+                                              targetDirectory + "/" + versions[index], versions[index],
+                                              jobsPerBuild, onOutput, cancelExportFlag);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < parallelBuilds; ++i)
+        workers.emplace_back(worker);
+    worker();
+    for (auto &thread : workers)
+        thread.join();
+
+    return results;
+}
@@ -2,15 +2,132 @@
 
 #include "Utility/ExportManager.hpp"
 #include "Utility/SSHManager.hpp"
+#include "Utility/FileManager.hpp"
+#include "Utility/NeonKernelGenerator.hpp"
+#include "Utility/ModelQuantizer.hpp"
+#include "Utility/WeightExternalizer.hpp"
+#include "Utility/ActivationPlanner.hpp"
+#include "Utility/LayerProbeInjector.hpp"
+#include "Utility/ModelAnalyzer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <vector>
 
 namespace fs = std::filesystem;
 
+// Bump when a transform changes what it writes, so stagings cached by older builds are not reused.
+static const int transformCacheVersion = 1;
+static const size_t stagedCacheEntries = 8;
+// A cached clone this recent is used without asking upstream for its HEAD (a blocking git ls-remote).
+static const auto remoteHeadCheckInterval = std::chrono::minutes(30);
+// Stats ABI shared with monitor_sender; shipped next to every version's sources so its stages can report.
+static const char *statsHeaderPath = "build/monitoring/rp_stats.h";
+
 const std::unordered_map<std::string, std::string> ExportManager::versionGitLinks = {
     {"threads_mutex", "https://github.com/aymanehajjaoui/threads_mutex.git"},
     {"threads_sem", "https://github.com/aymanehajjaoui/threads_sem.git"},
     {"process_mutex", "https://github.com/aymanehajjaoui/process_mutex.git"},
     {"process_sem", "https://github.com/aymanehajjaoui/process_sem.git"}};
 
+std::mutex ExportManager::lastRemoteExportMutex;
+std::unique_ptr<RemoteExportRecord> ExportManager::lastRemoteExportRecord;
+
+void ExportManager::rememberRemoteExport(const RemoteExportRecord &record)
+{
+    std::lock_guard<std::mutex> lock(lastRemoteExportMutex);
+    lastRemoteExportRecord = std::make_unique<RemoteExportRecord>(record);
+    lastRemoteExportRecord->options.log = nullptr;
+}
+
+bool ExportManager::lastRemoteExport(RemoteExportRecord &record)
+{
+    std::lock_guard<std::mutex> lock(lastRemoteExportMutex);
+    if (!lastRemoteExportRecord)
+        return false;
+    record = *lastRemoteExportRecord;
+    return true;
+}
+
+// build/monitoring/rp_stats.h from the working directory (make run), else monitoring/rp_stats.h next to the
+// executable, which is where copy-monitoring puts it.
+static fs::path findStatsHeader()
+{
+    std::error_code ec;
+    if (fs::is_regular_file(statsHeaderPath, ec))
+        return statsHeaderPath;
+    fs::path besideExecutable = fs::read_symlink("/proc/self/exe", ec).parent_path() / "monitoring" / fs::path(statsHeaderPath).filename();
+    if (!ec && fs::is_regular_file(besideExecutable, ec))
+        return besideExecutable;
+    return {};
+}
+
+bool ExportManager::addStatsHeader(const std::string &versionPath, const ExportOptions &options)
+{
+    fs::path header = findStatsHeader();
+    std::error_code ec;
+    if (!header.empty())
+        fs::copy_file(header, fs::path(versionPath) / header.filename(), fs::copy_options::overwrite_existing, ec);
+    if (header.empty() || ec)
+    {
+        std::string message = header.empty() ? "Stats header rp_stats.h not found in build/monitoring or next to the application"
+                                             : "Cannot copy " + header.string() + ": " + ec.message();
+        message += "; the model is exported without inference stats.";
+        std::cerr << message << std::endl;
+        if (options.log)
+            options.log(message);
+        return false;
+    }
+    return true;
+}
+
+// Reports every call of the model's entry function as the "inference" stage of rp_stats.h, which the staged
+// model.c then defines (RP_STATS_IMPLEMENTATION). Applied after removeStaticFromModelC, whose pass would
+// otherwise strip the registration function's static.
+void ExportManager::addInferenceStats(const std::string &stagedModelFolder)
+{
+    ModelProfile profile;
+    std::string error;
+    if (!ModelAnalyzer::analyze(stagedModelFolder, profile, error))
+    {
+        std::cerr << "Inference stats skipped: " << error << std::endl;
+        return;
+    }
+
+    std::ifstream in(profile.entryBody.file);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    in.close();
+    std::string text = buffer.str();
+
+    size_t definition = ModelAnalyzer::entryDefinitionStart(text, profile);
+    std::string body = text.substr(profile.entryBody.begin, profile.entryBody.end - profile.entryBody.begin);
+    if (definition == std::string::npos || std::regex_search(body, std::regex(R"(\breturn\b)")))
+    {
+        std::cerr << "Inference stats skipped: " << profile.entryFunction << "() has no single exit." << std::endl;
+        return;
+    }
+
+    // model.c sits somewhere below the version directory's model/, rp_stats.h in the version directory.
+    std::string include = "rp_stats.h";
+    for (const auto &part : fs::relative(fs::path(profile.entryBody.file).parent_path(), stagedModelFolder))
+        if (part != ".")
+            include = "../" + include;
+    include = "../" + include;
+
+    text.insert(profile.entryBody.end - 1, "  rp_stats_done(rp_stats_inference, rp_stats_now() - rp_stats_started);\n");
+    text.insert(profile.entryBody.begin + 1, "\n  uint64_t rp_stats_started = rp_stats_now();");
+    text.insert(definition, "#define RP_STATS_IMPLEMENTATION\n#include \"" + include + "\"\n\n"
+                            "int rp_stats_inference = -1;\n\n"
+                            "__attribute__((constructor)) static void rp_stats_register_inference(void)\n"
+                            "{\n  rp_stats_inference = rp_stats_stage(\"inference\", 0);\n}\n\n");
+
+    std::ofstream out(profile.entryBody.file);
+    out << text;
+}
+
 void ExportManager::removeStaticFromModelC(const std::string &versionPath)
 {
     fs::path modelCPath = fs::path(versionPath) / "model.c";
@@ -31,24 +148,287 @@ void ExportManager::removeStaticFromModelC(const std::string &versionPath)
     out.close();
 }
 
+void ExportManager::applyModelTransforms(const std::string &stagedModelFolder, const ExportOptions &options)
+{
+    auto log = [&options](const std::string &message)
+    {
+        if (options.log)
+            options.log(message);
+    };
+
+    bool quantized = false;
+    if (options.quantizationBits != 0)
+    {
+        std::string report;
+        if (options.calibrationFile.empty())
+            log("Quantization skipped: no calibration sample file was selected.");
+        else
+        {
+            quantized = ModelQuantizer::quantize(stagedModelFolder, options.quantizationBits, options.calibrationFile, report);
+            log(report);
+        }
+    }
+
+    if (options.planActivations)
+    {
+        std::string report;
+        ActivationPlanner::apply(stagedModelFolder, report);
+        log(report);
+    }
+
+    if (options.generateNeonKernels)
+    {
+        std::string report;
+        if (quantized)
+            log("NEON pass skipped: the exported model is fixed point.");
+        else
+        {
+            NeonKernelGenerator::apply(stagedModelFolder, report);
+            log(report);
+        }
+    }
+
+    if (options.externalizeWeights)
+    {
+        std::string report;
+        WeightExternalizer::apply(stagedModelFolder, report);
+        log(report);
+    }
+
+    if (options.injectLayerProbes)
+    {
+        std::string report;
+        LayerProbeInjector::apply(stagedModelFolder, report);
+        log(report);
+    }
+}
+
+bool ExportManager::stageModel(const std::string &modelFolder, const std::string &stagedModelFolder,
+                               const ExportOptions &options, const std::atomic<bool> &cancelExportFlag)
+{
+    bool transforms = options.generateNeonKernels || options.quantizationBits != 0 || options.externalizeWeights ||
+                      options.planActivations || options.injectLayerProbes;
+    if (!transforms)
+    {
+        fs::copy(modelFolder, stagedModelFolder, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
+        return !cancelExportFlag.load();
+    }
+
+    std::ostringstream key;
+    key << transformCacheVersion << " " << FileManager::toHex(FileManager::fingerprintFolder(modelFolder))
+        << " neon=" << options.generateNeonKernels << " bits=" << options.quantizationBits
+        << " calibration=" << (options.calibrationFile.empty() ? "-" : FileManager::toHex(FileManager::fingerprintFile(options.calibrationFile)))
+        << " weights=" << options.externalizeWeights << " arena=" << options.planActivations << " probes=" << options.injectLayerProbes;
+    std::string keyText = key.str();
+    std::string keyHash = FileManager::toHex(FileManager::hashBytes(keyText.data(), keyText.size()));
+    fs::path cacheRoot = fs::path(FileManager::cacheDirectory()) / "staged";
+    fs::path cached = cacheRoot / keyHash;
+
+    std::string reports;
+    if (fs::is_directory(cached / "model") && FileManager::readCachedText("staged", keyHash + ".log", reports))
+    {
+        fs::copy(cached / "model", stagedModelFolder, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
+        fs::last_write_time(cached, fs::file_time_type::clock::now());
+        if (options.log)
+        {
+            options.log("Model and export options unchanged: reusing transformed model " + keyHash + ".");
+            std::istringstream lines(reports);
+            std::string report;
+            while (std::getline(lines, report, '\0'))
+                options.log("(cached) " + report);
+        }
+        return !cancelExportFlag.load();
+    }
+
+    fs::copy(modelFolder, stagedModelFolder, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
+    if (cancelExportFlag.load())
+        return false;
+
+    ExportOptions recording = options;
+    recording.log = [&](const std::string &report)
+    {
+        reports += report;
+        reports.push_back('\0');
+        if (options.log)
+            options.log(report);
+    };
+    applyModelTransforms(stagedModelFolder, recording);
+    if (cancelExportFlag.load())
+        return false;
+
+    try
+    {
+        fs::path temporary = cacheRoot / (keyHash + ".tmp");
+        fs::remove_all(temporary);
+        fs::create_directories(temporary);
+        fs::copy(stagedModelFolder, temporary / "model", fs::copy_options::recursive);
+        fs::remove_all(cached);
+        fs::rename(temporary, cached);
+        FileManager::writeCachedText("staged", keyHash + ".log", reports);
+
+        std::vector<fs::path> entries;
+        for (const auto &entry : fs::directory_iterator(cacheRoot))
+            if (entry.is_directory())
+                entries.push_back(entry.path());
+        std::sort(entries.begin(), entries.end(), [](const fs::path &a, const fs::path &b)
+                  { return fs::last_write_time(a) > fs::last_write_time(b); });
+        for (size_t i = stagedCacheEntries; i < entries.size(); ++i)
+        {
+            fs::remove_all(entries[i]);
+            fs::remove(entries[i].string() + ".log");
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Could not cache the transformed model: " << e.what() << std::endl;
+    }
+    return true;
+}
+
+std::string ExportManager::remoteHead(const std::string &url)
+{
+    std::string command = "git ls-remote " + url + " HEAD 2>/dev/null";
+    FILE *pipe = popen(command.c_str(), "r");
+    if (!pipe)
+        return "";
+
+    char line[256];
+    std::string head;
+    if (fgets(line, sizeof(line), pipe))
+        head = std::string(line).substr(0, std::string(line).find_first_of(" \t\n"));
+    pclose(pipe);
+    return head.size() == 40 ? head : "";
+}
+
 bool ExportManager::cloneVersionFromGit(const std::string &version, const std::string &destination)
 {
     auto it = versionGitLinks.find(version);
     if (it == versionGitLinks.end())
         return false;
 
-    std::string command = "git clone --depth=1 " + it->second + " " + destination + " > /dev/null 2>&1";
-    if (std::system(command.c_str()) != 0)
-        return false;
+    // Clones are cached per upstream commit. Upstream is only asked for its HEAD once the newest cached clone
+    // of the version is older than remoteHeadCheckInterval; offline, that clone is used as is.
+    fs::path cacheRoot = fs::path(FileManager::cacheDirectory()) / "versions";
+    fs::path newest;
+    if (fs::is_directory(cacheRoot))
+    {
+        for (const auto &entry : fs::directory_iterator(cacheRoot))
+            if (entry.is_directory() && entry.path().filename().string().rfind(version + "-", 0) == 0 &&
+                entry.path().extension() != ".tmp" &&
+                (newest.empty() || entry.last_write_time() > fs::last_write_time(newest)))
+                newest = entry.path();
+    }
+
+    std::error_code ec;
+    auto now = fs::file_time_type::clock::now();
+    fs::path cached = newest;
+    if (newest.empty() || now - fs::last_write_time(newest) >= remoteHeadCheckInterval)
+    {
+        std::string head = remoteHead(it->second);
+        if (!head.empty())
+        {
+            cached = cacheRoot / (version + "-" + head.substr(0, 12));
+            // Checked against upstream just now.
+            if (fs::is_directory(cached))
+                fs::last_write_time(cached, now, ec);
+        }
+    }
 
-    fs::remove_all(fs::path(destination) / ".git");
+    if (cached.empty() || !fs::is_directory(cached))
+    {
+        fs::path target = cached.empty() ? fs::path(destination) : fs::path(cached.string() + ".tmp");
+        fs::remove_all(target);
+        fs::create_directories(target.parent_path());
+
+        std::string command = "git clone --depth=1 " + it->second + " " + target.string() + " > /dev/null 2>&1";
+        if (std::system(command.c_str()) != 0)
+            return false;
+
+        fs::remove_all(target / ".git");
+        if (cached.empty())
+            return true;
+        fs::rename(target, cached);
+    }
+
+    fs::copy(cached, destination, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
     return true;
 }
 
+bool ExportManager::uploadChangedFiles(const std::string &hostname, const std::string &password, const std::string &privateKeyPath,
+                                       const std::string &remoteVersionDir, const std::string &modelDir, const std::string &codeDir,
+                                       const std::string &manifestDir, const ExportOptions &options)
+{
+    std::map<std::string, uint64_t> modelHashes, codeHashes;
+    uint64_t modelFingerprint = FileManager::fingerprintFolder(modelDir, &modelHashes);
+    FileManager::fingerprintFolder(codeDir, &codeHashes);
+
+    // Remote path relative to the version directory -> (local path, hash).
+    std::map<std::string, std::pair<fs::path, uint64_t>> files;
+    for (const auto &entry : codeHashes)
+        files[entry.first] = {fs::path(codeDir) / entry.first, entry.second};
+    for (const auto &entry : modelHashes)
+        files["model/" + entry.first] = {fs::path(modelDir) / entry.first, entry.second};
+
+    // The manifest records what the last export uploaded; files are compared against it, not re-read.
+    std::map<std::string, uint64_t> remoteHashes;
+    std::string remoteManifest;
+    if (SSHManager::read_remote_file(hostname, password, privateKeyPath, remoteVersionDir + "/" + manifestName, remoteManifest))
+    {
+        std::istringstream lines(remoteManifest);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            std::istringstream fields(line);
+            std::string hash, path;
+            if (fields >> hash && std::getline(fields >> std::ws, path) && hash.size() == 16)
+                remoteHashes[path] = std::strtoull(hash.c_str(), nullptr, 16);
+        }
+    }
+
+    std::ostringstream manifest;
+    manifest << "# rp_manifest 1 model " << FileManager::toHex(modelFingerprint) << "\n";
+    std::vector<std::pair<std::string, std::string>> uploads;
+    for (const auto &file : files)
+    {
+        manifest << FileManager::toHex(file.second.second) << " " << file.first << "\n";
+        auto remote = remoteHashes.find(file.first);
+        if (remote == remoteHashes.end() || remote->second != file.second.second)
+            uploads.push_back({file.second.first.string(), remoteVersionDir + "/" + file.first});
+    }
+
+    // Files the previous export uploaded that this one does not ship (model_weights.bin once weights are no longer
+    // externalized, a file the model or version dropped) are removed, so the board runs only what was exported.
+    std::ostringstream removeCommand;
+    size_t removals = 0;
+    for (const auto &remote : remoteHashes)
+        if (files.count(remote.first) == 0 && remote.first.find('\'') == std::string::npos &&
+            remote.first.find("..") == std::string::npos)
+        {
+            removeCommand << (removals++ == 0 ? "rm -f" : "") << " '" << remoteVersionDir << "/" << remote.first << "'";
+        }
+    if (removals > 0 && !SSHManager::execute_remote_command(hostname, password, privateKeyPath, removeCommand.str()))
+        return false;
+
+    fs::remove_all(manifestDir);
+    fs::create_directories(manifestDir);
+    fs::path manifestPath = fs::path(manifestDir) / manifestName;
+    std::ofstream(manifestPath) << manifest.str();
+
+    if (options.log)
+        options.log("Upload to " + remoteVersionDir + ": " + std::to_string(uploads.size()) + " changed file(s), " +
+                    std::to_string(files.size() - uploads.size()) + " unchanged, " + std::to_string(removals) +
+                    " removed (model " + FileManager::toHex(modelFingerprint) + ").");
+
+    // The manifest goes last so an interrupted upload is retried in full next time.
+    uploads.push_back({manifestPath.string(), remoteVersionDir + "/" + manifestName});
+    return SSHManager::upload_files(hostname, password, privateKeyPath, uploads);
+}
+
 bool ExportManager::exportLocally(const std::string &modelFolder,
                                   const std::string &version,
                                   const std::string &targetFolder,
-                                  const std::atomic<bool> &cancelExportFlag)
+                                  const std::atomic<bool> &cancelExportFlag,
+                                  const ExportOptions &options)
 {
     try
     {
@@ -58,13 +438,16 @@ bool ExportManager::exportLocally(const std::string &modelFolder,
         fs::path versionDstPath = fs::path(targetFolder) / version;
         if (!cloneVersionFromGit(version, versionDstPath.string()))
             return false;
+        bool statsHeader = addStatsHeader(versionDstPath.string(), options);
 
-        if (cancelExportFlag.load())
+        if (cancelExportFlag.load() || !stageModel(modelFolder, (versionDstPath / "model").string(), options, cancelExportFlag))
             return false;
-        fs::copy(modelFolder, versionDstPath / "model", fs::copy_options::recursive | fs::copy_options::overwrite_existing);
 
         if ((version == "threads_mutex" || version == "threads_sem") && !cancelExportFlag.load())
             removeStaticFromModelC((versionDstPath / "model").string());
+        // model.c includes ../rp_stats.h once instrumented, so only with the header shipped.
+        if (statsHeader)
+            addInferenceStats((versionDstPath / "model").string());
 
         return !cancelExportFlag.load();
     }
@@ -81,7 +464,8 @@ bool ExportManager::exportSingleVersionToRedPitaya(const std::string &modelFolde
                                                    const std::string &password,
                                                    const std::string &privateKeyPath,
                                                    const std::string &targetDirectory,
-                                                   const std::atomic<bool> &cancelExportFlag)
+                                                   const std::atomic<bool> &cancelExportFlag,
+                                                   const ExportOptions &options)
 {
     try
     {
@@ -93,7 +477,6 @@ bool ExportManager::exportSingleVersionToRedPitaya(const std::string &modelFolde
 
             return false;
 
-        std::string remoteModelDir = remoteVersionDir + "/model";
         std::string tempModelDir = "/tmp/export_temp_model_" + version;
         std::string tempCodeDir = "/tmp/export_code_" + version;
 
@@ -101,27 +484,23 @@ bool ExportManager::exportSingleVersionToRedPitaya(const std::string &modelFolde
         fs::remove_all(tempCodeDir);
         fs::create_directories(tempModelDir);
 
-        if (cancelExportFlag.load())
+        if (cancelExportFlag.load() || !stageModel(modelFolder, tempModelDir, options, cancelExportFlag))
             return false;
-        fs::copy(modelFolder, tempModelDir, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
 
         if ((version == "threads_mutex" || version == "threads_sem") && !cancelExportFlag.load())
             removeStaticFromModelC(tempModelDir);
 
         if (!cloneVersionFromGit(version, tempCodeDir))
             return false;
+        // model.c includes ../rp_stats.h once instrumented, so only with the header shipped.
+        if (addStatsHeader(tempCodeDir, options))
+            addInferenceStats(tempModelDir);
 
         if (cancelExportFlag.load())
             return false;
-        if (!SSHManager::scp_transfer(hostname, password, tempModelDir, remoteModelDir, privateKeyPath))            return false;
-
-        for (const auto &file : fs::directory_iterator(tempCodeDir))
-        {
-            if (cancelExportFlag.load())
-                return false;
-            std::string remoteFilePath = remoteVersionDir + "/" + file.path().filename().string();
-            if (!SSHManager::scp_transfer(hostname, password, file.path().string(), remoteFilePath, privateKeyPath))                return false;
-        }
+        if (!uploadChangedFiles(hostname, password, privateKeyPath, remoteVersionDir, tempModelDir, tempCodeDir,
+                                "/tmp/export_manifest_" + version, options))
+            return false;
 
         return !cancelExportFlag.load();
     }
@@ -1,6 +1,90 @@
 /*FileManager.cpp*/
 
 #include "Utility/FileManager.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    struct CachedHash
+    {
+        uint64_t size = 0;
+        int64_t mtimeNs = 0;
+        uint64_t hash = 0;
+        uint64_t used = 0; // hashCacheClock when last looked up or stored
+    };
+
+    // Staged exports and temporary folders are fingerprinted too, so the cache keeps only the paths used last.
+    const size_t maxHashCacheEntries = 20000;
+
+    std::mutex hashCacheMutex;
+    std::map<std::string, CachedHash> hashCache;
+    uint64_t hashCacheClock = 0;
+    bool hashCacheLoaded = false;
+
+    const uint64_t prime1 = 11400714785074694791ULL;
+    const uint64_t prime2 = 14029467366897019727ULL;
+    const uint64_t prime3 = 1609587929392839161ULL;
+    const uint64_t prime4 = 9650029242287828579ULL;
+    const uint64_t prime5 = 2870177450012600261ULL;
+
+    inline uint64_t rotl(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    inline uint64_t read64(const unsigned char* p)
+    {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t read32(const unsigned char* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t xxhRound(uint64_t acc, uint64_t input)
+    {
+        acc += input * prime2;
+        return rotl(acc, 31) * prime1;
+    }
+
+    inline uint64_t mergeRound(uint64_t acc, uint64_t value)
+    {
+        acc ^= xxhRound(0, value);
+        return acc * prime1 + prime4;
+    }
+
+    bool statFile(const fs::path& path, uint64_t& size, int64_t& mtimeNs)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            return false;
+        size = static_cast<uint64_t>(st.st_size);
+        mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+        return true;
+    }
+}
 
 bool FileManager::isValidQualiaModel(const std::string& folderPath)
 {
@@ -14,3 +98,312 @@ bool FileManager::isValidQualiaModel(const std::string& folderPath)
            std::filesystem::exists(modelCPath) &&
            std::filesystem::exists(includeModelPath);
 }
+
+uint64_t FileManager::hashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    uint64_t h;
+
+    if (size >= 32)
+    {
+        uint64_t v1 = seed + prime1 + prime2, v2 = seed + prime2, v3 = seed, v4 = seed - prime1;
+        const unsigned char* limit = end - 32;
+        do
+        {
+            v1 = xxhRound(v1, read64(p));
+            v2 = xxhRound(v2, read64(p + 8));
+            v3 = xxhRound(v3, read64(p + 16));
+            v4 = xxhRound(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    }
+    else
+        h = seed + prime5;
+
+    h += static_cast<uint64_t>(size);
+
+    for (; p + 8 <= end; p += 8)
+        h = rotl(h ^ xxhRound(0, read64(p)), 27) * prime1 + prime4;
+    if (p + 4 <= end)
+    {
+        h = rotl(h ^ (static_cast<uint64_t>(read32(p)) * prime1), 23) * prime2 + prime3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+        h = rotl(h ^ (*p * prime5), 11) * prime1;
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string FileManager::toHex(uint64_t value)
+{
+    std::ostringstream out;
+    out << std::hex << std::setw(16) << std::setfill('0') << value;
+    return out.str();
+}
+
+std::string FileManager::readText(const fs::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+bool FileManager::writeText(const fs::path& path, const std::string& text)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << text;
+    return static_cast<bool>(out);
+}
+
+std::string FileManager::sanitizedName(const std::string& text)
+{
+    std::string name = text;
+    for (char& c : name)
+        if (!std::isalnum(static_cast<unsigned char>(c)))
+            c = '_';
+    return name;
+}
+
+FileManager::ScratchDirectory::~ScratchDirectory()
+{
+    std::error_code ec;
+    if (!path.empty())
+        fs::remove_all(path, ec);
+}
+
+bool FileManager::ScratchDirectory::create(const std::string& prefix, std::string& error)
+{
+    std::string pattern = (fs::temp_directory_path() / (prefix + "XXXXXX")).string();
+    if (!mkdtemp(pattern.data()))
+    {
+        error = "Cannot create a work directory from " + pattern + ": " + std::strerror(errno);
+        return false;
+    }
+    path = pattern;
+    return true;
+}
+
+std::string FileManager::cacheDirectory()
+{
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    const char* home = std::getenv("HOME");
+    fs::path base = xdg && *xdg ? fs::path(xdg) : fs::path(home && *home ? home : "/tmp") / ".cache";
+    return (base / "redpitaya_toolbox").string();
+}
+
+bool FileManager::readCachedText(const std::string& category, const std::string& key, std::string& text)
+{
+    std::ifstream in(fs::path(cacheDirectory()) / category / key, std::ios::binary);
+    if (!in)
+        return false;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    text = buffer.str();
+    return true;
+}
+
+void FileManager::writeCachedText(const std::string& category, const std::string& key, const std::string& text)
+{
+    std::error_code ec;
+    fs::path directory = fs::path(cacheDirectory()) / category;
+    fs::create_directories(directory, ec);
+    // Unique per writer: two threads may cache the same key at once.
+    static std::atomic<unsigned> writes{0};
+    fs::path temporary = directory / (key + ".tmp" + std::to_string(getpid()) + "." + std::to_string(writes++));
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out << text;
+        if (!out)
+            return;
+    }
+    fs::rename(temporary, directory / key, ec);
+}
+
+uint64_t FileManager::hashFile(const fs::path& path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+    uint64_t hash = 0;
+    if (fstat(fd, &st) == 0)
+    {
+        if (st.st_size == 0)
+            hash = hashBytes(nullptr, 0);
+        else
+        {
+            void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                hash = hashBytes(data, static_cast<size_t>(st.st_size));
+                munmap(data, static_cast<size_t>(st.st_size));
+            }
+        }
+    }
+    close(fd);
+    return hash;
+}
+
+void FileManager::loadHashCache()
+{
+    if (hashCacheLoaded)
+        return;
+    hashCacheLoaded = true;
+
+    std::ifstream in(fs::path(cacheDirectory()) / "file_hashes");
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        CachedHash entry;
+        std::string hash, path;
+        if (!(fields >> entry.size >> entry.mtimeNs >> hash) || !std::getline(fields >> std::ws, path))
+            continue;
+        entry.hash = std::strtoull(hash.c_str(), nullptr, 16);
+        entry.used = ++hashCacheClock;
+        hashCache[path] = entry;
+    }
+}
+
+void FileManager::saveHashCache()
+{
+    std::error_code ec;
+    fs::create_directories(cacheDirectory(), ec);
+
+    // Deleted files go, then the least recently used paths beyond maxHashCacheEntries.
+    std::vector<std::map<std::string, CachedHash>::iterator> entries;
+    for (auto it = hashCache.begin(); it != hashCache.end();)
+        if (fs::exists(it->first, ec))
+            entries.push_back(it++);
+        else
+            it = hashCache.erase(it);
+    std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b)
+              { return a->second.used < b->second.used; });
+    size_t evicted = entries.size() > maxHashCacheEntries ? entries.size() - maxHashCacheEntries : 0;
+    for (size_t i = 0; i < evicted; ++i)
+        hashCache.erase(entries[i]);
+
+    // Written to a temporary name and renamed so a concurrent reader never sees a partial cache. Oldest used
+    // first, which is the order loadHashCache() restores.
+    fs::path target = fs::path(cacheDirectory()) / "file_hashes";
+    fs::path temporary = target.string() + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        for (size_t i = evicted; i < entries.size(); ++i)
+            out << entries[i]->second.size << " " << entries[i]->second.mtimeNs << " " << toHex(entries[i]->second.hash)
+                << " " << entries[i]->first << "\n";
+        if (!out)
+            return;
+    }
+    fs::rename(temporary, target, ec);
+}
+
+uint64_t FileManager::fingerprintFile(const std::string& filePath)
+{
+    fs::path path = fs::absolute(filePath);
+    if (!fs::is_regular_file(path))
+        return 0;
+
+    uint64_t size = 0;
+    int64_t mtimeNs = 0;
+    {
+        std::lock_guard<std::mutex> lock(hashCacheMutex);
+        loadHashCache();
+        auto cached = hashCache.find(path.string());
+        if (statFile(path, size, mtimeNs) && cached != hashCache.end() &&
+            cached->second.size == size && cached->second.mtimeNs == mtimeNs)
+        {
+            cached->second.used = ++hashCacheClock;
+            return cached->second.hash;
+        }
+    }
+
+    uint64_t hash = hashFile(path);
+    std::lock_guard<std::mutex> lock(hashCacheMutex);
+    hashCache[path.string()] = {size, mtimeNs, hash, ++hashCacheClock};
+    saveHashCache();
+    return hash;
+}
+
+uint64_t FileManager::fingerprintFolder(const std::string& folderPath, std::map<std::string, uint64_t>* fileHashes)
+{
+    fs::path root = fs::absolute(folderPath);
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+        if (it->is_regular_file(ec))
+            files.push_back(it->path());
+    std::sort(files.begin(), files.end());
+
+    std::vector<uint64_t> hashes(files.size());
+    std::vector<uint64_t> sizes(files.size());
+    std::vector<int64_t> mtimes(files.size());
+    std::vector<size_t> pending;
+    {
+        std::lock_guard<std::mutex> lock(hashCacheMutex);
+        loadHashCache();
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            auto cached = hashCache.find(files[i].string());
+            if (statFile(files[i], sizes[i], mtimes[i]) && cached != hashCache.end() &&
+                cached->second.size == sizes[i] && cached->second.mtimeNs == mtimes[i])
+            {
+                hashes[i] = cached->second.hash;
+                cached->second.used = ++hashCacheClock;
+            }
+            else
+                pending.push_back(i);
+        }
+    }
+
+    if (!pending.empty())
+    {
+        std::atomic<size_t> next{0};
+        auto worker = [&]()
+        {
+            size_t index;
+            while ((index = next.fetch_add(1)) < pending.size())
+                hashes[pending[index]] = hashFile(files[pending[index]]);
+        };
+
+        size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), pending.size());
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < threadCount; ++i)
+            workers.emplace_back(worker);
+        worker();
+        for (auto& thread : workers)
+            thread.join();
+
+        std::lock_guard<std::mutex> lock(hashCacheMutex);
+        for (size_t index : pending)
+            hashCache[files[index].string()] = {sizes[index], mtimes[index], hashes[index], ++hashCacheClock};
+        saveHashCache();
+    }
+
+    std::string combined;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        std::string relative = fs::relative(files[i], root).generic_string();
+        if (fileHashes)
+            (*fileHashes)[relative] = hashes[i];
+        combined += relative;
+        combined.push_back('\0');
+        combined.append(reinterpret_cast<const char*>(&hashes[i]), sizeof(hashes[i]));
+    }
+    return hashBytes(combined.data(), combined.size());
+}
@@ -0,0 +1,383 @@
+/*LayerProbeInjector.cpp*/
+
+#include "Utility/LayerProbeInjector.hpp"
+#include "Utility/BenchmarkManager.hpp"
+#include "Utility/FileManager.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static constexpr uint32_t probeMagic = 0x504c5052; // "RPLP"
+static constexpr uint32_t probeVersion = 1;
+static constexpr size_t probeNameBytes = 32;
+
+static size_t headerBytes(size_t layers)
+{
+    return (6 * sizeof(uint32_t) + layers * probeNameBytes + 63) / 64 * 64;
+}
+
+static size_t slotBytes(size_t records)
+{
+    return 2 * sizeof(uint32_t) + records * sizeof(uint64_t);
+}
+
+template <typename T>
+static T readValue(const std::string &bytes, size_t offset)
+{
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    return value;
+}
+
+std::string LayerProbeInjector::generateHeader(const std::vector<std::string> &layerNames)
+{
+    std::ostringstream out;
+    out << "/* Per-layer timing probes, generated by the RedPitaya Toolbox.\n"
+        << " * rp_probe_layer(i) stores the time since the previous probe as layer i in the calling thread's ring.\n"
+        << " * Rings live in a shared file (RP_PROBE_PATH or " << remoteRingPath << ") that the toolbox copies back. */\n\n"
+        << "#ifndef _LAYER_PROBES_H_\n"
+        << "#define _LAYER_PROBES_H_\n\n"
+        << "#include <errno.h>\n"
+        << "#include <fcntl.h>\n"
+        << "#include <pthread.h>\n"
+        << "#include <signal.h>\n"
+        << "#include <stdint.h>\n"
+        << "#include <stdlib.h>\n"
+        << "#include <string.h>\n"
+        << "#include <sys/file.h>\n"
+        << "#include <sys/mman.h>\n"
+        << "#include <sys/stat.h>\n"
+        << "#include <time.h>\n"
+        << "#include <unistd.h>\n\n"
+        << "#ifndef CLOCK_MONOTONIC_RAW\n"
+        << "#define CLOCK_MONOTONIC_RAW 4\n"
+        << "#endif\n"
+        << "#ifndef RP_PROBE_DEFAULT_PATH\n"
+        << "#define RP_PROBE_DEFAULT_PATH \"" << remoteRingPath << "\"\n"
+        << "#endif\n\n"
+        << "#define RP_PROBE_MAGIC 0x" << std::hex << probeMagic << std::dec << "u\n"
+        << "#define RP_PROBE_VERSION " << probeVersion << "u\n"
+        << "#define RP_PROBE_LAYERS " << layerNames.size() << "u\n"
+        << "#define RP_PROBE_SLOTS " << ringSlots << "u\n"
+        << "#define RP_PROBE_RING " << ringRecords << "u\n"
+        << "#define RP_PROBE_HEADER_BYTES " << headerBytes(layerNames.size()) << "u\n"
+        << "#define RP_PROBE_SLOT_BYTES " << slotBytes(ringRecords) << "u\n\n"
+        << "static const char rp_probe_names[RP_PROBE_LAYERS][" << probeNameBytes << "] = {\n";
+    for (const auto &name : layerNames)
+        out << "    \"" << name.substr(0, probeNameBytes - 1) << "\",\n";
+    out << "};\n\n";
+
+    out << R"(struct rp_probe_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t layers;
+    uint32_t slots;
+    uint32_t ring;
+    uint32_t next_slot;
+};
+
+/* Single writer per slot: the record is stored before head is published, so a reader never sees a
+ * half-written entry behind head. Records are (layer << 32) | nanoseconds. */
+struct rp_probe_slot
+{
+    uint32_t pid;
+    uint32_t head;
+    uint64_t records[RP_PROBE_RING];
+};
+
+static unsigned char *rp_probe_base;
+static __thread struct rp_probe_slot *rp_probe_self;
+static __thread int rp_probe_claimed;
+static __thread uint64_t rp_probe_last;
+
+static void rp_probe_forget(void)
+{
+    rp_probe_self = 0;
+    rp_probe_claimed = 0;
+}
+
+/* The ring can be joined when it has this build's layout and one of the processes that claimed a slot is
+ * still running (the other processes of a process_* version); otherwise it is left over from an earlier run. */
+static int rp_probe_joinable(const unsigned char *base)
+{
+    const struct rp_probe_header *header = (const struct rp_probe_header *)base;
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != RP_PROBE_MAGIC || header->version != RP_PROBE_VERSION ||
+        header->layers != RP_PROBE_LAYERS || header->slots != RP_PROBE_SLOTS || header->ring != RP_PROBE_RING ||
+        memcmp(base + sizeof(*header), rp_probe_names, sizeof(rp_probe_names)) != 0)
+        return 0;
+    uint32_t claimed = header->next_slot < RP_PROBE_SLOTS ? header->next_slot : RP_PROBE_SLOTS;
+    for (uint32_t i = 0; i < claimed; i++)
+    {
+        const struct rp_probe_slot *slot = (const struct rp_probe_slot *)(base + RP_PROBE_HEADER_BYTES + (size_t)i * RP_PROBE_SLOT_BYTES);
+        /* pid 0: claimed this instant, by a process that has not stored its pid yet. */
+        if (!slot->pid || kill((pid_t)slot->pid, 0) == 0 || errno == EPERM)
+            return 1;
+    }
+    return 0;
+}
+
+/* No O_TRUNC: other processes of the same run may have the ring mapped, and cutting the file under them
+ * raises SIGBUS. The lock orders processes starting together, so exactly one of them initializes it. */
+__attribute__((constructor)) static void rp_probe_open(void)
+{
+    const char *path = getenv("RP_PROBE_PATH");
+    size_t bytes = RP_PROBE_HEADER_BYTES + (size_t)RP_PROBE_SLOTS * RP_PROBE_SLOT_BYTES;
+    int fd = open(path && *path ? path : RP_PROBE_DEFAULT_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (flock(fd, LOCK_EX) == 0 && fstat(fd, &st) == 0 && ((size_t)st.st_size == bytes || ftruncate(fd, (off_t)bytes) == 0))
+    {
+        void *mapping = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            struct rp_probe_header *header = (struct rp_probe_header *)mapping;
+            if (!rp_probe_joinable((const unsigned char *)mapping))
+            {
+                __atomic_store_n(&header->magic, 0, __ATOMIC_RELAXED);
+                memset((unsigned char *)mapping + sizeof(header->magic), 0, bytes - sizeof(header->magic));
+                header->version = RP_PROBE_VERSION;
+                header->layers = RP_PROBE_LAYERS;
+                header->slots = RP_PROBE_SLOTS;
+                header->ring = RP_PROBE_RING;
+                memcpy((unsigned char *)mapping + sizeof(*header), rp_probe_names, sizeof(rp_probe_names));
+                __atomic_store_n(&header->magic, RP_PROBE_MAGIC, __ATOMIC_RELEASE);
+            }
+            rp_probe_base = (unsigned char *)mapping;
+        }
+    }
+    /* Explicitly: the mapping keeps the file open, and with it the lock, past close(). */
+    flock(fd, LOCK_UN);
+    close(fd);
+    /* A forked worker must claim its own slot instead of sharing its parent's. */
+    pthread_atfork(0, 0, rp_probe_forget);
+}
+
+static inline uint64_t rp_probe_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline void rp_probe_begin(void)
+{
+    if (!rp_probe_claimed && rp_probe_base)
+    {
+        struct rp_probe_header *header = (struct rp_probe_header *)rp_probe_base;
+        uint32_t slot = __atomic_fetch_add(&header->next_slot, 1, __ATOMIC_RELAXED);
+        rp_probe_claimed = 1;
+        if (slot < RP_PROBE_SLOTS)
+        {
+            rp_probe_self = (struct rp_probe_slot *)(rp_probe_base + RP_PROBE_HEADER_BYTES + (size_t)slot * RP_PROBE_SLOT_BYTES);
+            rp_probe_self->pid = (uint32_t)getpid();
+        }
+    }
+    rp_probe_last = rp_probe_now();
+}
+
+static inline void rp_probe_layer(uint32_t layer)
+{
+    struct rp_probe_slot *slot = rp_probe_self;
+    if (!slot)
+        return;
+    uint64_t now = rp_probe_now();
+    uint64_t ns = now - rp_probe_last;
+    rp_probe_last = now;
+    if (ns > 0xffffffffull)
+        ns = 0xffffffffull;
+    uint32_t head = slot->head;
+    slot->records[head & (RP_PROBE_RING - 1)] = ((uint64_t)layer << 32) | ns;
+    __atomic_store_n(&slot->head, head + 1, __ATOMIC_RELEASE);
+}
+
+#endif
+)";
+    return out.str();
+}
+
+bool LayerProbeInjector::apply(const std::string &stagedModelFolder, std::string &report)
+{
+    std::string error;
+    auto fail = [&](const std::string &message)
+    {
+        report = "Layer probes skipped: " + message;
+        return false;
+    };
+
+    ModelProfile profile;
+    if (!ModelAnalyzer::analyze(stagedModelFolder, profile, error))
+        return fail(error);
+    if (profile.layers.empty())
+        return fail("no layer calls were found in " + profile.entryFunction + "().");
+    for (const auto &layer : profile.layers)
+        if (layer.call.file != profile.entryBody.file)
+            return fail("the layer calls are not in the entry function's file.");
+
+    std::string text = FileManager::readText(profile.entryBody.file);
+    size_t includeAt = ModelAnalyzer::entryDefinitionStart(text, profile);
+    if (includeAt == std::string::npos)
+        return fail("could not locate the definition of " + profile.entryFunction + "().");
+
+    std::vector<std::string> names;
+    std::vector<std::pair<size_t, std::string>> edits;
+    edits.push_back({includeAt, std::string("#include \"") + headerName + "\"\n\n"});
+    edits.push_back({profile.layers.front().call.begin, "rp_probe_begin();\n  "});
+    for (size_t i = 0; i < profile.layers.size(); ++i)
+    {
+        names.push_back(profile.layers[i].function);
+        edits.push_back({profile.layers[i].call.end, " rp_probe_layer(" + std::to_string(i) + ");"});
+    }
+    std::stable_sort(edits.begin(), edits.end(), [](const auto &a, const auto &b)
+                     { return a.first > b.first; });
+    for (const auto &edit : edits)
+        text.insert(edit.first, edit.second);
+
+    std::string workName = FileManager::sanitizedName(stagedModelFolder);
+    FileManager::ScratchDirectory scratch;
+    if (!scratch.create("rp_probes" + workName + "_", error))
+        return fail(error);
+    fs::path workDir = scratch.path;
+    fs::path candidate = workDir / "model";
+    fs::path relative = fs::relative(profile.entryBody.file, stagedModelFolder);
+
+    try
+    {
+        fs::copy(stagedModelFolder, candidate, fs::copy_options::recursive);
+        if (!FileManager::writeText(candidate / relative, text) || !FileManager::writeText((candidate / relative).parent_path() / headerName, generateHeader(names)))
+            return fail("cannot write the instrumented sources.");
+
+        fs::path ringFile = workDir / "probes.ring";
+        std::string probeFlags = "-O2 -DRP_PROBE_DEFAULT_PATH='\"" + ringFile.string() + "\"'";
+        std::vector<std::string> reference, probed;
+        if (!BenchmarkManager::collectOutputs(profile, stagedModelFolder, "-O2", (workDir / "plain").string(), 64, reference, error) ||
+            !BenchmarkManager::collectOutputs(profile, candidate.string(), probeFlags, (workDir / "probed").string(), 64, probed, error))
+            return fail(error);
+        if (reference != probed)
+            return fail("outputs changed with the probes in place.");
+
+        std::vector<LayerTiming> timings;
+        size_t threads = 0;
+        if (!summarize(FileManager::readText(ringFile), timings, threads, error))
+            return fail("the host run did not record timings (" + error + ").");
+
+        fs::copy_file(candidate / relative, fs::path(stagedModelFolder) / relative, fs::copy_options::overwrite_existing);
+        fs::copy_file((candidate / relative).parent_path() / headerName, (fs::path(stagedModelFolder) / relative).parent_path() / headerName,
+                      fs::copy_options::overwrite_existing);
+
+        report = "Layer probes: " + std::to_string(names.size()) + " layer(s) instrumented; the board run writes " + remoteRingPath +
+                 ". Host check:\n" + formatTimings(timings, threads);
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        return fail(e.what());
+    }
+}
+
+bool LayerProbeInjector::summarize(const std::string &ring, std::vector<LayerTiming> &timings, size_t &threads, std::string &error)
+{
+    timings.clear();
+    threads = 0;
+    if (ring.size() < 6 * sizeof(uint32_t) || readValue<uint32_t>(ring, 0) != probeMagic)
+    {
+        error = "not a layer probe ring file";
+        return false;
+    }
+    if (readValue<uint32_t>(ring, 4) != probeVersion)
+    {
+        error = "unsupported probe ring version " + std::to_string(readValue<uint32_t>(ring, 4));
+        return false;
+    }
+
+    uint32_t layers = readValue<uint32_t>(ring, 8);
+    uint32_t slots = readValue<uint32_t>(ring, 12);
+    uint32_t records = readValue<uint32_t>(ring, 16);
+    uint32_t claimed = std::min(readValue<uint32_t>(ring, 20), slots);
+    if (records == 0 || (records & (records - 1)) != 0 || ring.size() < headerBytes(layers) + slots * slotBytes(records))
+    {
+        error = "truncated probe ring file";
+        return false;
+    }
+
+    std::vector<std::vector<double>> samples(layers);
+    for (uint32_t layer = 0; layer < layers; ++layer)
+    {
+        const char *name = ring.data() + 6 * sizeof(uint32_t) + layer * probeNameBytes;
+        LayerTiming timing;
+        timing.name.assign(name, strnlen(name, probeNameBytes));
+        timings.push_back(timing);
+    }
+
+    for (uint32_t slot = 0; slot < claimed; ++slot)
+    {
+        size_t base = headerBytes(layers) + slot * slotBytes(records);
+        uint32_t head = readValue<uint32_t>(ring, base + 4);
+        if (head == 0)
+            continue;
+        ++threads;
+        uint32_t count = std::min(head, records);
+        for (uint32_t i = head - count; i != head; ++i)
+        {
+            uint64_t record = readValue<uint64_t>(ring, base + 8 + (i & (records - 1)) * sizeof(uint64_t));
+            uint32_t layer = static_cast<uint32_t>(record >> 32);
+            if (layer < layers)
+                samples[layer].push_back(static_cast<double>(record & 0xffffffffu) / 1000.0);
+        }
+    }
+
+    double total = 0.0;
+    for (uint32_t layer = 0; layer < layers; ++layer)
+    {
+        auto &values = samples[layer];
+        auto &timing = timings[layer];
+        timing.samples = values.size();
+        if (values.empty())
+            continue;
+        std::sort(values.begin(), values.end());
+        double sum = 0.0;
+        for (double value : values)
+            sum += value;
+        timing.meanUs = sum / values.size();
+        timing.p50Us = values[values.size() / 2];
+        timing.p99Us = values[std::min(values.size() - 1, values.size() * 99 / 100)];
+        timing.maxUs = values.back();
+        total += timing.meanUs;
+    }
+    for (auto &timing : timings)
+        timing.share = total > 0.0 ? timing.meanUs / total : 0.0;
+
+    if (threads == 0)
+    {
+        error = "no inference has been recorded yet";
+        return false;
+    }
+    return true;
+}
+
+std::string LayerProbeInjector::formatTimings(const std::vector<LayerTiming> &timings, size_t threads)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    out << std::left << std::setw(4) << "#" << std::setw(24) << "Layer" << std::right << std::setw(9) << "Samples"
+        << std::setw(11) << "Mean us" << std::setw(11) << "p50 us" << std::setw(11) << "p99 us" << std::setw(11) << "Max us"
+        << std::setw(8) << "Share" << "\n";
+
+    double total = 0.0;
+    for (size_t i = 0; i < timings.size(); ++i)
+    {
+        const auto &timing = timings[i];
+        total += timing.meanUs;
+        out << std::left << std::setw(4) << i + 1 << std::setw(24) << timing.name << std::right << std::setw(9) << timing.samples
+            << std::setw(11) << timing.meanUs << std::setw(11) << timing.p50Us << std::setw(11) << timing.p99Us
+            << std::setw(11) << timing.maxUs << std::setw(7) << timing.share * 100.0 << "%\n";
+    }
+    out << "Total mean " << total << " us per inference, " << threads << " recording thread(s).";
+    return out.str();
+}
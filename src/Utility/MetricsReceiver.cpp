@@ -0,0 +1,383 @@
+/*MetricsReceiver.cpp*/
+
+#include "Utility/MetricsReceiver.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const size_t receiveBytes = 65536;
+static const int maxEvents = 64;
+static const size_t maxDisks = 16;
+
+static uint64_t steadyNs()
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+MetricsReceiver::~MetricsReceiver()
+{
+    stop();
+}
+
+bool MetricsReceiver::start(uint16_t port, std::string &error)
+{
+    stop();
+
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listenFd < 0 || epollFd < 0 || stopFd < 0)
+    {
+        error = std::string("socket: ") + std::strerror(errno);
+        stop();
+        return false;
+    }
+
+    int one = 1;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(listenFd, SOMAXCONN) != 0)
+    {
+        error = "cannot listen on port " + std::to_string(port) + ": " + std::strerror(errno);
+        stop();
+        return false;
+    }
+
+    // The listening socket is registered with a null pointer, the stop eventfd with its own address.
+    epoll_event listenEvent{};
+    listenEvent.events = EPOLLIN;
+    listenEvent.data.ptr = nullptr;
+    epoll_event stopEvent{};
+    stopEvent.events = EPOLLIN;
+    stopEvent.data.ptr = &stopFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &listenEvent) != 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &stopEvent) != 0)
+    {
+        error = std::string("epoll: ") + std::strerror(errno);
+        stop();
+        return false;
+    }
+
+    // Kept across restarts, like the boards, so their points stay on one time axis.
+    if (startNs == 0)
+        startNs = steadyNs();
+    buffer.resize(receiveBytes);
+    active = true;
+    worker = std::thread(&MetricsReceiver::run, this);
+    return true;
+}
+
+void MetricsReceiver::stop()
+{
+    if (worker.joinable())
+    {
+        uint64_t one = 1;
+        if (write(stopFd, &one, sizeof(one)) < 0)
+            active = false;
+        worker.join();
+    }
+    active = false;
+    for (int *fd : {&listenFd, &epollFd, &stopFd})
+    {
+        if (*fd >= 0)
+            close(*fd);
+        *fd = -1;
+    }
+}
+
+const char *MetricsReceiver::metricLabel(Metric metric)
+{
+    static const char *labels[metricCount] = {"CPU", "CPU0", "CPU1", "RAM", "Temp", "Freq0", "Freq1",
+                                              "Net RX", "Net TX", "Disk read", "Disk write"};
+    return metric < Metric::Count ? labels[size_t(metric)] : "?";
+}
+
+double MetricsReceiver::secondsSinceStart() const
+{
+    return double(steadyNs() - startNs) / 1e9;
+}
+
+void MetricsReceiver::run()
+{
+    epoll_event events[maxEvents];
+    bool stopping = false;
+    while (active && !stopping)
+    {
+        int n = epoll_wait(epollFd, events, maxEvents, -1);
+        if (n < 0 && errno != EINTR)
+            break;
+        for (int i = 0; i < n; ++i)
+        {
+            void *ptr = events[i].data.ptr;
+            if (ptr == &stopFd)
+                stopping = true;
+            else if (!ptr)
+                accept();
+            else if (static_cast<Connection *>(ptr)->fd >= 0)
+                receive(static_cast<Connection *>(ptr));
+        }
+        // Closed connections are freed only here, as later events of the same batch may still name them.
+        connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                         [](const std::unique_ptr<Connection> &c)
+                                         { return c->fd < 0; }),
+                          connections.end());
+    }
+    for (auto &connection : connections)
+        closeConnection(connection.get());
+    connections.clear();
+    active = false;
+}
+
+void MetricsReceiver::accept()
+{
+    for (;;)
+    {
+        sockaddr_in addr{};
+        socklen_t addrLength = sizeof(addr);
+        int fd = ::accept4(listenFd, reinterpret_cast<sockaddr *>(&addr), &addrLength, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        auto connection = std::make_unique<Connection>();
+        char ip[INET_ADDRSTRLEN] = "?";
+        inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+        connection->fd = fd;
+        connection->address = ip;
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.ptr = connection.get();
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            close(fd);
+            continue;
+        }
+        connections.push_back(std::move(connection));
+    }
+}
+
+void MetricsReceiver::closeConnection(Connection *connection)
+{
+    if (connection->fd < 0)
+        return;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, nullptr);
+    close(connection->fd);
+    connection->fd = -1;
+    if (connection->board && connection->board->connection == connection)
+    {
+        connection->board->connection = nullptr;
+        connection->board->connected = false;
+    }
+}
+
+MetricsReceiver::Board *MetricsReceiver::attach(Connection *connection, const TelemetryFrame &frame)
+{
+    std::string name = connection->address;
+    if (frame.type == TP_FRAME_HELLO && !frame.samples.empty())
+        for (const auto &field : frame.samples[0].fields)
+            if (field.id == TP_BOARD_NAME && !field.text.empty())
+                name = field.text;
+
+    Board *board = nullptr;
+    for (size_t i = 0; i < boardTotal && !board; ++i)
+        if (boards[i]->name == name)
+            board = boards[i].get();
+    if (!board)
+    {
+        if (boardTotal == maxBoards)
+            return nullptr;
+        boards[boardTotal] = std::make_unique<Board>();
+        boards[boardTotal]->name = name;
+        board = boards[boardTotal].get();
+        publishedBoards.store(++boardTotal, std::memory_order_release);
+    }
+
+    // A board streams over one connection at a time: a newer one means the older is dead (e.g. it rebooted).
+    if (board->connection)
+        closeConnection(board->connection);
+    board->connection = connection;
+    board->connected = true;
+    return board;
+}
+
+void MetricsReceiver::receive(Connection *connection)
+{
+    ssize_t got = recv(connection->fd, buffer.data(), buffer.size(), 0);
+    if (got <= 0)
+    {
+        if (got == 0 || (errno != EAGAIN && errno != EINTR))
+            closeConnection(connection);
+        return;
+    }
+
+    frames.clear();
+    connection->decoder.feed(buffer.data(), size_t(got), frames);
+    bool binary = connection->decoder.format() == TelemetryDecoder::Format::Binary;
+    for (const auto &frame : frames)
+    {
+        if (!connection->board && !(connection->board = attach(connection, frame)))
+        {
+            std::cerr << "[MetricsReceiver] More than " << maxBoards << " boards; refusing " << connection->address << std::endl;
+            closeConnection(connection);
+            return;
+        }
+        Board &board = *connection->board;
+        board.sequences.track(frame);
+
+        // The frame header carries the board clock at sending time: anchored on every HELLO (the board
+        // may have rebooted), the board's points land on our time axis whatever backlog it replays.
+        if (frame.timestampNs != 0 && (frame.type == TP_FRAME_HELLO || !board.originKnown))
+        {
+            board.origin = double(frame.timestampNs) / 1e9 - secondsSinceStart();
+            board.originKnown = true;
+        }
+        if (frame.type == TP_FRAME_HELLO && !frame.samples.empty() && frame.samples[0].has(TP_INTERVAL_US))
+            board.interval = uint32_t(frame.samples[0].get(TP_INTERVAL_US));
+        else if (frame.type == TP_FRAME_SAMPLES)
+            for (const auto &sample : frame.samples)
+                publish(board, sample, binary);
+    }
+    if (connection->board)
+        connection->board->lost = connection->board->sequences.lostSamples();
+}
+
+void MetricsReceiver::publish(Board &board, const TelemetrySample &sample, bool binary)
+{
+    // Board timestamps when the frames carry them (text lines do not), else one interval per sample.
+    if (sample.timestampNs != 0 && board.originKnown)
+        board.elapsed = double(sample.timestampNs) / 1e9 - board.origin;
+    else if (!board.originKnown)
+    {
+        board.elapsed = secondsSinceStart();
+        board.originKnown = true;
+    }
+    else
+        board.elapsed += board.interval.load() != 0 ? board.interval.load() / 1e6 : 0.5;
+
+    // One pass over the fields, the first of each kind counting. Traffic is in MB/s, and a partition
+    // is left out when its disk is listed too.
+    std::array<double, metricCount> values{};
+    std::array<bool, metricCount> present{};
+    auto set = [&](Metric metric, double value)
+    {
+        if (present[size_t(metric)])
+            return;
+        values[size_t(metric)] = value;
+        present[size_t(metric)] = true;
+    };
+    struct Disk
+    {
+        uint16_t instance;
+        const std::string *name;
+        double readBytes, writeBytes;
+    };
+    std::array<Disk, maxDisks> disks;
+    size_t diskCount = 0;
+    auto disk = [&](uint16_t instance) -> Disk *
+    {
+        for (size_t i = 0; i < diskCount; ++i)
+            if (disks[i].instance == instance)
+                return &disks[i];
+        if (diskCount == maxDisks)
+            return nullptr;
+        disks[diskCount] = {instance, nullptr, 0.0, 0.0};
+        return &disks[diskCount++];
+    };
+    double netRx = 0.0, netTx = 0.0;
+
+    for (const auto &field : sample.fields)
+    {
+        Disk *d = nullptr;
+        switch (field.id)
+        {
+        case TP_CPU_PERCENT:
+            set(Metric::Cpu, field.value);
+            break;
+        case TP_CORE_PERCENT:
+            if (field.instance < 2)
+                set(field.instance == 0 ? Metric::Cpu0 : Metric::Cpu1, field.value);
+            break;
+        case TP_RAM_PERCENT:
+            set(Metric::Ram, field.value);
+            break;
+        case TP_TEMP_C:
+            set(Metric::Temp, field.value);
+            break;
+        case TP_FREQ_MHZ:
+            if (field.instance < 2)
+                set(field.instance == 0 ? Metric::Freq0 : Metric::Freq1, field.value);
+            break;
+        case TP_MISSED_DEADLINES:
+            board.missed = uint32_t(field.value);
+            break;
+        case TP_NET_RX_BYTES_PER_S:
+            netRx += field.value;
+            break;
+        case TP_NET_TX_BYTES_PER_S:
+            netTx += field.value;
+            break;
+        case TP_DISK_NAME:
+            if ((d = disk(field.instance)))
+                d->name = &field.text;
+            break;
+        case TP_DISK_READ_BYTES_PER_S:
+            if ((d = disk(field.instance)))
+                d->readBytes += field.value;
+            break;
+        case TP_DISK_WRITE_BYTES_PER_S:
+            if ((d = disk(field.instance)))
+                d->writeBytes += field.value;
+            break;
+        }
+    }
+
+    if (binary)
+    {
+        double diskRead = 0.0, diskWrite = 0.0;
+        for (size_t i = 0; i < diskCount; ++i)
+        {
+            const std::string *name = disks[i].name;
+            bool partition = false;
+            for (size_t j = 0; j < diskCount && name && !partition; ++j)
+                partition = disks[j].name && *disks[j].name != *name && name->compare(0, disks[j].name->size(), *disks[j].name) == 0;
+            if (partition)
+                continue;
+            diskRead += disks[i].readBytes;
+            diskWrite += disks[i].writeBytes;
+        }
+        set(Metric::NetRx, netRx / 1e6);
+        set(Metric::NetTx, netTx / 1e6);
+        set(Metric::DiskRead, diskRead / 1e6);
+        set(Metric::DiskWrite, diskWrite / 1e6);
+    }
+
+    for (size_t m = 0; m < metricCount; ++m)
+        if (present[m] && !board.rings[m].push({board.elapsed, float(values[m])}))
+            board.overrun++;
+
+    // The details view shows the latest of these, so a few per second do; a board clock that went back
+    // (reboot) starts the period over.
+    if (board.detailsSent && std::fabs(board.elapsed - board.detailsAt) < detailPeriod)
+        return;
+    TelemetrySample details;
+    details.timestampNs = sample.timestampNs;
+    details.sequence = sample.sequence;
+    for (const auto &field : sample.fields)
+        if (TelemetryDecoder::isDetailField(field.id))
+            details.fields.push_back(field);
+    if (!details.fields.empty() && board.details.push(details))
+    {
+        board.detailsAt = board.elapsed;
+        board.detailsSent = true;
+    }
+}
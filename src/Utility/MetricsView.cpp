@@ -0,0 +1,342 @@
+/*MetricsView.cpp*/
+
+#include "Utility/MetricsView.hpp"
+#include <glibmm/main.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+static const int marginLeft = 60;
+static const int marginRight = 12;
+static const int marginTop = 20;
+static const int marginBottom = 18;
+static const double fontSize = 11.0;
+
+MetricsView::MetricsView(MetricsReceiver &receiver) : receiver(receiver)
+{
+    panels = {{"CPU (%)", {{Metric::Cpu, 0.12, 0.47, 0.71}, {Metric::Cpu0, 1.0, 0.5, 0.05}, {Metric::Cpu1, 0.17, 0.63, 0.17}}, 110.0, false, 0.0},
+              {"RAM (%)", {{Metric::Ram, 0.0, 0.5, 0.0}}, 110.0, false, 0.0},
+              {"Temp (°C)", {{Metric::Temp, 0.84, 0.15, 0.16}}, 0.0, false, 1.0},
+              {"CPU Freq (MHz)", {{Metric::Freq0, 0.12, 0.47, 0.71}, {Metric::Freq1, 1.0, 0.5, 0.05}}, 0.0, false, 10.0},
+              {"I/O (MB/s)", {{Metric::NetRx, 0.12, 0.47, 0.71}, {Metric::NetTx, 1.0, 0.5, 0.05}, {Metric::DiskRead, 0.17, 0.63, 0.17}, {Metric::DiskWrite, 0.84, 0.15, 0.16}}, 0.0, true, 0.0}};
+    set_size_request(600, 100 * int(panels.size()));
+    frameTimer = Glib::signal_timeout().connect(sigc::mem_fun(*this, &MetricsView::onFrame), frameMs);
+}
+
+MetricsView::~MetricsView()
+{
+    frameTimer.disconnect();
+}
+
+void MetricsView::reset()
+{
+    for (auto &board : history)
+        for (auto &points : board)
+            points.clear();
+    timeOrigin = latestTime;
+    queue_draw();
+}
+
+void MetricsView::setBoard(int board)
+{
+    if (board == selected)
+        return;
+    selected = board;
+    queue_draw();
+}
+
+bool MetricsView::onFrame()
+{
+    // Every board is drained, shown or not, so its rings never overrun and switching to it shows its history.
+    history.resize(receiver.boardCount());
+    std::array<bool, MetricsReceiver::metricCount> updated{};
+    for (size_t b = 0; b < history.size(); ++b)
+        for (size_t m = 0; m < MetricsReceiver::metricCount; ++m)
+        {
+            auto &points = history[b][m];
+            MetricPoint point;
+            bool got = false;
+            while (receiver.pop(b, Metric(m), point))
+            {
+                points.push_back(point);
+                latestTime = std::max(latestTime, point.time);
+                got = true;
+            }
+            while (points.size() > historyPoints)
+                points.pop_front();
+            updated[m] = updated[m] || (got && shown(b));
+        }
+
+    for (size_t i = 0; i < panels.size(); ++i)
+        for (const auto &series : panels[i].series)
+            if (updated[size_t(series.metric)])
+            {
+                Gdk::Rectangle area = panelArea(i);
+                queue_draw_area(area.get_x(), area.get_y(), area.get_width(), area.get_height());
+                break;
+            }
+    return true;
+}
+
+Gdk::Rectangle MetricsView::panelArea(size_t index) const
+{
+    int height = get_allocated_height() / int(panels.size());
+    return Gdk::Rectangle(0, int(index) * height, get_allocated_width(), height);
+}
+
+bool MetricsView::on_draw(const Cairo::RefPtr<Cairo::Context> &cr)
+{
+    double x1, y1, x2, y2;
+    cr->get_clip_extents(x1, y1, x2, y2);
+    cr->set_source_rgb(1.0, 1.0, 1.0);
+    cr->paint();
+    cr->select_font_face("Sans", Cairo::FONT_SLANT_NORMAL, Cairo::FONT_WEIGHT_NORMAL);
+    cr->set_font_size(fontSize);
+
+    // Only the panels the invalidated region touches.
+    for (size_t i = 0; i < panels.size(); ++i)
+    {
+        Gdk::Rectangle area = panelArea(i);
+        if (area.get_y() < y2 && area.get_y() + area.get_height() > y1)
+            drawPanel(cr, i, area);
+    }
+    return true;
+}
+
+// Overlaid boards get a colour each and the series of a panel a dash pattern each.
+static void boardColour(size_t board, double &red, double &green, double &blue)
+{
+    static const double palette[][3] = {{0.12, 0.47, 0.71}, {1.0, 0.5, 0.05}, {0.17, 0.63, 0.17}, {0.84, 0.15, 0.16},
+                                        {0.58, 0.4, 0.74}, {0.55, 0.34, 0.29}, {0.89, 0.47, 0.76}, {0.5, 0.5, 0.5},
+                                        {0.74, 0.74, 0.13}, {0.09, 0.75, 0.81}};
+    const double *colour = palette[board % (sizeof(palette) / sizeof(palette[0]))];
+    red = colour[0];
+    green = colour[1];
+    blue = colour[2];
+}
+
+static std::vector<double> seriesDash(size_t series)
+{
+    switch (series)
+    {
+    case 0:
+        return {};
+    case 1:
+        return {6.0, 3.0};
+    case 2:
+        return {2.0, 2.0};
+    default:
+        return {8.0, 3.0, 2.0, 3.0};
+    }
+}
+
+void MetricsView::drawPanel(const Cairo::RefPtr<Cairo::Context> &cr, size_t index, const Gdk::Rectangle &area) const
+{
+    const Panel &panel = panels[index];
+    double left = area.get_x() + marginLeft;
+    double right = area.get_x() + area.get_width() - marginRight;
+    double top = area.get_y() + marginTop;
+    double bottom = area.get_y() + area.get_height() - marginBottom;
+    if (right - left < 20 || bottom - top < 20)
+        return;
+    bool overlay = selected == allBoards && history.size() > 1;
+
+    double tMin = std::numeric_limits<double>::max(), tMax = std::numeric_limits<double>::lowest();
+    double vMin = std::numeric_limits<double>::max(), vMax = std::numeric_limits<double>::lowest();
+    for (size_t b = 0; b < history.size(); ++b)
+        for (const auto &series : panel.series)
+        {
+            const auto &points = history[b][size_t(series.metric)];
+            if (!shown(b) || points.empty())
+                continue;
+            tMin = std::min(tMin, points.front().time);
+            tMax = std::max(tMax, points.back().time);
+            for (const auto &point : points)
+            {
+                vMin = std::min(vMin, double(point.value));
+                vMax = std::max(vMax, double(point.value));
+            }
+        }
+    if (tMin > tMax)
+    {
+        tMin = tMax = timeOrigin;
+        vMin = vMax = 0.0;
+    }
+    if (tMax - tMin < 1e-6)
+        tMax = tMin + 1.0;
+    if (panel.fixedMax > 0.0)
+    {
+        vMin = 0.0;
+        vMax = panel.fixedMax;
+    }
+    else if (panel.fromZero)
+    {
+        vMin = 0.0;
+        vMax = std::max(1.0, vMax * 1.1);
+    }
+    else
+    {
+        double pad = std::max(panel.minPad, 0.05 * (vMax - vMin));
+        vMin -= pad;
+        vMax += pad;
+    }
+
+    // Grid and axis labels.
+    char text[32];
+    Cairo::TextExtents extents;
+    cr->set_line_width(1.0);
+    for (int k = 0; k <= 4; ++k)
+    {
+        double y = bottom - k * (bottom - top) / 4.0;
+        cr->set_source_rgb(0.88, 0.88, 0.88);
+        cr->move_to(left, int(y) + 0.5);
+        cr->line_to(right, int(y) + 0.5);
+        cr->stroke();
+        std::snprintf(text, sizeof(text), "%.1f", vMin + k * (vMax - vMin) / 4.0);
+        cr->get_text_extents(text, extents);
+        cr->set_source_rgb(0.3, 0.3, 0.3);
+        cr->move_to(left - 6 - extents.x_advance, y + fontSize / 3);
+        cr->show_text(text);
+    }
+    for (int k = 0; k <= 2; ++k)
+    {
+        std::snprintf(text, sizeof(text), "%.1f s", tMin - timeOrigin + k * (tMax - tMin) / 2.0);
+        cr->get_text_extents(text, extents);
+        double x = left + k * (right - left) / 2.0 - extents.x_advance * k / 2.0;
+        cr->move_to(x, bottom + fontSize + 3);
+        cr->show_text(text);
+    }
+    cr->set_source_rgb(0.6, 0.6, 0.6);
+    cr->rectangle(int(left) + 0.5, int(top) + 0.5, int(right - left), int(bottom - top));
+    cr->stroke();
+
+    // Title, then one legend entry per series in its colour, or in its dash pattern when boards are
+    // overlaid, the first panel then also naming the boards in theirs, as many as fit.
+    cr->set_source_rgb(0.1, 0.1, 0.1);
+    cr->move_to(left, top - 6);
+    cr->show_text(panel.title);
+    cr->get_text_extents(panel.title, extents);
+    double x = left + extents.x_advance + 16;
+    auto legend = [&](const char *label)
+    {
+        cr->move_to(x + 22, top - 6);
+        cr->show_text(label);
+        cr->get_text_extents(label, extents);
+        x += 22 + extents.x_advance + 12;
+    };
+    for (size_t s = 0; s < panel.series.size(); ++s)
+    {
+        const Series &series = panel.series[s];
+        double y = top - 6 - fontSize * 0.35;
+        if (overlay)
+        {
+            cr->set_source_rgb(0.3, 0.3, 0.3);
+            cr->set_dash(seriesDash(s), 0.0);
+            cr->set_line_width(1.5);
+            cr->move_to(x, y);
+            cr->line_to(x + 18, y);
+            cr->stroke();
+            cr->unset_dash();
+        }
+        else
+        {
+            cr->set_source_rgb(series.red, series.green, series.blue);
+            cr->rectangle(x, y - 1.5, 18, 3);
+            cr->fill();
+        }
+        cr->set_source_rgb(0.1, 0.1, 0.1);
+        legend(MetricsReceiver::metricLabel(series.metric));
+    }
+    for (size_t b = 0; overlay && index == 0 && b < history.size(); ++b)
+    {
+        const std::string &name = receiver.boardName(b);
+        cr->get_text_extents(name, extents);
+        if (x + 22 + extents.x_advance > right)
+            break;
+        double red, green, blue;
+        boardColour(b, red, green, blue);
+        cr->set_source_rgb(red, green, blue);
+        cr->rectangle(x, top - 6 - fontSize * 0.35 - 1.5, 18, 3);
+        cr->fill();
+        legend(name.c_str());
+    }
+
+    // The series, clipped to the plot.
+    cr->save();
+    cr->rectangle(left, top, right - left, bottom - top);
+    cr->clip();
+    cr->set_line_width(overlay ? 1.0 : 1.5);
+    cr->set_line_join(Cairo::LINE_JOIN_ROUND);
+    for (size_t b = 0; b < history.size(); ++b)
+    {
+        if (!shown(b))
+            continue;
+        for (size_t s = 0; s < panel.series.size(); ++s)
+        {
+            const Series &series = panel.series[s];
+            const auto &points = history[b][size_t(series.metric)];
+            if (points.empty())
+                continue;
+            drawSeries(cr, points, left, right, top, bottom, tMin, tMax, vMin, vMax);
+            if (overlay)
+            {
+                double red, green, blue;
+                boardColour(b, red, green, blue);
+                cr->set_source_rgb(red, green, blue);
+                cr->set_dash(seriesDash(s), 0.0);
+            }
+            else
+                cr->set_source_rgb(series.red, series.green, series.blue);
+            cr->stroke();
+            cr->unset_dash();
+        }
+    }
+    cr->restore();
+}
+
+void MetricsView::drawSeries(const Cairo::RefPtr<Cairo::Context> &cr, const std::deque<MetricPoint> &points, double left, double right,
+                             double top, double bottom, double tMin, double tMax, double vMin, double vMax) const
+{
+    // Per pixel column, a vertical stroke from its lowest to its highest value: the same picture as
+    // every point, whatever the number of boards times points, at no more than two per column.
+    auto px = [&](double time) { return left + (time - tMin) / (tMax - tMin) * (right - left); };
+    auto py = [&](double value) { return bottom - (value - vMin) / (vMax - vMin) * (bottom - top); };
+    bool first = true;
+    long column = 0;
+    double columnX = 0.0, low = 0.0, high = 0.0, last = 0.0;
+    size_t count = 0;
+    auto flush = [&]()
+    {
+        if (count == 1)
+            cr->line_to(columnX, py(last));
+        else if (count > 1)
+        {
+            cr->line_to(columnX, py(low));
+            cr->line_to(columnX, py(high));
+            cr->line_to(columnX, py(last));
+        }
+    };
+    for (const auto &point : points)
+    {
+        double x = px(point.time);
+        long c = long(std::floor(x));
+        if (first || c != column)
+        {
+            if (first)
+                cr->move_to(x, py(point.value));
+            else
+                flush();
+            first = false;
+            column = c;
+            columnX = x;
+            low = high = point.value;
+            count = 0;
+        }
+        low = std::min(low, double(point.value));
+        high = std::max(high, double(point.value));
+        last = point.value;
+        ++count;
+    }
+    flush();
+}
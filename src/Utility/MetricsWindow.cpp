@@ -0,0 +1,141 @@
+/*MetricsWindow.cpp*/
+
+#include "Utility/MetricsWindow.hpp"
+#include <glibmm/main.h>
+#include <cstdio>
+
+MetricsWindow::MetricsWindow()
+    : box(Gtk::ORIENTATION_VERTICAL),
+      topRow(Gtk::ORIENTATION_HORIZONTAL),
+      buttonReset("Reset"),
+      panes(Gtk::ORIENTATION_VERTICAL),
+      view(receiver)
+{
+    set_title("System Monitor");
+    set_default_size(1000, 1050);
+
+    box.set_spacing(5);
+    box.set_border_width(5);
+    topRow.set_spacing(10);
+    labelStatus.set_halign(Gtk::ALIGN_END);
+    buttonReset.signal_clicked().connect(sigc::mem_fun(view, &MetricsView::reset));
+    comboBoard.append("All boards");
+    comboBoard.set_active(0);
+    comboBoard.signal_changed().connect(sigc::mem_fun(*this, &MetricsWindow::onBoardChanged));
+    topRow.pack_start(buttonReset, Gtk::PACK_SHRINK);
+    topRow.pack_start(comboBoard, Gtk::PACK_SHRINK);
+    topRow.pack_end(labelStatus, Gtk::PACK_SHRINK);
+    detailsView.set_editable(false);
+    detailsView.set_monospace(true);
+    detailsScroll.set_policy(Gtk::POLICY_AUTOMATIC, Gtk::POLICY_AUTOMATIC);
+    detailsScroll.set_size_request(-1, 120);
+    detailsScroll.add(detailsView);
+    panes.pack1(view, true, false);
+    panes.pack2(detailsScroll, false, true);
+    box.pack_start(topRow, Gtk::PACK_SHRINK);
+    box.pack_start(panes, Gtk::PACK_EXPAND_WIDGET);
+    add(box);
+}
+
+MetricsWindow::~MetricsWindow()
+{
+    stop();
+}
+
+bool MetricsWindow::start(uint16_t port, std::string &error)
+{
+    if (receiver.running())
+        return true;
+    if (!receiver.start(port, error))
+        return false;
+    this->port = port;
+    updateStatus();
+    statusTimer = Glib::signal_timeout().connect(sigc::mem_fun(*this, &MetricsWindow::updateStatus), 250);
+    return true;
+}
+
+void MetricsWindow::stop()
+{
+    statusTimer.disconnect();
+    receiver.stop();
+}
+
+void MetricsWindow::onBoardChanged()
+{
+    // Row 0 is "All boards", then the boards in the receiver's order.
+    int row = comboBoard.get_active_row_number();
+    view.setBoard(row <= 0 ? MetricsView::allBoards : row - 1);
+    updateDetails();
+}
+
+bool MetricsWindow::updateStatus()
+{
+    // Boards are only ever added, so the list just grows.
+    size_t boards = receiver.boardCount();
+    for (size_t b = listedBoards; b < boards; ++b)
+        comboBoard.append(receiver.boardName(b));
+    listedBoards = boards;
+
+    char text[160];
+    int row = comboBoard.get_active_row_number();
+    if (boards == 0)
+        std::snprintf(text, sizeof(text), "Waiting for monitor_sender on port %u", unsigned(port));
+    else if (row > 0)
+    {
+        size_t b = size_t(row - 1);
+        if (!receiver.connected(b))
+            std::snprintf(text, sizeof(text), "%s disconnected, lost samples: %llu", receiver.boardName(b).c_str(),
+                          (unsigned long long)receiver.lostSamples(b));
+        else
+            std::snprintf(text, sizeof(text), "Interval: %.3f s, missed deadlines: %u, lost samples: %llu",
+                          receiver.intervalUs(b) / 1e6, receiver.missedDeadlines(b), (unsigned long long)receiver.lostSamples(b));
+    }
+    else
+    {
+        size_t connected = 0;
+        unsigned long long lost = 0;
+        for (size_t b = 0; b < boards; ++b)
+        {
+            connected += receiver.connected(b) ? 1 : 0;
+            lost += receiver.lostSamples(b);
+        }
+        std::snprintf(text, sizeof(text), "%zu of %zu boards connected, lost samples: %llu", connected, boards, lost);
+    }
+    if (labelStatus.get_text() != text)
+        labelStatus.set_text(text);
+    updateDetails();
+    return true;
+}
+
+void MetricsWindow::updateDetails()
+{
+    size_t boards = receiver.boardCount();
+    details.resize(boards);
+    TelemetrySample sample;
+    for (size_t b = 0; b < boards; ++b)
+        while (receiver.popDetails(b, sample))
+            details[b] = sample;
+
+    int row = comboBoard.get_active_row_number();
+    std::string text;
+    for (size_t b = 0; b < boards; ++b)
+    {
+        if (row > 0 && b != size_t(row - 1))
+            continue;
+        std::string tables = TelemetryDecoder::formatDetails(details[b]);
+        if (tables.empty())
+            continue;
+        if (row <= 0)
+            text += (text.empty() ? "" : "\n") + receiver.boardName(b) + "\n\n";
+        text += tables;
+    }
+    if (text.empty())
+        text = "No process, stage, counter or XADC fields yet: start monitor_sender with a pipeline process, --perf or --xadc-hz, "
+               "or run an exported model.";
+    // Only on change, so a reader's scroll position and selection survive the refresh.
+    if (text != detailsText)
+    {
+        detailsText = text;
+        detailsView.get_buffer()->set_text(text);
+    }
+}
@@ -0,0 +1,1496 @@
+/*ModelAnalyzer.cpp*/
+
+#include "Utility/ModelAnalyzer.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <optional>
+#include <set>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+// Qualia emits plain scalar loops, so every output keeps one dependent multiply-accumulate chain:
+// a VFP vmla.f32 chain costs ~9 cycles per MAC on the Cortex-A9, an smlabb/mla chain ~3.
+static const double floatCyclesPerMac = 9.0;
+static const double fixedCyclesPerMac = 3.0;
+static const double cyclesPerElementOp = 2.0;
+static const size_t l2CacheBytes = 512 * 1024;
+static const double dramCyclesPerByte = 1.5;
+
+struct SourceFile
+{
+    std::string path;
+    std::string text;
+};
+
+struct MacroEvent
+{
+    size_t offset;
+    bool defined;
+    bool functionLike;
+    std::string value;
+};
+
+struct CodePiece
+{
+    size_t codeOffset;
+    size_t fileIndex;
+    size_t fileOffset;
+    size_t length;
+};
+
+struct Token
+{
+    std::string text;
+    char kind;
+    size_t begin;
+    size_t end;
+};
+
+struct TypedefInfo
+{
+    std::string base;
+    std::vector<std::string> dims;
+    size_t offset;
+};
+
+struct ParamInfo
+{
+    std::string type;
+    std::string name;
+    std::vector<std::string> dims;
+};
+
+struct FunctionInfo
+{
+    std::string name;
+    std::vector<ParamInfo> params;
+    size_t offset;
+    size_t bodyBegin;
+    size_t bodyEnd;
+};
+
+struct ModelSources
+{
+    std::string root;
+    std::vector<SourceFile> files;
+    std::string code;
+    std::vector<CodePiece> pieces;
+    std::map<std::string, std::vector<MacroEvent>> macros;
+    std::map<std::string, TypedefInfo> typedefs;
+    std::vector<FunctionInfo> functions;
+    std::vector<WeightArray> arrays;
+    std::set<std::string> processed;
+
+    const MacroEvent *macroAt(const std::string &name, size_t offset) const
+    {
+        auto it = macros.find(name);
+        if (it == macros.end())
+            return nullptr;
+
+        const MacroEvent *found = nullptr;
+        for (const auto &event : it->second)
+        {
+            if (event.offset > offset)
+                break;
+            found = &event;
+        }
+        return (found && found->defined) ? found : nullptr;
+    }
+
+    SourceSpan span(size_t codeBegin, size_t codeEnd) const
+    {
+        SourceSpan result;
+        auto locate = [this](size_t offset) -> const CodePiece *
+        {
+            auto it = std::upper_bound(pieces.begin(), pieces.end(), offset,
+                                       [](size_t value, const CodePiece &piece)
+                                       { return value < piece.codeOffset; });
+            if (it == pieces.begin())
+                return nullptr;
+            return &*std::prev(it);
+        };
+
+        const CodePiece *first = locate(codeBegin);
+        const CodePiece *last = locate(codeEnd > codeBegin ? codeEnd - 1 : codeBegin);
+        if (!first || !last || first->fileIndex != last->fileIndex)
+            return result;
+
+        result.file = files[first->fileIndex].path;
+        result.begin = first->fileOffset + (codeBegin - first->codeOffset);
+        result.end = last->fileOffset + (codeEnd - last->codeOffset);
+        return result;
+    }
+};
+
+static std::string trim(const std::string &text)
+{
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+        return "";
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+static bool isIdentStart(char c)
+{
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+static bool isIdentChar(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// Blanks out comments while keeping every other byte (and so every offset) in place.
+static std::string stripComments(const std::string &text)
+{
+    std::string out = text;
+    size_t i = 0;
+    const size_t n = text.size();
+    while (i < n)
+    {
+        char c = text[i];
+        if (c == '"' || c == '\'')
+        {
+            char quote = c;
+            ++i;
+            while (i < n && text[i] != quote && text[i] != '\n')
+                i += (text[i] == '\\') ? 2 : 1;
+            ++i;
+        }
+        else if (c == '/' && i + 1 < n && text[i + 1] == '/')
+        {
+            while (i < n && text[i] != '\n')
+                out[i++] = ' ';
+        }
+        else if (c == '/' && i + 1 < n && text[i + 1] == '*')
+        {
+            size_t end = text.find("*/", i + 2);
+            end = (end == std::string::npos) ? n : end + 2;
+            for (; i < end; ++i)
+                if (out[i] != '\n')
+                    out[i] = ' ';
+        }
+        else
+            ++i;
+    }
+    return out;
+}
+
+static std::vector<Token> tokenize(const std::string &text, size_t begin, size_t end)
+{
+    std::vector<Token> tokens;
+    size_t i = begin;
+    while (i < end)
+    {
+        char c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            ++i;
+            continue;
+        }
+
+        size_t start = i;
+        char kind;
+        if (isIdentStart(c))
+        {
+            while (i < end && isIdentChar(text[i]))
+                ++i;
+            kind = 'i';
+        }
+        else if (std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && i + 1 < end && std::isdigit(static_cast<unsigned char>(text[i + 1]))))
+        {
+            while (i < end && (isIdentChar(text[i]) || text[i] == '.' ||
+                               ((text[i] == '+' || text[i] == '-') && (text[i - 1] == 'e' || text[i - 1] == 'E'))))
+                ++i;
+            kind = 'n';
+        }
+        else if (c == '"' || c == '\'')
+        {
+            ++i;
+            while (i < end && text[i] != c)
+                i += (text[i] == '\\') ? 2 : 1;
+            i = std::min(i + 1, end);
+            kind = 's';
+        }
+        else
+        {
+            static const char *twoCharOps[] = {"&&", "||", "==", "!=", "<=", ">=", "<<", ">>", "->", "++", "--"};
+            i += 1;
+            for (const char *op : twoCharOps)
+                if (start + 1 < end && text[start] == op[0] && text[start + 1] == op[1])
+                {
+                    i = start + 2;
+                    break;
+                }
+            kind = 'p';
+        }
+        tokens.push_back({text.substr(start, i - start), kind, start, i});
+    }
+    return tokens;
+}
+
+class ExpressionEvaluator
+{
+public:
+    ExpressionEvaluator(const ModelSources &sources, size_t offset, bool undefinedAsZero)
+        : sources(sources), offset(offset), undefinedAsZero(undefinedAsZero) {}
+
+    std::optional<long long> evaluate(const std::string &expression, int depth = 0)
+    {
+        if (depth > 32)
+            return std::nullopt;
+
+        auto savedTokens = std::move(tokens);
+        size_t savedPos = pos;
+        int savedDepth = currentDepth;
+
+        tokens = tokenize(expression, 0, expression.size());
+        pos = 0;
+        currentDepth = depth;
+        failed = false;
+
+        long long value = parseOr();
+        bool ok = !failed && pos == tokens.size();
+
+        tokens = std::move(savedTokens);
+        pos = savedPos;
+        currentDepth = savedDepth;
+        if (!ok)
+        {
+            failed = false;
+            return std::nullopt;
+        }
+        return value;
+    }
+
+private:
+    const ModelSources &sources;
+    size_t offset;
+    bool undefinedAsZero;
+    std::vector<Token> tokens;
+    size_t pos = 0;
+    int currentDepth = 0;
+    bool failed = false;
+
+    bool accept(const char *op)
+    {
+        if (pos < tokens.size() && tokens[pos].text == op)
+        {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    long long parseOr()
+    {
+        long long value = parseAnd();
+        while (accept("||"))
+        {
+            long long rhs = parseAnd();
+            value = (value || rhs) ? 1 : 0;
+        }
+        return value;
+    }
+
+    long long parseAnd()
+    {
+        long long value = parseEquality();
+        while (accept("&&"))
+        {
+            long long rhs = parseEquality();
+            value = (value && rhs) ? 1 : 0;
+        }
+        return value;
+    }
+
+    long long parseEquality()
+    {
+        long long value = parseRelational();
+        for (;;)
+        {
+            if (accept("=="))
+                value = (value == parseRelational());
+            else if (accept("!="))
+                value = (value != parseRelational());
+            else
+                return value;
+        }
+    }
+
+    long long parseRelational()
+    {
+        long long value = parseShift();
+        for (;;)
+        {
+            if (accept("<="))
+                value = (value <= parseShift());
+            else if (accept(">="))
+                value = (value >= parseShift());
+            else if (accept("<"))
+                value = (value < parseShift());
+            else if (accept(">"))
+                value = (value > parseShift());
+            else
+                return value;
+        }
+    }
+
+    long long parseShift()
+    {
+        long long value = parseAdditive();
+        for (;;)
+        {
+            if (accept("<<"))
+                value <<= parseAdditive();
+            else if (accept(">>"))
+                value >>= parseAdditive();
+            else
+                return value;
+        }
+    }
+
+    long long parseAdditive()
+    {
+        long long value = parseMultiplicative();
+        for (;;)
+        {
+            if (accept("+"))
+                value += parseMultiplicative();
+            else if (accept("-"))
+                value -= parseMultiplicative();
+            else
+                return value;
+        }
+    }
+
+    long long parseMultiplicative()
+    {
+        long long value = parseUnary();
+        for (;;)
+        {
+            if (accept("*"))
+                value *= parseUnary();
+            else if (accept("/") || accept("%"))
+            {
+                bool modulo = tokens[pos - 1].text == "%";
+                long long rhs = parseUnary();
+                if (rhs == 0)
+                {
+                    failed = true;
+                    return 0;
+                }
+                value = modulo ? value % rhs : value / rhs;
+            }
+            else
+                return value;
+        }
+    }
+
+    long long parseUnary()
+    {
+        if (accept("!"))
+            return !parseUnary();
+        if (accept("-"))
+            return -parseUnary();
+        if (accept("+"))
+            return parseUnary();
+        if (accept("~"))
+            return ~parseUnary();
+        return parsePrimary();
+    }
+
+    long long parsePrimary()
+    {
+        if (pos >= tokens.size())
+        {
+            failed = true;
+            return 0;
+        }
+
+        if (accept("("))
+        {
+            long long value = parseOr();
+            if (!accept(")"))
+                failed = true;
+            return value;
+        }
+
+        const Token &token = tokens[pos++];
+        if (token.kind == 'n')
+        {
+            std::string digits = token.text;
+            while (!digits.empty() && std::strchr("uUlL", digits.back()))
+                digits.pop_back();
+            try
+            {
+                size_t used = 0;
+                long long value = std::stoll(digits, &used, 0);
+                if (used != digits.size())
+                    failed = true;
+                return value;
+            }
+            catch (const std::exception &)
+            {
+                failed = true;
+                return 0;
+            }
+        }
+
+        if (token.kind != 'i')
+        {
+            failed = true;
+            return 0;
+        }
+
+        if (token.text == "defined")
+        {
+            bool parenthesized = accept("(");
+            if (pos >= tokens.size() || tokens[pos].kind != 'i')
+            {
+                failed = true;
+                return 0;
+            }
+            bool defined = sources.macroAt(tokens[pos++].text, offset) != nullptr;
+            if (parenthesized && !accept(")"))
+                failed = true;
+            return defined ? 1 : 0;
+        }
+
+        const MacroEvent *macro = sources.macroAt(token.text, offset);
+        if (macro && !macro->functionLike)
+        {
+            ExpressionEvaluator nested(sources, offset, undefinedAsZero);
+            auto value = nested.evaluate(macro->value, currentDepth + 1);
+            if (value)
+                return *value;
+        }
+
+        if (!undefinedAsZero)
+            failed = true;
+        return 0;
+    }
+};
+
+static bool isQualifier(const std::string &word)
+{
+    static const std::set<std::string> qualifiers = {"const", "static", "volatile", "extern", "register", "inline", "__inline", "__inline__", "restrict", "__restrict"};
+    return qualifiers.count(word) != 0;
+}
+
+static const std::map<std::string, size_t> &baseTypeSizes()
+{
+    // Sizes on the 32-bit ARM target, not on the host.
+    static const std::map<std::string, size_t> sizes = {
+        {"float", 4}, {"double", 8}, {"char", 1}, {"signed char", 1}, {"unsigned char", 1},
+        {"short", 2}, {"unsigned short", 2}, {"int", 4}, {"unsigned", 4}, {"unsigned int", 4},
+        {"long", 4}, {"unsigned long", 4}, {"long long", 8}, {"unsigned long long", 8},
+        {"int8_t", 1}, {"uint8_t", 1}, {"int16_t", 2}, {"uint16_t", 2},
+        {"int32_t", 4}, {"uint32_t", 4}, {"int64_t", 8}, {"uint64_t", 8}};
+    return sizes;
+}
+
+static void preprocessFile(ModelSources &sources, const fs::path &path, int depth);
+
+static std::optional<fs::path> resolveInclude(const ModelSources &sources, const fs::path &currentFile, const std::string &name)
+{
+    for (const fs::path &dir : {currentFile.parent_path(), fs::path(sources.root), fs::path(sources.root) / "include"})
+    {
+        fs::path candidate = dir / name;
+        if (fs::is_regular_file(candidate))
+            return candidate;
+    }
+    return std::nullopt;
+}
+
+static void handleDirective(ModelSources &sources, const fs::path &path, const std::string &directive, int depth,
+                            std::vector<std::pair<bool, bool>> &conditions, bool &active)
+{
+    size_t i = 0;
+    while (i < directive.size() && std::isspace(static_cast<unsigned char>(directive[i])))
+        ++i;
+    size_t wordStart = i;
+    while (i < directive.size() && isIdentChar(directive[i]))
+        ++i;
+    std::string word = directive.substr(wordStart, i - wordStart);
+    std::string rest = trim(directive.substr(i));
+
+    auto evaluateCondition = [&](const std::string &expression)
+    {
+        ExpressionEvaluator evaluator(sources, sources.code.size(), true);
+        auto value = evaluator.evaluate(expression);
+        return value.value_or(0) != 0;
+    };
+
+    // Each condition entry holds (branch active, some branch already taken); the entry below it tells
+    // whether the enclosing block is active.
+    if (word == "if" || word == "ifdef" || word == "ifndef")
+    {
+        bool enclosing = active;
+        bool condition = false;
+        if (enclosing)
+        {
+            if (word == "if")
+                condition = evaluateCondition(rest);
+            else
+            {
+                std::string name = rest.substr(0, std::min(rest.size(), rest.find_first_of(" \t")));
+                bool defined = sources.macroAt(name, sources.code.size()) != nullptr;
+                condition = (word == "ifdef") ? defined : !defined;
+            }
+        }
+        conditions.push_back({enclosing, condition});
+        active = enclosing && condition;
+        return;
+    }
+    if (word == "elif" || word == "else")
+    {
+        if (conditions.empty())
+            return;
+        auto &top = conditions.back();
+        if (!top.first || top.second)
+            active = false;
+        else
+        {
+            active = (word == "else") ? true : evaluateCondition(rest);
+            top.second = active;
+        }
+        return;
+    }
+    if (word == "endif")
+    {
+        if (conditions.empty())
+            return;
+        active = conditions.back().first;
+        conditions.pop_back();
+        return;
+    }
+
+    if (!active)
+        return;
+
+    if (word == "define" || word == "undef")
+    {
+        size_t nameEnd = 0;
+        while (nameEnd < rest.size() && isIdentChar(rest[nameEnd]))
+            ++nameEnd;
+        std::string name = rest.substr(0, nameEnd);
+        if (name.empty())
+            return;
+
+        MacroEvent event{sources.code.size(), word == "define", false, ""};
+        if (event.defined)
+        {
+            event.functionLike = nameEnd < rest.size() && rest[nameEnd] == '(';
+            event.value = trim(rest.substr(nameEnd));
+        }
+        sources.macros[name].push_back(event);
+    }
+    else if (word == "include" && !rest.empty() && rest[0] == '"')
+    {
+        size_t close = rest.find('"', 1);
+        if (close == std::string::npos)
+            return;
+        auto included = resolveInclude(sources, path, rest.substr(1, close - 1));
+        if (included)
+            preprocessFile(sources, *included, depth + 1);
+    }
+}
+
+// Flattens model.c and the local files it includes into one buffer of active code, the way the
+// compiler would see it, while recording every #define/#undef at the code offset where it happens.
+static void preprocessFile(ModelSources &sources, const fs::path &path, int depth)
+{
+    if (depth > 32)
+        return;
+
+    std::string canonical = fs::weakly_canonical(path).string();
+    if (!sources.processed.insert(canonical).second)
+        return;
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+
+    size_t fileIndex = sources.files.size();
+    sources.files.push_back({canonical, buffer.str()});
+    const std::string stripped = stripComments(sources.files[fileIndex].text);
+
+    std::vector<std::pair<bool, bool>> conditions;
+    bool active = true;
+    size_t pos = 0;
+    const size_t n = stripped.size();
+    while (pos < n)
+    {
+        size_t lineEnd = pos;
+        for (;;)
+        {
+            lineEnd = stripped.find('\n', lineEnd);
+            if (lineEnd == std::string::npos)
+            {
+                lineEnd = n;
+                break;
+            }
+            size_t last = lineEnd;
+            while (last > pos && (stripped[last - 1] == '\r' || stripped[last - 1] == ' '))
+                --last;
+            if (last > pos && stripped[last - 1] == '\\')
+            {
+                ++lineEnd;
+                continue;
+            }
+            break;
+        }
+
+        size_t first = stripped.find_first_not_of(" \t", pos);
+        if (first != std::string::npos && first < lineEnd && stripped[first] == '#')
+        {
+            std::string directive = stripped.substr(first + 1, lineEnd - first - 1);
+            for (size_t c = 0; c + 1 < directive.size(); ++c)
+                if (directive[c] == '\\' && (directive[c + 1] == '\n' || directive[c + 1] == '\r'))
+                    directive[c] = ' ';
+            handleDirective(sources, path, directive, depth, conditions, active);
+            // Included files append to the code buffer, so their pieces must not merge with ours.
+        }
+        else if (active)
+        {
+            size_t pieceEnd = std::min(lineEnd + 1, n);
+            if (!sources.pieces.empty() && sources.pieces.back().fileIndex == fileIndex &&
+                sources.pieces.back().fileOffset + sources.pieces.back().length == pos &&
+                sources.pieces.back().codeOffset + sources.pieces.back().length == sources.code.size())
+                sources.pieces.back().length += pieceEnd - pos;
+            else
+                sources.pieces.push_back({sources.code.size(), fileIndex, pos, pieceEnd - pos});
+
+            sources.code.append(stripped, pos, pieceEnd - pos);
+            if (pieceEnd == n && (n == 0 || stripped[n - 1] != '\n'))
+                sources.code.push_back('\n');
+        }
+        pos = lineEnd + 1;
+    }
+}
+
+static size_t matchBrace(const std::string &code, size_t open)
+{
+    int depth = 0;
+    for (size_t i = open; i < code.size(); ++i)
+    {
+        char c = code[i];
+        if (c == '"' || c == '\'')
+        {
+            ++i;
+            while (i < code.size() && code[i] != c)
+                i += (code[i] == '\\') ? 2 : 1;
+        }
+        else if (c == '{')
+            ++depth;
+        else if (c == '}' && --depth == 0)
+            return i;
+    }
+    return std::string::npos;
+}
+
+static std::vector<std::vector<Token>> splitTopLevel(const std::vector<Token> &tokens, size_t begin, size_t end, const char *separator)
+{
+    std::vector<std::vector<Token>> parts(1);
+    int depth = 0;
+    for (size_t i = begin; i < end; ++i)
+    {
+        const std::string &text = tokens[i].text;
+        if (text == "(" || text == "[" || text == "{")
+            ++depth;
+        else if (text == ")" || text == "]" || text == "}")
+            --depth;
+        if (depth == 0 && text == separator)
+        {
+            parts.emplace_back();
+            continue;
+        }
+        parts.back().push_back(tokens[i]);
+    }
+    if (parts.size() == 1 && parts[0].empty())
+        parts.clear();
+    return parts;
+}
+
+// Splits "const number_t kernel[A][B]" into type, name and dimension expressions.
+static bool parseDeclarator(const std::string &code, const std::vector<Token> &tokens, std::string &type, std::string &name, std::vector<std::string> &dims)
+{
+    size_t nameIndex = tokens.size();
+    for (size_t i = 0; i < tokens.size(); ++i)
+    {
+        if (tokens[i].text == "[" || tokens[i].text == "=" || tokens[i].text == "(")
+            break;
+        if (tokens[i].kind == 'i')
+            nameIndex = i;
+    }
+    if (nameIndex == tokens.size())
+        return false;
+
+    type.clear();
+    for (size_t i = 0; i < nameIndex; ++i)
+    {
+        if (tokens[i].kind != 'i' || isQualifier(tokens[i].text) || tokens[i].text == "typedef")
+            continue;
+        type += (type.empty() ? "" : " ") + tokens[i].text;
+    }
+    name = tokens[nameIndex].text;
+
+    dims.clear();
+    for (size_t i = nameIndex + 1; i < tokens.size() && tokens[i].text == "["; )
+    {
+        size_t close = i + 1;
+        int depth = 1;
+        for (; close < tokens.size(); ++close)
+        {
+            if (tokens[close].text == "[")
+                ++depth;
+            else if (tokens[close].text == "]" && --depth == 0)
+                break;
+        }
+        if (close >= tokens.size())
+            return false;
+        dims.push_back(close > i + 1 ? code.substr(tokens[i + 1].begin, tokens[close - 1].end - tokens[i + 1].begin) : "");
+        i = close + 1;
+    }
+    return !type.empty();
+}
+
+static std::string resolveType(const ModelSources &sources, std::string type, size_t offset, std::vector<long> &shape, bool &ok)
+{
+    for (int guard = 0; guard < 16; ++guard)
+    {
+        const MacroEvent *macro = sources.macroAt(type, offset);
+        if (macro && !macro->functionLike && !macro->value.empty())
+        {
+            type = macro->value;
+            continue;
+        }
+
+        auto it = sources.typedefs.find(type);
+        if (it == sources.typedefs.end())
+            break;
+
+        ExpressionEvaluator evaluator(sources, it->second.offset, false);
+        for (const auto &dim : it->second.dims)
+        {
+            auto value = evaluator.evaluate(dim);
+            if (!value)
+                ok = false;
+            shape.push_back(value.value_or(0));
+        }
+        type = it->second.base;
+    }
+    return type;
+}
+
+static std::vector<long> evaluateDims(const ModelSources &sources, const std::vector<std::string> &dims, size_t offset, bool &ok)
+{
+    std::vector<long> shape;
+    ExpressionEvaluator evaluator(sources, offset, false);
+    for (const auto &dim : dims)
+    {
+        auto value = evaluator.evaluate(dim);
+        if (!value)
+            ok = false;
+        shape.push_back(value.value_or(0));
+    }
+    return shape;
+}
+
+static size_t product(const std::vector<long> &shape)
+{
+    size_t total = 1;
+    for (long dim : shape)
+        total *= static_cast<size_t>(std::max(dim, 0L));
+    return total;
+}
+
+static void handleTopLevelStatement(ModelSources &sources, const std::vector<Token> &stmt, size_t endOffset)
+{
+    if (stmt.empty())
+        return;
+
+    std::string type, name;
+    std::vector<std::string> dims;
+
+    if (stmt[0].text == "typedef")
+    {
+        if (std::any_of(stmt.begin(), stmt.end(), [](const Token &t)
+                        { return t.text == "(" || t.text == "{}"; }))
+            return;
+        if (parseDeclarator(sources.code, stmt, type, name, dims))
+            sources.typedefs[name] = {type, dims, stmt[0].begin};
+        return;
+    }
+
+    auto assign = std::find_if(stmt.begin(), stmt.end(), [](const Token &t)
+                               { return t.text == "="; });
+    if (assign == stmt.end() || assign + 1 == stmt.end() || (assign + 1)->text != "{}")
+        return;
+    if (!parseDeclarator(sources.code, std::vector<Token>(stmt.begin(), assign), type, name, dims) || dims.empty())
+        return;
+
+    WeightArray array;
+    array.name = name;
+    array.declaredType = type;
+    array.isConst = std::any_of(stmt.begin(), assign, [](const Token &t)
+                                { return t.text == "const"; });
+    array.definition = sources.span(stmt[0].begin, endOffset);
+    array.initializer = sources.span((assign + 1)->begin, (assign + 1)->end);
+
+    bool ok = true;
+    array.shape = evaluateDims(sources, dims, stmt[0].begin, ok);
+    array.elementType = resolveType(sources, type, stmt[0].begin, array.shape, ok);
+    array.elementSize = ModelAnalyzer::elementSizeOf(array.elementType);
+    if (ok && array.elementSize > 0)
+        sources.arrays.push_back(array);
+}
+
+static void scanTopLevel(ModelSources &sources)
+{
+    const std::string &code = sources.code;
+    std::vector<Token> stmt;
+    int parenDepth = 0;
+    size_t pos = 0;
+
+    while (pos < code.size())
+    {
+        size_t next = code.find_first_of("{};", pos);
+        size_t chunkEnd = (next == std::string::npos) ? code.size() : next;
+        for (auto &token : tokenize(code, pos, chunkEnd))
+        {
+            if (token.text == "(")
+                ++parenDepth;
+            else if (token.text == ")")
+                --parenDepth;
+            stmt.push_back(std::move(token));
+        }
+        if (next == std::string::npos)
+            break;
+
+        char c = code[next];
+        if (c == ';')
+        {
+            if (parenDepth <= 0)
+            {
+                handleTopLevelStatement(sources, stmt, next + 1);
+                stmt.clear();
+                parenDepth = 0;
+            }
+            pos = next + 1;
+        }
+        else if (c == '}')
+        {
+            stmt.clear();
+            parenDepth = 0;
+            pos = next + 1;
+        }
+        else
+        {
+            bool isInitializer = std::any_of(stmt.begin(), stmt.end(), [](const Token &t)
+                                             { return t.text == "="; });
+            bool isExternC = !stmt.empty() && stmt[0].text == "extern" && stmt.size() == 2 && stmt[1].kind == 's';
+            bool isFunction = !isInitializer && !stmt.empty() && stmt.back().text == ")" && parenDepth == 0;
+
+            if (isExternC)
+            {
+                stmt.clear();
+                pos = next + 1;
+                continue;
+            }
+
+            size_t close = matchBrace(code, next);
+            if (close == std::string::npos)
+                break;
+
+            if (isFunction)
+            {
+                auto open = std::find_if(stmt.begin(), stmt.end(), [](const Token &t)
+                                         { return t.text == "("; });
+                if (open != stmt.begin() && (open - 1)->kind == 'i')
+                {
+                    FunctionInfo function;
+                    function.name = (open - 1)->text;
+                    function.offset = stmt[0].begin;
+                    function.bodyBegin = next;
+                    function.bodyEnd = close + 1;
+
+                    size_t openIndex = open - stmt.begin();
+                    for (const auto &paramTokens : splitTopLevel(stmt, openIndex + 1, stmt.size() - 1, ","))
+                    {
+                        ParamInfo param;
+                        if (parseDeclarator(code, paramTokens, param.type, param.name, param.dims))
+                            function.params.push_back(param);
+                    }
+                    sources.functions.push_back(function);
+                }
+                stmt.clear();
+            }
+            else
+                stmt.push_back({"{}", 'p', next, close + 1});
+
+            parenDepth = 0;
+            pos = close + 1;
+        }
+    }
+}
+
+static std::string bufferReference(const std::string &argument)
+{
+    std::string text;
+    for (char c : argument)
+        if (!std::isspace(static_cast<unsigned char>(c)))
+            text.push_back(c);
+
+    // Drop casts such as "(const number_t *)" and address-of/dereference operators.
+    for (;;)
+    {
+        if (!text.empty() && (text[0] == '&' || text[0] == '*'))
+            text.erase(0, 1);
+        else if (!text.empty() && text[0] == '(')
+        {
+            int depth = 0;
+            size_t close = 0;
+            for (; close < text.size(); ++close)
+            {
+                if (text[close] == '(')
+                    ++depth;
+                else if (text[close] == ')' && --depth == 0)
+                    break;
+            }
+            if (close + 1 >= text.size())
+                text = text.substr(1, close > 0 ? close - 1 : 0);
+            else
+                text.erase(0, close + 1);
+        }
+        else
+            break;
+    }
+
+    size_t end = 0;
+    while (end < text.size() && (isIdentChar(text[end]) || text[end] == '.'))
+        ++end;
+    return text.substr(0, end);
+}
+
+static std::string layerKind(const std::string &function)
+{
+    size_t end = function.size();
+    while (end > 0 && std::isdigit(static_cast<unsigned char>(function[end - 1])))
+        --end;
+    if (end < function.size() && end > 0 && function[end - 1] == '_')
+        return function.substr(0, end - 1);
+    return function;
+}
+
+static void scanEntryBody(ModelSources &sources, const FunctionInfo &entry, ModelProfile &profile,
+                          std::map<std::string, std::pair<std::string, std::vector<long>>> &buffers)
+{
+    const std::string &code = sources.code;
+    std::vector<Token> stmt;
+    size_t pos = entry.bodyBegin + 1;
+    const size_t end = entry.bodyEnd - 1;
+    std::set<std::string> knownFunctions;
+    for (const auto &function : sources.functions)
+        knownFunctions.insert(function.name);
+
+    auto declareBuffer = [&](const std::string &name, const std::string &type, const std::vector<std::string> &dims, size_t offset, size_t &bytes)
+    {
+        bool ok = true;
+        std::vector<long> shape = evaluateDims(sources, dims, offset, ok);
+        std::string base = resolveType(sources, type, offset, shape, ok);
+        size_t size = ok ? product(shape) * ModelAnalyzer::elementSizeOf(base) : 0;
+        buffers[name] = {base, shape};
+        bytes = size;
+    };
+
+    while (pos < end)
+    {
+        size_t next = code.find_first_of("{};", pos);
+        if (next == std::string::npos || next >= end)
+            break;
+        for (auto &token : tokenize(code, pos, next))
+            stmt.push_back(std::move(token));
+
+        char c = code[next];
+        if (c == '{')
+        {
+            bool aggregate = std::any_of(stmt.begin(), stmt.end(), [](const Token &t)
+                                         { return t.text == "union" || t.text == "struct"; });
+            if (aggregate)
+            {
+                size_t close = matchBrace(code, next);
+                if (close == std::string::npos || close >= end)
+                    break;
+                stmt.push_back({"{}", 'p', next, close + 1});
+                pos = close + 1;
+            }
+            else
+            {
+                stmt.clear();
+                pos = next + 1;
+            }
+            continue;
+        }
+        if (c == '}')
+        {
+            stmt.clear();
+            pos = next + 1;
+            continue;
+        }
+
+        pos = next + 1;
+        if (stmt.empty())
+            continue;
+
+        auto aggregate = std::find_if(stmt.begin(), stmt.end(), [](const Token &t)
+                                      { return t.text == "{}"; });
+        if (aggregate != stmt.end())
+        {
+            ActivationStorage storage;
+            storage.isUnion = std::any_of(stmt.begin(), aggregate, [](const Token &t)
+                                          { return t.text == "union"; });
+            storage.isStatic = std::any_of(stmt.begin(), aggregate, [](const Token &t)
+                                           { return t.text == "static"; });
+            if (aggregate + 1 != stmt.end() && (aggregate + 1)->kind == 'i')
+                storage.name = (aggregate + 1)->text;
+            storage.declaration = sources.span(stmt[0].begin, next + 1);
+
+            auto memberTokens = tokenize(code, aggregate->begin + 1, aggregate->end - 1);
+            for (const auto &member : splitTopLevel(memberTokens, 0, memberTokens.size(), ";"))
+            {
+                std::string type, name;
+                std::vector<std::string> dims;
+                if (!parseDeclarator(code, member, type, name, dims))
+                    continue;
+                size_t bytes = 0;
+                declareBuffer(storage.name + "." + name, type, dims, member[0].begin, bytes);
+                storage.members.push_back({type, name});
+                storage.bytes = storage.isUnion ? std::max(storage.bytes, bytes) : storage.bytes + bytes;
+            }
+            profile.activationStorage.push_back(storage);
+        }
+        else if (stmt[0].kind == 'i' && stmt.size() >= 3 && stmt[1].text == "(" && stmt.back().text == ")")
+        {
+            if (!knownFunctions.count(stmt[0].text) && !sources.macroAt(stmt[0].text, stmt[0].begin))
+            {
+                profile.warnings.push_back("Ignoring call to unknown function '" + stmt[0].text + "' in " + entry.name + "().");
+                stmt.clear();
+                continue;
+            }
+
+            LayerCall layer;
+            layer.function = stmt[0].text;
+            layer.kind = layerKind(layer.function);
+            layer.call = sources.span(stmt[0].begin, next + 1);
+            layer.argumentList = sources.span(stmt[1].begin, stmt.back().end);
+            for (const auto &argument : splitTopLevel(stmt, 2, stmt.size() - 1, ","))
+            {
+                if (argument.empty())
+                    continue;
+                std::string text = code.substr(argument.front().begin, argument.back().end - argument.front().begin);
+                layer.arguments.push_back(text);
+                layer.bufferArguments.push_back(bufferReference(text));
+            }
+            // Calls that pass no variable (timing probes, logging with constants) are not layers.
+            if (std::any_of(layer.bufferArguments.begin(), layer.bufferArguments.end(), [](const std::string &buffer)
+                            { return !buffer.empty() && (std::isalpha(static_cast<unsigned char>(buffer[0])) || buffer[0] == '_'); }))
+                profile.layers.push_back(layer);
+        }
+        else if (std::none_of(stmt.begin(), stmt.end(), [](const Token &t)
+                              { return t.text == "(" || t.text == "="; }))
+        {
+            std::string type, name;
+            std::vector<std::string> dims;
+            if (parseDeclarator(code, stmt, type, name, dims))
+            {
+                ActivationStorage storage;
+                storage.name = name;
+                storage.isStatic = std::any_of(stmt.begin(), stmt.end(), [](const Token &t)
+                                               { return t.text == "static"; });
+                storage.members.push_back({type, name});
+                storage.declaration = sources.span(stmt[0].begin, next + 1);
+                declareBuffer(name, type, dims, stmt[0].begin, storage.bytes);
+                profile.activationStorage.push_back(storage);
+            }
+        }
+        stmt.clear();
+    }
+}
+
+static void describeLayers(const ModelSources &sources, ModelProfile &profile,
+                           const std::map<std::string, std::pair<std::string, std::vector<long>>> &buffers)
+{
+    std::map<std::string, const FunctionInfo *> functions;
+    for (const auto &function : sources.functions)
+        functions[function.name] = &function;
+
+    for (auto &layer : profile.layers)
+    {
+        const FunctionInfo *function = functions.count(layer.function) ? functions[layer.function] : nullptr;
+
+        auto shapeOf = [&](const std::string &buffer, const ParamInfo *param, std::vector<long> &shape, std::string &elementType)
+        {
+            bool ok = true;
+            if (param)
+            {
+                shape = evaluateDims(sources, param->dims, function->offset, ok);
+                elementType = resolveType(sources, param->type, function->offset, shape, ok);
+                if (ok && !shape.empty())
+                    return;
+            }
+            auto it = buffers.find(buffer);
+            if (it != buffers.end())
+            {
+                shape = it->second.second;
+                elementType = it->second.first;
+            }
+        };
+
+        if (!layer.bufferArguments.empty())
+        {
+            std::string inputType, outputType;
+            const ParamInfo *firstParam = (function && !function->params.empty()) ? &function->params.front() : nullptr;
+            const ParamInfo *lastParam = (function && !function->params.empty()) ? &function->params.back() : nullptr;
+            shapeOf(layer.bufferArguments.front(), firstParam, layer.inputShape, inputType);
+            shapeOf(layer.bufferArguments.back(), lastParam, layer.outputShape, outputType);
+            layer.elementType = outputType.empty() ? profile.numberType : outputType;
+            layer.inputBytes = product(layer.inputShape) * ModelAnalyzer::elementSizeOf(inputType.empty() ? layer.elementType : inputType);
+            layer.outputBytes = product(layer.outputShape) * ModelAnalyzer::elementSizeOf(layer.elementType);
+        }
+
+        if (function)
+        {
+            ExpressionEvaluator evaluator(sources, function->offset, false);
+            for (const auto &entry : sources.macros)
+            {
+                const MacroEvent *event = sources.macroAt(entry.first, function->offset);
+                if (!event)
+                    continue;
+                if (entry.first.rfind("ACTIVATION_", 0) == 0)
+                {
+                    layer.activation = entry.first.substr(11);
+                    std::transform(layer.activation.begin(), layer.activation.end(), layer.activation.begin(), ::tolower);
+                }
+                else if (!event->functionLike && !event->value.empty())
+                {
+                    auto value = evaluator.evaluate(event->value);
+                    if (value)
+                        layer.constants[entry.first] = static_cast<long>(*value);
+                }
+            }
+        }
+
+        const WeightArray *kernel = nullptr;
+        bool kernelNamed = false;
+        for (const auto &buffer : layer.bufferArguments)
+        {
+            const WeightArray *weight = profile.findWeight(buffer);
+            if (!weight)
+                continue;
+            layer.weights.push_back(weight->name);
+
+            bool named = weight->name.find("kernel") != std::string::npos || weight->name.find("weight") != std::string::npos;
+            if (!kernel || (named && !kernelNamed) || (named == kernelNamed && weight->elements() > kernel->elements()))
+            {
+                kernel = weight;
+                kernelNamed = named;
+            }
+        }
+
+        size_t outputElements = product(layer.outputShape);
+        size_t inputElements = product(layer.inputShape);
+        if (kernel && !kernel->shape.empty())
+        {
+            // The kernel's leading dimension is the unit/filter count, and every output element
+            // consumes one slice of it: dense gives units x inputs, conv gives positions x filters x taps.
+            size_t filters = static_cast<size_t>(kernel->shape.front());
+            size_t positions = (filters > 0 && outputElements % filters == 0) ? outputElements / filters : 1;
+            layer.macs = static_cast<unsigned long long>(kernel->elements()) * positions;
+            layer.elementOps = outputElements;
+        }
+        else
+            layer.elementOps = std::max(inputElements, outputElements);
+
+        profile.macs += layer.macs;
+        profile.elementOps += layer.elementOps;
+    }
+}
+
+static void computeActivationMemory(ModelProfile &profile,
+                                    const std::map<std::string, std::pair<std::string, std::vector<long>>> &buffers)
+{
+    for (const auto &storage : profile.activationStorage)
+        profile.allocatedActivationBytes += storage.bytes;
+
+    std::map<std::string, size_t> firstWrite, lastUse;
+    for (size_t i = 0; i < profile.layers.size(); ++i)
+    {
+        const auto &arguments = profile.layers[i].bufferArguments;
+        for (size_t a = 0; a < arguments.size(); ++a)
+        {
+            if (!buffers.count(arguments[a]) || profile.findWeight(arguments[a]))
+                continue;
+            if (a + 1 == arguments.size() && !firstWrite.count(arguments[a]))
+                firstWrite[arguments[a]] = i;
+            lastUse[arguments[a]] = i;
+        }
+    }
+
+    for (size_t i = 0; i < profile.layers.size(); ++i)
+    {
+        size_t live = 0;
+        for (const auto &entry : firstWrite)
+        {
+            if (entry.second > i || lastUse[entry.first] < i)
+                continue;
+            const auto &buffer = buffers.at(entry.first);
+            live += product(buffer.second) * ModelAnalyzer::elementSizeOf(buffer.first);
+        }
+        profile.peakActivationBytes = std::max(profile.peakActivationBytes, live);
+    }
+}
+
+size_t WeightArray::elements() const
+{
+    return product(shape);
+}
+
+const WeightArray *ModelProfile::findWeight(const std::string &name) const
+{
+    for (const auto &weight : weights)
+        if (weight.name == name)
+            return &weight;
+    return nullptr;
+}
+
+size_t ModelProfile::inputElements() const
+{
+    return product(inputShape);
+}
+
+size_t ModelProfile::outputElements() const
+{
+    return product(outputShape);
+}
+
+bool ModelAnalyzer::analyze(const std::string &modelFolder, ModelProfile &profile, std::string &error)
+{
+    profile = ModelProfile();
+    profile.folder = modelFolder;
+
+    fs::path modelC = fs::path(modelFolder) / "model.c";
+    if (!fs::exists(modelC))
+    {
+        error = "model.c not found in " + modelFolder;
+        return false;
+    }
+
+    try
+    {
+        ModelSources sources;
+        sources.root = modelFolder;
+        preprocessFile(sources, modelC, 0);
+        scanTopLevel(sources);
+
+        const FunctionInfo *entry = nullptr;
+        for (const auto &function : sources.functions)
+            for (const auto &param : function.params)
+                if (param.type == "input_t")
+                    entry = &function;
+        if (!entry)
+        {
+            error = "Could not find the model entry function (a function taking an input_t) in model.c.";
+            return false;
+        }
+
+        profile.entryFunction = entry->name;
+        profile.entryBody = sources.span(entry->bodyBegin, entry->bodyEnd);
+
+        std::vector<long> numberShape;
+        bool ok = true;
+        profile.numberType = resolveType(sources, "number_t", entry->offset, numberShape, ok);
+        if (!elementSizeOf(profile.numberType))
+            profile.numberType = "float";
+        profile.fixedPoint = isIntegerType(profile.numberType);
+
+        profile.weights = sources.arrays;
+        for (const auto &weight : profile.weights)
+            profile.weightBytes += weight.bytes();
+
+        std::map<std::string, std::pair<std::string, std::vector<long>>> buffers;
+        for (const auto &param : entry->params)
+        {
+            profile.entryParameters.push_back(param.name);
+            profile.entryParameterTypes.push_back(param.type);
+            bool paramOk = true;
+            std::vector<long> shape = evaluateDims(sources, param.dims, entry->offset, paramOk);
+            std::string base = resolveType(sources, param.type, entry->offset, shape, paramOk);
+            buffers[param.name] = {base, shape};
+        }
+        if (entry->params.size() >= 2)
+        {
+            profile.inputShape = buffers[entry->params.front().name].second;
+            profile.inputElementType = buffers[entry->params.front().name].first;
+            profile.outputShape = buffers[entry->params.back().name].second;
+            profile.outputElementType = buffers[entry->params.back().name].first;
+        }
+
+        scanEntryBody(sources, *entry, profile, buffers);
+        if (profile.layers.empty())
+        {
+            error = "No layer calls found in " + profile.entryFunction + "().";
+            return false;
+        }
+
+        describeLayers(sources, profile, buffers);
+
+        // The model's own input and output are owned by the caller and never count as activations.
+        for (const auto &param : entry->params)
+            buffers.erase(param.name);
+        profile.activationBuffers = buffers;
+        computeActivationMemory(profile, buffers);
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        error = std::string("Model analysis failed: ") + e.what();
+        return false;
+    }
+}
+
+double ModelAnalyzer::predictLatencyUs(const ModelProfile &profile, double freqMHz)
+{
+    if (freqMHz <= 0.0)
+        freqMHz = defaultFreqMHz;
+
+    double cycles = static_cast<double>(profile.macs) * (profile.fixedPoint ? fixedCyclesPerMac : floatCyclesPerMac) +
+                    static_cast<double>(profile.elementOps) * cyclesPerElementOp;
+    if (profile.weightBytes > l2CacheBytes)
+        cycles += static_cast<double>(profile.weightBytes) * dramCyclesPerByte;
+    return cycles / freqMHz;
+}
+
+size_t ModelAnalyzer::elementSizeOf(const std::string &type)
+{
+    auto it = baseTypeSizes().find(type);
+    return it == baseTypeSizes().end() ? 0 : it->second;
+}
+
+bool ModelAnalyzer::isIntegerType(const std::string &type)
+{
+    return elementSizeOf(type) > 0 && type != "float" && type != "double";
+}
+
+size_t ModelAnalyzer::entryDefinitionStart(const std::string &text, const ModelProfile &profile)
+{
+    size_t name = text.rfind(profile.entryFunction, profile.entryBody.begin);
+    if (name == std::string::npos)
+        return std::string::npos;
+    size_t insertAt = text.rfind('\n', name);
+    insertAt = insertAt == std::string::npos ? 0 : insertAt + 1;
+    while (insertAt > 0)
+    {
+        size_t previousStart = text.rfind('\n', insertAt - 2);
+        previousStart = previousStart == std::string::npos ? 0 : previousStart + 1;
+        std::string previous = text.substr(previousStart, insertAt - 1 - previousStart);
+        size_t last = previous.find_last_not_of(" \t\r");
+        if (last == std::string::npos || previous[last] == ';' || previous[last] == '}' || previous[last] == '/' ||
+            previous.find_first_not_of(" \t") == previous.find('#'))
+            break;
+        insertAt = previousStart;
+    }
+    return insertAt;
+}
+
+std::string ModelAnalyzer::formatShape(const std::vector<long> &shape)
+{
+    if (shape.empty())
+        return "scalar";
+    std::string text;
+    for (size_t i = 0; i < shape.size(); ++i)
+        text += (i ? " x " : "") + std::to_string(shape[i]);
+    return text;
+}
+
+std::string ModelAnalyzer::formatBytes(size_t bytes)
+{
+    std::ostringstream out;
+    if (bytes >= 1024 * 1024)
+        out << std::fixed << std::setprecision(2) << bytes / (1024.0 * 1024.0) << " MiB";
+    else if (bytes >= 1024)
+        out << std::fixed << std::setprecision(1) << bytes / 1024.0 << " KiB";
+    else
+        out << bytes << " B";
+    return out.str();
+}
+
+std::string ModelAnalyzer::formatSummary(const ModelProfile &profile)
+{
+    size_t parameters = 0;
+    for (const auto &weight : profile.weights)
+        parameters += weight.elements();
+
+    std::ostringstream out;
+    out << profile.layers.size() << " layers, " << parameters << " parameters (" << formatBytes(profile.weightBytes)
+        << "), " << profile.macs << " MACs, peak activations " << formatBytes(profile.peakActivationBytes)
+        << ", " << profile.numberType;
+    return out.str();
+}
+
+// Cuts text that would run into the next column of the layer table, keeping one space of separation.
+static std::string fitColumn(const std::string &text, size_t width)
+{
+    if (text.size() < width)
+        return text;
+    return text.substr(0, width - 4) + "...";
+}
+
+std::string ModelAnalyzer::formatReport(const ModelProfile &profile, double freqMHz)
+{
+    std::ostringstream out;
+    out << "Model: " << profile.folder << "\n"
+        << "Entry: " << profile.entryFunction << "(input " << formatShape(profile.inputShape) << " " << profile.inputElementType
+        << ") -> " << formatShape(profile.outputShape) << " " << profile.outputElementType << "\n"
+        << "Arithmetic: " << profile.numberType << (profile.fixedPoint ? " (fixed-point)" : " (floating-point)") << "\n\n";
+
+    out << std::left << std::setw(4) << "#" << std::setw(22) << "Layer" << std::setw(20) << "Kind"
+        << std::setw(16) << "Output" << std::right << std::setw(12) << "MACs" << std::setw(12) << "Out bytes" << "\n";
+    for (size_t i = 0; i < profile.layers.size(); ++i)
+    {
+        const auto &layer = profile.layers[i];
+        std::string kind = layer.kind + (layer.activation.empty() ? "" : " (" + layer.activation + ")");
+        out << std::left << std::setw(4) << i << std::setw(22) << fitColumn(layer.function, 22)
+            << std::setw(20) << fitColumn(kind, 20) << std::setw(16) << fitColumn(formatShape(layer.outputShape), 16)
+            << std::right << std::setw(12) << layer.macs << std::setw(12) << layer.outputBytes << "\n";
+        for (const auto &name : layer.weights)
+        {
+            const WeightArray *weight = profile.findWeight(name);
+            out << "      " << weight->name << " [" << formatShape(weight->shape) << "] " << weight->elementType
+                << ", " << formatBytes(weight->bytes()) << "\n";
+        }
+    }
+
+    double latencyUs = predictLatencyUs(profile, freqMHz);
+    out << "\nWeights: " << profile.weights.size() << " arrays, " << formatBytes(profile.weightBytes) << "\n"
+        << "MACs per inference: " << profile.macs << " (+" << profile.elementOps << " element ops)\n"
+        << "Activation memory: " << formatBytes(profile.allocatedActivationBytes) << " allocated, "
+        << formatBytes(profile.peakActivationBytes) << " peak live\n"
+        << "Predicted Cortex-A9 latency @ " << std::fixed << std::setprecision(0) << freqMHz << " MHz: "
+        << std::setprecision(1) << latencyUs << " us per inference (~" << std::setprecision(0)
+        << (latencyUs > 0 ? 1e6 / latencyUs : 0) << " inferences/s)\n";
+
+    for (const auto &warning : profile.warnings)
+        out << "Warning: " << warning << "\n";
+    return out.str();
+}
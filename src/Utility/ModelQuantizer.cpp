@@ -0,0 +1,682 @@
+/*ModelQuantizer.cpp*/
+
+#include "Utility/ModelQuantizer.hpp"
+#include "Utility/BenchmarkManager.hpp"
+#include "Utility/FileManager.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static long elementCount(const std::vector<long> &shape)
+{
+    long total = 1;
+    for (long dim : shape)
+        total *= dim;
+    return total;
+}
+
+static long constantOr(const LayerCall &layer, const std::string &name, long fallback)
+{
+    auto it = layer.constants.find(name);
+    return it != layer.constants.end() ? it->second : fallback;
+}
+
+bool ModelQuantizer::readSamples(const std::string &path, size_t inputElements, std::vector<std::vector<float>> &samples, std::string &error)
+{
+    samples.clear();
+    std::ifstream in(path);
+    if (!in)
+    {
+        error = "Cannot open calibration file " + path;
+        return false;
+    }
+
+    std::vector<std::vector<float>> lines;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        line = line.substr(0, line.find('#'));
+        for (char &c : line)
+            if (c == ',' || c == ';')
+                c = ' ';
+
+        std::istringstream words(line);
+        std::vector<float> values;
+        std::string word;
+        while (words >> word)
+        {
+            char *end = nullptr;
+            float value = std::strtof(word.c_str(), &end);
+            if (end == word.c_str() || *end != '\0')
+            {
+                error = "Calibration file contains a non-numeric value: '" + word + "'";
+                return false;
+            }
+            values.push_back(value);
+        }
+        if (!values.empty())
+            lines.push_back(std::move(values));
+    }
+
+    bool onePerLine = !lines.empty() && std::all_of(lines.begin(), lines.end(), [&](const std::vector<float> &values)
+                                                    { return values.size() == inputElements; });
+    if (onePerLine)
+    {
+        samples = std::move(lines);
+        return true;
+    }
+
+    std::vector<float> flat;
+    for (const auto &values : lines)
+        flat.insert(flat.end(), values.begin(), values.end());
+    if (flat.empty() || inputElements == 0 || flat.size() % inputElements != 0)
+    {
+        error = "Calibration file must hold a whole number of samples of " + std::to_string(inputElements) + " values (found " +
+                std::to_string(flat.size()) + ").";
+        return false;
+    }
+    for (size_t i = 0; i < flat.size(); i += inputElements)
+        samples.emplace_back(flat.begin() + i, flat.begin() + i + inputElements);
+    return true;
+}
+
+bool ModelQuantizer::parseInitializer(const WeightArray &weight, std::vector<double> &values, std::string &error)
+{
+    values.clear();
+    std::string text = FileManager::readText(weight.initializer.file);
+    if (weight.initializer.file.empty() || weight.initializer.end > text.size() || weight.initializer.begin >= weight.initializer.end)
+    {
+        error = "Cannot locate the initializer of " + weight.name;
+        return false;
+    }
+    text = text.substr(weight.initializer.begin, weight.initializer.end - weight.initializer.begin);
+
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        char c = text[pos];
+        if (c == '/' && pos + 1 < text.size() && (text[pos + 1] == '/' || text[pos + 1] == '*'))
+        {
+            size_t close = text[pos + 1] == '/' ? text.find('\n', pos) : text.find("*/", pos + 2);
+            pos = close == std::string::npos ? text.size() : close + (text[pos + 1] == '/' ? 1 : 2);
+            continue;
+        }
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '+' || c == '.')
+        {
+            char *end = nullptr;
+            double value = std::strtod(text.c_str() + pos, &end);
+            if (end == text.c_str() + pos)
+            {
+                error = "Unexpected text in the initializer of " + weight.name;
+                return false;
+            }
+            values.push_back(value);
+            pos = end - text.c_str();
+            while (pos < text.size() && (text[pos] == 'f' || text[pos] == 'F' || text[pos] == 'l' || text[pos] == 'L'))
+                ++pos;
+            continue;
+        }
+        if (c != '{' && c != '}' && c != ',' && !std::isspace(static_cast<unsigned char>(c)))
+        {
+            error = "Initializer of " + weight.name + " is not a plain list of numbers";
+            return false;
+        }
+        ++pos;
+    }
+
+    if (values.size() != weight.elements())
+    {
+        error = "Initializer of " + weight.name + " has " + std::to_string(values.size()) + " values, expected " +
+                std::to_string(weight.elements());
+        return false;
+    }
+    return true;
+}
+
+int ModelQuantizer::fracBitsFor(double maxAbs, int bits)
+{
+    double qmax = std::ldexp(1.0, bits - 1) - 1.0;
+    if (!(maxAbs > 0.0))
+        return bits - 1;
+    int frac = static_cast<int>(std::floor(std::log2(qmax / maxAbs)));
+    return std::clamp(frac, -16, 30);
+}
+
+long long ModelQuantizer::quantizeValue(double value, int fracBits, long long low, long long high)
+{
+    double scaled = std::round(std::ldexp(value, fracBits));
+    if (scaled <= static_cast<double>(low))
+        return low;
+    if (scaled >= static_cast<double>(high))
+        return high;
+    return static_cast<long long>(scaled);
+}
+
+bool ModelQuantizer::calibrate(const ModelProfile &profile, const std::string &modelFolder, const std::string &workDirectory,
+                               const std::string &samplesFile, size_t sampleCount, std::vector<double> &maxAbs, std::string &error)
+{
+    fs::path work(workDirectory);
+    fs::path instrumented = work / "calibration_model";
+    fs::path rangesFile = work / "ranges.txt";
+    fs::remove_all(instrumented);
+    fs::copy(modelFolder, instrumented, fs::copy_options::recursive);
+
+    std::ostringstream header;
+    header << "#include <stdio.h>\n"
+           << "static double rp_calibration_max[" << profile.layers.size() << "];\n"
+           << "static void rp_calibration_record(int layer, const void *data, long count)\n"
+           << "{\n"
+           << "    const float *values = (const float *)data;\n"
+           << "    for (long i = 0; i < count; i++)\n"
+           << "    {\n"
+           << "        double magnitude = values[i] < 0 ? -(double)values[i] : (double)values[i];\n"
+           << "        if (magnitude > rp_calibration_max[layer])\n"
+           << "            rp_calibration_max[layer] = magnitude;\n"
+           << "    }\n"
+           << "}\n"
+           << "__attribute__((destructor)) static void rp_calibration_dump(void)\n"
+           << "{\n"
+           << "    FILE *out = fopen(\"" << rangesFile.string() << "\", \"w\");\n"
+           << "    if (!out)\n"
+           << "        return;\n"
+           << "    for (int i = 0; i < " << profile.layers.size() << "; i++)\n"
+           << "        fprintf(out, \"%a\\n\", rp_calibration_max[i]);\n"
+           << "    fclose(out);\n"
+           << "}\n";
+    if (!FileManager::writeText(work / "rp_calibration.h", header.str()))
+    {
+        error = "Cannot write the calibration header";
+        return false;
+    }
+
+    const std::string &entryFile = profile.entryBody.file;
+    std::string text = FileManager::readText(entryFile);
+    std::vector<std::pair<size_t, std::string>> edits;
+    for (size_t i = 0; i < profile.layers.size(); ++i)
+    {
+        const auto &layer = profile.layers[i];
+        if (layer.call.file != entryFile || layer.arguments.empty())
+        {
+            error = "Cannot instrument the call to " + layer.function;
+            return false;
+        }
+        edits.push_back({layer.call.end, "\n  rp_calibration_record(" + std::to_string(i) + ", (const void *)(" + layer.arguments.back() +
+                                             "), " + std::to_string(elementCount(layer.outputShape)) + ");"});
+    }
+    edits.push_back({0, "#include \"rp_calibration.h\"\n"});
+    std::sort(edits.begin(), edits.end(), [](const auto &a, const auto &b)
+              { return a.first > b.first; });
+    for (const auto &edit : edits)
+        text.insert(edit.first, edit.second);
+
+    if (!FileManager::writeText(instrumented / fs::relative(entryFile, modelFolder), text))
+    {
+        error = "Cannot write the instrumented model";
+        return false;
+    }
+
+    std::vector<std::string> outputs;
+    if (!BenchmarkManager::collectOutputs(profile, instrumented.string(), "-O1 -I\"" + work.string() + "\"", (work / "calibration").string(),
+                                          sampleCount, outputs, error, samplesFile))
+        return false;
+
+    std::istringstream ranges(FileManager::readText(rangesFile));
+    std::string line;
+    maxAbs.clear();
+    while (std::getline(ranges, line))
+        maxAbs.push_back(std::strtod(line.c_str(), nullptr));
+    if (maxAbs.size() != profile.layers.size())
+    {
+        error = "Calibration run did not report every layer";
+        return false;
+    }
+    return true;
+}
+
+bool ModelQuantizer::planLayers(const ModelProfile &profile, const std::vector<double> &maxAbs, double inputMaxAbs, int bits,
+                                std::vector<QuantizedLayer> &layers, std::string &error)
+{
+    const long long qmax = (1LL << (bits - 1)) - 1;
+    const long long accLimit = bits == 8 ? (1LL << 30) : (1LL << 62);
+    int currentFrac = fracBitsFor(inputMaxAbs, bits);
+    std::string currentBuffer = profile.entryParameters.front();
+
+    layers.clear();
+    for (size_t i = 0; i < profile.layers.size(); ++i)
+    {
+        const LayerCall &call = profile.layers[i];
+        if (call.bufferArguments.empty() || call.bufferArguments.front() != currentBuffer)
+        {
+            error = call.function + " does not consume the previous layer's output; only sequential models can be quantized.";
+            return false;
+        }
+        currentBuffer = call.bufferArguments.back();
+
+        if (!call.activation.empty() && call.activation != "relu" && call.activation != "linear")
+        {
+            error = call.function + ": activation '" + call.activation + "' has no fixed-point form.";
+            return false;
+        }
+
+        QuantizedLayer layer;
+        layer.function = call.function;
+        layer.kind = call.kind;
+        layer.relu = call.activation == "relu";
+        layer.inputFracBits = currentFrac;
+        layer.outputFracBits = currentFrac;
+        layer.outputMaxAbs = maxAbs[i];
+        layer.inputElements = elementCount(call.inputShape);
+        layer.outputElements = elementCount(call.outputShape);
+
+        if (call.kind == "dense" || call.kind == "conv1d")
+        {
+            const WeightArray *kernel = call.bufferArguments.size() == 4 ? profile.findWeight(call.bufferArguments[1]) : nullptr;
+            const WeightArray *bias = call.bufferArguments.size() == 4 ? profile.findWeight(call.bufferArguments[2]) : nullptr;
+            if (!kernel || !bias)
+            {
+                error = call.function + ": expected (input, kernel, bias, output) arguments.";
+                return false;
+            }
+
+            std::vector<double> kernelValues, biasValues;
+            if (!parseInitializer(*kernel, kernelValues, error) || !parseInitializer(*bias, biasValues, error))
+                return false;
+
+            if (call.kind == "dense")
+            {
+                if (kernel->shape.size() != 2 || kernel->shape[1] != layer.inputElements || kernel->shape[0] != layer.outputElements)
+                {
+                    error = call.function + ": kernel shape does not match the layer.";
+                    return false;
+                }
+                layer.parameters = {kernel->shape[1], kernel->shape[0]};
+            }
+            else
+            {
+                if (kernel->shape.size() != 3 || call.inputShape.size() != 2 || call.outputShape.size() != 2)
+                {
+                    error = call.function + ": kernel shape does not match the layer.";
+                    return false;
+                }
+                long stride = constantOr(call, "CONV_STRIDE", 1);
+                long padLeft = constantOr(call, "ZEROPADDING_LEFT", 0);
+                layer.parameters = {call.inputShape[0], kernel->shape[2], kernel->shape[0], kernel->shape[1], call.outputShape[0], stride, padLeft};
+            }
+
+            double weightMax = 0.0;
+            for (double value : kernelValues)
+                weightMax = std::max(weightMax, std::fabs(value));
+            layer.weightFracBits = fracBitsFor(weightMax, bits);
+            layer.outputFracBits = fracBitsFor(maxAbs[i], bits);
+
+            for (double value : kernelValues)
+                layer.kernel.push_back(quantizeValue(value, layer.weightFracBits, -qmax - 1, qmax));
+            for (double value : biasValues)
+                layer.bias.push_back(quantizeValue(value, layer.inputFracBits + layer.weightFracBits, -accLimit, accLimit));
+        }
+        else if (call.kind == "max_pooling1d")
+        {
+            if (call.inputShape.size() != 2 || call.outputShape.size() != 2)
+            {
+                error = call.function + ": unexpected pooling shapes.";
+                return false;
+            }
+            long fallback = call.outputShape[0] > 0 ? call.inputShape[0] / call.outputShape[0] : 1;
+            long poolSize = constantOr(call, "POOL_SIZE", fallback);
+            long poolStride = constantOr(call, "POOL_STRIDE", poolSize);
+            layer.parameters = {call.outputShape[0], call.inputShape[1], poolSize, poolStride};
+        }
+        else if (call.kind == "flatten")
+        {
+            if (layer.inputElements != layer.outputElements)
+            {
+                error = call.function + ": flatten changes the element count.";
+                return false;
+            }
+        }
+        else
+        {
+            error = "Layer " + call.function + " (" + call.kind + ") has no fixed-point kernel.";
+            return false;
+        }
+
+        currentFrac = layer.outputFracBits;
+        layers.push_back(layer);
+    }
+
+    if (currentBuffer != profile.entryParameters.back())
+    {
+        error = "The last layer does not write the model output.";
+        return false;
+    }
+    return true;
+}
+
+std::string ModelQuantizer::generateModel(const ModelProfile &profile, const std::vector<QuantizedLayer> &layers, int bits, int inputFracBits)
+{
+    const bool wide = bits == 16;
+    std::ostringstream out;
+
+    long bufferElements = profile.inputElements();
+    for (const auto &layer : layers)
+        bufferElements = std::max(bufferElements, layer.outputElements);
+
+    out << "/* int" << bits << " fixed-point version of " << profile.entryFunction << "(), generated by the RedPitaya Toolbox from the float model.\n"
+        << " * Every tensor uses a power-of-two scale calibrated on sample data; see " << reportName << ". */\n\n"
+        << "#include <stdint.h>\n"
+        << "#include \"number.h\"\n"
+        << "#include \"model.h\"\n\n"
+        << "typedef int" << bits << "_t q_number_t;\n"
+        << "typedef int" << (wide ? 64 : 32) << "_t q_acc_t;\n"
+        << "#define Q_MIN (" << -(1LL << (bits - 1)) << ")\n"
+        << "#define Q_MAX " << ((1LL << (bits - 1)) - 1) << "\n"
+        << "#define Q_BUFFER_ELEMENTS " << bufferElements << "\n\n";
+
+    out << R"(static q_number_t q_requantize(q_acc_t acc, int shift, int relu)
+{
+    if (shift > 0)
+        acc = (acc + ((q_acc_t)1 << (shift - 1))) >> shift;
+    else if (shift < 0)
+        acc = acc * ((q_acc_t)1 << -shift);
+    if (relu && acc < 0)
+        acc = 0;
+    if (acc < Q_MIN)
+        acc = Q_MIN;
+    if (acc > Q_MAX)
+        acc = Q_MAX;
+    return (q_number_t)acc;
+}
+
+)";
+
+    auto uses = [&](const std::string &kind)
+    {
+        return std::any_of(layers.begin(), layers.end(), [&](const QuantizedLayer &layer)
+                           { return layer.kind == kind; });
+    };
+
+    if (uses("dense"))
+        out << R"(static void q_dense(const q_number_t *input, const q_number_t *kernel, const q_acc_t *bias, q_number_t *output,
+                    int inputs, int units, int shift, int relu)
+{
+    for (int u = 0; u < units; u++)
+    {
+        const q_number_t *row = &kernel[u * inputs];
+        q_acc_t acc = bias[u];
+        for (int i = 0; i < inputs; i++)
+            acc += (q_acc_t)row[i] * input[i];
+        output[u] = q_requantize(acc, shift, relu);
+    }
+}
+
+)";
+
+    if (uses("conv1d"))
+        out << R"(static void q_conv1d(const q_number_t *input, const q_number_t *kernel, const q_acc_t *bias, q_number_t *output,
+                     int samples, int channels, int filters, int kernel_size, int out_samples, int stride, int pad_left,
+                     int shift, int relu)
+{
+    for (int pos = 0; pos < out_samples; pos++)
+    {
+        for (int f = 0; f < filters; f++)
+        {
+            q_acc_t acc = bias[f];
+            for (int z = 0; z < kernel_size; z++)
+            {
+                int x = pos * stride - pad_left + z;
+                if (x < 0 || x >= samples)
+                    continue;
+                const q_number_t *tap = &kernel[(f * kernel_size + z) * channels];
+                const q_number_t *sample = &input[x * channels];
+                for (int c = 0; c < channels; c++)
+                    acc += (q_acc_t)tap[c] * sample[c];
+            }
+            output[pos * filters + f] = q_requantize(acc, shift, relu);
+        }
+    }
+}
+
+)";
+
+    if (uses("max_pooling1d"))
+        out << R"(static void q_max_pooling1d(const q_number_t *input, q_number_t *output, int out_samples, int channels, int pool_size, int pool_stride)
+{
+    for (int pos = 0; pos < out_samples; pos++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            q_number_t max = input[(pos * pool_stride) * channels + c];
+            for (int x = 1; x < pool_size; x++)
+            {
+                q_number_t value = input[(pos * pool_stride + x) * channels + c];
+                if (value > max)
+                    max = value;
+            }
+            output[pos * channels + c] = max;
+        }
+    }
+}
+
+)";
+
+    auto writeValues = [&](const std::vector<long long> &values)
+    {
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            if (i % 16 == 0)
+                out << "\n    ";
+            out << values[i] << (i + 1 < values.size() ? ", " : "");
+        }
+        out << "\n";
+    };
+
+    for (const auto &layer : layers)
+    {
+        if (layer.kernel.empty())
+            continue;
+        out << "/* " << layer.function << ": weights 2^-" << layer.weightFracBits << ", input 2^-" << layer.inputFracBits
+            << ", output 2^-" << layer.outputFracBits << " */\n"
+            << "static const q_number_t " << layer.function << "_kernel_q[" << layer.kernel.size() << "] = {";
+        writeValues(layer.kernel);
+        out << "};\n"
+            << "static const q_acc_t " << layer.function << "_bias_q[" << layer.bias.size() << "] = {";
+        writeValues(layer.bias);
+        out << "};\n\n";
+    }
+
+    const std::string input = profile.entryParameters.front();
+    const std::string output = profile.entryParameters.back();
+    int outputFrac = layers.empty() ? inputFracBits : layers.back().outputFracBits;
+
+    out << "void " << profile.entryFunction << "(\n"
+        << "  const " << profile.entryParameterTypes.front() << " " << input << ",\n"
+        << "  number_t " << output << "[" << profile.outputElements() << "]) {\n\n"
+        << "  /* On the stack: the threads_* versions run this on every thread at once. */\n"
+        << "  q_number_t q_buffer_a[Q_BUFFER_ELEMENTS];\n"
+        << "  q_number_t q_buffer_b[Q_BUFFER_ELEMENTS];\n"
+        << "  const number_t *values = (const number_t *)" << input << ";\n"
+        << "  q_number_t *current = q_buffer_a;\n"
+        << "  q_number_t *next = q_buffer_b;\n"
+        << "  q_number_t *swap;\n\n"
+        << "  for (int i = 0; i < " << profile.inputElements() << "; i++) {\n"
+        << "    number_t scaled = values[i] * (number_t)" << std::setprecision(17) << std::ldexp(1.0, inputFracBits) << ";\n"
+        << "    if (scaled < (number_t)Q_MIN) scaled = (number_t)Q_MIN;\n"
+        << "    if (scaled > (number_t)Q_MAX) scaled = (number_t)Q_MAX;\n"
+        << "    current[i] = (q_number_t)(scaled < 0 ? scaled - (number_t)0.5 : scaled + (number_t)0.5);\n"
+        << "  }\n\n";
+
+    for (const auto &layer : layers)
+    {
+        const auto &p = layer.parameters;
+        int shift = layer.inputFracBits + layer.weightFracBits - layer.outputFracBits;
+        if (layer.kind == "flatten")
+        {
+            out << "  /* " << layer.function << ": the buffer is already flat */\n\n";
+            continue;
+        }
+        if (layer.kind == "dense")
+            out << "  q_dense(current, " << layer.function << "_kernel_q, " << layer.function << "_bias_q, next, " << p[0] << ", " << p[1]
+                << ", " << shift << ", " << (layer.relu ? 1 : 0) << ");\n";
+        else if (layer.kind == "conv1d")
+            out << "  q_conv1d(current, " << layer.function << "_kernel_q, " << layer.function << "_bias_q, next, " << p[0] << ", " << p[1]
+                << ", " << p[2] << ", " << p[3] << ", " << p[4] << ", " << p[5] << ", " << p[6] << ", " << shift << ", "
+                << (layer.relu ? 1 : 0) << ");\n";
+        else
+            out << "  q_max_pooling1d(current, next, " << p[0] << ", " << p[1] << ", " << p[2] << ", " << p[3] << ");\n";
+        out << "  swap = current; current = next; next = swap;\n\n";
+    }
+
+    out << "  (void)next;\n"
+        << "  for (int i = 0; i < " << profile.outputElements() << "; i++)\n"
+        << "    " << output << "[i] = (number_t)current[i] * (number_t)" << std::setprecision(17) << std::ldexp(1.0, -outputFrac) << ";\n"
+        << "}\n";
+    return out.str();
+}
+
+QuantizationDrift ModelQuantizer::measureDrift(const std::vector<std::string> &reference, const std::vector<std::string> &quantized)
+{
+    QuantizationDrift drift;
+    double errorSum = 0.0;
+    size_t errorCount = 0, agreements = 0;
+    double low = 0.0, high = 0.0;
+    bool first = true;
+
+    for (size_t s = 0; s < reference.size() && s < quantized.size(); ++s)
+    {
+        std::vector<double> expected, actual;
+        if (!BenchmarkManager::parseOutputLine(reference[s], expected) || !BenchmarkManager::parseOutputLine(quantized[s], actual) ||
+            expected.size() != actual.size() || expected.empty())
+            continue;
+
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            double error = std::fabs(expected[i] - actual[i]);
+            drift.maxAbsError = std::max(drift.maxAbsError, error);
+            errorSum += error;
+            ++errorCount;
+            low = first ? expected[i] : std::min(low, expected[i]);
+            high = first ? expected[i] : std::max(high, expected[i]);
+            first = false;
+        }
+        if (std::max_element(expected.begin(), expected.end()) - expected.begin() ==
+            std::max_element(actual.begin(), actual.end()) - actual.begin())
+            ++agreements;
+        ++drift.samples;
+    }
+
+    drift.meanAbsError = errorCount ? errorSum / errorCount : 0.0;
+    drift.outputRange = high - low;
+    drift.argmaxAgreement = drift.samples ? 100.0 * agreements / drift.samples : 0.0;
+    return drift;
+}
+
+bool ModelQuantizer::quantize(const std::string &stagedModelFolder, int bits, const std::string &calibrationFile, std::string &report)
+{
+    std::string error;
+    auto fail = [&](const std::string &message)
+    {
+        report = "int" + std::to_string(bits) + " quantization skipped: " + message;
+        return false;
+    };
+
+    if (bits != 8 && bits != 16)
+        return fail("only 8 and 16 bit fixed point are supported.");
+
+    ModelProfile profile;
+    if (!ModelAnalyzer::analyze(stagedModelFolder, profile, error))
+        return fail(error);
+    if (profile.fixedPoint || profile.numberType != "float" || profile.inputElementType != "float" || profile.outputElementType != "float")
+        return fail("the model is not a float model.");
+    if (profile.entryParameters.size() != 2)
+        return fail("unexpected signature for " + profile.entryFunction + "().");
+
+    std::vector<std::vector<float>> samples;
+    if (!readSamples(calibrationFile, profile.inputElements(), samples, error))
+        return fail(error);
+
+    std::string workName = FileManager::sanitizedName(stagedModelFolder);
+    FileManager::ScratchDirectory scratch;
+    if (!scratch.create("rp_quantize" + workName + "_", error))
+        return fail(error);
+    fs::path workDir = scratch.path;
+    fs::path candidate = workDir / "model";
+
+    try
+    {
+
+        std::string samplesFile = (workDir / "samples.bin").string();
+        std::ofstream samplesOut(samplesFile, std::ios::binary);
+        double inputMaxAbs = 0.0;
+        for (const auto &sample : samples)
+        {
+            samplesOut.write(reinterpret_cast<const char *>(sample.data()), sample.size() * sizeof(float));
+            for (float value : sample)
+                inputMaxAbs = std::max(inputMaxAbs, std::fabs(static_cast<double>(value)));
+        }
+        samplesOut.close();
+
+        std::vector<double> maxAbs;
+        if (!calibrate(profile, stagedModelFolder, workDir.string(), samplesFile, samples.size(), maxAbs, error))
+            return fail(error);
+
+        std::vector<QuantizedLayer> layers;
+        if (!planLayers(profile, maxAbs, inputMaxAbs, bits, layers, error))
+            return fail(error);
+
+        int inputFrac = fracBitsFor(inputMaxAbs, bits);
+        fs::copy(stagedModelFolder, candidate, fs::copy_options::recursive);
+        fs::path relative = fs::relative(profile.entryBody.file, stagedModelFolder);
+        if (!FileManager::writeText(candidate / relative, generateModel(profile, layers, bits, inputFrac)))
+            return fail("cannot write the quantized model.");
+
+        std::vector<std::string> reference, quantized;
+        if (!BenchmarkManager::collectOutputs(profile, stagedModelFolder, "-O1", (workDir / "float").string(), samples.size(), reference,
+                                              error, samplesFile) ||
+            !BenchmarkManager::collectOutputs(profile, candidate.string(), "-O1", (workDir / "fixed").string(), samples.size(), quantized,
+                                              error, samplesFile))
+            return fail(error);
+
+        QuantizationDrift drift = measureDrift(reference, quantized);
+
+        size_t floatWeightBytes = 0, fixedWeightBytes = 0;
+        for (const auto &layer : layers)
+        {
+            floatWeightBytes += (layer.kernel.size() + layer.bias.size()) * sizeof(float);
+            fixedWeightBytes += layer.kernel.size() * (bits / 8) + layer.bias.size() * (bits == 8 ? 4 : 8);
+        }
+
+        std::ostringstream out;
+        out << "int" << bits << " quantization of " << profile.entryFunction << "() calibrated on " << samples.size() << " sample(s) from "
+            << calibrationFile << "\n\n"
+            << std::left << std::setw(20) << "Tensor" << std::right << std::setw(12) << "max |x|" << std::setw(10) << "scale" << "\n"
+            << std::left << std::setw(20) << "input" << std::right << std::setw(12) << std::setprecision(4) << inputMaxAbs
+            << std::setw(10) << ("2^-" + std::to_string(inputFrac)) << "\n";
+        for (const auto &layer : layers)
+            out << std::left << std::setw(20) << layer.function << std::right << std::setw(12) << std::setprecision(4) << layer.outputMaxAbs
+                << std::setw(10) << ("2^-" + std::to_string(layer.outputFracBits)) << "\n";
+        out << "\nWeights: " << ModelAnalyzer::formatBytes(floatWeightBytes) << " float -> " << ModelAnalyzer::formatBytes(fixedWeightBytes)
+            << " fixed point\n"
+            << "Drift against the float model on the calibration set:\n"
+            << "  max |error|:      " << std::setprecision(6) << drift.maxAbsError << "\n"
+            << "  mean |error|:     " << drift.meanAbsError << "\n"
+            << "  float output range: " << drift.outputRange << "\n";
+        if (profile.outputElements() > 1)
+            out << "  argmax agreement: " << std::fixed << std::setprecision(1) << drift.argmaxAgreement << " %\n";
+
+        fs::copy_file(candidate / relative, fs::path(stagedModelFolder) / relative, fs::copy_options::overwrite_existing);
+        FileManager::writeText(fs::path(stagedModelFolder) / reportName, out.str());
+        report = out.str();
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        return fail(e.what());
+    }
+}
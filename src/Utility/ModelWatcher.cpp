@@ -0,0 +1,161 @@
+/*ModelWatcher.cpp*/
+
+#include "Utility/ModelWatcher.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static const uint32_t watchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                  IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+ModelWatcher::~ModelWatcher()
+{
+    stop();
+}
+
+bool ModelWatcher::start(const std::string &folder, int debounceMs, const std::function<void()> &onChange, std::string &error)
+{
+    if (active)
+    {
+        error = "the previous watch of " + this->folder + " is still finishing";
+        return false;
+    }
+    stop();
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotifyFd < 0 || stopFd < 0)
+    {
+        error = std::string("inotify unavailable: ") + std::strerror(errno);
+        stop();
+        return false;
+    }
+
+    this->folder = folder;
+    this->debounceMs = debounceMs;
+    this->onChange = onChange;
+    addWatches();
+    if (watches.empty())
+    {
+        error = "cannot watch " + folder;
+        stop();
+        return false;
+    }
+
+    active = true;
+    worker = std::thread(&ModelWatcher::run, this);
+    return true;
+}
+
+void ModelWatcher::requestStop()
+{
+    uint64_t one = 1;
+    if (stopFd >= 0 && write(stopFd, &one, sizeof(one)) < 0)
+        active = false;
+}
+
+void ModelWatcher::stop()
+{
+    if (worker.joinable())
+    {
+        requestStop();
+        worker.join();
+    }
+    active = false;
+    if (inotifyFd >= 0)
+        close(inotifyFd);
+    if (stopFd >= 0)
+        close(stopFd);
+    inotifyFd = stopFd = -1;
+    watches.clear();
+}
+
+void ModelWatcher::addWatches()
+{
+    // Re-adding an existing path returns its current descriptor, so this also repairs watches lost
+    // when the generator deletes and recreates directories.
+    std::error_code ec;
+    if (!fs::is_directory(folder, ec))
+        return;
+
+    auto add = [this](const fs::path &path)
+    {
+        int wd = inotify_add_watch(inotifyFd, path.c_str(), watchMask);
+        if (wd >= 0)
+            watches[wd] = path.string();
+    };
+    add(folder);
+    for (auto it = fs::recursive_directory_iterator(folder, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+        if (it->is_directory(ec))
+            add(it->path());
+}
+
+void ModelWatcher::run()
+{
+    alignas(struct inotify_event) char buffer[16384];
+    using clock = std::chrono::steady_clock;
+    bool pending = false;
+    clock::time_point firstEvent, lastEvent;
+
+    while (true)
+    {
+        int timeout = -1;
+        if (pending)
+        {
+            auto now = clock::now();
+            auto quiet = std::chrono::duration_cast<std::chrono::milliseconds>(lastEvent + std::chrono::milliseconds(debounceMs) - now).count();
+            auto limit = std::chrono::duration_cast<std::chrono::milliseconds>(firstEvent + std::chrono::milliseconds(maxDelayMs) - now).count();
+            timeout = static_cast<int>(std::max<long long>(0, std::min(quiet, limit)));
+        }
+
+        struct pollfd fds[2] = {{stopFd, POLLIN, 0}, {inotifyFd, POLLIN, 0}};
+        int ready = poll(fds, 2, timeout);
+        if (ready < 0 && errno != EINTR)
+            break;
+        if (fds[0].revents & POLLIN)
+            break;
+
+        if (fds[1].revents & POLLIN)
+        {
+            bool structureChanged = false;
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char *p = buffer; p < buffer + length;)
+                {
+                    auto *event = reinterpret_cast<struct inotify_event *>(p);
+                    if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+                        watches.erase(event->wd);
+                    if (event->mask & IN_ISDIR)
+                        structureChanged = true;
+                    p += sizeof(struct inotify_event) + event->len;
+                }
+            }
+            if (structureChanged || watches.empty())
+                addWatches();
+
+            lastEvent = clock::now();
+            if (!pending)
+                firstEvent = lastEvent;
+            pending = true;
+            continue;
+        }
+
+        if (pending && ready == 0)
+        {
+            pending = false;
+            addWatches();
+            if (onChange)
+                onChange();
+        }
+    }
+    active = false;
+}
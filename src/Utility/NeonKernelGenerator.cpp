@@ -0,0 +1,530 @@
+/*NeonKernelGenerator.cpp*/
+
+#include "Utility/NeonKernelGenerator.hpp"
+#include "Utility/BenchmarkManager.hpp"
+#include "Utility/FileManager.hpp"
+#include "Utility/ModelQuantizer.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static long shapeProduct(const std::vector<long> &shape)
+{
+    long total = 1;
+    for (long dim : shape)
+        total *= dim;
+    return total;
+}
+
+static std::string upper(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), ::toupper);
+    return text;
+}
+
+// A float literal that converts back to exactly (float)value.
+static std::string floatLiteral(double value)
+{
+    std::ostringstream out;
+    out << std::setprecision(std::numeric_limits<float>::max_digits10) << static_cast<float>(value);
+    std::string text = out.str();
+    if (text.find_first_of(".e") == std::string::npos)
+        text += ".0";
+    return text + "f";
+}
+
+// Writes values (row-major, dims outermost first) as a nested C initializer, one innermost row per line.
+static void writeTable(std::ostream &out, const std::vector<double> &values, const std::vector<long> &dims, size_t dim = 0,
+                       size_t offset = 0, const std::string &indent = "    ")
+{
+    long stride = 1;
+    for (size_t i = dim + 1; i < dims.size(); ++i)
+        stride *= dims[i];
+    out << "{";
+    for (long i = 0; i < dims[dim]; ++i)
+    {
+        if (dim + 1 == dims.size())
+        {
+            out << (i ? ", " : "") << floatLiteral(values[offset + i]);
+            continue;
+        }
+        out << (i ? "," : "") << "\n" << indent;
+        writeTable(out, values, dims, dim + 1, offset + i * stride, indent + "    ");
+    }
+    if (dim + 1 < dims.size())
+        out << "\n" << indent.substr(4);
+    out << "}";
+}
+
+size_t NeonLayerPlan::tableBytes() const
+{
+    long columns = (units + 3) / 4 * 4;
+    long rows = kind == "dense" ? inputs : kernelSize * channels;
+    return static_cast<size_t>((rows + 1) * columns) * sizeof(float);
+}
+
+std::vector<NeonLayerPlan> NeonKernelGenerator::planLayers(const ModelProfile &profile, std::vector<std::string> &skipped)
+{
+    std::vector<NeonLayerPlan> plans;
+    std::set<std::string> seen;
+
+    for (const auto &layer : profile.layers)
+    {
+        if (layer.kind != "dense" && layer.kind != "conv1d")
+            continue;
+
+        auto skip = [&](const std::string &reason)
+        {
+            skipped.push_back(layer.function + ": " + reason);
+        };
+
+        if (seen.count(layer.function))
+        {
+            skip("called more than once");
+            continue;
+        }
+        seen.insert(layer.function);
+
+        if (layer.elementType != "float" || layer.bufferArguments.size() != 4)
+        {
+            skip("only float layers with (input, kernel, bias, output) arguments are specialized");
+            continue;
+        }
+        if (!layer.activation.empty() && layer.activation != "relu" && layer.activation != "linear")
+        {
+            skip("activation '" + layer.activation + "' has no NEON form");
+            continue;
+        }
+
+        const WeightArray *kernel = profile.findWeight(layer.bufferArguments[1]);
+        const WeightArray *bias = profile.findWeight(layer.bufferArguments[2]);
+        if (!kernel || !bias || kernel->elementType != "float" || bias->elementType != "float" || bias->shape.size() != 1)
+        {
+            skip("kernel and bias must be float weight arrays");
+            continue;
+        }
+
+        NeonLayerPlan plan;
+        plan.function = layer.function;
+        plan.kind = layer.kind;
+        plan.kernelWeight = kernel->name;
+        plan.biasWeight = bias->name;
+        plan.relu = layer.activation == "relu";
+        plan.call = layer.call;
+
+        if (layer.kind == "dense")
+        {
+            if (kernel->shape.size() != 2 || bias->shape[0] != kernel->shape[0] ||
+                shapeProduct(layer.inputShape) != kernel->shape[1] || shapeProduct(layer.outputShape) != kernel->shape[0])
+            {
+                skip("kernel " + ModelAnalyzer::formatShape(kernel->shape) + " does not match the layer shapes");
+                continue;
+            }
+            plan.units = kernel->shape[0];
+            plan.inputs = kernel->shape[1];
+        }
+        else
+        {
+            if (kernel->shape.size() != 3 || layer.inputShape.size() != 2 || layer.outputShape.size() != 2 ||
+                bias->shape[0] != kernel->shape[0] || layer.inputShape[1] != kernel->shape[2] || layer.outputShape[1] != kernel->shape[0])
+            {
+                skip("kernel " + ModelAnalyzer::formatShape(kernel->shape) + " does not match the layer shapes");
+                continue;
+            }
+            plan.units = kernel->shape[0];
+            plan.kernelSize = kernel->shape[1];
+            plan.channels = kernel->shape[2];
+            plan.samples = layer.inputShape[0];
+            plan.outputSamples = layer.outputShape[0];
+
+            // Only stride 1 without zero padding: there the scalar loop never skips a tap, so the order of the sums is fixed.
+            if (plan.outputSamples != plan.samples - plan.kernelSize + 1)
+            {
+                skip("only stride 1 without padding is specialized");
+                continue;
+            }
+        }
+
+        if (plan.call.file.empty())
+        {
+            skip("call site could not be located");
+            continue;
+        }
+
+        std::string error;
+        if (!ModelQuantizer::parseInitializer(*kernel, plan.kernelValues, error) ||
+            !ModelQuantizer::parseInitializer(*bias, plan.biasValues, error))
+        {
+            skip(error);
+            continue;
+        }
+        plans.push_back(plan);
+    }
+    return plans;
+}
+
+std::string NeonKernelGenerator::generateDense(const NeonLayerPlan &plan)
+{
+    const std::string name = plan.function;
+    const std::string prefix = upper(name) + "_NEON";
+    std::ostringstream out;
+
+    // Transposed to [input][unit], units padded with zeros to whole vectors.
+    const long columns = (plan.units + 3) / 4 * 4;
+    std::vector<double> transposed(plan.inputs * columns, 0.0), bias(columns, 0.0);
+    for (long u = 0; u < plan.units; u++)
+    {
+        for (long i = 0; i < plan.inputs; i++)
+            transposed[i * columns + u] = plan.kernelValues[u * plan.inputs + i];
+        bias[u] = plan.biasValues[u];
+    }
+
+    out << "/* " << name << ": dense " << plan.inputs << " -> " << plan.units << (plan.relu ? ", relu" : "") << " */\n"
+        << "#define " << prefix << "_INPUTS " << plan.inputs << "\n"
+        << "#define " << prefix << "_UNITS " << plan.units << "\n"
+        << "#define " << prefix << "_GROUPS ((" << prefix << "_UNITS + 3) / 4)\n\n"
+        << "static const float " << name << "_neon_kernel[" << prefix << "_INPUTS][" << prefix << "_GROUPS * 4] __attribute__((aligned(16))) = ";
+    writeTable(out, transposed, {plan.inputs, columns});
+    out << ";\n"
+        << "static const float " << name << "_neon_bias[" << prefix << "_GROUPS * 4] __attribute__((aligned(16))) = ";
+    writeTable(out, bias, {columns});
+    out << ";\n\n"
+        << "static inline void " << name << "_neon(const void *input_data, const void *kernel, const void *bias, void *output_data)\n"
+        << "{\n"
+        << "    const float *input = (const float *)input_data;\n"
+        << "    float *output = (float *)output_data;\n"
+        << "    const float32x4_t zero = vdupq_n_f32(0.0f);\n"
+        << "    (void)kernel;\n"
+        << "    (void)bias;\n\n"
+        << "    for (int g = 0; g < " << prefix << "_GROUPS; g++)\n"
+        << "    {\n"
+        << "        float32x4_t acc = zero;\n"
+        << "        for (int i = 0; i < " << prefix << "_INPUTS; i++)\n"
+        << "            acc = vaddq_f32(acc, vmulq_f32(vld1q_f32(&" << name << "_neon_kernel[i][g * 4]), vdupq_n_f32(input[i])));\n"
+        << "        acc = vaddq_f32(acc, vld1q_f32(&" << name << "_neon_bias[g * 4]));\n";
+    if (plan.relu)
+        out << "        acc = vbslq_f32(vcltq_f32(acc, zero), zero, acc);\n";
+    out << "        neon_store_lanes(&output[g * 4], acc, " << prefix << "_UNITS - g * 4);\n"
+        << "    }\n"
+        << "}\n\n";
+    return out.str();
+}
+
+std::string NeonKernelGenerator::generateConv1d(const NeonLayerPlan &plan)
+{
+    const std::string name = plan.function;
+    const std::string prefix = upper(name) + "_NEON";
+    std::ostringstream out;
+
+    // Transposed to [tap][channel][filter], filters padded with zeros to whole vectors.
+    const long columns = (plan.units + 3) / 4 * 4;
+    std::vector<double> transposed(plan.kernelSize * plan.channels * columns, 0.0), bias(columns, 0.0);
+    for (long f = 0; f < plan.units; f++)
+    {
+        for (long z = 0; z < plan.kernelSize; z++)
+            for (long x = 0; x < plan.channels; x++)
+                transposed[(z * plan.channels + x) * columns + f] = plan.kernelValues[(f * plan.kernelSize + z) * plan.channels + x];
+        bias[f] = plan.biasValues[f];
+    }
+
+    out << "/* " << name << ": conv1d " << plan.samples << "x" << plan.channels << " -> " << plan.outputSamples << "x" << plan.units
+        << ", kernel " << plan.kernelSize << (plan.relu ? ", relu" : "") << " */\n"
+        << "#define " << prefix << "_CHANNELS " << plan.channels << "\n"
+        << "#define " << prefix << "_FILTERS " << plan.units << "\n"
+        << "#define " << prefix << "_KERNEL_SIZE " << plan.kernelSize << "\n"
+        << "#define " << prefix << "_OUTSAMPLES " << plan.outputSamples << "\n"
+        << "#define " << prefix << "_GROUPS ((" << prefix << "_FILTERS + 3) / 4)\n\n"
+        << "static const float " << name << "_neon_kernel[" << prefix << "_KERNEL_SIZE][" << prefix << "_CHANNELS][" << prefix
+        << "_GROUPS * 4] __attribute__((aligned(16))) = ";
+    writeTable(out, transposed, {plan.kernelSize, plan.channels, columns});
+    out << ";\n"
+        << "static const float " << name << "_neon_bias[" << prefix << "_GROUPS * 4] __attribute__((aligned(16))) = ";
+    writeTable(out, bias, {columns});
+    out << ";\n\n"
+        << "static inline void " << name << "_neon(const void *input_data, const void *kernel, const void *bias, void *output_data)\n"
+        << "{\n"
+        << "    const float *input = (const float *)input_data;\n"
+        << "    float *output = (float *)output_data;\n"
+        << "    const float32x4_t zero = vdupq_n_f32(0.0f);\n"
+        << "    (void)kernel;\n"
+        << "    (void)bias;\n\n"
+        << "    for (int pos = 0; pos < " << prefix << "_OUTSAMPLES; pos++)\n"
+        << "    {\n"
+        << "        const float *window = &input[pos * " << prefix << "_CHANNELS];\n"
+        << "        for (int g = 0; g < " << prefix << "_GROUPS; g++)\n"
+        << "        {\n"
+        << "            float32x4_t acc = zero;\n"
+        << "            for (int z = 0; z < " << prefix << "_KERNEL_SIZE; z++)\n"
+        << "                for (int x = 0; x < " << prefix << "_CHANNELS; x++)\n"
+        << "                    acc = vaddq_f32(acc, vmulq_f32(vld1q_f32(&" << name << "_neon_kernel[z][x][g * 4]), vdupq_n_f32(window[z * "
+        << prefix << "_CHANNELS + x])));\n"
+        << "            acc = vaddq_f32(acc, vld1q_f32(&" << name << "_neon_bias[g * 4]));\n";
+    if (plan.relu)
+        out << "            acc = vbslq_f32(vcltq_f32(acc, zero), zero, acc);\n";
+    out << "            neon_store_lanes(&output[pos * " << prefix << "_FILTERS + g * 4], acc, " << prefix << "_FILTERS - g * 4);\n"
+        << "        }\n"
+        << "    }\n"
+        << "}\n\n";
+    return out.str();
+}
+
+std::string NeonKernelGenerator::generateHeader(const std::vector<NeonLayerPlan> &plans)
+{
+    std::ostringstream out;
+    out << "/* Shape-specialized NEON kernels, generated by the RedPitaya Toolbox.\n"
+        << " * Each kernel computes four output units per vector with the same accumulation order as the scalar layer,\n"
+        << " * so results are bit-exact. Without NEON (build with -mfpu=neon) the original layers are used. */\n\n"
+        << "#ifndef _NEON_KERNELS_H_\n"
+        << "#define _NEON_KERNELS_H_\n\n"
+        << "#if defined(NEON_EMULATION)\n"
+        << "#include \"neon_emulation.h\"\n"
+        << "#define NEON_KERNELS_ENABLED\n"
+        << "#elif defined(__ARM_NEON) || defined(__ARM_NEON__)\n"
+        << "#include <arm_neon.h>\n"
+        << "#define NEON_KERNELS_ENABLED\n"
+        << "#endif\n\n"
+        << "#ifdef NEON_KERNELS_ENABLED\n\n"
+        << "#include <string.h>\n\n"
+        << "static inline void neon_store_lanes(float *output, float32x4_t value, int lanes)\n"
+        << "{\n"
+        << "    if (lanes >= 4)\n"
+        << "    {\n"
+        << "        vst1q_f32(output, value);\n"
+        << "        return;\n"
+        << "    }\n"
+        << "    float tail[4] __attribute__((aligned(16)));\n"
+        << "    vst1q_f32(tail, value);\n"
+        << "    memcpy(output, tail, (size_t)lanes * sizeof(float));\n"
+        << "}\n\n";
+
+    for (const auto &plan : plans)
+        out << (plan.kind == "dense" ? generateDense(plan) : generateConv1d(plan));
+
+    out << "#else\n\n";
+    for (const auto &plan : plans)
+        out << "#define " << plan.function << "_neon " << plan.function << "\n";
+    out << "\n#endif\n\n"
+        << "#endif\n";
+    return out.str();
+}
+
+std::string NeonKernelGenerator::generateEmulationHeader()
+{
+    // Host stand-in for the few intrinsics the kernels use. ARMv7 NEON always flushes denormal
+    // inputs and results to zero, so the emulation does the same to expose any difference.
+    return R"(/* Host emulation of the NEON intrinsics used by neon_kernels.h, generated by the RedPitaya Toolbox. */
+#ifndef _NEON_EMULATION_H_
+#define _NEON_EMULATION_H_
+
+#include <math.h>
+#include <stdint.h>
+
+typedef struct { float lane[4]; } float32x4_t;
+typedef struct { uint32_t lane[4]; } uint32x4_t;
+
+static inline float neon_emulation_flush(float value)
+{
+    return fpclassify(value) == FP_SUBNORMAL ? copysignf(0.0f, value) : value;
+}
+
+static inline float32x4_t vdupq_n_f32(float value)
+{
+    float32x4_t result = {{value, value, value, value}};
+    return result;
+}
+
+static inline float32x4_t vld1q_f32(const float *data)
+{
+    float32x4_t result = {{data[0], data[1], data[2], data[3]}};
+    return result;
+}
+
+static inline void vst1q_f32(float *data, float32x4_t value)
+{
+    for (int i = 0; i < 4; i++)
+        data[i] = value.lane[i];
+}
+
+static inline float32x4_t vmulq_f32(float32x4_t a, float32x4_t b)
+{
+    float32x4_t result;
+    for (int i = 0; i < 4; i++)
+        result.lane[i] = neon_emulation_flush(neon_emulation_flush(a.lane[i]) * neon_emulation_flush(b.lane[i]));
+    return result;
+}
+
+static inline float32x4_t vaddq_f32(float32x4_t a, float32x4_t b)
+{
+    float32x4_t result;
+    for (int i = 0; i < 4; i++)
+        result.lane[i] = neon_emulation_flush(neon_emulation_flush(a.lane[i]) + neon_emulation_flush(b.lane[i]));
+    return result;
+}
+
+static inline uint32x4_t vcltq_f32(float32x4_t a, float32x4_t b)
+{
+    uint32x4_t result;
+    for (int i = 0; i < 4; i++)
+        result.lane[i] = neon_emulation_flush(a.lane[i]) < neon_emulation_flush(b.lane[i]) ? 0xffffffffu : 0u;
+    return result;
+}
+
+static inline float32x4_t vbslq_f32(uint32x4_t mask, float32x4_t a, float32x4_t b)
+{
+    float32x4_t result;
+    for (int i = 0; i < 4; i++)
+    {
+        union { float f; uint32_t u; } x = {a.lane[i]}, y = {b.lane[i]}, r;
+        r.u = (x.u & mask.lane[i]) | (y.u & ~mask.lane[i]);
+        result.lane[i] = r.f;
+    }
+    return result;
+}
+
+#endif
+)";
+}
+
+bool NeonKernelGenerator::rewriteModelSource(const ModelProfile &profile, const std::vector<NeonLayerPlan> &plans,
+                                             const std::string &sourceFolder, const std::string &targetFolder, std::string &error)
+{
+    const std::string &entryFile = profile.entryBody.file;
+    for (const auto &plan : plans)
+        if (plan.call.file != entryFile)
+        {
+            error = "the call to " + plan.function + " is not in the file defining " + profile.entryFunction + "()";
+            return false;
+        }
+
+    std::string text = FileManager::readText(entryFile);
+
+    size_t insertAt = ModelAnalyzer::entryDefinitionStart(text, profile);
+    if (insertAt == std::string::npos)
+    {
+        error = "could not locate the definition of " + profile.entryFunction + "()";
+        return false;
+    }
+
+    std::vector<std::pair<size_t, std::string>> edits;
+    for (const auto &plan : plans)
+    {
+        if (text.compare(plan.call.begin, plan.function.size(), plan.function) != 0)
+        {
+            error = "unexpected text at the call to " + plan.function;
+            return false;
+        }
+        edits.push_back({plan.call.begin + plan.function.size(), "_neon"});
+    }
+    edits.push_back({insertAt, std::string("#include \"") + headerName + "\"\n\n"});
+
+    std::sort(edits.begin(), edits.end(), [](const auto &a, const auto &b)
+              { return a.first > b.first; });
+    for (const auto &edit : edits)
+        text.insert(edit.first, edit.second);
+
+    fs::path relative = fs::relative(entryFile, sourceFolder);
+    if (!FileManager::writeText(fs::path(targetFolder) / relative, text) ||
+        !FileManager::writeText(fs::path(targetFolder) / relative.parent_path() / headerName, generateHeader(plans)))
+    {
+        error = "could not write the transformed sources";
+        return false;
+    }
+    return true;
+}
+
+bool NeonKernelGenerator::apply(const std::string &stagedModelFolder, std::string &report)
+{
+    std::string error;
+    ModelProfile profile;
+    if (!ModelAnalyzer::analyze(stagedModelFolder, profile, error))
+    {
+        report = "NEON pass skipped: " + error;
+        return false;
+    }
+
+    std::vector<std::string> skipped;
+    std::vector<NeonLayerPlan> plans = planLayers(profile, skipped);
+    std::ostringstream out;
+    for (const auto &reason : skipped)
+        out << "NEON pass: left " << reason << "\n";
+    if (plans.empty())
+    {
+        out << "NEON pass skipped: no dense or conv1d layer can be specialized.";
+        report = out.str();
+        return false;
+    }
+
+    std::string workName = FileManager::sanitizedName(stagedModelFolder);
+    FileManager::ScratchDirectory scratch;
+    if (!scratch.create("rp_neon" + workName + "_", error))
+    {
+        out << "NEON pass skipped: " << error;
+        report = out.str();
+        return false;
+    }
+    fs::path workDir = scratch.path;
+    fs::path candidate = workDir / "model";
+
+    try
+    {
+        fs::copy(stagedModelFolder, candidate, fs::copy_options::recursive);
+        if (!FileManager::writeText(workDir / "neon_emulation.h", generateEmulationHeader()) ||
+            !rewriteModelSource(profile, plans, stagedModelFolder, candidate.string(), error))
+        {
+            out << "NEON pass skipped: " << error;
+            report = out.str();
+            return false;
+        }
+
+        std::vector<std::string> reference, transformed;
+        const std::string flags = "-O2 -ffp-contract=off";
+        if (!BenchmarkManager::collectOutputs(profile, stagedModelFolder, flags, (workDir / "reference").string(),
+                                              verificationInputSets, reference, error) ||
+            !BenchmarkManager::collectOutputs(profile, candidate.string(), flags + " -DNEON_EMULATION -I\"" + workDir.string() + "\"",
+                                              (workDir / "neon").string(), verificationInputSets, transformed, error))
+        {
+            out << "NEON pass skipped: " << error;
+            report = out.str();
+            return false;
+        }
+
+        for (size_t i = 0; i < reference.size(); ++i)
+            if (reference[i] != transformed[i])
+            {
+                out << "NEON pass rejected: outputs differ from the original on input set " << i << ", shipping the scalar model.";
+                report = out.str();
+                return false;
+            }
+
+        fs::path relative = fs::relative(profile.entryBody.file, stagedModelFolder);
+        fs::copy_file(candidate / relative, fs::path(stagedModelFolder) / relative, fs::copy_options::overwrite_existing);
+        fs::copy_file(candidate / relative.parent_path() / headerName, fs::path(stagedModelFolder) / relative.parent_path() / headerName,
+                      fs::copy_options::overwrite_existing);
+    }
+    catch (const std::exception &e)
+    {
+        out << "NEON pass skipped: " << e.what();
+        report = out.str();
+        return false;
+    }
+
+    size_t tableBytes = 0;
+    out << "NEON pass: specialized";
+    for (const auto &plan : plans)
+    {
+        out << " " << plan.function;
+        tableBytes += plan.tableBytes();
+    }
+    out << ", bit-exact with the original on " << verificationInputSets << " host input sets; the transposed weights add "
+        << ModelAnalyzer::formatBytes(tableBytes) << " of const data.";
+    report = out.str();
+    return true;
+}
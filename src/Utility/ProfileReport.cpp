@@ -0,0 +1,493 @@
+/*ProfileReport.cpp*/
+
+#include "Utility/ProfileReport.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cxxabi.h>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+namespace
+{
+    // Bounds-checked little-endian reader over one frame payload.
+    struct Cursor
+    {
+        const uint8_t *p;
+        const uint8_t *end;
+        bool ok = true;
+
+        const uint8_t *take(size_t bytes)
+        {
+            if (!ok || size_t(end - p) < bytes)
+            {
+                ok = false;
+                return nullptr;
+            }
+            const uint8_t *at = p;
+            p += bytes;
+            return at;
+        }
+        uint16_t u16()
+        {
+            const uint8_t *at = take(2);
+            return at ? tp_get16(at) : 0;
+        }
+        uint32_t u32()
+        {
+            const uint8_t *at = take(4);
+            return at ? tp_get32(at) : 0;
+        }
+        uint64_t u64()
+        {
+            const uint8_t *at = take(8);
+            return at ? tp_get64(at) : 0;
+        }
+        std::string text()
+        {
+            uint16_t length = u16();
+            const uint8_t *at = take(length);
+            return at ? std::string(reinterpret_cast<const char *>(at), length) : std::string();
+        }
+    };
+
+    struct Mapping
+    {
+        uint64_t start;
+        uint64_t end;
+        uint64_t offset;
+        int module;
+    };
+
+    struct Symbol
+    {
+        uint64_t address;
+        uint64_t size;
+        std::string name;
+    };
+
+    // Function symbols of one ELF file (32 or 64-bit, little-endian), enough to name sampled addresses.
+    class ElfSymbols
+    {
+    public:
+        explicit ElfSymbols(const std::string &image) : bytes(image)
+        {
+            if (bytes.size() < 52 || bytes.compare(0, 4, "\x7f" "ELF") != 0 || bytes[5] != 1)
+                return;
+            wide = bytes[4] == 2;
+            uint16_t machine = get<uint16_t>(18);
+            uint64_t phoff = wide ? get<uint64_t>(32) : get<uint32_t>(28);
+            uint64_t shoff = wide ? get<uint64_t>(40) : get<uint32_t>(32);
+            uint16_t phentsize = get<uint16_t>(wide ? 54 : 42), phnum = get<uint16_t>(wide ? 56 : 44);
+            uint16_t shentsize = get<uint16_t>(wide ? 58 : 46), shnum = get<uint16_t>(wide ? 60 : 48);
+
+            for (uint16_t i = 0; i < phnum; ++i)
+            {
+                uint64_t ph = phoff + uint64_t(i) * phentsize;
+                if (get<uint32_t>(ph) != 1) // PT_LOAD
+                    continue;
+                Segment segment;
+                segment.offset = wide ? get<uint64_t>(ph + 8) : get<uint32_t>(ph + 4);
+                segment.vaddr = wide ? get<uint64_t>(ph + 16) : get<uint32_t>(ph + 8);
+                segment.size = wide ? get<uint64_t>(ph + 32) : get<uint32_t>(ph + 16);
+                segments.push_back(segment);
+            }
+
+            // .symtab when the binary is not stripped, else the dynamic symbols every shared object keeps.
+            for (uint32_t wanted : {2u, 11u})
+            {
+                for (uint16_t i = 0; i < shnum && symbols.empty(); ++i)
+                {
+                    uint64_t sh = shoff + uint64_t(i) * shentsize;
+                    if (get<uint32_t>(sh + 4) != wanted)
+                        continue;
+                    uint32_t link = get<uint32_t>(sh + (wide ? 40 : 24));
+                    uint64_t strtab = shoff + uint64_t(link) * shentsize;
+                    readSymbols(wide ? get<uint64_t>(sh + 24) : get<uint32_t>(sh + 16),
+                                wide ? get<uint64_t>(sh + 32) : get<uint32_t>(sh + 20),
+                                wide ? get<uint64_t>(strtab + 24) : get<uint32_t>(strtab + 16),
+                                wide ? get<uint64_t>(strtab + 32) : get<uint32_t>(strtab + 20),
+                                machine == 40 /* EM_ARM: bit 0 marks Thumb code */);
+                }
+                if (!symbols.empty())
+                    break;
+            }
+            std::sort(symbols.begin(), symbols.end(), [](const Symbol &a, const Symbol &b)
+                      { return a.address < b.address; });
+        }
+
+        // Name of the function holding the code at this file offset, or empty.
+        std::string lookup(uint64_t offset) const
+        {
+            uint64_t address = 0;
+            bool mapped = false;
+            for (const auto &segment : segments)
+                if (offset >= segment.offset && offset < segment.offset + segment.size)
+                {
+                    address = offset - segment.offset + segment.vaddr;
+                    mapped = true;
+                    break;
+                }
+            if (!mapped)
+                return "";
+            auto it = std::upper_bound(symbols.begin(), symbols.end(), address, [](uint64_t a, const Symbol &s)
+                                       { return a < s.address; });
+            if (it == symbols.begin())
+                return "";
+            --it;
+            if (it->size != 0 && address >= it->address + it->size)
+                return "";
+            return it->name;
+        }
+
+    private:
+        struct Segment
+        {
+            uint64_t offset;
+            uint64_t vaddr;
+            uint64_t size;
+        };
+
+        template <typename T>
+        T get(uint64_t offset) const
+        {
+            T value = 0;
+            if (offset + sizeof(T) <= bytes.size())
+                std::memcpy(&value, bytes.data() + offset, sizeof(T));
+            return value;
+        }
+
+        void readSymbols(uint64_t offset, uint64_t size, uint64_t strOffset, uint64_t strSize, bool thumb)
+        {
+            size_t entry = wide ? 24 : 16;
+            for (uint64_t at = offset; at + entry <= offset + size && at + entry <= bytes.size(); at += entry)
+            {
+                uint32_t name = get<uint32_t>(at);
+                uint8_t info = get<uint8_t>(at + (wide ? 4 : 12));
+                uint16_t section = get<uint16_t>(at + (wide ? 6 : 14));
+                uint64_t value = wide ? get<uint64_t>(at + 8) : get<uint32_t>(at + 4);
+                uint64_t length = wide ? get<uint64_t>(at + 16) : get<uint32_t>(at + 8);
+                if ((info & 0xf) != 2 || section == 0 || name >= strSize || strOffset + name >= bytes.size()) // STT_FUNC, defined
+                    continue;
+                if (thumb)
+                    value &= ~uint64_t(1);
+                const char *text = bytes.data() + strOffset + name;
+                symbols.push_back({value, length, std::string(text, strnlen(text, bytes.size() - strOffset - name))});
+            }
+        }
+
+        const std::string &bytes;
+        bool wide = false;
+        std::vector<Segment> segments;
+        std::vector<Symbol> symbols;
+    };
+
+    std::string demangle(const std::string &name)
+    {
+        if (name.compare(0, 2, "_Z") != 0)
+            return name;
+        int status = 0;
+        std::unique_ptr<char, void (*)(void *)> plain(abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status), std::free);
+        return status == 0 && plain ? plain.get() : name;
+    }
+
+    std::string basename(const std::string &path)
+    {
+        size_t slash = path.rfind('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    std::string hex(uint64_t value)
+    {
+        std::ostringstream out;
+        out << "0x" << std::hex << value;
+        return out.str();
+    }
+
+    std::string escapeXml(const std::string &text)
+    {
+        std::string out;
+        for (char c : text)
+        {
+            if (c == '<')
+                out += "&lt;";
+            else if (c == '>')
+                out += "&gt;";
+            else if (c == '&')
+                out += "&amp;";
+            else if (c == '"')
+                out += "&quot;";
+            else
+                out += c;
+        }
+        return out;
+    }
+
+    struct FlameNode
+    {
+        uint64_t count = 0;
+        std::map<std::string, FlameNode> children;
+    };
+
+    size_t depthOf(const FlameNode &node)
+    {
+        size_t depth = 0;
+        for (const auto &[name, child] : node.children)
+            depth = std::max(depth, depthOf(child));
+        return depth + 1;
+    }
+}
+
+bool ProfileReport::parse(const std::string &bytes, ProfileData &profile, std::string &error)
+{
+    profile = ProfileData();
+    std::map<std::pair<uint32_t, std::vector<std::pair<int, uint64_t>>>, size_t> stackIndex;
+    std::map<std::string, int> moduleIndex;
+
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(bytes.data());
+    size_t at = 0;
+    while (at + TP_FRAME_HEADER_BYTES <= bytes.size())
+    {
+        const uint8_t *frame = data + at;
+        uint16_t headerBytes = tp_get16(frame + 6);
+        uint32_t payloadBytes = tp_get32(frame + 8);
+        if (tp_get32(frame) != TP_MAGIC || headerBytes < TP_FRAME_HEADER_BYTES || headerBytes + size_t(payloadBytes) > bytes.size() - at)
+            break; // the sender was stopped while writing: keep what came before
+        at += headerBytes + size_t(payloadBytes);
+        if (frame[5] != TP_FRAME_PROFILE)
+            continue;
+
+        Cursor in{frame + headerBytes, frame + headerBytes + payloadBytes};
+        uint64_t timestampNs = tp_get64(frame + 16);
+        profile.pid = in.u32();
+        profile.frequencyHz = in.u32();
+        profile.samples += in.u32();
+        profile.lost += in.u32();
+        uint16_t mappingCount = in.u16();
+        uint16_t threadCount = in.u16();
+        uint32_t stackCount = in.u32();
+
+        std::vector<Mapping> mappings;
+        for (uint16_t i = 0; i < mappingCount && in.ok; ++i)
+        {
+            Mapping mapping;
+            mapping.start = in.u64();
+            mapping.end = in.u64();
+            mapping.offset = in.u64();
+            std::string path = in.text();
+            auto module = moduleIndex.emplace(path, int(profile.modules.size()));
+            if (module.second)
+                profile.modules.push_back(path);
+            mapping.module = module.first->second;
+            mappings.push_back(mapping);
+        }
+        for (uint16_t i = 0; i < threadCount && in.ok; ++i)
+        {
+            uint32_t tid = in.u32();
+            std::string name = in.text();
+            if (!name.empty())
+                profile.threadNames[tid] = name;
+        }
+        for (uint32_t i = 0; i < stackCount && in.ok; ++i)
+        {
+            uint32_t count = in.u32();
+            uint32_t tid = in.u32();
+            uint16_t depth = in.u16();
+            std::vector<std::pair<int, uint64_t>> key;
+            for (uint16_t d = 0; d < depth && in.ok; ++d)
+            {
+                uint64_t address = in.u64();
+                auto mapping = std::find_if(mappings.begin(), mappings.end(), [address](const Mapping &m)
+                                            { return address >= m.start && address < m.end; });
+                if (mapping == mappings.end())
+                    key.emplace_back(-1, address);
+                else
+                    key.emplace_back(mapping->module, address - mapping->start + mapping->offset);
+            }
+            auto existing = stackIndex.find({tid, key});
+            if (existing != stackIndex.end())
+            {
+                profile.stacks[existing->second].count += count;
+                continue;
+            }
+            ProfileStack stack;
+            stack.count = count;
+            stack.tid = tid;
+            for (const auto &[module, offset] : key)
+                stack.frames.push_back({module, offset});
+            stackIndex.emplace(std::make_pair(tid, std::move(key)), profile.stacks.size());
+            profile.stacks.push_back(std::move(stack));
+        }
+        if (!in.ok)
+        {
+            error = "truncated profile frame";
+            return false;
+        }
+        if (profile.frames++ == 0)
+            profile.firstNs = timestampNs;
+        profile.lastNs = timestampNs;
+    }
+
+    if (profile.frames == 0)
+    {
+        error = "no profile frames";
+        return false;
+    }
+    return true;
+}
+
+std::map<std::string, uint64_t> ProfileReport::fold(const ProfileData &profile, const std::map<std::string, std::string> &images)
+{
+    std::vector<std::unique_ptr<ElfSymbols>> symbols(profile.modules.size());
+    for (size_t i = 0; i < profile.modules.size(); ++i)
+    {
+        auto image = images.find(profile.modules[i]);
+        if (image != images.end())
+            symbols[i] = std::make_unique<ElfSymbols>(image->second);
+    }
+
+    std::map<std::string, uint64_t> folded;
+    for (const auto &stack : profile.stacks)
+    {
+        auto thread = profile.threadNames.find(stack.tid);
+        std::string line = thread != profile.threadNames.end() ? thread->second : "tid " + std::to_string(stack.tid);
+        for (size_t i = stack.frames.size(); i-- > 0;)
+        {
+            const auto &frame = stack.frames[i];
+            std::string name;
+            if (frame.module < 0)
+                name = "[unknown " + hex(frame.offset) + "]";
+            else
+            {
+                // Outer frames hold return addresses, which may already be the first byte of the next function.
+                uint64_t offset = i > 0 && frame.offset > 0 ? frame.offset - 1 : frame.offset;
+                if (symbols[frame.module])
+                    name = demangle(symbols[frame.module]->lookup(offset));
+                if (name.empty())
+                    name = basename(profile.modules[frame.module]) + "+" + hex(frame.offset);
+            }
+            std::replace(name.begin(), name.end(), ';', ':');
+            line += ";" + name;
+        }
+        folded[line] += stack.count;
+    }
+    return folded;
+}
+
+std::string ProfileReport::renderFlameGraph(const std::map<std::string, uint64_t> &folded, const std::string &title)
+{
+    FlameNode root;
+    for (const auto &[line, count] : folded)
+    {
+        FlameNode *node = &root;
+        node->count += count;
+        std::istringstream frames(line);
+        std::string name;
+        while (std::getline(frames, name, ';'))
+        {
+            node = &node->children[name];
+            node->count += count;
+        }
+    }
+
+    const double width = 1200.0, frameHeight = 16.0, top = 36.0, charWidth = 7.0;
+    size_t depth = depthOf(root);
+    double height = top + depth * frameHeight + 10.0;
+
+    std::ostringstream svg;
+    svg << std::fixed << std::setprecision(1);
+    svg << "<?xml version=\"1.0\" standalone=\"no\"?>\n"
+        << "<svg version=\"1.1\" width=\"" << width << "\" height=\"" << height << "\" xmlns=\"http://www.w3.org/2000/svg\">\n"
+        << "<rect x=\"0\" y=\"0\" width=\"100%\" height=\"100%\" fill=\"#f8f8f8\"/>\n"
+        << "<text x=\"" << width / 2 << "\" y=\"22\" text-anchor=\"middle\" font-family=\"Verdana\" font-size=\"15\">"
+        << escapeXml(title) << "</text>\n";
+    if (root.count == 0)
+    {
+        svg << "</svg>\n";
+        return svg.str();
+    }
+
+    // Callers at the bottom, callees stacked above them; widths are shares of all samples.
+    std::vector<std::tuple<const FlameNode *, std::string, double, size_t>> pending{{&root, "all", 0.0, 0}};
+    while (!pending.empty())
+    {
+        auto [node, name, x, level] = pending.back();
+        pending.pop_back();
+        double w = width * double(node->count) / double(root.count);
+        if (w < 0.3)
+            continue;
+        double y = height - 10.0 - (level + 1) * frameHeight;
+        unsigned hash = 0;
+        for (char c : name)
+            hash = hash * 31 + static_cast<unsigned char>(c);
+        int red = 205 + hash % 50, green = (hash / 50) % 200, blue = (hash / 10000) % 55;
+
+        std::ostringstream share;
+        share << std::fixed << std::setprecision(2) << 100.0 * double(node->count) / double(root.count);
+        svg << "<g><title>" << escapeXml(name) << " (" << node->count << " samples, " << share.str() << "%)</title>"
+            << "<rect x=\"" << x << "\" y=\"" << y << "\" width=\"" << w << "\" height=\"" << frameHeight - 1
+            << "\" fill=\"rgb(" << red << "," << green << "," << blue << ")\" rx=\"2\"/>";
+        size_t fits = size_t(std::max(0.0, (w - 6.0) / charWidth));
+        if (fits >= 3)
+        {
+            std::string label = name.size() <= fits ? name : name.substr(0, fits - 2) + "..";
+            svg << "<text x=\"" << x + 3 << "\" y=\"" << y + frameHeight - 5
+                << "\" font-family=\"Verdana\" font-size=\"12\">" << escapeXml(label) << "</text>";
+        }
+        svg << "</g>\n";
+
+        double childX = x;
+        for (const auto &[childName, child] : node->children)
+        {
+            pending.emplace_back(&child, childName, childX, level + 1);
+            childX += width * double(child.count) / double(root.count);
+        }
+    }
+    svg << "</svg>\n";
+    return svg.str();
+}
+
+std::string ProfileReport::formatHotFunctions(const ProfileData &profile, const std::map<std::string, uint64_t> &folded, size_t limit)
+{
+    // Self samples land on the innermost frame; total samples count each function once per stack.
+    std::map<std::string, std::pair<uint64_t, uint64_t>> functions;
+    uint64_t total = 0;
+    for (const auto &[line, count] : folded)
+    {
+        total += count;
+        std::vector<std::string> names;
+        std::istringstream frames(line);
+        std::string name;
+        std::getline(frames, name, ';'); // thread
+        while (std::getline(frames, name, ';'))
+            names.push_back(name);
+        if (names.empty())
+            continue;
+        functions[names.back()].first += count;
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+        for (const auto &unique : names)
+            functions[unique].second += count;
+    }
+
+    std::vector<std::pair<std::string, std::pair<uint64_t, uint64_t>>> sorted(functions.begin(), functions.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b)
+              { return a.second.first != b.second.first ? a.second.first > b.second.first : a.second.second > b.second.second; });
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    double seconds = double(profile.lastNs - profile.firstNs) / 1e9;
+    out << total << " samples of pid " << profile.pid << " over " << seconds << " s at " << profile.frequencyHz << " Hz per core";
+    if (profile.lost > 0)
+        out << ", " << profile.lost << " lost";
+    out << ".\n"
+        << std::right << std::setw(7) << "Self" << std::setw(8) << "Total" << "  Function\n";
+    for (size_t i = 0; i < sorted.size() && i < limit; ++i)
+    {
+        const auto &[name, counts] = sorted[i];
+        out << std::setw(6) << 100.0 * double(counts.first) / double(std::max<uint64_t>(total, 1)) << "%"
+            << std::setw(7) << 100.0 * double(counts.second) / double(std::max<uint64_t>(total, 1)) << "%  " << name << "\n";
+    }
+    return out.str();
+}
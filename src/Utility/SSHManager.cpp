@@ -304,3 +304,232 @@ bool SSHManager::execute_remote_command(const std::string &hostname,
     ssh_free(session);
     return true;
 }
+
+static std::mutex sessionPoolMutex;
+static std::map<std::string, std::vector<ssh_session>> sessionPool;
+
+ssh_session SSHManager::acquire_session(const std::string &hostname, const std::string &password, const std::string &privateKeyPath)
+{
+    {
+        std::lock_guard<std::mutex> lock(sessionPoolMutex);
+        auto &idle = sessionPool[hostname];
+        while (!idle.empty())
+        {
+            ssh_session session = idle.back();
+            idle.pop_back();
+            if (ssh_is_connected(session))
+                return session;
+
+            ssh_free(session);
+        }
+    }
+
+    ssh_session session = ssh_new();
+    if (!session)
+    {
+        std::cerr << "Failed to allocate SSH session" << std::endl;
+        return nullptr;
+    }
+
+    ssh_options_set(session, SSH_OPTIONS_HOST, hostname.c_str());
+    ssh_options_set(session, SSH_OPTIONS_USER, "root");
+
+    if (ssh_connect(session) != SSH_OK)
+    {
+        std::cerr << "SSH connection failed: " << ssh_get_error(session) << std::endl;
+        ssh_free(session);
+        return nullptr;
+    }
+
+    if (!authenticate(session, password, privateKeyPath))
+    {
+        ssh_disconnect(session);
+        ssh_free(session);
+        return nullptr;
+    }
+
+    return session;
+}
+
+void SSHManager::release_session(const std::string &hostname, ssh_session session)
+{
+    if (!session)
+        return;
+
+    if (!ssh_is_connected(session))
+    {
+        ssh_free(session);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(sessionPoolMutex);
+    sessionPool[hostname].push_back(session);
+}
+
+void SSHManager::close_pooled_sessions()
+{
+    std::lock_guard<std::mutex> lock(sessionPoolMutex);
+    for (auto &entry : sessionPool)
+    {
+        for (ssh_session session : entry.second)
+        {
+            ssh_disconnect(session);
+            ssh_free(session);
+        }
+    }
+    sessionPool.clear();
+}
+
+int SSHManager::execute_remote_command_streamed(const std::string &hostname,
+                                                const std::string &password,
+                                                const std::string &privateKeyPath,
+                                                const std::string &command,
+                                                const std::function<void(const std::string &)> &onLine)
+{
+    ssh_session session = acquire_session(hostname, password, privateKeyPath);
+    if (!session)
+        return -1;
+
+    ssh_channel channel = ssh_channel_new(session);
+    if (!channel || ssh_channel_open_session(channel) != SSH_OK)
+    {
+        std::cerr << "Failed to open channel for command execution." << std::endl;
+        ssh_channel_free(channel);
+        ssh_disconnect(session);
+        ssh_free(session);
+        return -1;
+    }
+
+    std::string merged = "(" + command + ") 2>&1";
+    if (ssh_channel_request_exec(channel, merged.c_str()) != SSH_OK)
+    {
+        std::cerr << "Failed to execute remote command: " << ssh_get_error(session) << std::endl;
+        ssh_channel_close(channel);
+        ssh_channel_free(channel);
+        release_session(hostname, session);
+        return -1;
+    }
+
+    std::string pending;
+    std::vector<char> buffer(4096);
+    int bytesRead;
+    while ((bytesRead = ssh_channel_read(channel, buffer.data(), buffer.size(), 0)) > 0)
+    {
+        pending.append(buffer.data(), bytesRead);
+
+        std::string::size_type newline;
+        while ((newline = pending.find('\n')) != std::string::npos)
+        {
+            if (onLine)
+                onLine(pending.substr(0, newline));
+            pending.erase(0, newline + 1);
+        }
+    }
+
+    if (!pending.empty() && onLine)
+        onLine(pending);
+
+    ssh_channel_send_eof(channel);
+    int exitStatus = bytesRead < 0 ? -1 : ssh_channel_get_exit_status(channel);
+
+    ssh_channel_close(channel);
+    ssh_channel_free(channel);
+    release_session(hostname, session);
+    return exitStatus;
+}
+
+bool SSHManager::read_remote_file(const std::string &hostname,
+                                  const std::string &password,
+                                  const std::string &privateKeyPath,
+                                  const std::string &remotePath,
+                                  std::string &contents)
+{
+    ssh_session session = acquire_session(hostname, password, privateKeyPath);
+    if (!session)
+        return false;
+
+    ssh_scp scp = ssh_scp_new(session, SSH_SCP_READ, remotePath.c_str());
+    if (!scp || ssh_scp_init(scp) != SSH_OK)
+    {
+        std::cerr << "Error initializing SCP read of " << remotePath << ": " << ssh_get_error(session) << std::endl;
+        if (scp)
+            ssh_scp_free(scp);
+        release_session(hostname, session);
+        return false;
+    }
+
+    if (ssh_scp_pull_request(scp) != SSH_SCP_REQUEST_NEWFILE)
+    {
+        std::cerr << "Remote file not available: " << remotePath << ": " << ssh_get_error(session) << std::endl;
+        ssh_scp_close(scp);
+        ssh_scp_free(scp);
+        release_session(hostname, session);
+        return false;
+    }
+
+    size_t size = ssh_scp_request_get_size(scp);
+    ssh_scp_accept_request(scp);
+
+    contents.assign(size, '\0');
+    size_t received = 0;
+    while (received < size)
+    {
+        int bytesRead = ssh_scp_read(scp, &contents[received], size - received);
+        if (bytesRead == SSH_ERROR || bytesRead == 0)
+        {
+            std::cerr << "Error reading remote file " << remotePath << ": " << ssh_get_error(session) << std::endl;
+            ssh_scp_close(scp);
+            ssh_scp_free(scp);
+            release_session(hostname, session);
+            return false;
+        }
+        received += bytesRead;
+    }
+
+    ssh_scp_pull_request(scp);
+    ssh_scp_close(scp);
+    ssh_scp_free(scp);
+    release_session(hostname, session);
+    return true;
+}
+
+bool SSHManager::upload_files(const std::string &hostname,
+                              const std::string &password,
+                              const std::string &privateKeyPath,
+                              const std::vector<std::pair<std::string, std::string>> &files)
+{
+    if (files.empty())
+        return true;
+
+    ssh_session session = acquire_session(hostname, password, privateKeyPath);
+    if (!session)
+        return false;
+
+    std::vector<std::string> createdDirectories;
+    for (const auto &file : files)
+    {
+        std::string remoteDir = std::filesystem::path(file.second).parent_path().string();
+        if (std::find(createdDirectories.begin(), createdDirectories.end(), remoteDir) == createdDirectories.end())
+        {
+            if (!create_remote_directory(session, remoteDir))
+            {
+                std::cerr << "Failed to create remote directory: " << remoteDir << std::endl;
+                ssh_disconnect(session);
+                ssh_free(session);
+                return false;
+            }
+            createdDirectories.push_back(remoteDir);
+        }
+
+        if (!send_file(session, file.first, file.second))
+        {
+            std::cerr << "Failed to send file: " << file.first << std::endl;
+            ssh_disconnect(session);
+            ssh_free(session);
+            return false;
+        }
+    }
+
+    release_session(hostname, session);
+    return true;
+}
@@ -10,6 +10,13 @@ SelectDialog::SelectDialog()
       cb_threads_sem("threads_sem"),
       cb_process_mutex("process_mutex"),
       cb_process_sem("process_sem"),
+      cb_neon_kernels("Generate NEON kernels for dense/conv1d layers (checked bit-exact on this PC)"),
+      cb_external_weights("Move weight tables to model_weights.bin (mapped at startup)"),
+      cb_activation_arena("Share one activation arena between layers (liveness planned)"),
+      cb_layer_probes("Record per-layer timings on the board (see Layer Timings)"),
+      labelPrecision("Model precision:"),
+      labelCalibration("Calibration samples for fixed point (one input per line):"),
+      chooserCalibration("Select a calibration sample file", Gtk::FILE_CHOOSER_ACTION_OPEN),
       buttonVersionHelp("Need help about which version to choose?")
 {
     set_resizable(true);
@@ -27,6 +34,25 @@ SelectDialog::SelectDialog()
     box.pack_start(cb_process_mutex, Gtk::PACK_SHRINK);
     box.pack_start(cb_process_sem, Gtk::PACK_SHRINK);
 
+    box.pack_start(cb_neon_kernels, Gtk::PACK_SHRINK);
+    box.pack_start(cb_external_weights, Gtk::PACK_SHRINK);
+    box.pack_start(cb_activation_arena, Gtk::PACK_SHRINK);
+    box.pack_start(cb_layer_probes, Gtk::PACK_SHRINK);
+
+    comboPrecision.append("float", "float (original model)");
+    comboPrecision.append("16", "int16 fixed point");
+    comboPrecision.append("8", "int8 fixed point");
+    comboPrecision.set_active_id("float");
+    comboPrecision.signal_changed().connect([this]()
+                                            { chooserCalibration.set_sensitive(comboPrecision.get_active_id() != "float"); });
+    chooserCalibration.set_sensitive(false);
+    labelPrecision.set_halign(Gtk::ALIGN_START);
+    labelCalibration.set_halign(Gtk::ALIGN_START);
+    box.pack_start(labelPrecision, Gtk::PACK_SHRINK);
+    box.pack_start(comboPrecision, Gtk::PACK_SHRINK);
+    box.pack_start(labelCalibration, Gtk::PACK_SHRINK);
+    box.pack_start(chooserCalibration, Gtk::PACK_SHRINK);
+
     buttonVersionHelp.signal_clicked().connect(sigc::mem_fun(*this, &SelectDialog::onVersionHelp));
     box.pack_start(buttonVersionHelp, Gtk::PACK_SHRINK);
 
@@ -53,6 +79,21 @@ std::vector<std::string> SelectDialog::get_selected_versions() const
     return selected;
 }
 
+ExportOptions SelectDialog::get_export_options() const
+{
+    ExportOptions options;
+    options.generateNeonKernels = cb_neon_kernels.get_active();
+    options.externalizeWeights = cb_external_weights.get_active();
+    options.planActivations = cb_activation_arena.get_active();
+    options.injectLayerProbes = cb_layer_probes.get_active();
+    if (comboPrecision.get_active_id() != "float")
+    {
+        options.quantizationBits = std::stoi(comboPrecision.get_active_id());
+        options.calibrationFile = chooserCalibration.get_filename();
+    }
+    return options;
+}
+
 void SelectDialog::onVersionHelp()
 {
     Gtk::MessageDialog helpDialog(*this, "Explanation of Available Versions", false, Gtk::MESSAGE_INFO);
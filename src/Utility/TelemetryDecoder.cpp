@@ -0,0 +1,572 @@
+/*TelemetryDecoder.cpp*/
+
+#include "Utility/TelemetryDecoder.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include "telemetry_pack.h"
+
+static const size_t maxUnpackedBytes = size_t(1) << 26;
+static const size_t minSampleBytes = 256;
+
+double TelemetrySample::get(uint16_t id, uint16_t instance, double fallback) const
+{
+    for (const auto &field : fields)
+        if (field.id == id && field.instance == instance)
+            return field.value;
+    return fallback;
+}
+
+bool TelemetrySample::has(uint16_t id, uint16_t instance) const
+{
+    return std::any_of(fields.begin(), fields.end(), [&](const TelemetryField &field)
+                       { return field.id == id && field.instance == instance; });
+}
+
+static double fieldValue(const uint8_t *p, uint8_t type)
+{
+    switch (type)
+    {
+    case TP_F32:
+    {
+        uint32_t bits = tp_get32(p);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    case TP_F64:
+    {
+        uint64_t bits = tp_get64(p);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    case TP_U32:
+        return tp_get32(p);
+    default:
+        return static_cast<double>(tp_get64(p));
+    }
+}
+
+// largest grows to the size of the biggest sample decoded.
+static bool decodeSamples(const uint8_t *p, const uint8_t *end, uint16_t sampleCount, TelemetryFrame &frame, size_t &largest,
+                          std::string &error)
+{
+    for (uint16_t s = 0; s < sampleCount; ++s)
+    {
+        const uint8_t *start = p;
+        if (end - p < TP_SAMPLE_HEADER_BYTES)
+        {
+            error = "truncated sample";
+            return false;
+        }
+        TelemetrySample sample;
+        sample.timestampNs = tp_get64(p);
+        sample.sequence = tp_get32(p + 8);
+        uint16_t fieldCount = tp_get16(p + 12);
+        sample.flags = tp_get16(p + 14);
+        p += TP_SAMPLE_HEADER_BYTES;
+
+        sample.fields.reserve(fieldCount);
+        for (uint16_t f = 0; f < fieldCount; ++f)
+        {
+            if (end - p < TP_FIELD_HEADER_BYTES)
+            {
+                error = "truncated field";
+                return false;
+            }
+            TelemetryField field;
+            field.id = tp_get16(p);
+            field.instance = tp_get16(p + 2);
+            field.type = p[4];
+            const uint8_t *value = p + TP_FIELD_HEADER_BYTES;
+            size_t valueBytes = tp_field_value_bytes(field.type, value, size_t(end - value));
+            if (valueBytes == 0)
+            {
+                error = "unknown or truncated field value";
+                return false;
+            }
+            if (field.type == TP_STR)
+                field.text.assign(reinterpret_cast<const char *>(value + 2), valueBytes - 2);
+            else
+                field.value = fieldValue(value, field.type);
+            p += TP_FIELD_HEADER_BYTES + valueBytes;
+            sample.fields.push_back(field);
+        }
+        largest = std::max(largest, size_t(p - start));
+        frame.samples.push_back(std::move(sample));
+    }
+    return true;
+}
+
+// Expands the blocks of a TP_FRAME_PACKED frame back into the samples they were packed from, through a
+// buffer kept across frames. It is sized for the block's sample count at the largest sample seen so far,
+// so only samples bigger than any before (e.g. threads appeared) cost a second pass, at the exact size.
+bool TelemetryDecoder::unpackBlocks(const uint8_t *p, const uint8_t *end, uint16_t blockCount, TelemetryFrame &frame, std::string &error)
+{
+    tp_pack_state state = {};
+    bool ok = true;
+    for (uint16_t b = 0; b < blockCount && ok; ++b)
+    {
+        if (end - p < TP_PACK_BLOCK_HEADER_BYTES)
+        {
+            error = "truncated packed block";
+            ok = false;
+            break;
+        }
+        size_t bound = size_t(tp_get16(p + 4)) * std::max(minSampleBytes, largestSample);
+        tp_writer writer;
+        size_t used = 0;
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            if (bound > maxUnpackedBytes)
+                break;
+            if (unpacked.size() < bound)
+                unpacked.resize(bound);
+            tp_writer_init(&writer, unpacked.data(), unpacked.size());
+            used = tp_unpack_block(&state, p, size_t(end - p), &writer);
+            if (used == 0 || !writer.overflow)
+                break;
+            bound = writer.length + writer.missing;
+        }
+        if (bound > maxUnpackedBytes)
+        {
+            error = "packed block too large";
+            ok = false;
+        }
+        else if (used == 0 || writer.overflow)
+        {
+            error = "malformed packed block";
+            ok = false;
+        }
+        else
+            ok = decodeSamples(unpacked.data(), unpacked.data() + writer.length, writer.samples, frame, largestSample, error);
+        p += used;
+    }
+    tp_pack_state_free(&state);
+    return ok;
+}
+
+bool TelemetryDecoder::decodeFrame(const uint8_t *data, size_t length, TelemetryFrame &frame, std::string &error)
+{
+    if (length < TP_FRAME_HEADER_BYTES || tp_get32(data) != TP_MAGIC)
+    {
+        error = "not a telemetry frame";
+        return false;
+    }
+    uint16_t headerBytes = tp_get16(data + 6);
+    uint32_t payloadBytes = tp_get32(data + 8);
+    if (headerBytes < TP_FRAME_HEADER_BYTES || size_t(headerBytes) + payloadBytes != length)
+    {
+        error = "inconsistent frame length";
+        return false;
+    }
+
+    frame = TelemetryFrame();
+    frame.version = data[4];
+    frame.type = data[5];
+    frame.sequence = tp_get32(data + 12);
+    frame.timestampNs = tp_get64(data + 16);
+    uint16_t sampleCount = tp_get16(data + 24);
+
+    const uint8_t *p = data + headerBytes;
+    const uint8_t *end = data + length;
+    if (frame.type == TP_FRAME_PACKED)
+    {
+        // Handed on as the plain samples they carry; sample_count counts blocks here.
+        frame.type = TP_FRAME_SAMPLES;
+        return unpackBlocks(p, end, sampleCount, frame, error);
+    }
+    return decodeSamples(p, end, sampleCount, frame, largestSample, error);
+}
+
+bool TelemetryDecoder::parseTextLine(const std::string &line, TelemetryFrame &frame)
+{
+    frame = TelemetryFrame();
+    frame.version = 0;
+
+    unsigned interval = 0;
+    if (std::sscanf(line.c_str(), "INTERVAL_US:%u", &interval) == 1)
+    {
+        frame.type = TP_FRAME_HELLO;
+        TelemetrySample sample;
+        sample.fields.push_back({TP_INTERVAL_US, 0, TP_U32, double(interval)});
+        frame.samples.push_back(sample);
+        return true;
+    }
+
+    float cpu, cpu0, cpu1, ram, freq0, freq1, temp;
+    unsigned long usedMb, totalMb;
+    if (std::sscanf(line.c_str(), "CPU:%f%%, CPU0:%f%%, CPU1:%f%%, RAM:%f%% (%lu/%lu MB), FREQ0:%fMHz, FREQ1:%fMHz, Temp:%f",
+                    &cpu, &cpu0, &cpu1, &ram, &usedMb, &totalMb, &freq0, &freq1, &temp) != 9)
+        return false;
+
+    frame.type = TP_FRAME_SAMPLES;
+    TelemetrySample sample;
+    sample.fields = {{TP_CPU_PERCENT, 0, TP_F32, cpu},
+                     {TP_CORE_PERCENT, 0, TP_F32, cpu0},
+                     {TP_CORE_PERCENT, 1, TP_F32, cpu1},
+                     {TP_RAM_PERCENT, 0, TP_F32, ram},
+                     {TP_RAM_USED_KB, 0, TP_U32, double(usedMb * 1024)},
+                     {TP_RAM_TOTAL_KB, 0, TP_U32, double(totalMb * 1024)},
+                     {TP_FREQ_MHZ, 0, TP_F32, freq0},
+                     {TP_FREQ_MHZ, 1, TP_F32, freq1},
+                     {TP_TEMP_C, 0, TP_F32, temp}};
+    frame.samples.push_back(sample);
+    return true;
+}
+
+void TelemetryDecoder::feed(const uint8_t *data, size_t length, std::vector<TelemetryFrame> &frames)
+{
+    pending.insert(pending.end(), data, data + length);
+
+    if (mode == Format::Unknown && pending.size() >= 4)
+        mode = tp_get32(pending.data()) == TP_MAGIC ? Format::Binary : Format::Text;
+
+    if (mode == Format::Binary)
+        decodeBinary(frames);
+    else if (mode == Format::Text)
+        decodeText(frames);
+}
+
+void TelemetryDecoder::decodeBinary(std::vector<TelemetryFrame> &frames)
+{
+    size_t offset = 0;
+    while (pending.size() - offset >= TP_FRAME_HEADER_BYTES)
+    {
+        const uint8_t *p = pending.data() + offset;
+        uint16_t headerBytes = tp_get16(p + 6);
+        uint32_t payloadBytes = tp_get32(p + 8);
+        if (tp_get32(p) != TP_MAGIC || headerBytes < TP_FRAME_HEADER_BYTES ||
+            size_t(headerBytes) + payloadBytes > TP_MAX_FRAME_BYTES)
+        {
+            // Lost sync: skip to the next occurrence of the magic.
+            ++offset;
+            ++dropped;
+            continue;
+        }
+        size_t frameBytes = size_t(headerBytes) + payloadBytes;
+        if (pending.size() - offset < frameBytes)
+            break;
+
+        TelemetryFrame frame;
+        std::string error;
+        if (decodeFrame(p, frameBytes, frame, error))
+        {
+            if (frame.type == TP_FRAME_HELLO || frame.type == TP_FRAME_SAMPLES)
+            {
+                track(frame);
+                frames.push_back(std::move(frame));
+            }
+        }
+        else
+            dropped += frameBytes;
+        offset += frameBytes;
+    }
+    pending.erase(pending.begin(), pending.begin() + offset);
+}
+
+void TelemetryDecoder::decodeText(std::vector<TelemetryFrame> &frames)
+{
+    size_t start = 0;
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        if (pending[i] != '\n')
+            continue;
+        std::string line(pending.begin() + start, pending.begin() + i);
+        TelemetryFrame frame;
+        if (parseTextLine(line, frame))
+        {
+            if (frame.type == TP_FRAME_SAMPLES)
+                frame.sequence = frame.samples[0].sequence = textSequence++;
+            frames.push_back(std::move(frame));
+        }
+        else
+            dropped += line.size() + 1;
+        start = i + 1;
+    }
+    pending.erase(pending.begin(), pending.begin() + start);
+}
+
+void TelemetryDecoder::track(const TelemetryFrame &frame)
+{
+    if (frame.type == TP_FRAME_HELLO)
+    {
+        // A sender that reconnects names the first sample it still holds; anything between is lost.
+        const TelemetrySample *hello = frame.samples.empty() ? nullptr : &frame.samples[0];
+        if (!hello || !hello->has(TP_SEQUENCE_START))
+        {
+            sequenceKnown = false;
+            return;
+        }
+        uint32_t start = static_cast<uint32_t>(hello->get(TP_SEQUENCE_START));
+        if (sequenceKnown && static_cast<int32_t>(start - nextSequence) > 0)
+            lost += start - nextSequence;
+        nextSequence = start;
+        sequenceKnown = true;
+        return;
+    }
+    for (const auto &sample : frame.samples)
+    {
+        if (sequenceKnown && static_cast<int32_t>(sample.sequence - nextSequence) > 0)
+            lost += sample.sequence - nextSequence;
+        nextSequence = sample.sequence + 1;
+        sequenceKnown = true;
+    }
+}
+
+void TelemetryDecoder::reconnect()
+{
+    pending.clear();
+    mode = Format::Unknown;
+}
+
+void TelemetryDecoder::reset()
+{
+    pending.clear();
+    mode = Format::Unknown;
+    dropped = lost = 0;
+    textSequence = nextSequence = 0;
+    sequenceKnown = false;
+}
+
+const char *TelemetryDecoder::fieldName(uint16_t id)
+{
+    switch (id)
+    {
+    case TP_INTERVAL_US:
+        return "interval_us";
+    case TP_CPU_PERCENT:
+        return "cpu_percent";
+    case TP_CORE_PERCENT:
+        return "core_percent";
+    case TP_RAM_PERCENT:
+        return "ram_percent";
+    case TP_RAM_USED_KB:
+        return "ram_used_kb";
+    case TP_RAM_TOTAL_KB:
+        return "ram_total_kb";
+    case TP_FREQ_MHZ:
+        return "freq_mhz";
+    case TP_TEMP_C:
+        return "temp_c";
+    case TP_FLUSH_US:
+        return "flush_us";
+    case TP_MISSED_DEADLINES:
+        return "missed_deadlines";
+    case TP_SEQUENCE_START:
+        return "sequence_start";
+    case TP_BOARD_NAME:
+        return "board_name";
+    case TP_PROC_PID:
+        return "proc_pid";
+    case TP_PROC_THREADS:
+        return "proc_threads";
+    case TP_PROC_CPU_PERCENT:
+        return "proc_cpu_percent";
+    case TP_PROC_RSS_KB:
+        return "proc_rss_kb";
+    case TP_THREAD_TID:
+        return "thread_tid";
+    case TP_THREAD_NAME:
+        return "thread_name";
+    case TP_THREAD_CPU_PERCENT:
+        return "thread_cpu_percent";
+    case TP_THREAD_WAIT_PERCENT:
+        return "thread_wait_percent";
+    case TP_THREAD_VOLUNTARY_CS:
+        return "thread_voluntary_cs";
+    case TP_THREAD_INVOLUNTARY_CS:
+        return "thread_involuntary_cs";
+    case TP_STAGE_NAME:
+        return "stage_name";
+    case TP_STAGE_DEPTH:
+        return "stage_depth";
+    case TP_STAGE_DEPTH_MAX:
+        return "stage_depth_max";
+    case TP_STAGE_CAPACITY:
+        return "stage_capacity";
+    case TP_STAGE_DROPS:
+        return "stage_drops";
+    case TP_STAGE_ITEMS_PER_S:
+        return "stage_items_per_s";
+    case TP_STAGE_LATENCY_MEAN_US:
+        return "stage_latency_mean_us";
+    case TP_STAGE_LATENCY_P50_US:
+        return "stage_latency_p50_us";
+    case TP_STAGE_LATENCY_P99_US:
+        return "stage_latency_p99_us";
+    case TP_PERF_CYCLES:
+        return "perf_cycles";
+    case TP_PERF_IPC:
+        return "perf_ipc";
+    case TP_PERF_L1D_MPKI:
+        return "perf_l1d_mpki";
+    case TP_PERF_L2_MPKI:
+        return "perf_l2_mpki";
+    case TP_PERF_BRANCH_MPKI:
+        return "perf_branch_mpki";
+    case TP_NET_IFACE:
+        return "net_iface";
+    case TP_NET_RX_BYTES_PER_S:
+        return "net_rx_bytes_per_s";
+    case TP_NET_TX_BYTES_PER_S:
+        return "net_tx_bytes_per_s";
+    case TP_NET_RX_PACKETS_PER_S:
+        return "net_rx_packets_per_s";
+    case TP_NET_TX_PACKETS_PER_S:
+        return "net_tx_packets_per_s";
+    case TP_NET_RX_DROPS_PER_S:
+        return "net_rx_drops_per_s";
+    case TP_NET_TX_DROPS_PER_S:
+        return "net_tx_drops_per_s";
+    case TP_DISK_NAME:
+        return "disk_name";
+    case TP_DISK_READS_PER_S:
+        return "disk_reads_per_s";
+    case TP_DISK_WRITES_PER_S:
+        return "disk_writes_per_s";
+    case TP_DISK_READ_BYTES_PER_S:
+        return "disk_read_bytes_per_s";
+    case TP_DISK_WRITE_BYTES_PER_S:
+        return "disk_write_bytes_per_s";
+    case TP_DISK_AWAIT_MS:
+        return "disk_await_ms";
+    case TP_DISK_BUSY_PERCENT:
+        return "disk_busy_percent";
+    case TP_DISK_QUEUE_DEPTH:
+        return "disk_queue_depth";
+    case TP_XADC_SCANS_PER_S:
+        return "xadc_scans_per_s";
+    case TP_XADC_TEMP_MIN_C:
+        return "xadc_temp_min_c";
+    case TP_XADC_TEMP_MAX_C:
+        return "xadc_temp_max_c";
+    case TP_XADC_VOLTAGE_V:
+        return "xadc_voltage_v";
+    case TP_XADC_VOLTAGE_MIN_V:
+        return "xadc_voltage_min_v";
+    case TP_XADC_VOLTAGE_MAX_V:
+        return "xadc_voltage_max_v";
+    default:
+        return "unknown";
+    }
+}
+
+namespace
+{
+    // Consecutive field ids shown as one table. label names an instance's row (a TP_STR field), else the rows
+    // are names[instance] or rowPrefix followed by the instance.
+    struct DetailTable
+    {
+        const char *title;
+        uint16_t first;
+        uint16_t last;
+        uint16_t label;
+        const char *rowPrefix;
+        std::vector<const char *> names;
+    };
+
+    const std::vector<DetailTable> &detailTables()
+    {
+        static const std::vector<DetailTable> tables = {
+            {"Process", TP_PROC_PID, TP_PROC_RSS_KB, 0, "", {}},
+            {"Threads", TP_THREAD_TID, TP_THREAD_INVOLUNTARY_CS, TP_THREAD_NAME, "thread ", {}},
+            {"Pipeline stages", TP_STAGE_NAME, TP_STAGE_LATENCY_P99_US, TP_STAGE_NAME, "stage ", {}},
+            {"Hardware counters", TP_PERF_CYCLES, TP_PERF_BRANCH_MPKI, 0, "core ", {}},
+            {"Network", TP_NET_IFACE, TP_NET_TX_DROPS_PER_S, TP_NET_IFACE, "interface ", {}},
+            {"Disks", TP_DISK_NAME, TP_DISK_QUEUE_DEPTH, TP_DISK_NAME, "disk ", {}},
+            {"XADC", TP_XADC_SCANS_PER_S, TP_XADC_TEMP_MAX_C, 0, "", {}},
+            {"XADC rails", TP_XADC_VOLTAGE_V, TP_XADC_VOLTAGE_MAX_V, 0, "rail ", {"vccint", "vccaux"}},
+        };
+        return tables;
+    }
+
+    // The field name without the table's common prefix (thread_cpu_percent -> cpu_percent).
+    std::string columnName(uint16_t id)
+    {
+        std::string name = TelemetryDecoder::fieldName(id);
+        size_t underscore = name.find('_');
+        return underscore == std::string::npos ? name : name.substr(underscore + 1);
+    }
+
+    std::string formatValue(const TelemetryField &field)
+    {
+        if (field.type == TP_STR)
+            return field.text;
+        char text[32];
+        if (field.type == TP_U32 || field.type == TP_U64)
+            std::snprintf(text, sizeof(text), "%.0f", field.value);
+        else
+            std::snprintf(text, sizeof(text), "%.2f", field.value);
+        return text;
+    }
+}
+
+std::string TelemetryDecoder::formatDetails(const TelemetrySample &sample)
+{
+    std::ostringstream out;
+    for (const auto &table : detailTables())
+    {
+        // Columns in id order and rows in the sample's instance order, each only when the sample has them.
+        std::vector<uint16_t> columns, instances;
+        for (uint16_t id = table.first; id <= table.last; ++id)
+            if (id != table.label && std::any_of(sample.fields.begin(), sample.fields.end(), [&](const TelemetryField &field)
+                                                 { return field.id == id; }))
+                columns.push_back(id);
+        for (const auto &field : sample.fields)
+            if (field.id >= table.first && field.id <= table.last &&
+                std::find(instances.begin(), instances.end(), field.instance) == instances.end())
+                instances.push_back(field.instance);
+        if (columns.empty())
+            continue;
+
+        std::vector<std::vector<std::string>> rows(1);
+        rows[0].push_back(table.label ? columnName(table.label) : "");
+        for (uint16_t id : columns)
+            rows[0].push_back(columnName(id));
+        for (uint16_t instance : instances)
+        {
+            std::vector<std::string> row;
+            auto find = [&](uint16_t id) -> const TelemetryField *
+            {
+                for (const auto &field : sample.fields)
+                    if (field.id == id && field.instance == instance)
+                        return &field;
+                return nullptr;
+            };
+            const TelemetryField *label = table.label ? find(table.label) : nullptr;
+            if (label)
+                row.push_back(label->text);
+            else if (instance < table.names.size())
+                row.push_back(table.names[instance]);
+            else
+                row.push_back(instances.size() > 1 || *table.rowPrefix ? table.rowPrefix + std::to_string(instance) : "");
+            for (uint16_t id : columns)
+            {
+                const TelemetryField *field = find(id);
+                row.push_back(field ? formatValue(*field) : "-");
+            }
+            rows.push_back(row);
+        }
+
+        std::vector<size_t> widths(rows[0].size(), 0);
+        for (const auto &row : rows)
+            for (size_t c = 0; c < row.size(); ++c)
+                widths[c] = std::max(widths[c], row[c].size());
+
+        out << (out.tellp() > 0 ? "\n" : "") << table.title << "\n";
+        // Names left-aligned, values right-aligned; a table of one unnamed row has no name column.
+        for (const auto &row : rows)
+        {
+            std::string line;
+            if (widths[0] > 0)
+                line = "  " + row[0] + std::string(widths[0] - row[0].size(), ' ');
+            for (size_t c = 1; c < row.size(); ++c)
+                line += "  " + std::string(widths[c] - row[c].size(), ' ') + row[c];
+            out << line << "\n";
+        }
+    }
+    return out.str();
+}
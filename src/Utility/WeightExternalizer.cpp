@@ -0,0 +1,318 @@
+/*WeightExternalizer.cpp*/
+
+#include "Utility/WeightExternalizer.hpp"
+#include "Utility/BenchmarkManager.hpp"
+#include "Utility/FileManager.hpp"
+#include "Utility/ModelQuantizer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static void appendLittleEndian(std::string &bytes, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        bytes.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+static size_t sourceBytes(const fs::path &folder)
+{
+    size_t total = 0;
+    for (const auto &entry : fs::recursive_directory_iterator(folder))
+    {
+        std::string extension = entry.path().extension().string();
+        if (entry.is_regular_file() && (extension == ".c" || extension == ".h"))
+            total += entry.file_size();
+    }
+    return total;
+}
+
+uint64_t WeightExternalizer::layoutHash(const std::vector<ExternalWeight> &weights)
+{
+    // FNV-1a over the table layout: a blob is accepted by any model.c built for the same layout.
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](const std::string &text)
+    {
+        for (unsigned char c : text)
+        {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+    };
+    for (const auto &weight : weights)
+        mix(weight.name + ":" + weight.elementType + ":" + std::to_string(weight.offset) + ":" + std::to_string(weight.bytes) + ";");
+    return hash;
+}
+
+bool WeightExternalizer::encodeArray(const WeightArray &weight, const std::vector<double> &values, std::string &bytes, std::string &error)
+{
+    bytes.clear();
+    bytes.reserve(values.size() * weight.elementSize);
+    const std::string &type = weight.elementType;
+
+    for (double value : values)
+    {
+        if (type == "float")
+        {
+            float f = static_cast<float>(value);
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            appendLittleEndian(bytes, bits, 4);
+        }
+        else if (type == "double")
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            appendLittleEndian(bytes, bits, 8);
+        }
+        else if (ModelAnalyzer::isIntegerType(type))
+            appendLittleEndian(bytes, static_cast<uint64_t>(static_cast<long long>(value)), weight.elementSize);
+        else
+        {
+            error = weight.name + " has unsupported element type " + type;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string WeightExternalizer::accessMacro(const ExternalWeight &weight)
+{
+    std::string dims;
+    for (long dim : weight.shape)
+        dims += "[" + std::to_string(dim) + "]";
+    return "#define " + weight.name + " (*(const " + weight.elementType + " (*)" + dims + ")(model_weights_base + " +
+           std::to_string(weight.offset) + "))";
+}
+
+std::string WeightExternalizer::generateLoader(const std::vector<ExternalWeight> &weights, size_t totalBytes, uint64_t layout)
+{
+    std::ostringstream out;
+    out << "/* Weight tables are read from " << blobName << " (generated by the RedPitaya Toolbox), mapped read-only at startup.\n"
+        << " * Layout:\n";
+    for (const auto &weight : weights)
+        out << " *   " << std::left << std::setw(28) << weight.name << " offset " << std::setw(10) << weight.offset << weight.bytes << " bytes\n";
+    out << " * A retrained model with the same layout only needs a new " << blobName << ". */\n"
+        << "#ifndef _GNU_SOURCE\n"
+        << "#define _GNU_SOURCE\n"
+        << "#endif\n"
+        << "#include <fcntl.h>\n"
+        << "#include <stdint.h>\n"
+        << "#include <stdio.h>\n"
+        << "#include <stdlib.h>\n"
+        << "#include <string.h>\n"
+        << "#include <sys/mman.h>\n"
+        << "#include <sys/stat.h>\n"
+        << "#include <unistd.h>\n\n"
+        << "#define MODEL_WEIGHTS_FILE \"" << blobName << "\"\n"
+        << "#define MODEL_WEIGHTS_BYTES " << totalBytes << "ull\n"
+        << "#define MODEL_WEIGHTS_LAYOUT 0x" << std::hex << layout << std::dec << "ull\n"
+        << "#define MODEL_WEIGHTS_VERSION " << blobVersion << "u\n\n";
+
+    out << R"(struct model_weights_header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t layout;
+    uint64_t bytes;
+};
+
+static const unsigned char *model_weights_base;
+
+static int model_weights_map(const char *path)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size != MODEL_WEIGHTS_BYTES)
+    {
+        close(fd);
+        return 0;
+    }
+
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    void *base = mmap(NULL, (size_t)MODEL_WEIGHTS_BYTES, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return 0;
+
+    const struct model_weights_header *header = (const struct model_weights_header *)base;
+    if (memcmp(header->magic, "RPWB", 4) != 0 || header->version != MODEL_WEIGHTS_VERSION ||
+        header->layout != MODEL_WEIGHTS_LAYOUT || header->bytes != MODEL_WEIGHTS_BYTES)
+    {
+        munmap(base, (size_t)MODEL_WEIGHTS_BYTES);
+        return 0;
+    }
+    model_weights_base = (const unsigned char *)base;
+    return 1;
+}
+
+/* Runs before other constructors, which may already read the tables. Search order: $MODEL_WEIGHTS_PATH,
+ * MODEL_WEIGHTS_DEFAULT_PATH if defined at build time, ./model/, ./, then the same two next to the executable. */
+__attribute__((constructor(101))) static void model_weights_load(void)
+{
+    const char *env = getenv("MODEL_WEIGHTS_PATH");
+    if (env && model_weights_map(env))
+        return;
+#ifdef MODEL_WEIGHTS_DEFAULT_PATH
+    if (model_weights_map(MODEL_WEIGHTS_DEFAULT_PATH))
+        return;
+#endif
+    if (model_weights_map("model/" MODEL_WEIGHTS_FILE) || model_weights_map(MODEL_WEIGHTS_FILE))
+        return;
+
+    char path[4096];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length > 0)
+    {
+        path[length] = '\0';
+        char *slash = strrchr(path, '/');
+        if (slash && (size_t)(slash - path) + 32 < sizeof(path))
+        {
+            strcpy(slash + 1, "model/" MODEL_WEIGHTS_FILE);
+            if (model_weights_map(path))
+                return;
+            strcpy(slash + 1, MODEL_WEIGHTS_FILE);
+            if (model_weights_map(path))
+                return;
+        }
+    }
+
+    fprintf(stderr, "model: cannot map a matching %s (set MODEL_WEIGHTS_PATH)\n", MODEL_WEIGHTS_FILE);
+    abort();
+}
+
+)";
+    return out.str();
+}
+
+bool WeightExternalizer::apply(const std::string &stagedModelFolder, std::string &report)
+{
+    std::string error;
+    auto fail = [&](const std::string &message)
+    {
+        report = "Weight externalization skipped: " + message;
+        return false;
+    };
+
+    ModelProfile profile;
+    if (!ModelAnalyzer::analyze(stagedModelFolder, profile, error))
+        return fail(error);
+
+    std::vector<ExternalWeight> weights;
+    std::string blob(alignment, '\0');
+    for (const auto &weight : profile.weights)
+    {
+        if (!weight.isConst || weight.definition.file.empty())
+            continue;
+
+        std::vector<double> values;
+        std::string bytes;
+        if (!ModelQuantizer::parseInitializer(weight, values, error) || !encodeArray(weight, values, bytes, error))
+            return fail(error);
+
+        ExternalWeight external;
+        external.name = weight.name;
+        external.elementType = weight.elementType;
+        external.shape = weight.shape;
+        external.offset = blob.size();
+        external.bytes = bytes.size();
+        external.definition = weight.definition;
+        weights.push_back(external);
+
+        blob += bytes;
+        blob.resize((blob.size() + alignment - 1) / alignment * alignment, '\0');
+    }
+    if (weights.empty())
+        return fail("the model has no constant weight tables.");
+
+    uint64_t layout = layoutHash(weights);
+    std::string header;
+    header.append("RPWB", 4);
+    appendLittleEndian(header, blobVersion, 4);
+    appendLittleEndian(header, weights.size(), 4);
+    appendLittleEndian(header, 0, 4);
+    appendLittleEndian(header, layout, 8);
+    appendLittleEndian(header, blob.size(), 8);
+    blob.replace(0, header.size(), header);
+
+    std::string workName = FileManager::sanitizedName(stagedModelFolder);
+    FileManager::ScratchDirectory scratch;
+    if (!scratch.create("rp_weights" + workName + "_", error))
+        return fail(error);
+    fs::path workDir = scratch.path;
+    fs::path candidate = workDir / "model";
+
+    try
+    {
+        fs::copy(stagedModelFolder, candidate, fs::copy_options::recursive);
+
+        std::map<std::string, std::vector<const ExternalWeight *>> byFile;
+        for (const auto &weight : weights)
+            byFile[weight.definition.file].push_back(&weight);
+
+        std::vector<fs::path> rewritten;
+        for (auto &entry : byFile)
+        {
+            std::string text = FileManager::readText(entry.first);
+            std::sort(entry.second.begin(), entry.second.end(), [](const ExternalWeight *a, const ExternalWeight *b)
+                      { return a->definition.begin > b->definition.begin; });
+            for (const ExternalWeight *weight : entry.second)
+                text.replace(weight->definition.begin, weight->definition.end - weight->definition.begin, "\n" + accessMacro(*weight) + "\n");
+
+            fs::path relative = fs::relative(entry.first, stagedModelFolder);
+            rewritten.push_back(relative);
+            if (!FileManager::writeText(candidate / relative, text))
+                return fail("cannot write " + relative.string());
+        }
+
+        fs::path modelC = candidate / "model.c";
+        if (!FileManager::writeText(modelC, generateLoader(weights, blob.size(), layout) + FileManager::readText(modelC)) || !FileManager::writeText(candidate / blobName, blob))
+            return fail("cannot write the loader or " + std::string(blobName));
+        rewritten.push_back("model.c");
+
+        auto timed = [&](const std::string &folder, const std::string &flags, const std::string &name, std::vector<std::string> &outputs, double &seconds)
+        {
+            auto start = std::chrono::steady_clock::now();
+            bool ok = BenchmarkManager::collectOutputs(profile, folder, flags, (workDir / name).string(), 16, outputs, error);
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return ok;
+        };
+
+        std::vector<std::string> reference, externalized;
+        double referenceSeconds = 0.0, externalizedSeconds = 0.0;
+        if (!timed(stagedModelFolder, "-O2", "inline", reference, referenceSeconds) ||
+            !timed(candidate.string(), "-O2", "external", externalized, externalizedSeconds))
+            return fail(error);
+        if (reference != externalized)
+            return fail("the model reads different weights from " + std::string(blobName) + "; keeping the inline tables.");
+
+        size_t before = sourceBytes(stagedModelFolder);
+        for (const auto &relative : rewritten)
+            fs::copy_file(candidate / relative, fs::path(stagedModelFolder) / relative, fs::copy_options::overwrite_existing);
+        fs::copy_file(candidate / blobName, fs::path(stagedModelFolder) / blobName, fs::copy_options::overwrite_existing);
+        size_t after = sourceBytes(stagedModelFolder);
+
+        std::ostringstream out;
+        out << "Weights: moved " << weights.size() << " table(s) to " << blobName << " (" << ModelAnalyzer::formatBytes(blob.size())
+            << "); sources " << ModelAnalyzer::formatBytes(before) << " -> " << ModelAnalyzer::formatBytes(after)
+            << ", host compile and check " << std::fixed << std::setprecision(2) << referenceSeconds << " s -> " << externalizedSeconds << " s.";
+        report = out.str();
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        return fail(e.what());
+    }
+}
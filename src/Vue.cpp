@@ -5,8 +5,12 @@
 Vue::Vue()
     : buttonBrowseModel("Browse model generated by Qualia"),
       buttonExportLocally("Export locally"),
+      buttonAnalyzeModel("Analyze Model"),
+      buttonBenchmarkModel("Benchmark Model"),
       buttonConnectRedPitaya("Connect to RedPitaya"),
       buttonShowMetrics("Show Metrics"),
+      buttonLayerTimings("Layer Timings"),
+      buttonProfile("Profile"),
       buttonExportToRedPitaya("Export to RedPitaya"),
       cancelExportButton("Cancel Export"),
       buttonHelp("Help"),
@@ -14,6 +18,7 @@ Vue::Vue()
       mainBox(Gtk::ORIENTATION_VERTICAL),
       buttonRowBox(Gtk::ORIENTATION_HORIZONTAL),
       checkShowDetails("Show details"),
+      checkWatchModel("Redeploy when the model folder changes"),
       modelLoaded(false),
       redpitayaConnected(false)
 {
@@ -27,6 +32,8 @@ Vue::Vue()
                                                      buttonBrowseModel,
                                                      buttonExportLocally,
                                                      buttonExportToRedPitaya,
+                                                     buttonAnalyzeModel,
+                                                     buttonBenchmarkModel,
                                                      detailsPanel,
                                                      modelFolder,
                                                      modelLoaded,
@@ -41,12 +48,32 @@ Vue::Vue()
                                                        cancelExportFlag,
                                                        detailsPanel); });
 
+    buttonAnalyzeModel.signal_clicked().connect([this]()
+                                                { AnalyzeModelHandler::handle(
+                                                      this,
+                                                      buttonAnalyzeModel,
+                                                      modelFolder,
+                                                      redpitayaHost,
+                                                      redpitayaPassword,
+                                                      redpitayaPrivateKeyPath,
+                                                      redpitayaConnected,
+                                                      detailsPanel); });
+
+    buttonBenchmarkModel.signal_clicked().connect([this]()
+                                                  { BenchmarkModelHandler::handle(
+                                                        this,
+                                                        buttonBenchmarkModel,
+                                                        modelFolder,
+                                                        detailsPanel); });
+
     buttonConnectRedPitaya.signal_clicked().connect([this]()
                                                     { ConnectRedPitayaHandler::handle(
                                                           this,
                                                           buttonConnectRedPitaya,
                                                           buttonExportToRedPitaya,
                                                           buttonShowMetrics,
+                                                          buttonLayerTimings,
+                                                          buttonProfile,
                                                           detailsPanel,
                                                           redpitayaHost,
                                                           redpitayaPassword,
@@ -64,6 +91,24 @@ Vue::Vue()
                                                      redpitayaPrivateKeyPath,
                                                      detailsPanel); });
 
+    buttonLayerTimings.signal_clicked().connect([this]()
+                                                { LayerTimingsHandler::handle(
+                                                      this,
+                                                      buttonLayerTimings,
+                                                      redpitayaHost,
+                                                      redpitayaPassword,
+                                                      redpitayaPrivateKeyPath,
+                                                      detailsPanel); });
+
+    buttonProfile.signal_clicked().connect([this]()
+                                           { ProfileVersionHandler::handle(
+                                                 this,
+                                                 buttonProfile,
+                                                 redpitayaHost,
+                                                 redpitayaPassword,
+                                                 redpitayaPrivateKeyPath,
+                                                 detailsPanel); });
+
     buttonExportToRedPitaya.signal_clicked().connect([this]()
                                                      { ExportToRedPitayaHandler::handle(
                                                            this,
@@ -95,16 +140,21 @@ Vue::Vue()
         }); });
 
     buttonRowBox.pack_start(buttonBrowseModel, Gtk::PACK_SHRINK);
+    buttonRowBox.pack_start(buttonAnalyzeModel, Gtk::PACK_SHRINK);
+    buttonRowBox.pack_start(buttonBenchmarkModel, Gtk::PACK_SHRINK);
     buttonRowBox.pack_start(buttonExportLocally, Gtk::PACK_SHRINK);
     buttonRowBox.pack_start(buttonConnectRedPitaya, Gtk::PACK_SHRINK);
     buttonRowBox.pack_start(buttonExportToRedPitaya, Gtk::PACK_SHRINK);
     buttonRowBox.pack_start(cancelExportButton, Gtk::PACK_SHRINK);
     buttonRowBox.pack_start(buttonShowMetrics, Gtk::PACK_SHRINK);
+    buttonRowBox.pack_start(buttonLayerTimings, Gtk::PACK_SHRINK);
+    buttonRowBox.pack_start(buttonProfile, Gtk::PACK_SHRINK);
     buttonRowBox.pack_start(buttonHelp, Gtk::PACK_SHRINK);
     buttonRowBox.pack_start(buttonQuit, Gtk::PACK_SHRINK);
 
     mainBox.pack_start(buttonRowBox, Gtk::PACK_SHRINK);
     mainBox.pack_start(checkShowDetails, Gtk::PACK_SHRINK);
+    mainBox.pack_start(checkWatchModel, Gtk::PACK_SHRINK);
     mainBox.pack_start(detailsPanel, Gtk::PACK_EXPAND_WIDGET);
 
     add(mainBox);
@@ -114,14 +164,34 @@ Vue::Vue()
     checkShowDetails.set_active(false);
 
     buttonExportLocally.set_sensitive(false);
+    buttonAnalyzeModel.set_sensitive(false);
+    buttonBenchmarkModel.set_sensitive(false);
     buttonExportToRedPitaya.set_sensitive(false);
     cancelExportButton.set_sensitive(false);
     buttonShowMetrics.set_sensitive(false);
+    buttonLayerTimings.set_sensitive(false);
+    buttonProfile.set_sensitive(false);
 
     checkShowDetails.signal_toggled().connect(sigc::mem_fun(*this, &Vue::onCheckShowDetailsClicked));
+    checkWatchModel.signal_toggled().connect([this]()
+                                             { WatchModelHandler::handle(
+                                                   this,
+                                                   checkWatchModel,
+                                                   modelWatcher,
+                                                   modelFolder,
+                                                   redpitayaHost,
+                                                   redpitayaPassword,
+                                                   redpitayaPrivateKeyPath,
+                                                   modelLoaded,
+                                                   redpitayaConnected,
+                                                   detailsPanel); });
 }
 
-Vue::~Vue() {}
+Vue::~Vue()
+{
+    ShowMetricsHandler::close();
+    WatchModelHandler::close(modelWatcher);
+}
 
 void Vue::onCheckShowDetailsClicked()
 {
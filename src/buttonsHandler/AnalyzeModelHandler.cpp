@@ -0,0 +1,121 @@
+/*AnalyzeModelHandler.cpp*/
+
+#include "buttonsHandler/AnalyzeModelHandler.hpp"
+#include "Utility/SSHManager.hpp"
+
+namespace AnalyzeModelHandler
+{
+    static double readBoardFreqMHz(const std::string &redpitayaHost,
+                                   const std::string &redpitayaPassword,
+                                   const std::string &redpitayaPrivateKeyPath)
+    {
+        double freqMHz = 0.0;
+        int status = SSHManager::execute_remote_command_streamed(
+            redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath,
+            "cat /sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq",
+            [&freqMHz](const std::string &line)
+            {
+                if (freqMHz == 0.0)
+                    freqMHz = std::atof(line.c_str()) / 1000.0;
+            });
+        return status == 0 ? freqMHz : 0.0;
+    }
+
+    static void showReportDialog(Gtk::Window *parentWindow, const ModelProfile &profile, double freqMHz, bool measuredFreq)
+    {
+        auto dialog = new Gtk::Dialog("Model profile", false);
+        dialog->set_transient_for(*parentWindow);
+        dialog->set_modal(false);
+        dialog->set_resizable(true);
+        dialog->set_position(Gtk::WIN_POS_CENTER);
+        dialog->set_default_size(760, 520);
+        dialog->add_button("OK", Gtk::RESPONSE_OK);
+
+        Gtk::Box *content = dialog->get_content_area();
+
+        auto textView = Gtk::make_managed<Gtk::TextView>();
+        textView->set_editable(false);
+        textView->set_monospace(true);
+        textView->get_buffer()->set_text(ModelAnalyzer::formatReport(profile, freqMHz) +
+                                         (measuredFreq ? "(FREQ0 read from the connected RedPitaya)\n"
+                                                       : "(RedPitaya not connected: nominal Cortex-A9 frequency assumed)\n"));
+
+        auto scroll = Gtk::make_managed<Gtk::ScrolledWindow>();
+        scroll->set_policy(Gtk::POLICY_AUTOMATIC, Gtk::POLICY_AUTOMATIC);
+        scroll->set_vexpand(true);
+        scroll->add(*textView);
+        content->pack_start(*scroll, Gtk::PACK_EXPAND_WIDGET);
+
+        auto budgetBox = Gtk::make_managed<Gtk::Box>(Gtk::ORIENTATION_HORIZONTAL, 5);
+        auto budgetLabel = Gtk::make_managed<Gtk::Label>("Required inference rate (Hz):");
+        auto rateSpin = Gtk::make_managed<Gtk::SpinButton>(Gtk::Adjustment::create(1000.0, 1.0, 10000000.0, 100.0, 1000.0), 1.0, 0);
+        auto verdict = Gtk::make_managed<Gtk::Label>();
+        budgetBox->pack_start(*budgetLabel, Gtk::PACK_SHRINK);
+        budgetBox->pack_start(*rateSpin, Gtk::PACK_SHRINK);
+        budgetBox->pack_start(*verdict, Gtk::PACK_SHRINK);
+        content->pack_start(*budgetBox, Gtk::PACK_SHRINK);
+
+        double latencyUs = ModelAnalyzer::predictLatencyUs(profile, freqMHz);
+        auto updateVerdict = [rateSpin, verdict, latencyUs]()
+        {
+            double budgetUs = 1e6 / rateSpin->get_value();
+            std::ostringstream text;
+            text << std::fixed << std::setprecision(1) << "budget " << budgetUs << " us: "
+                 << (latencyUs <= budgetUs ? "fits" : "TOO SLOW") << " (" << std::setprecision(0)
+                 << 100.0 * latencyUs / budgetUs << "% of budget)";
+            verdict->set_text(text.str());
+        };
+        rateSpin->signal_value_changed().connect(updateVerdict);
+        updateVerdict();
+
+        dialog->signal_response().connect([dialog](int)
+        {
+            dialog->hide();
+            delete dialog;
+        });
+        dialog->show_all();
+    }
+
+    void handle(Gtk::Window* parentWindow,
+                Gtk::Button& buttonAnalyzeModel,
+                const std::string& modelFolder,
+                const std::string& redpitayaHost,
+                const std::string& redpitayaPassword,
+                const std::string& redpitayaPrivateKeyPath,
+                bool redpitayaConnected,
+                DetailsPanel& detailsPanel)
+    {
+        buttonAnalyzeModel.set_sensitive(false);
+        detailsPanel.append_log("Analyzing model sources...");
+        detailsPanel.set_status("Analyzing model...");
+
+        std::thread([=, &buttonAnalyzeModel, &detailsPanel]()
+        {
+            ModelProfile profile;
+            std::string error;
+            bool ok = ModelAnalyzer::analyze(modelFolder, profile, error);
+
+            double freqMHz = 0.0;
+            if (ok && redpitayaConnected)
+                freqMHz = readBoardFreqMHz(redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath);
+            bool measuredFreq = freqMHz > 0.0;
+            if (!measuredFreq)
+                freqMHz = ModelAnalyzer::defaultFreqMHz;
+
+            Glib::signal_idle().connect_once([=, &buttonAnalyzeModel, &detailsPanel]()
+            {
+                buttonAnalyzeModel.set_sensitive(true);
+                if (!ok)
+                {
+                    detailsPanel.append_log("[Error] " + error);
+                    detailsPanel.set_status("Model analysis failed");
+                    return;
+                }
+
+                detailsPanel.append_log("Model profile: " + ModelAnalyzer::formatSummary(profile));
+                detailsPanel.set_status("Model analyzed");
+                showReportDialog(parentWindow, profile, freqMHz, measuredFreq);
+            });
+        }).detach();
+    }
+}
@@ -0,0 +1,134 @@
+/*BenchmarkModelHandler.cpp*/
+
+#include "buttonsHandler/BenchmarkModelHandler.hpp"
+
+namespace BenchmarkModelHandler
+{
+    static void showResultsDialog(Gtk::Window *parentWindow, const std::string &text)
+    {
+        auto dialog = new Gtk::Dialog("Host benchmark results", false);
+        dialog->set_transient_for(*parentWindow);
+        dialog->set_modal(false);
+        dialog->set_resizable(true);
+        dialog->set_position(Gtk::WIN_POS_CENTER);
+        dialog->set_default_size(720, 260);
+        dialog->add_button("OK", Gtk::RESPONSE_OK);
+
+        auto textView = Gtk::make_managed<Gtk::TextView>();
+        textView->set_editable(false);
+        textView->set_monospace(true);
+        textView->get_buffer()->set_text(text);
+
+        auto scroll = Gtk::make_managed<Gtk::ScrolledWindow>();
+        scroll->set_policy(Gtk::POLICY_AUTOMATIC, Gtk::POLICY_AUTOMATIC);
+        scroll->set_vexpand(true);
+        scroll->add(*textView);
+        dialog->get_content_area()->pack_start(*scroll, Gtk::PACK_EXPAND_WIDGET);
+
+        dialog->signal_response().connect([dialog](int)
+        {
+            dialog->hide();
+            delete dialog;
+        });
+        dialog->show_all();
+    }
+
+    void handle(Gtk::Window* parentWindow,
+                Gtk::Button& buttonBenchmarkModel,
+                const std::string& modelFolder,
+                DetailsPanel& detailsPanel)
+    {
+        buttonBenchmarkModel.set_sensitive(false);
+
+        auto dialog = new Gtk::Dialog("Benchmark model on host", false);
+        dialog->set_transient_for(*parentWindow);
+        dialog->set_modal(false);
+        dialog->set_position(Gtk::WIN_POS_CENTER);
+        dialog->set_default_size(420, 200);
+
+        Gtk::Box *content = dialog->get_content_area();
+        auto checkO2 = Gtk::make_managed<Gtk::CheckButton>("Build with -O2");
+        auto checkO3 = Gtk::make_managed<Gtk::CheckButton>("Build with -O3");
+        checkO2->set_active(true);
+        checkO3->set_active(true);
+
+        auto iterationsLabel = Gtk::make_managed<Gtk::Label>("Timed inferences per variant:");
+        auto iterationsSpin = Gtk::make_managed<Gtk::SpinButton>(Gtk::Adjustment::create(1000.0, 10.0, 10000000.0, 100.0, 1000.0), 1.0, 0);
+
+        auto compareLabel = Gtk::make_managed<Gtk::Label>("Optional: another build of this model to compare (e.g. fixed-point):");
+        auto compareChooser = Gtk::make_managed<Gtk::FileChooserButton>("Select a model folder", Gtk::FILE_CHOOSER_ACTION_SELECT_FOLDER);
+
+        content->pack_start(*checkO2, Gtk::PACK_SHRINK);
+        content->pack_start(*checkO3, Gtk::PACK_SHRINK);
+        content->pack_start(*iterationsLabel, Gtk::PACK_SHRINK);
+        content->pack_start(*iterationsSpin, Gtk::PACK_SHRINK);
+        content->pack_start(*compareLabel, Gtk::PACK_SHRINK);
+        content->pack_start(*compareChooser, Gtk::PACK_SHRINK);
+
+        dialog->add_button("_Cancel", Gtk::RESPONSE_CANCEL);
+        dialog->add_button("_Run", Gtk::RESPONSE_OK);
+
+        dialog->signal_response().connect([parentWindow, dialog, checkO2, checkO3, iterationsSpin, compareChooser,
+                                           modelFolder, &buttonBenchmarkModel, &detailsPanel](int response)
+        {
+            std::vector<std::string> optimizations;
+            if (checkO2->get_active())
+                optimizations.push_back("-O2");
+            if (checkO3->get_active())
+                optimizations.push_back("-O3");
+            unsigned long iterations = static_cast<unsigned long>(iterationsSpin->get_value());
+            std::string compareFolder = compareChooser->get_filename();
+
+            dialog->hide();
+            delete dialog;
+
+            if (response != Gtk::RESPONSE_OK || optimizations.empty())
+            {
+                buttonBenchmarkModel.set_sensitive(true);
+                return;
+            }
+
+            std::vector<BenchmarkVariant> variants;
+            for (const auto &optimization : optimizations)
+            {
+                variants.push_back({"model " + optimization, modelFolder, optimization});
+                if (!compareFolder.empty() && compareFolder != modelFolder)
+                    variants.push_back({"compare " + optimization, compareFolder, optimization});
+            }
+
+            detailsPanel.append_log("Benchmarking " + std::to_string(variants.size()) + " host build(s) of the model...");
+            detailsPanel.set_status("Benchmarking...");
+            detailsPanel.set_progress(0.0);
+
+            std::thread([parentWindow, variants, iterations, &buttonBenchmarkModel, &detailsPanel]()
+            {
+                static const std::atomic<bool> neverCancel{false};
+                std::vector<BenchmarkResult> results;
+                for (size_t i = 0; i < variants.size(); ++i)
+                {
+                    results.push_back(BenchmarkManager::runBenchmark(variants[i], iterations, neverCancel));
+
+                    double progress = static_cast<double>(i + 1) / variants.size();
+                    std::string label = variants[i].label;
+                    bool ok = results.back().success;
+                    Glib::signal_idle().connect_once([&detailsPanel, progress, label, ok]()
+                    {
+                        detailsPanel.append_log((ok ? "Benchmarked: " : "Benchmark failed: ") + label);
+                        detailsPanel.set_progress(progress);
+                    });
+                }
+
+                std::string report = BenchmarkManager::formatResults(results);
+                Glib::signal_idle().connect_once([parentWindow, report, &buttonBenchmarkModel, &detailsPanel]()
+                {
+                    detailsPanel.append_log(report);
+                    detailsPanel.set_status("Benchmark complete");
+                    buttonBenchmarkModel.set_sensitive(true);
+                    showResultsDialog(parentWindow, report);
+                });
+            }).detach();
+        });
+
+        dialog->show_all();
+    }
+}
@@ -8,6 +8,8 @@ namespace BrowseModelHandler
                 Gtk::Button& buttonBrowseModel,
                 Gtk::Button& buttonExportLocally,
                 Gtk::Button& buttonExportToRedPitaya,
+                Gtk::Button& buttonAnalyzeModel,
+                Gtk::Button& buttonBenchmarkModel,
                 DetailsPanel& detailsPanel,
                 std::string& modelFolder,
                 bool& modelLoaded,
@@ -24,7 +26,7 @@ namespace BrowseModelHandler
         dialog->add_button("_Cancel", Gtk::RESPONSE_CANCEL);
         dialog->add_button("_OK", Gtk::RESPONSE_OK);
 
-        dialog->signal_response().connect([=, &buttonBrowseModel, &buttonExportLocally, &buttonExportToRedPitaya, &detailsPanel, &modelFolder, &modelLoaded, &redpitayaConnected](int response)
+        dialog->signal_response().connect([=, &buttonBrowseModel, &buttonExportLocally, &buttonExportToRedPitaya, &buttonAnalyzeModel, &buttonBenchmarkModel, &detailsPanel, &modelFolder, &modelLoaded, &redpitayaConnected](int response)
         {
             std::string folder = dialog->get_filename();
 
@@ -46,11 +48,43 @@ namespace BrowseModelHandler
             if (FileManager::isValidQualiaModel(modelFolder))
             {
                 detailsPanel.append_log("Model folder is valid.");
+
+                // Fingerprinting and analyzing a large model.c takes seconds, so the profile is logged from a
+                // worker once ready; the model is usable before that. It only depends on the folder contents, so
+                // it is cached under the fingerprint.
+                std::thread([folder, &detailsPanel]()
+                {
+                    std::string fingerprint = FileManager::toHex(FileManager::fingerprintFolder(folder));
+                    std::string summary, message;
+                    if (FileManager::readCachedText("profiles", fingerprint, summary))
+                        message = "Model profile (unchanged, " + fingerprint + "): " + summary;
+                    else
+                    {
+                        ModelProfile profile;
+                        std::string error;
+                        if (ModelAnalyzer::analyze(folder, profile, error))
+                        {
+                            summary = ModelAnalyzer::formatSummary(profile);
+                            FileManager::writeCachedText("profiles", fingerprint, summary);
+                            message = "Model profile: " + summary;
+                        }
+                        else
+                            message = "Model profile unavailable: " + error;
+                    }
+
+                    Glib::signal_idle().connect_once([message, &detailsPanel]()
+                    {
+                        detailsPanel.append_log(message);
+                    });
+                }).detach();
+
                 detailsPanel.set_status("Model loaded");
                 detailsPanel.set_progress(1.0);
 
                 modelLoaded = true;
                 buttonExportLocally.set_sensitive(true);
+                buttonAnalyzeModel.set_sensitive(true);
+                buttonBenchmarkModel.set_sensitive(true);
                 if (redpitayaConnected)
                     buttonExportToRedPitaya.set_sensitive(true);
             }
@@ -22,6 +22,8 @@ namespace ConnectRedPitayaHandler
                 Gtk::Button &buttonConnectRedPitaya,
                 Gtk::Button &buttonExportToRedPitaya,
                 Gtk::Button &buttonShowMetrics,
+                Gtk::Button &buttonLayerTimings,
+                Gtk::Button &buttonProfile,
                 DetailsPanel &detailsPanel,
                 std::string &redpitayaHost,
                 std::string &redpitayaPassword,
@@ -200,7 +202,7 @@ namespace ConnectRedPitayaHandler
             } });
 
         buttonConnect->signal_clicked().connect(
-            [=, &redpitayaHost, &redpitayaPassword, &redpitayaPrivateKeyPath, &redpitayaConnected, &detailsPanel, &buttonConnectRedPitaya, &buttonExportToRedPitaya, &buttonShowMetrics]()
+            [=, &redpitayaHost, &redpitayaPassword, &redpitayaPrivateKeyPath, &redpitayaConnected, &detailsPanel, &buttonConnectRedPitaya, &buttonExportToRedPitaya, &buttonShowMetrics, &buttonLayerTimings, &buttonProfile]()
             {
                 std::string hostname;
                 std::string password = entryPassword->get_text();
@@ -276,6 +278,8 @@ namespace ConnectRedPitayaHandler
                         buttonExportToRedPitaya.set_sensitive(true);
 
                     buttonShowMetrics.set_sensitive(true);
+                    buttonLayerTimings.set_sensitive(true);
+                    buttonProfile.set_sensitive(true);
 
                     detailsPanel.append_log("Successfully connected to " + hostname);
                     detailsPanel.set_status("Connected");
@@ -23,6 +23,7 @@ namespace ExportLocalHandler
         selectDialog->signal_response().connect([parentWindow, &buttonExportLocally, &cancelExportButton, &detailsPanel, &modelFolder, &cancelExportFlag, selectDialog](int response)
                                                 {
             auto selectedVersions = selectDialog->get_selected_versions();
+            ExportOptions exportOptions = selectDialog->get_export_options();
             selectDialog->hide();
             delete selectDialog;
 
@@ -41,7 +42,7 @@ namespace ExportLocalHandler
             folderDialog->add_button("_Cancel", Gtk::RESPONSE_CANCEL);
             folderDialog->add_button("_OK", Gtk::RESPONSE_OK);
 
-            folderDialog->signal_response().connect([parentWindow, &buttonExportLocally, &cancelExportButton, &detailsPanel, &modelFolder, selectedVersions, &cancelExportFlag, folderDialog](int response)
+            folderDialog->signal_response().connect([parentWindow, &buttonExportLocally, &cancelExportButton, &detailsPanel, &modelFolder, selectedVersions, exportOptions, &cancelExportFlag, folderDialog](int response) mutable
             {
                 std::string targetFolder = folderDialog->get_filename();
                 folderDialog->hide();
@@ -61,12 +62,17 @@ namespace ExportLocalHandler
                 detailsPanel.set_status("Exporting...");
                 detailsPanel.set_progress(0.0);
 
+                exportOptions.log = [&detailsPanel](const std::string &line)
+                {
+                    detailsPanel.append_log(line);
+                };
+
                 for (const auto &version : selectedVersions)
                 {
                     detailsPanel.append_log("Exporting version: " + version + "...");
                     bool success = ExportManager::exportLocally(
                         modelFolder, version,
-                        targetFolder, cancelExportFlag);
+                        targetFolder, cancelExportFlag, exportOptions);
 
                     if (success)
                         detailsPanel.append_log("Exported: " + version);
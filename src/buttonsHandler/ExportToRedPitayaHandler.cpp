@@ -2,6 +2,7 @@
 
 #include "buttonsHandler/ExportToRedPitayaHandler.hpp"
 #include "Utility/ExportManager.hpp"
+#include "Utility/BuildManager.hpp"
 #include "Utility/ConnectionManager.hpp"
 #include "Utility/SelectDialog.hpp"
 
@@ -65,6 +66,7 @@ namespace ExportToRedPitayaHandler
                                                  &detailsPanel, selectDialog](int selResp)
         {
             std::vector<std::string> selectedVersions = selectDialog->get_selected_versions();
+            ExportOptions exportOptions = selectDialog->get_export_options();
             selectDialog->hide();
             Glib::signal_idle().connect_once([selectDialog]() {
                 delete selectDialog;
@@ -92,18 +94,21 @@ namespace ExportToRedPitayaHandler
             auto entry = Gtk::make_managed<Gtk::Entry>();
             entry->set_text("/root/");
             entry->set_activates_default(true);
+            auto checkBuild = Gtk::make_managed<Gtk::CheckButton>("Build on RedPitaya after export");
 
             dirDialog->add_button("_Cancel", Gtk::RESPONSE_CANCEL);
             dirDialog->add_button("_OK", Gtk::RESPONSE_OK);
             dirDialog->set_default_response(Gtk::RESPONSE_OK);
             box->pack_start(*label, Gtk::PACK_SHRINK);
             box->pack_start(*entry, Gtk::PACK_SHRINK);
+            box->pack_start(*checkBuild, Gtk::PACK_SHRINK);
 
-            dirDialog->signal_response().connect([parentWindow, dirDialog, entry, selectedVersions, &buttonExportToRedPitaya, &cancelExportButton,
+            dirDialog->signal_response().connect([parentWindow, dirDialog, entry, checkBuild, selectedVersions, exportOptions, &buttonExportToRedPitaya, &cancelExportButton,
                                                   &cancelExportFlag, modelFolder, redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath,
                                                   &detailsPanel](int dirResp)
             {
                 std::string targetDirectory;
+                bool buildOnTarget = checkBuild->get_active();
                 if (dirResp == Gtk::RESPONSE_OK)
                     targetDirectory = entry->get_text();
 
@@ -120,9 +125,15 @@ namespace ExportToRedPitayaHandler
                 cancelExportButton.set_sensitive(true);
                 cancelExportFlag = false;
 
-                std::thread([parentWindow, selectedVersions, targetDirectory, modelFolder, redpitayaHost, redpitayaPassword,
-                             redpitayaPrivateKeyPath, &detailsPanel, &cancelExportButton, &buttonExportToRedPitaya, &cancelExportFlag]()
+                std::thread([parentWindow, selectedVersions, exportOptions, targetDirectory, buildOnTarget, modelFolder, redpitayaHost, redpitayaPassword,
+                             redpitayaPrivateKeyPath, &detailsPanel, &cancelExportButton, &buttonExportToRedPitaya, &cancelExportFlag]() mutable
                 {
+                    exportOptions.log = [&detailsPanel](const std::string &line) {
+                        Glib::signal_idle().connect_once([&detailsPanel, line]() {
+                            detailsPanel.append_log(line);
+                        });
+                    };
+
                     Glib::signal_idle().connect_once([&detailsPanel]() {
                         detailsPanel.append_log("Starting export to RedPitaya...");
                         detailsPanel.set_status("Exporting...");
@@ -149,7 +160,7 @@ namespace ExportToRedPitayaHandler
                         bool ok = ExportManager::exportSingleVersionToRedPitaya(
                             modelFolder, version,
                             redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath,
-                            targetDirectory, cancelExportFlag);
+                            targetDirectory, cancelExportFlag, exportOptions);
 
                         if (!ok)
                         {
@@ -171,12 +182,57 @@ namespace ExportToRedPitayaHandler
                         });
                     }
 
+                    RemoteExportRecord record;
+                    record.versions = selectedVersions;
+                    record.targetDirectory = targetDirectory;
+                    record.options = exportOptions;
+                    record.buildOnTarget = buildOnTarget;
+                    ExportManager::rememberRemoteExport(record);
+
+                    bool buildsSucceeded = true;
+                    if (buildOnTarget)
+                    {
+                        Glib::signal_idle().connect_once([&detailsPanel]() {
+                            detailsPanel.append_log("Building exported version(s) on RedPitaya...");
+                            detailsPanel.set_status("Building on RedPitaya...");
+                        });
+
+                        auto results = BuildManager::buildVersionsOnRedPitaya(
+                            redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath,
+                            targetDirectory, selectedVersions,
+                            [&detailsPanel](const std::string &line) {
+                                Glib::signal_idle().connect_once([&detailsPanel, line]() {
+                                    detailsPanel.append_log(line);
+                                });
+                            },
+                            cancelExportFlag);
+
+                        for (const auto &result : results)
+                        {
+                            buildsSucceeded = buildsSucceeded && result.success;
+
+                            std::ostringstream summary;
+                            summary << "Build " << (result.success ? "succeeded" : "failed") << ": " << result.version
+                                    << " (" << std::fixed << std::setprecision(1) << result.seconds << " s)";
+                            for (const auto &fileTime : result.fileCompileTimesMs)
+                                summary << "\n    " << fileTime.first << ": " << fileTime.second << " ms";
+
+                            Glib::signal_idle().connect_once([&detailsPanel, text = summary.str()]() {
+                                detailsPanel.append_log(text);
+                            });
+                        }
+                    }
+
                     cancelExportButton.set_sensitive(false);
 
-                    Glib::signal_idle().connect_once([&detailsPanel, &cancelExportButton, &buttonExportToRedPitaya, parentWindow]() {
-                        detailsPanel.set_status("Export complete");
+                    Glib::signal_idle().connect_once([&detailsPanel, &cancelExportButton, &buttonExportToRedPitaya, parentWindow, buildOnTarget, buildsSucceeded]() {
+                        detailsPanel.set_status(!buildOnTarget ? "Export complete" : buildsSucceeded ? "Export and build complete" : "Build failed");
                         detailsPanel.set_progress(1.0);
-                        showInfoDialog(parentWindow, "Files and directories exported successfully!");
+                        if (buildsSucceeded)
+                            showInfoDialog(parentWindow, buildOnTarget ? "Exported versions built successfully on RedPitaya!"
+                                                                       : "Files and directories exported successfully!");
+                        else
+                            showErrorDialog(parentWindow, "Build on RedPitaya failed.", "See the details panel for the compiler output.");
                         cancelExportButton.set_sensitive(false);
                         buttonExportToRedPitaya.set_sensitive(true);
                     });
@@ -0,0 +1,73 @@
+/*LayerTimingsHandler.cpp*/
+
+#include "buttonsHandler/LayerTimingsHandler.hpp"
+
+namespace LayerTimingsHandler
+{
+    static void showTimingsDialog(Gtk::Window *parentWindow, const std::string &text)
+    {
+        auto dialog = new Gtk::Dialog("Per-layer latency on the RedPitaya", false);
+        dialog->set_transient_for(*parentWindow);
+        dialog->set_modal(false);
+        dialog->set_resizable(true);
+        dialog->set_position(Gtk::WIN_POS_CENTER);
+        dialog->set_default_size(760, 300);
+        dialog->add_button("OK", Gtk::RESPONSE_OK);
+
+        auto textView = Gtk::make_managed<Gtk::TextView>();
+        textView->set_editable(false);
+        textView->set_monospace(true);
+        textView->get_buffer()->set_text(text);
+
+        auto scroll = Gtk::make_managed<Gtk::ScrolledWindow>();
+        scroll->set_policy(Gtk::POLICY_AUTOMATIC, Gtk::POLICY_AUTOMATIC);
+        scroll->set_vexpand(true);
+        scroll->add(*textView);
+        dialog->get_content_area()->pack_start(*scroll, Gtk::PACK_EXPAND_WIDGET);
+
+        dialog->signal_response().connect([dialog](int)
+        {
+            dialog->hide();
+            delete dialog;
+        });
+        dialog->show_all();
+    }
+
+    void handle(Gtk::Window* parentWindow,
+                Gtk::Button& buttonLayerTimings,
+                const std::string& redpitayaHost,
+                const std::string& redpitayaPassword,
+                const std::string& redpitayaPrivateKeyPath,
+                DetailsPanel& detailsPanel)
+    {
+        buttonLayerTimings.set_sensitive(false);
+        detailsPanel.append_log(std::string("Fetching ") + LayerProbeInjector::remoteRingPath + " from " + redpitayaHost + "...");
+        detailsPanel.set_status("Fetching layer timings...");
+
+        std::thread([parentWindow, redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath, &buttonLayerTimings, &detailsPanel]()
+        {
+            std::string ring, error, report;
+            std::vector<LayerTiming> timings;
+            size_t threads = 0;
+            bool ok = false;
+            if (!SSHManager::read_remote_file(redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath, LayerProbeInjector::remoteRingPath, ring))
+                report = "[Error] No layer timings on the board. Export with \"Record per-layer timings\" and run the model first.";
+            else if (!LayerProbeInjector::summarize(ring, timings, threads, error))
+                report = "[Error] Layer timings unavailable: " + error + ".";
+            else
+            {
+                report = LayerProbeInjector::formatTimings(timings, threads);
+                ok = true;
+            }
+
+            Glib::signal_idle().connect_once([parentWindow, ok, report, &buttonLayerTimings, &detailsPanel]()
+            {
+                detailsPanel.append_log(report);
+                detailsPanel.set_status(ok ? "Layer timings fetched" : "Layer timings unavailable");
+                buttonLayerTimings.set_sensitive(true);
+                if (ok)
+                    showTimingsDialog(parentWindow, report);
+            });
+        }).detach();
+    }
+}
@@ -0,0 +1,194 @@
+/*ProfileVersionHandler.cpp*/
+
+#include "buttonsHandler/ProfileVersionHandler.hpp"
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace ProfileVersionHandler
+{
+    static const char *remoteProfilePath = "/tmp/rp_profile.bin";
+    static const char *localProfileDir = "build/profiles";
+
+    static void showReportDialog(Gtk::Window *parentWindow, const std::string &text)
+    {
+        auto dialog = new Gtk::Dialog("Hot functions on the RedPitaya", false);
+        dialog->set_transient_for(*parentWindow);
+        dialog->set_modal(false);
+        dialog->set_resizable(true);
+        dialog->set_position(Gtk::WIN_POS_CENTER);
+        dialog->set_default_size(760, 360);
+        dialog->add_button("OK", Gtk::RESPONSE_OK);
+
+        auto textView = Gtk::make_managed<Gtk::TextView>();
+        textView->set_editable(false);
+        textView->set_monospace(true);
+        textView->get_buffer()->set_text(text);
+
+        auto scroll = Gtk::make_managed<Gtk::ScrolledWindow>();
+        scroll->set_policy(Gtk::POLICY_AUTOMATIC, Gtk::POLICY_AUTOMATIC);
+        scroll->set_vexpand(true);
+        scroll->add(*textView);
+        dialog->get_content_area()->pack_start(*scroll, Gtk::PACK_EXPAND_WIDGET);
+
+        dialog->signal_response().connect([dialog](int)
+        {
+            dialog->hide();
+            delete dialog;
+        });
+        dialog->show_all();
+    }
+
+    void handle(Gtk::Window* parentWindow,
+                Gtk::Button& buttonProfile,
+                const std::string& redpitayaHost,
+                const std::string& redpitayaPassword,
+                const std::string& redpitayaPrivateKeyPath,
+                DetailsPanel& detailsPanel)
+    {
+        Gtk::Dialog dialog("Profile the deployed pipeline", *parentWindow);
+        dialog.set_modal(true);
+        dialog.add_button("Cancel", Gtk::RESPONSE_CANCEL);
+        dialog.add_button("Start", Gtk::RESPONSE_OK);
+
+        Gtk::Box *content = dialog.get_content_area();
+        auto processLabel = Gtk::make_managed<Gtk::Label>("Process to profile:");
+        auto processEntry = Gtk::make_managed<Gtk::Entry>();
+        processEntry->set_placeholder_text("Process name or PID");
+        auto durationLabel = Gtk::make_managed<Gtk::Label>("Duration (seconds):");
+        auto durationSpin = Gtk::make_managed<Gtk::SpinButton>();
+        durationSpin->set_range(1, 300);
+        durationSpin->set_increments(1, 10);
+        durationSpin->set_value(10);
+        auto rateLabel = Gtk::make_managed<Gtk::Label>("Samples per second and core:");
+        auto rateCombo = Gtk::make_managed<Gtk::ComboBoxText>();
+        rateCombo->append("99");
+        rateCombo->append("499");
+        rateCombo->append("999");
+        rateCombo->set_active(1);
+        auto hint = Gtk::make_managed<Gtk::Label>("Call stacks need the version built with -fno-omit-frame-pointer;\n"
+                                                  "without it only the innermost function is reliable.");
+
+        content->pack_start(*processLabel, Gtk::PACK_SHRINK);
+        content->pack_start(*processEntry, Gtk::PACK_SHRINK);
+        content->pack_start(*durationLabel, Gtk::PACK_SHRINK);
+        content->pack_start(*durationSpin, Gtk::PACK_SHRINK);
+        content->pack_start(*rateLabel, Gtk::PACK_SHRINK);
+        content->pack_start(*rateCombo, Gtk::PACK_SHRINK);
+        content->pack_start(*hint, Gtk::PACK_SHRINK);
+        dialog.show_all();
+
+        if (dialog.run() != Gtk::RESPONSE_OK)
+            return;
+
+        std::string process = processEntry->get_text();
+        if (process.empty() || process.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_.-") != std::string::npos)
+        {
+            detailsPanel.append_log("[Error] Invalid process name.");
+            return;
+        }
+        std::string processOption = (process.find_first_not_of("0123456789") == std::string::npos ? "--pid " : "--process ") + process;
+        int seconds = durationSpin->get_value_as_int();
+        std::string rate = rateCombo->get_active_text();
+
+        buttonProfile.set_sensitive(false);
+        detailsPanel.append_log("Profiling " + process + " on " + redpitayaHost + " for " + std::to_string(seconds) + " s...");
+        detailsPanel.set_status("Profiling...");
+
+        std::thread([=, &buttonProfile, &detailsPanel]()
+        {
+            auto finish = [&buttonProfile, &detailsPanel, parentWindow](bool ok, const std::string &report, const std::string &svgPath)
+            {
+                Glib::signal_idle().connect_once([=, &buttonProfile, &detailsPanel]()
+                {
+                    detailsPanel.append_log(report);
+                    detailsPanel.set_status(ok ? "Profile ready" : "Profile unavailable");
+                    buttonProfile.set_sensitive(true);
+                    if (!ok)
+                        return;
+                    detailsPanel.append_log("Flame graph written to " + svgPath);
+                    showReportDialog(parentWindow, report);
+                    try
+                    {
+                        Gio::AppInfo::launch_default_for_uri(Glib::filename_to_uri(fs::absolute(svgPath).string()));
+                    }
+                    catch (const Glib::Error &e)
+                    {
+                        detailsPanel.append_log("[Warning] Cannot open the flame graph: " + std::string(e.what()));
+                    }
+                });
+            };
+
+            SSHManager::execute_remote_command(redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath, "mkdir -p /root/monitoring");
+            if (!SSHManager::scp_transfer(redpitayaHost, redpitayaPassword, "build/monitoring/monitor_sender",
+                                          "/root/monitoring/monitor_sender", redpitayaPrivateKeyPath))
+            {
+                finish(false, "[Error] Failed to upload monitor_sender.", "");
+                return;
+            }
+
+            // A separate, non-streaming sender so a running Show Metrics session keeps going; it exits on its own.
+            std::ostringstream remoteCmd;
+            remoteCmd << "chmod +x /root/monitoring/monitor_sender && "
+                      << "/root/monitoring/monitor_sender --no-stream " << processOption
+                      << " --profile-out " << remoteProfilePath << " --profile-hz " << rate
+                      << " --duration " << seconds << " 1000000 > /dev/null 2>&1";
+            SSHManager::execute_remote_command(redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath, remoteCmd.str());
+
+            std::string bytes, error;
+            ProfileData profile;
+            if (!SSHManager::read_remote_file(redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath, remoteProfilePath, bytes))
+            {
+                finish(false, "[Error] No profile was written on the board.", "");
+                return;
+            }
+            if (!ProfileReport::parse(bytes, profile, error))
+            {
+                finish(false, "[Error] Profile unavailable: " + error + ".", "");
+                return;
+            }
+            if (profile.samples == 0)
+            {
+                finish(false, "[Error] No samples: is " + process + " running, and does the board allow perf_event_open?", "");
+                return;
+            }
+
+            // Symbolized against the very files that were mapped, copied back from the board.
+            std::map<std::string, std::string> images;
+            for (const auto &module : profile.modules)
+            {
+                std::string image;
+                if (SSHManager::read_remote_file(redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath, module, image))
+                    images[module] = std::move(image);
+            }
+            auto folded = ProfileReport::fold(profile, images);
+
+            std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+            std::ostringstream name;
+            name << process << "-" << std::put_time(std::localtime(&now), "%Y%m%d-%H%M%S");
+            // Non-throwing, like everything else on this detached thread: failures are reported, not raised.
+            std::error_code ec;
+            fs::create_directories(localProfileDir, ec);
+            std::string svgPath = std::string(localProfileDir) + "/" + name.str() + ".svg";
+            std::ofstream svgOut(svgPath);
+            svgOut << ProfileReport::renderFlameGraph(folded, process + " on " + redpitayaHost);
+            // The folded stacks too, for flamegraph.pl or speedscope.
+            std::ofstream foldedOut(std::string(localProfileDir) + "/" + name.str() + ".folded");
+            for (const auto &[stack, count] : folded)
+                foldedOut << stack << " " << count << "\n";
+            if (ec || !svgOut || !foldedOut)
+            {
+                finish(false, "[Error] Cannot write the profile to " + std::string(localProfileDir) +
+                                  (ec ? ": " + ec.message() : "") + ".", "");
+                return;
+            }
+
+            finish(true, ProfileReport::formatHotFunctions(profile, folded, 25), svgPath);
+        }).detach();
+    }
+}
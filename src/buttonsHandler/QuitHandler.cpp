@@ -1,7 +1,7 @@
 /*QuitHandler.cpp*/
 
 #include "buttonsHandler/QuitHandler.hpp"
-#include <cstdlib>
+#include "buttonsHandler/ShowMetricsHandler.hpp"
 #include <thread>
 
 namespace QuitHandler
@@ -11,8 +11,7 @@ namespace QuitHandler
                 const std::string &redpitayaPassword,
                 const std::string &redpitayaPrivateKeyPath)
     {
-        // Kill local monitoring.py plotter if running
-        std::system("pkill -f monitoring.py");
+        ShowMetricsHandler::close();
 
         // Delete /root/monitoring from RedPitaya (if connected)
         if (!redpitayaHost.empty()) {
@@ -23,6 +22,8 @@ namespace QuitHandler
                 "rm -rf /root/monitoring");
         }
 
+        SSHManager::close_pooled_sessions();
+
         // Exit GUI
         parentWindow->hide();
     }
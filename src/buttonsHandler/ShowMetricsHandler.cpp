@@ -4,6 +4,44 @@
 
 namespace ShowMetricsHandler
 {
+    // monitor_sender's default --port; it connects to us, through the board's default gateway.
+    static const uint16_t metricsPort = 5000;
+    // Pid of the streaming sender started by the last Show Metrics, on the board.
+    static const char *senderPidPath = "/dev/shm/rp_monitor_sender.pid";
+    // One plot window for the session, kept (hidden) between runs.
+    static std::unique_ptr<MetricsWindow> metricsWindow;
+    static sigc::connection metricsWindowHidden;
+
+    static void openMetricsWindow(Gtk::Button &buttonShowMetrics, DetailsPanel &detailsPanel)
+    {
+        if (!metricsWindow)
+        {
+            metricsWindow = std::make_unique<MetricsWindow>();
+            metricsWindowHidden = metricsWindow->signal_hide().connect([&buttonShowMetrics, &detailsPanel]() {
+                metricsWindow->stop();
+                detailsPanel.append_log("Metrics window closed by user.");
+                buttonShowMetrics.set_sensitive(true);
+                detailsPanel.set_status("Monitoring stopped.");
+            });
+        }
+
+        std::string error;
+        if (!metricsWindow->start(metricsPort, error))
+        {
+            detailsPanel.append_log("[Error] Cannot receive metrics: " + error);
+            buttonShowMetrics.set_sensitive(true);
+            return;
+        }
+        metricsWindow->show_all();
+        metricsWindow->present();
+    }
+
+    void close()
+    {
+        metricsWindowHidden.disconnect();
+        metricsWindow.reset();
+    }
+
     void handle(Gtk::Window *parentWindow,
                 Gtk::Button &buttonShowMetrics,
                 Gtk::Button &buttonConnectRedPitaya,
@@ -23,16 +61,25 @@ namespace ShowMetricsHandler
         auto combo = Gtk::make_managed<Gtk::ComboBoxText>();
         auto customEntry = Gtk::make_managed<Gtk::Entry>();
 
+        combo->append("1000");
+        combo->append("10000");
+        combo->append("100000");
         combo->append("500000");
         combo->append("1000000");
         combo->append("2000000");
         combo->append("Custom");
-        combo->set_active(0);
+        combo->set_active(3);
 
         customEntry->set_placeholder_text("Custom interval (us)");
 
+        auto processLabel = Gtk::make_managed<Gtk::Label>("Pipeline process to break down per thread (optional):");
+        auto processEntry = Gtk::make_managed<Gtk::Entry>();
+        processEntry->set_placeholder_text("Process name or PID");
+
         content->pack_start(*label, Gtk::PACK_SHRINK);
         content->pack_start(*combo, Gtk::PACK_SHRINK);
+        content->pack_end(*processEntry, Gtk::PACK_SHRINK);
+        content->pack_end(*processLabel, Gtk::PACK_SHRINK);
         // Note: customEntry is not added initially
 
         combo->signal_changed().connect([combo, customEntry, content, &dialog]() {
@@ -65,6 +112,16 @@ namespace ShowMetricsHandler
             return;
         }
 
+        std::string process = processEntry->get_text();
+        if (process.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_.-") != std::string::npos)
+        {
+            detailsPanel.append_log("[Error] Invalid process name.");
+            return;
+        }
+        std::string processOption;
+        if (!process.empty())
+            processOption = (process.find_first_not_of("0123456789") == std::string::npos ? "--pid " : "--process ") + process + " ";
+
         buttonShowMetrics.set_sensitive(false);
         buttonConnectRedPitaya.set_sensitive(false);
         detailsPanel.append_log("Checking RedPitaya connectivity...");
@@ -115,10 +172,19 @@ namespace ShowMetricsHandler
                 detailsPanel.append_log("monitor_sender uploaded successfully.");
             });
 
+            // Fast intervals are batched so the board sends ~20 frames per second instead of one per sample.
+            std::string batching = std::stoi(interval) < 50000 ? "--flush-us 50000 " : "";
+
             std::ostringstream remoteCmd;
+            // The sender keeps reconnecting on its own, so a previous one has to be stopped first. Its
+            // unsent samples stay in the backlog file and are replayed by the new one. Only the sender
+            // started here is stopped (through its pidfile), not a --no-stream profiling run.
             remoteCmd << "chmod +x /root/monitoring/monitor_sender && "
-                      << "nohup /root/monitoring/monitor_sender " << interval
-                      << " > /dev/null 2>&1 &";
+                      << "{ pid=$(cat " << senderPidPath << " 2>/dev/null) && "
+                      << "[ \"$(cat /proc/$pid/comm 2>/dev/null)\" = monitor_sender ] && kill $pid; true; } && "
+                      << "{ nohup /root/monitoring/monitor_sender --backlog-file /dev/shm/rp_telemetry_backlog "
+                      << batching << processOption << interval
+                      << " > /dev/null 2>&1 & echo $! > " << senderPidPath << "; }";
 
             bool senderStarted = SSHManager::execute_remote_command(
                 redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath, remoteCmd.str());
@@ -135,21 +201,9 @@ namespace ShowMetricsHandler
                 detailsPanel.append_log("monitor_sender started on RedPitaya.");
             });
 
-            std::system("pkill -f monitoring.py");
-
-            std::thread([&buttonShowMetrics, &detailsPanel]() {
-                int status = std::system("python3 build/monitoring/monitoring.py");
-
-                Glib::signal_idle().connect_once([&]() {
-                    if (status != 0) {
-                        detailsPanel.append_log("[Error] monitoring.py exited with error.");
-                    } else {
-                        detailsPanel.append_log("monitoring.py closed by user.");
-                    }
-                    buttonShowMetrics.set_sensitive(true);
-                    detailsPanel.set_status("Monitoring stopped.");
-                });
-            }).detach(); })
+            Glib::signal_idle().connect_once([&buttonShowMetrics, &detailsPanel]() {
+                openMetricsWindow(buttonShowMetrics, detailsPanel);
+            }); })
             .detach();
     }
 }
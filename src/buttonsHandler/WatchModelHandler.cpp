@@ -0,0 +1,214 @@
+/*WatchModelHandler.cpp*/
+
+#include "buttonsHandler/WatchModelHandler.hpp"
+#include "Utility/BuildManager.hpp"
+#include "Utility/ExportManager.hpp"
+#include "Utility/FileManager.hpp"
+#include "Utility/SSHManager.hpp"
+#include <iomanip>
+#include <sstream>
+
+namespace WatchModelHandler
+{
+    static std::atomic<bool> cancelRedeploy{false};
+
+    static void showErrorDialog(Gtk::Window* parent, const std::string& title, const std::string& text)
+    {
+        auto dialog = new Gtk::MessageDialog(*parent, title, false, Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, false);
+        if (!text.empty())
+            dialog->set_secondary_text(text);
+        dialog->signal_response().connect([dialog](int)
+        {
+            dialog->hide();
+            delete dialog;
+        });
+        dialog->show_all();
+    }
+
+    // Runs on the watcher thread: repeats the last export to the board with the new model files.
+    static void redeploy(const std::string& modelFolder,
+                         const std::string& redpitayaHost,
+                         const std::string& redpitayaPassword,
+                         const std::string& redpitayaPrivateKeyPath,
+                         const std::string& restartCommand,
+                         uint64_t& deployedFingerprint,
+                         DetailsPanel& detailsPanel)
+    {
+        auto post = [&detailsPanel](const std::string& line)
+        {
+            Glib::signal_idle().connect_once([&detailsPanel, line]()
+            {
+                detailsPanel.append_log(line);
+            });
+        };
+        auto status = [&detailsPanel](const std::string& text)
+        {
+            Glib::signal_idle().connect_once([&detailsPanel, text]()
+            {
+                detailsPanel.set_status(text);
+            });
+        };
+
+        if (!FileManager::isValidQualiaModel(modelFolder))
+        {
+            post("Model folder changed but is incomplete; waiting for the next change.");
+            return;
+        }
+
+        uint64_t fingerprint = FileManager::fingerprintFolder(modelFolder);
+        if (fingerprint == deployedFingerprint)
+            return;
+
+        RemoteExportRecord record;
+        if (!ExportManager::lastRemoteExport(record))
+        {
+            post("Model changed, but there is no previous export to RedPitaya to repeat.");
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        post("Model changed (" + FileManager::toHex(fingerprint) + "): redeploying to " + record.targetDirectory + "...");
+        status("Redeploying...");
+
+        record.options.log = post;
+        for (const auto& version : record.versions)
+        {
+            if (!ExportManager::exportSingleVersionToRedPitaya(modelFolder, version, redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath,
+                                                               record.targetDirectory, cancelRedeploy, record.options))
+            {
+                post(cancelRedeploy ? "Redeploy canceled." : "Redeploy failed while exporting " + version + ".");
+                status(cancelRedeploy ? "Redeploy canceled" : "Redeploy failed");
+                return;
+            }
+        }
+
+        if (cancelRedeploy)
+        {
+            post("Redeploy canceled.");
+            status("Redeploy canceled");
+            return;
+        }
+
+        if (record.buildOnTarget)
+        {
+            auto results = BuildManager::buildVersionsOnRedPitaya(redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath,
+                                                                  record.targetDirectory, record.versions, post, cancelRedeploy);
+            for (const auto& result : results)
+            {
+                if (!result.success)
+                {
+                    post("Redeploy stopped: build failed for " + result.version + ".");
+                    status("Redeploy build failed");
+                    return;
+                }
+            }
+        }
+
+        if (!restartCommand.empty() && !cancelRedeploy)
+        {
+            int exitStatus = SSHManager::execute_remote_command_streamed(redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath,
+                                                                         restartCommand, post);
+            if (exitStatus != 0)
+                post("Restart command exited with status " + std::to_string(exitStatus) + ".");
+        }
+
+        deployedFingerprint = fingerprint;
+        std::ostringstream done;
+        done << "Redeployed " << record.versions.size() << " version(s) in " << std::fixed << std::setprecision(1)
+             << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s.";
+        post(done.str());
+        status("Redeployed");
+    }
+
+    void close(ModelWatcher& modelWatcher)
+    {
+        cancelRedeploy = true;
+        modelWatcher.requestStop();
+    }
+
+    void handle(Gtk::Window* parentWindow,
+                Gtk::CheckButton& checkWatchModel,
+                ModelWatcher& modelWatcher,
+                const std::string& modelFolder,
+                const std::string& redpitayaHost,
+                const std::string& redpitayaPassword,
+                const std::string& redpitayaPrivateKeyPath,
+                bool modelLoaded,
+                bool redpitayaConnected,
+                DetailsPanel& detailsPanel)
+    {
+        if (!checkWatchModel.get_active())
+        {
+            if (modelWatcher.running())
+            {
+                // Not joined here: a redeploy in progress stops at its next step, off the GUI thread.
+                cancelRedeploy = true;
+                modelWatcher.requestStop();
+                detailsPanel.append_log("Stopped watching " + modelWatcher.watchedFolder() + ".");
+            }
+            return;
+        }
+
+        RemoteExportRecord record;
+        if (!modelLoaded || !redpitayaConnected || !ExportManager::lastRemoteExport(record))
+        {
+            checkWatchModel.set_active(false);
+            showErrorDialog(parentWindow, "Nothing to redeploy yet.",
+                            "Load a model, connect to the RedPitaya and export once with 'Export to RedPitaya'. "
+                            "Changes to the model folder then repeat that export.");
+            return;
+        }
+
+        auto dialog = new Gtk::Dialog("Redeploy on model change", false);
+        dialog->set_transient_for(*parentWindow);
+        dialog->set_modal(true);
+        dialog->set_position(Gtk::WIN_POS_CENTER);
+        dialog->set_default_size(520, 120);
+
+        Gtk::Box *content = dialog->get_content_area();
+        auto label = Gtk::make_managed<Gtk::Label>("Repeat the last export (" + std::to_string(record.versions.size()) + " version(s) to " +
+                                                   record.targetDirectory + ") whenever the model folder changes.\n"
+                                                   "Optional command to restart the application on RedPitaya afterwards:");
+        auto entry = Gtk::make_managed<Gtk::Entry>();
+        entry->set_placeholder_text("e.g. killall app; cd " + record.targetDirectory + "/" + record.versions.front() +
+                                    " && nohup ./app > /dev/null 2>&1 &");
+        content->pack_start(*label, Gtk::PACK_SHRINK);
+        content->pack_start(*entry, Gtk::PACK_SHRINK);
+        dialog->add_button("_Cancel", Gtk::RESPONSE_CANCEL);
+        dialog->add_button("_Watch", Gtk::RESPONSE_OK);
+
+        dialog->signal_response().connect([dialog, entry, &checkWatchModel, &modelWatcher, modelFolder, redpitayaHost, redpitayaPassword,
+                                           redpitayaPrivateKeyPath, &detailsPanel](int response)
+        {
+            std::string restartCommand = entry->get_text();
+            dialog->hide();
+            delete dialog;
+
+            if (response != Gtk::RESPONSE_OK)
+            {
+                checkWatchModel.set_active(false);
+                return;
+            }
+
+            cancelRedeploy = false;
+            auto deployedFingerprint = std::make_shared<uint64_t>(FileManager::fingerprintFolder(modelFolder));
+            std::string error;
+            bool started = modelWatcher.start(modelFolder, 500, [modelFolder, redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath,
+                                                                 restartCommand, deployedFingerprint, &detailsPanel]()
+            {
+                redeploy(modelFolder, redpitayaHost, redpitayaPassword, redpitayaPrivateKeyPath, restartCommand,
+                         *deployedFingerprint, detailsPanel);
+            }, error);
+
+            if (!started)
+            {
+                detailsPanel.append_log("[Error] Cannot watch the model folder: " + error);
+                checkWatchModel.set_active(false);
+                return;
+            }
+            detailsPanel.append_log("Watching " + modelFolder + " for changes; each change repeats the last export.");
+        });
+
+        dialog->show_all();
+    }
+}